@@ -22,6 +22,15 @@ class SignedBuilder {
     var vm                      : VirtualMachine!
     var context                 : SignedContext!
     var alreadyRequired         : [String] = []
+    
+    /// The public modules every build starts with
+    let publicModules           = ["vec3", "vec2", "bbox", "command"]
+    
+    /// A VM with the libraries, print and the public modules loaded, cloned at the start of each build
+    var snapshot                : VirtualMachine? = nil
+    var snapshotModules         = Data()
+    var snapshotRequired        : [String] = []
+    var snapshotClones          = true
         
     var workItem                : DispatchWorkItem? = nil
     
@@ -542,7 +551,7 @@ class SignedBuilder {
     }
     
     /// Load and execute the givenessential  modules
-    func requireModules(_ inputs: [String]) {
+    func requireModules(_ inputs: [String], in vm: VirtualMachine) {
         
         let request = ModuleEntity.fetchRequest()
 
@@ -573,6 +582,103 @@ class SignedBuilder {
         }
     }
     
+    /// The code of the given modules, to know when the snapshot is out of date. Like requireModules() it uses the first module of each name
+    func modulesCode(_ names: [String]) -> Data {
+        
+        let request = ModuleEntity.fetchRequest()
+
+        let managedObjectContext = PersistenceController.shared.container.viewContext
+        let modules = try! managedObjectContext.fetch(request)
+        
+        var found : [String: Data] = [:]
+        modules.forEach { module in
+            if let name = module.name, let data = module.code {
+                if found[name] == nil {
+                    found[name] = data
+                }
+            }
+        }
+        
+        var code = Data()
+        
+        for name in Set(names).sorted() {
+            code.append(name.data(using: .utf8)!)
+            code.append(0)
+            if let data = found[name] {
+                code.append(data)
+            }
+            code.append(0)
+        }
+        return code
+    }
+    
+    /// Creates a VM with the libraries, print and the public modules loaded
+    func loadVirtualMachine() -> VirtualMachine {
+        
+        let vm = VirtualMachine()
+        
+        _ = vm.eval("""
+        
+        print = function(...)
+            local args = {...}
+            local printResult = ""
+            for i,v in ipairs(args) do
+                if i > 1 then
+                    printResult = printResult .. ", "
+                end
+                printResult = printResult .. tostring(v)
+            end
+            _print(printResult)
+        end
+        
+        """, args: [])
+        
+        // Modules may print or require each other while loading. Swift functions are bound to their VM, so they are removed afterwards; a module which keeps one makes the VM impossible to clone
+        vm.globals["_print"] = vm.createFunction([String.arg]) { args in
+            if args.values.isEmpty == false {
+                print(args.string)
+            }
+            return .nothing
+        }
+        
+        vm.globals["require"] = vm.createFunction([String.arg]) { [weak vm] args in
+            if let vm = vm, args.values.isEmpty == false {
+                self.requireModules([args.string], in: vm)
+            }
+            return .nothing
+        }
+        
+        alreadyRequired = []
+        requireModules(publicModules, in: vm)
+        
+        vm.globals["_print"] = Nil()
+        vm.globals["require"] = Nil()
+        return vm
+    }
+    
+    /// Returns the VM for a build, a clone of the snapshot VM which is only loaded again when the modules it holds change
+    func newVirtualMachine() -> VirtualMachine {
+        
+        // Also the private modules which the public ones required while loading, the snapshot holds them too
+        let code = modulesCode(publicModules + snapshotRequired)
+        
+        if snapshot == nil || code != snapshotModules {
+            snapshot = loadVirtualMachine()
+            snapshotRequired = alreadyRequired
+            snapshotModules = modulesCode(publicModules + snapshotRequired)
+            snapshotClones = true
+        }
+        
+        if snapshotClones, let vm = VirtualMachine(cloning: snapshot!) {
+            alreadyRequired = snapshotRequired
+            return vm
+        }
+        
+        // The snapshot cannot be cloned (a module kept a Swift function), load the modules into each VM until they change
+        snapshotClones = false
+        return loadVirtualMachine()
+    }
+    
     /// build 3D texture
     func build(code: String, kit: ModelerKit, content: ModelerKit.Content = .project, renderKits: [RenderKit], objectEntity: ObjectEntity? = nil, materialEntity: MaterialEntity? = nil) {
         
@@ -621,7 +727,7 @@ class SignedBuilder {
                 model.progressTotal = 0
             }
                     
-            self.vm = VirtualMachine()
+            self.vm = self.newVirtualMachine()
             self.context = SignedContext(model: model, kit: kit)
             self.context.addToPipeline(cmd: SignedCommand("Clear", role: .GeometryAndMaterial, action: .Clear))
             
@@ -641,35 +747,17 @@ class SignedBuilder {
                 }
                 return .nothing
             }
-            
-            _ = self.vm.eval("""
-            
-            print = function(...)
-                local args = {...}
-                local printResult = ""
-                for i,v in ipairs(args) do
-                    if i > 1 then
-                        printResult = printResult .. ", "
-                    end
-                    printResult = printResult .. tostring(v)
-                end
-                _print(printResult)
-            end
-            
-            """, args: [])
+
             // require
             self.vm.globals["require"] = self.vm.createFunction([String.arg]) { args in
                 if args.values.isEmpty == false {
                     let string = args.string
-                    self.requireModules([string])
+                    self.requireModules([string], in: self.vm)
                 }
                 return .nothing
             }
             
-            self.alreadyRequired = []
-            
-            // Auto require the basic public modules
-            self.requireModules(["vec3", "vec2", "bbox", "command"])
+            // The basic public modules are already loaded in the snapshot
             
             // If we build a project require the project modules first, these have priority over public modules
             //if kit.content == .project && kit.role == .main {
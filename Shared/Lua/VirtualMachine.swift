@@ -43,14 +43,22 @@ public enum Kind {
 
 open class VirtualMachine {
     
-    internal let vm = luaL_newstate()
+    internal let vm: OpaquePointer
 
     open var errorHandler: ErrorHandler? = { print("error: \($0)") }
     
     public init(openLibs: Bool = true) {
+        vm = luaL_newstate()
         if openLibs { luaL_openlibs(vm) }
     }
     
+    /// Starts as a copy of the snapshot VM, with its libraries, globals and loaded modules, which is much faster than loading them again.
+    /// Fails if the snapshot can reach a Swift function (these are bound to the VM which created them), a coroutine, an open file or a userdata without a `__clone` metamethod, or if memory runs out.
+    public init?(cloning snapshot: VirtualMachine) {
+        guard let state = luaL_clonestate(snapshot.vm) else { return nil }
+        vm = state
+    }
+    
     deinit {
         lua_close(vm)
     }
@@ -258,7 +266,9 @@ open class VirtualMachine {
         let imp = imp_implementationWithBlock(block)
         
         let fp = unsafeBitCast(imp, to: lua_CFunction.self)
-        lua_pushcclosure(vm, fp, 0)
+        // The block is bound to this VM. Its upvalue, a userdata without __clone, makes cloning fail for any VM which can still reach it
+        _ = lua_newuserdata(vm, 0)
+        lua_pushcclosure(vm, fp, 1)
         return popValue(-1) as! Function
     }
     
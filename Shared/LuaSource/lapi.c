@@ -20,6 +20,7 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
@@ -334,13 +335,20 @@ LUA_API int lua_compare (lua_State *L, int index1, int index2, int op) {
 
 
 LUA_API size_t lua_stringtonumber (lua_State *L, const char *s) {
-  size_t sz = luaO_str2num(s, L->top);
+  size_t sz = luaO_str2num(L, s, L->top);
   if (sz != 0)
     api_incr_top(L);
   return sz;
 }
 
 
+LUA_API int lua_formatfloat (lua_State *L, char *buff, lua_Number n,
+                             int conv, int prec) {
+  UNUSED(L);
+  return luaO_fmtfloat(buff, n, conv, prec);
+}
+
+
 LUA_API lua_Number lua_tonumberx (lua_State *L, int idx, int *pisnum) {
   lua_Number n;
   const TValue *o = index2addr(L, idx);
@@ -369,7 +377,11 @@ LUA_API int lua_toboolean (lua_State *L, int idx) {
 }
 
 
-LUA_API const char *lua_tolstring (lua_State *L, int idx, size_t *len) {
+/*
+** Like 'lua_tolstring', but a string view keeps sharing its bytes, which
+** are not followed by a '\0'
+*/
+LUA_API const char *lua_toview (lua_State *L, int idx, size_t *len) {
   StkId o = index2addr(L, idx);
   if (!ttisstring(o)) {
     if (!cvt2str(o)) {  /* not convertible? */
@@ -387,6 +399,23 @@ LUA_API const char *lua_tolstring (lua_State *L, int idx, size_t *len) {
 }
 
 
+LUA_API const char *lua_tolstring (lua_State *L, int idx, size_t *len) {
+  const char *s = lua_toview(L, idx, len);
+  if (s != NULL && isview(tsvalue(index2addr(L, idx)))) {
+    StkId o;
+    lua_lock(L);  /* replace the view by a copy, which ends with '\0' */
+    luaC_checkGC(L);
+    o = index2addr(L, idx);
+    setsvalue(L, o, luaS_materialize(L, tsvalue(o)));
+    if (isupvalue(idx))  /* function upvalue? */
+      luaC_barrier(L, clCvalue(L->ci->func), o);
+    s = svalue(o);
+    lua_unlock(L);
+  }
+  return s;
+}
+
+
 LUA_API size_t lua_rawlen (lua_State *L, int idx) {
   StkId o = index2addr(L, idx);
   switch (ttnov(o)) {
@@ -463,7 +492,7 @@ LUA_API void lua_pushnumber (lua_State *L, lua_Number n) {
 
 LUA_API void lua_pushinteger (lua_State *L, lua_Integer n) {
   lua_lock(L);
-  setivalue(L->top, n);
+  setivalue(L, L->top, n);
   api_incr_top(L);
   lua_unlock(L);
 }
@@ -481,6 +510,28 @@ LUA_API const char *lua_pushlstring (lua_State *L, const char *s, size_t len) {
 }
 
 
+/*
+** Pushes the 'len' bytes at offset 'i' of the string at index 'idx';
+** unless short, the result is a view sharing the bytes of that string.
+*/
+LUA_API const char *lua_pushview (lua_State *L, int idx, size_t i,
+                                                         size_t len) {
+  TString *ts;
+  StkId o;
+  lua_lock(L);
+  luaC_checkGC(L);
+  o = index2addr(L, idx);
+  api_check(ttisstring(o), "string expected");
+  api_check(i <= tsvalue(o)->len && len <= tsvalue(o)->len - i,
+            "invalid string range");
+  ts = luaS_newview(L, tsvalue(o), i, len);
+  setsvalue2s(L, L->top, ts);
+  api_incr_top(L);
+  lua_unlock(L);
+  return getstr(ts);
+}
+
+
 LUA_API const char *lua_pushstring (lua_State *L, const char *s) {
   if (s == NULL) {
     lua_pushnil(L);
@@ -616,7 +667,7 @@ LUA_API int lua_geti (lua_State *L, int idx, lua_Integer n) {
   StkId t;
   lua_lock(L);
   t = index2addr(L, idx);
-  setivalue(L->top, n);
+  setivalue(L, L->top, n);
   api_incr_top(L);
   luaV_gettable(L, t, L->top - 1, L->top - 1);
   lua_unlock(L);
@@ -674,6 +725,25 @@ LUA_API void lua_createtable (lua_State *L, int narray, int nrec) {
 }
 
 
+/*
+** pushes a copy of the table at 'idx', without its metatable (see
+** 'luaH_copy')
+*/
+LUA_API void lua_clonetable (lua_State *L, int idx) {
+  StkId o;
+  Table *t;
+  lua_lock(L);
+  luaC_checkGC(L);
+  o = index2addr(L, idx);
+  api_check(ttistable(o), "table expected");
+  t = luaH_new(L);
+  sethvalue(L, L->top, t);
+  api_incr_top(L);
+  luaH_copy(L, t, hvalue(o));
+  lua_unlock(L);
+}
+
+
 LUA_API int lua_getmetatable (lua_State *L, int objindex) {
   const TValue *obj;
   Table *mt;
@@ -759,7 +829,7 @@ LUA_API void lua_seti (lua_State *L, int idx, lua_Integer n) {
   lua_lock(L);
   api_checknelems(L, 1);
   t = index2addr(L, idx);
-  setivalue(L->top++, n);
+  setivalue(L, L->top++, n);
   luaV_settable(L, t, L->top - 1, L->top - 2);
   L->top -= 2;  /* pop value and key */
   lua_unlock(L);
@@ -854,6 +924,20 @@ LUA_API int lua_setmetatable (lua_State *L, int objindex) {
 }
 
 
+/*
+** removes all entries from the table at 'idx' (with no metamethods),
+** keeping the memory of the table for new entries
+*/
+LUA_API void lua_cleartable (lua_State *L, int idx) {
+  StkId o;
+  lua_lock(L);
+  o = index2addr(L, idx);
+  api_check(ttistable(o), "table expected");
+  luaH_clear(hvalue(o));
+  lua_unlock(L);
+}
+
+
 LUA_API void lua_setuservalue (lua_State *L, int idx) {
   StkId o;
   lua_lock(L);
@@ -1050,7 +1134,8 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
         luaC_checkGC(L);
       }
       g->gcrunning = oldrunning;  /* restore previous state */
-      if (debt > 0 && g->gcstate == GCSpause)  /* end of cycle? */
+      if (debt > 0 &&  /* end of cycle? (each generational step is one) */
+          (g->gcstate == GCSpause || g->gcmode == KGC_GEN))
         res = 1;  /* signal it */
       break;
     }
@@ -1069,6 +1154,33 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
       res = g->gcrunning;
       break;
     }
+    case LUA_GCSTRPAUSE: {  /* worst step resizing the string table */
+      res = g->strt.maxpause;
+      g->strt.maxpause = 0;
+      break;
+    }
+    case LUA_GCGEN: case LUA_GCINC: {  /* change mode; return old one */
+      res = (g->gcmode != KGC_INC) ? LUA_GCGEN : LUA_GCINC;
+      if (what == LUA_GCGEN && data != 0)  /* set minor multiplier? */
+        g->genminormul = (data > 100) ? 100 : data;
+      luaC_changemode(L, (what == LUA_GCGEN) ? KGC_GEN : KGC_INC);
+      break;
+    }
+    case LUA_GCSTEPTIME: {  /* maximum microseconds per step (0 = off) */
+      res = g->gcsteptime;
+      g->gcsteptime = (data > 0) ? data : 0;
+      break;
+    }
+    case LUA_GCOVERHEAD: {
+      res = g->gcoverhead;
+      g->gcoverhead = (data > 0) ? data : 0;
+      break;
+    }
+    case LUA_GCTIMING: {
+      res = g->gctiming;
+      g->gctiming = (data != 0);
+      break;
+    }
     default: res = -1;  /* invalid option */
   }
   lua_unlock(L);
@@ -1076,6 +1188,35 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
 }
 
 
+LUA_API void lua_gcstats (lua_State *L, lua_GCStats *st, int reset) {
+  lua_lock(L);
+  luaC_getstats(L, st, reset);
+  lua_unlock(L);
+}
+
+
+/*
+** JIT compiler control. Returns whether the compiler is on. Functions
+** already compiled keep their machine code, which runs only while the
+** compiler is on.
+*/
+LUA_API int lua_jit (lua_State *L, int what) {
+  global_State *g = G(L);
+  lua_lock(L);
+#if defined(LUAI_JIT)
+  switch (what) {
+    case LUA_JITOFF: g->jiton = 0; break;
+    case LUA_JITON: g->jiton = 1; break;
+    default: break;
+  }
+#else
+  UNUSED(what);  /* no compiler: always off */
+#endif
+  lua_unlock(L);
+  return g->jiton;
+}
+
+
 
 /*
 ** miscellaneous functions
@@ -1164,6 +1305,108 @@ LUA_API void *lua_newuserdata (lua_State *L, size_t size) {
 }
 
 
+/*
+** {======================================================
+** Typed arrays
+** =======================================================
+*/
+
+/* creates a typed array with room for 'size' bytes after its header */
+static TArray *newarray (lua_State *L, int kind, size_t n, size_t size) {
+  Udata *u;
+  TArray *a;
+  api_check(0 <= kind && kind < LUA_NUMAKINDS, "invalid array kind");
+  u = luaS_newudata(L, sizeof(TArray) + size);
+  u->metatable = G(L)->arraymt;  /* no barrier needed: 'u' is white */
+  setuvalue(L, L->top, u);
+  api_incr_top(L);
+  a = gettarray(u);
+  a->data = NULL;
+  a->n = n;
+  a->kind = kind;
+  return a;
+}
+
+
+/*
+** Pushes a new typed array with 'n' elements (all zeros) and returns its
+** elements. The array only works as such (for indexing, '#', methods)
+** after the array library sets its metatable.
+*/
+LUA_API void *lua_newarray (lua_State *L, int kind, size_t n) {
+  TArray *a;
+  size_t esize = lua_arrayelemsize(kind);
+  lua_lock(L);
+  luaC_checkGC(L);
+  if (n > (MAX_SIZE - sizeof(TArray)) / esize)
+    luaM_toobig(L);
+  a = newarray(L, kind, n, n * esize);
+  a->data = a + 1;
+  memset(a->data, 0, n * esize);
+  lua_unlock(L);
+  return a->data;
+}
+
+
+/*
+** Pushes a typed array over the 'n' elements at 'data', with no copy.
+** That memory stays owned by the caller, which must keep it valid while
+** the array (or a slice of it) is alive.
+*/
+LUA_API void lua_pusharray (lua_State *L, int kind, void *data, size_t n) {
+  lua_lock(L);
+  luaC_checkGC(L);
+  newarray(L, kind, n, 0)->data = data;
+  lua_unlock(L);
+}
+
+
+/*
+** Returns 1 if the value at 'idx' is a typed array. (A typed array from
+** 'lua_pusharray' with no elements can have NULL as its elements, so
+** 'lua_toarray' alone cannot tell.)
+*/
+LUA_API int lua_isarray (lua_State *L, int idx) {
+  StkId o = index2addr(L, idx);
+  return ttistarray(G(L), o);
+}
+
+
+/*
+** Returns the elements of the typed array at 'idx', with their kind and
+** number in '*kind' and '*n' (when not NULL), or NULL if that value is
+** not a typed array.
+*/
+LUA_API void *lua_toarray (lua_State *L, int idx, int *kind, size_t *n) {
+  StkId o = index2addr(L, idx);
+  TArray *a;
+  if (!ttistarray(G(L), o))
+    return NULL;
+  a = gettarray(uvalue(o));
+  if (kind) *kind = a->kind;
+  if (n) *n = a->n;
+  return a->data;
+}
+
+
+/*
+** Pops a table (or nil) and sets it as the metatable of typed arrays,
+** which the VM then indexes without calling metamethods (see 'lvm.c').
+** New arrays get this metatable.
+*/
+LUA_API void lua_setarraymetatable (lua_State *L) {
+  lua_lock(L);
+  api_checknelems(L, 1);
+  api_check(ttisnil(L->top - 1) || ttistable(L->top - 1),
+            "table expected");
+  G(L)->arraymt = ttisnil(L->top - 1) ? NULL : hvalue(L->top - 1);
+  L->top--;
+  lua_unlock(L);
+}
+
+/* }====================================================== */
+
+
 
 static const char *aux_upvalue (StkId fi, int n, TValue **val,
                                 CClosure **owner, UpVal **uv) {
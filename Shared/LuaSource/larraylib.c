@@ -0,0 +1,373 @@
+/*
+** $Id: larraylib.c $
+** Typed arrays (contiguous arrays of numbers)
+** See Copyright Notice in lua.h
+*/
+
+#define larraylib_c
+#define LUA_LIB
+
+#include "lprefix.h"
+
+
+#include <limits.h>
+#include <string.h>
+
+#include "lua.h"
+
+#include "lauxlib.h"
+#include "lualib.h"
+
+
+/*
+** Typed arrays are userdata holding C arrays of one of the kinds below
+** (see 'lua_newarray'). The VM itself reads and writes 'a[i]' for integer
+** keys and computes '#a'; this library gives them their metatable, with
+** the metamethods for the other cases and the methods.
+*/
+
+
+#define ARRAYTYPE	"array"
+
+
+static const char *const kindnames[] = {
+  "float64", "float32", "int32", "uint8", NULL
+};
+
+
+static char *checkarray (lua_State *L, int arg, int *kind, size_t *n) {
+  if (!lua_isarray(L, arg))
+    luaL_checkudata(L, arg, ARRAYTYPE);  /* raise the error */
+  return (char *)lua_toarray(L, arg, kind, n);
+}
+
+
+/* translate a relative position: negative means back from end */
+static lua_Integer posrelat (lua_Integer pos, size_t len) {
+  if (pos >= 0) return pos;
+  else if (0u - (size_t)pos > len) return 0;
+  else return (lua_Integer)len + pos + 1;
+}
+
+
+/*
+** Gets the range given by the optional arguments 'arg' and 'arg + 1'
+** (as in 'string.sub'), clipped to the 'n' elements of an array. Returns
+** the number of elements in it, with its first (0-based) in '*first'.
+*/
+static size_t getrange (lua_State *L, int arg, size_t n, size_t *first) {
+  lua_Integer i = posrelat(luaL_optinteger(L, arg, 1), n);
+  lua_Integer j = posrelat(luaL_optinteger(L, arg + 1, -1), n);
+  if (i < 1) i = 1;
+  if (j > (lua_Integer)n) j = (lua_Integer)n;
+  *first = (size_t)i - 1;
+  return (i > j) ? 0 : (size_t)(j - i) + 1;
+}
+
+
+static void pushelem (lua_State *L, const char *p, int kind, size_t i) {
+  switch (kind) {
+    case LUA_AFLOAT64: lua_pushnumber(L, (lua_Number)((const double *)p)[i]);
+      break;
+    case LUA_AFLOAT32: lua_pushnumber(L, (lua_Number)((const float *)p)[i]);
+      break;
+    case LUA_AINT32: lua_pushinteger(L, ((const int *)p)[i]);
+      break;
+    default: lua_pushinteger(L, ((const unsigned char *)p)[i]);
+      break;
+  }
+}
+
+
+/*
+** Stores the number at 'idx' in element 'i', as the VM does (integer
+** elements get integral numbers modulo 2^bits). Returns 0 if that value
+** cannot go to the array.
+*/
+static int setelem (lua_State *L, char *p, int kind, size_t i, int idx) {
+  int isnum;
+  if (kind == LUA_AFLOAT64 || kind == LUA_AFLOAT32) {
+    lua_Number x = lua_tonumberx(L, idx, &isnum);
+    if (!isnum) return 0;
+    if (kind == LUA_AFLOAT64) ((double *)p)[i] = (double)x;
+    else ((float *)p)[i] = (float)x;
+  }
+  else {
+    lua_Integer x = lua_tointegerx(L, idx, &isnum);
+    if (!isnum) return 0;
+    if (kind == LUA_AINT32) ((int *)p)[i] = (int)(unsigned int)x;
+    else ((unsigned char *)p)[i] = (unsigned char)x;
+  }
+  return 1;
+}
+
+
+/* stores argument 'arg' in element 'i', raising an error if it cannot */
+static void checkelem (lua_State *L, char *p, int kind, size_t i, int arg) {
+  if (!setelem(L, p, kind, i, arg)) {
+    if (lua_type(L, arg) == LUA_TNUMBER)
+      luaL_argerror(L, arg, "number has no integer representation");
+    luaL_checknumber(L, arg);  /* raise the error */
+  }
+}
+
+
+static int arr_new (lua_State *L) {
+  int kind = luaL_checkoption(L, 1, NULL, kindnames);
+  if (lua_type(L, 2) == LUA_TTABLE) {  /* array with the items of a list? */
+    size_t i;
+    size_t n = (size_t)luaL_len(L, 2);
+    char *p = (char *)lua_newarray(L, kind, n);
+    for (i = 0; i < n; i++) {
+      lua_geti(L, 2, (lua_Integer)i + 1);
+      if (!setelem(L, p, kind, i, -1))
+        return luaL_error(L, "invalid value (%s) at index %d in table for "
+                          "'new'", luaL_typename(L, -1), (int)i + 1);
+      lua_pop(L, 1);
+    }
+  }
+  else {
+    lua_Integer n = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, n >= 0, 2, "invalid size");
+    lua_newarray(L, kind, (size_t)n);
+  }
+  return 1;
+}
+
+
+/* array with the bytes of a string (as written by 'tobytes') */
+static int arr_frombytes (lua_State *L) {
+  int kind = luaL_checkoption(L, 1, NULL, kindnames);
+  size_t l;
+  const char *s = luaL_checklstring(L, 2, &l);
+  size_t esize = lua_arrayelemsize(kind);
+  luaL_argcheck(L, l % esize == 0, 2,
+                   "length is not a multiple of the element size");
+  memcpy(lua_newarray(L, kind, l / esize), s, l);
+  return 1;
+}
+
+
+static int arr_type (lua_State *L) {
+  int kind;
+  luaL_checkany(L, 1);
+  if (luaL_testudata(L, 1, ARRAYTYPE)) {
+    lua_toarray(L, 1, &kind, NULL);
+    lua_pushstring(L, kindnames[kind]);
+  }
+  else
+    lua_pushnil(L);  /* not an array */
+  return 1;
+}
+
+
+/*
+** array.move(a1, f, e, t [,a2]): copies a1[f..e] to a2[t..] (a2 defaults
+** to a1), as 'table.move'; both ranges must be inside their arrays.
+*/
+static int arr_move (lua_State *L) {
+  int k1, k2;
+  size_t n1, n2;
+  char *p1 = checkarray(L, 1, &k1, &n1);
+  lua_Integer f = luaL_checkinteger(L, 2);
+  lua_Integer e = luaL_checkinteger(L, 3);
+  lua_Integer t = luaL_checkinteger(L, 4);
+  int tt = !lua_isnoneornil(L, 5) ? 5 : 1;  /* destination array */
+  char *p2 = checkarray(L, tt, &k2, &n2);
+  if (e >= f) {  /* otherwise, nothing to move */
+    size_t i, count;
+    luaL_argcheck(L, f > 0 && e <= (lua_Integer)n1, 3,
+                     "range out of bounds");
+    count = (size_t)(e - f) + 1;
+    luaL_argcheck(L, t > 0 && count <= n2 && (size_t)(t - 1) <= n2 - count, 4,
+                     "destination out of bounds");
+    if (k1 == k2) {
+      size_t esize = lua_arrayelemsize(k1);
+      memmove(p2 + (t - 1) * esize, p1 + (f - 1) * esize, count * esize);
+    }
+    else {  /* convert each element */
+      for (i = 0; i < count; i++) {
+        pushelem(L, p1, k1, (size_t)f - 1 + i);
+        if (!setelem(L, p2, k2, (size_t)t - 1 + i, -1))
+          return luaL_error(L, "number has no integer representation");
+        lua_pop(L, 1);
+      }
+    }
+  }
+  lua_pushvalue(L, tt);  /* return destination array */
+  return 1;
+}
+
+
+/* a:fill(v [, i [, j]]) */
+static int arr_fill (lua_State *L) {
+  int kind;
+  size_t n, i, first;
+  char *p = checkarray(L, 1, &kind, &n);
+  size_t count = getrange(L, 3, n, &first);
+  if (count > 0) {
+    checkelem(L, p, kind, first, 2);  /* set first element ... */
+    switch (kind) {  /* ... and copy it to the others */
+      case LUA_AFLOAT64: {
+        double *e = (double *)p + first;
+        for (i = 1; i < count; i++) e[i] = e[0];
+        break;
+      }
+      case LUA_AFLOAT32: {
+        float *e = (float *)p + first;
+        for (i = 1; i < count; i++) e[i] = e[0];
+        break;
+      }
+      case LUA_AINT32: {
+        int *e = (int *)p + first;
+        for (i = 1; i < count; i++) e[i] = e[0];
+        break;
+      }
+      default: {
+        memset(p + first, p[first], count);
+        break;
+      }
+    }
+  }
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* a:slice([i [, j]]): array sharing the elements a[i..j] */
+static int arr_slice (lua_State *L) {
+  int kind;
+  size_t n, first;
+  char *p = checkarray(L, 1, &kind, &n);
+  size_t count = getrange(L, 2, n, &first);
+  lua_pusharray(L, kind, p + first * lua_arrayelemsize(kind), count);
+  lua_pushvalue(L, 1);
+  lua_setuservalue(L, -2);  /* the slice keeps its array alive */
+  return 1;
+}
+
+
+/* a:tobytes([i [, j]]): the memory of a[i..j] as a string */
+static int arr_tobytes (lua_State *L) {
+  int kind;
+  size_t n, first;
+  char *p = checkarray(L, 1, &kind, &n);
+  size_t count = getrange(L, 2, n, &first);
+  size_t esize = lua_arrayelemsize(kind);
+  lua_pushlstring(L, p + first * esize, count * esize);
+  return 1;
+}
+
+
+static int arr_totable (lua_State *L) {
+  int kind;
+  size_t n, first, i;
+  char *p = checkarray(L, 1, &kind, &n);
+  size_t count = getrange(L, 2, n, &first);
+  luaL_argcheck(L, count < (size_t)INT_MAX, 1, "too many elements");
+  lua_createtable(L, (int)count, 0);
+  for (i = 0; i < count; i++) {
+    pushelem(L, p, kind, first + i);
+    lua_rawseti(L, -2, (lua_Integer)i + 1);
+  }
+  return 1;
+}
+
+
+/*
+** Metamethods: the VM handles integer keys and '#' itself; these handle
+** float keys with integral values and give the methods.
+*/
+
+static int arr_index (lua_State *L) {
+  int kind;
+  size_t n;
+  char *p = checkarray(L, 1, &kind, &n);
+  if (lua_type(L, 2) == LUA_TNUMBER) {
+    int isint;
+    lua_Integer i = lua_tointegerx(L, 2, &isint);
+    if (isint && 1 <= i && (size_t)i <= n)
+      pushelem(L, p, kind, (size_t)i - 1);
+    else
+      lua_pushnil(L);
+  }
+  else {
+    lua_settop(L, 2);
+    lua_rawget(L, lua_upvalueindex(1));  /* method */
+  }
+  return 1;
+}
+
+
+static int arr_newindex (lua_State *L) {
+  int kind;
+  size_t n;
+  char *p = checkarray(L, 1, &kind, &n);
+  int isint;
+  lua_Integer i = lua_tointegerx(L, 2, &isint);
+  luaL_argcheck(L, isint && lua_type(L, 2) == LUA_TNUMBER, 2,
+                   "invalid key to array");
+  luaL_argcheck(L, 1 <= i && (size_t)i <= n, 2, "array index out of range");
+  checkelem(L, p, kind, (size_t)i - 1, 3);
+  return 0;
+}
+
+
+static int arr_len (lua_State *L) {
+  size_t n;
+  checkarray(L, 1, NULL, &n);
+  lua_pushinteger(L, (lua_Integer)n);
+  return 1;
+}
+
+
+static int arr_tostring (lua_State *L) {
+  int kind;
+  size_t n;
+  checkarray(L, 1, &kind, &n);
+  lua_pushfstring(L, "%s array (%I): %p", kindnames[kind], (lua_Integer)n,
+                     lua_topointer(L, 1));
+  return 1;
+}
+
+
+static const luaL_Reg arr_funcs[] = {
+  {"new", arr_new},
+  {"frombytes", arr_frombytes},
+  {"type", arr_type},
+  {"move", arr_move},
+  {NULL, NULL}
+};
+
+
+static const luaL_Reg arr_methods[] = {
+  {"fill", arr_fill},
+  {"slice", arr_slice},
+  {"tobytes", arr_tobytes},
+  {"totable", arr_totable},
+  {"move", arr_move},
+  {NULL, NULL}
+};
+
+
+static const luaL_Reg arr_meta[] = {
+  {"__newindex", arr_newindex},
+  {"__len", arr_len},
+  {"__tostring", arr_tostring},
+  {NULL, NULL}
+};
+
+
+LUAMOD_API int luaopen_array (lua_State *L) {
+  luaL_newlib(L, arr_funcs);
+  luaL_newmetatable(L, ARRAYTYPE);
+  luaL_setfuncs(L, arr_meta, 0);
+  luaL_newlib(L, arr_methods);
+  lua_pushcclosure(L, arr_index, 1);  /* methods are its upvalue */
+  lua_setfield(L, -2, "__index");
+  lua_pushvalue(L, -1);
+  lua_setarraymetatable(L);  /* the VM must know the metatable */
+  lua_pop(L, 1);  /* pop metatable */
+  return 1;
+}
+
@@ -7,6 +7,14 @@
 #define lauxlib_c
 #define LUA_LIB
 
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE  /* for MAP_ANONYMOUS */
+#endif
+
+#if !defined(_DARWIN_C_SOURCE)
+#define _DARWIN_C_SOURCE  /* for MAP_ANON in macOS */
+#endif
+
 #include "lprefix.h"
 
 
@@ -440,8 +448,91 @@ LUALIB_API lua_Integer luaL_optinteger (lua_State *L, int arg,
 ** =======================================================
 */
 
+/* minimum size for a buffer block */
+#define MINBUFFSIZE	32
+
+
+/*
+** new size for a buffer of 'size' bytes, 'n' of them in use, that needs
+** 'sz' more: buffers grow geometrically (doubling), so that adding
+** bytes one piece at a time takes amortized constant time
+*/
+static size_t newbuffsize (lua_State *L, size_t size, size_t n, size_t sz) {
+  size_t newsize = size * 2;  /* double buffer size */
+  if (newsize < MINBUFFSIZE)
+    newsize = MINBUFFSIZE;
+  if (newsize - n < sz)  /* not big enough? */
+    newsize = n + sz;
+  if (newsize < n || newsize - n < sz || newsize < size)
+    luaL_error(L, "buffer too large");
+  return newsize;
+}
+
+
+/*
+** Resizes block 'b' (with '*size' bytes, the first 'n' in use; NULL
+** when '*size' is 0) with the state allocator, so that it has at least
+** 'sz' free bytes, and updates '*size'. Both 'luaL_Buffer' and string
+** buffers grow through here.
+*/
+LUALIB_API char *luaL_growbuffer (lua_State *L, char *b, size_t n,
+                                  size_t *size, size_t sz) {
+  void *ud;
+  lua_Alloc allocf = lua_getallocf(L, &ud);
+  size_t newsize = newbuffsize(L, *size, n, sz);
+  char *newb = (char *)allocf(ud, b, *size, newsize);
+  if (newb == NULL)  /* allocation failed? ('b' is still valid) */
+    luaL_error(L, "not enough memory for buffer allocation");
+  *size = newsize;
+  return newb;
+}
+
+
+/*
+** A 'luaL_Buffer' that outgrows its initial space moves to a "box", a
+** userdata on the stack holding a block from 'luaL_growbuffer'. The
+** block is freed when the buffer ends (or by the box finalizer, after
+** an error), so growing leaves no old copies as garbage.
+*/
+typedef struct UBox {
+  char *box;
+  size_t bsize;
+} UBox;
+
+
+static void freebox (lua_State *L, int idx) {
+  UBox *box = (UBox *)lua_touserdata(L, idx);
+  if (box->box != NULL) {
+    void *ud;
+    lua_Alloc allocf = lua_getallocf(L, &ud);
+    allocf(ud, box->box, box->bsize, 0);
+    box->box = NULL;
+    box->bsize = 0;
+  }
+}
+
+
+static int boxgc (lua_State *L) {
+  freebox(L, 1);
+  return 0;
+}
+
+
+static UBox *newbox (lua_State *L) {
+  UBox *box = (UBox *)lua_newuserdata(L, sizeof(UBox));
+  box->box = NULL;
+  box->bsize = 0;
+  if (luaL_newmetatable(L, "_UBOX*")) {  /* creating metatable? */
+    lua_pushcfunction(L, boxgc);
+    lua_setfield(L, -2, "__gc");
+  }
+  lua_setmetatable(L, -2);
+  return box;
+}
+
+
 /*
-** check whether buffer is using a userdata on the stack as a temporary
+** check whether buffer is using a box on the stack as a temporary
 ** buffer
 */
 #define buffonstack(B)	((B)->b != (B)->initb)
@@ -453,20 +544,19 @@ LUALIB_API lua_Integer luaL_optinteger (lua_State *L, int arg,
 LUALIB_API char *luaL_prepbuffsize (luaL_Buffer *B, size_t sz) {
   lua_State *L = B->L;
   if (B->size - B->n < sz) {  /* not enough space? */
-    char *newbuff;
-    size_t newsize = B->size * 2;  /* double buffer size */
-    if (newsize - B->n < sz)  /* not big enough? */
-      newsize = B->n + sz;
-    if (newsize < B->n || newsize - B->n < sz)
-      luaL_error(L, "buffer too large");
-    /* create larger buffer */
-    newbuff = (char *)lua_newuserdata(L, newsize * sizeof(char));
-    /* move content to new buffer */
-    memcpy(newbuff, B->b, B->n * sizeof(char));
-    if (buffonstack(B))
-      lua_remove(L, -2);  /* remove old buffer */
-    B->b = newbuff;
-    B->size = newsize;
+    UBox *box;
+    if (buffonstack(B)) {
+      box = (UBox *)lua_touserdata(L, -1);
+      B->b = luaL_growbuffer(L, box->box, B->n, &box->bsize, sz);
+    }
+    else {  /* move content from the initial buffer to a new box */
+      size_t newsize = newbuffsize(L, B->size, B->n, sz);
+      box = newbox(L);
+      B->b = luaL_growbuffer(L, NULL, 0, &box->bsize, newsize);
+      memcpy(B->b, B->initb, B->n * sizeof(char));
+    }
+    box->box = B->b;
+    B->size = box->bsize;
   }
   return &B->b[B->n];
 }
@@ -487,8 +577,10 @@ LUALIB_API void luaL_addstring (luaL_Buffer *B, const char *s) {
 LUALIB_API void luaL_pushresult (luaL_Buffer *B) {
   lua_State *L = B->L;
   lua_pushlstring(L, B->b, B->n);
-  if (buffonstack(B))
-    lua_remove(L, -2);  /* remove old buffer */
+  if (buffonstack(B)) {
+    freebox(L, -2);  /* free its block now */
+    lua_remove(L, -2);  /* remove box */
+  }
 }
 
 
@@ -498,6 +590,21 @@ LUALIB_API void luaL_pushresultsize (luaL_Buffer *B, size_t sz) {
 }
 
 
+/*
+** ends a buffer without pushing its contents (for callers that copy
+** them somewhere else), freeing and removing its box, if any
+*/
+LUALIB_API void luaL_buffclose (luaL_Buffer *B) {
+  if (buffonstack(B)) {
+    freebox(B->L, -1);
+    lua_pop(B->L, 1);  /* remove box */
+  }
+  B->b = B->initb;
+  B->n = 0;
+  B->size = LUAL_BUFFERSIZE;
+}
+
+
 LUALIB_API void luaL_addvalue (luaL_Buffer *B) {
   lua_State *L = B->L;
   size_t l;
@@ -939,6 +1046,408 @@ LUALIB_API const char *luaL_gsub (lua_State *L, const char *s, const char *p,
 }
 
 
+/*
+** {======================================================
+** Default allocator
+** =======================================================
+*/
+
+#if defined(LUA_USE_POSIX) && !defined(LUA_NOSLAB)	/* { */
+
+/*
+** Slab allocator. Each state has its own heap, where small blocks
+** live in pages holding blocks of a single size. The size classes
+** fit the usual Lua objects: multiples of 8 bytes up to 128 (short
+** strings, closures, upvalues, tables, 'CallInfo's and small node
+** vectors) and of 16 bytes up to SLABMAX. As Lua always gives the
+** size of a block it reallocates or frees, small blocks need no
+** header: the class comes from the size, and the page from the
+** address, as pages are aligned to their size. A state is never used
+** by two threads at the same time, so the heap needs no locks. Larger
+** blocks go to 'realloc', or straight to 'mmap' from SLABMMAPMIN bytes
+** on, and have a header telling which. A page that becomes empty goes
+** back to the system, unless it is the only one in its class with free
+** blocks. The whole heap goes away with the block holding the state,
+** which is the last one freed by 'lua_close'. Define LUA_NOSLAB to use
+** only 'realloc'.
+*/
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+
+
+#define SLABPAGE	(64 * 1024)	/* size (and alignment) of a page */
+#define SLABCHUNK	16	/* pages mapped at a time */
+#define SLABMAX		256	/* largest block kept in pages */
+#define NSLABCLASS	(128 / 8 + (SLABMAX - 128) / 16)
+
+/* blocks with at least this size get their own mapping */
+#if !defined(SLABMMAPMIN)
+#define SLABMMAPMIN	(128 * 1024)
+#endif
+
+/* size class for a block with 'sz' bytes (0 < sz <= SLABMAX) */
+#define sizeclass(sz)  \
+	((sz) <= 128 ? (int)(((sz) + 7) / 8) - 1 \
+	             : 128 / 8 + (int)(((sz) - 128 + 15) / 16) - 1)
+
+#define classsize(c)	((c) < 16 ? ((c) + 1) * 8 : 128 + ((c) - 15) * 16)
+
+/* kinds of blocks */
+#define BSLAB	0
+#define BMALLOC	1
+#define BMMAP	2
+
+#define blockkind(sz)  \
+	((sz) <= SLABMAX ? BSLAB : (sz) < SLABMMAPMIN ? BMALLOC : BMMAP)
+
+
+/*
+** Header of blocks from 'malloc' and mappings. A shrink that cannot
+** get a block of the kind of its new size keeps the block where it
+** is (Lua never expects a shrink to fail), so the header keeps the
+** real kind. Such a block that ends with at most SLABMAX bytes (a
+** "stray") also goes to a list of the heap, as its size alone would
+** make it a slab block.
+*/
+typedef struct BigHead {
+  struct BigHead *next;  /* next stray */
+  size_t mapped;  /* bytes mapped, or 0 for a block from 'malloc' */
+} BigHead;
+
+#define BIGHEAD		((sizeof(BigHead) + 15) & ~(size_t)15)
+
+#define headof(b)	((BigHead *)((char *)(b) - BIGHEAD))
+
+
+/*
+** For the tests (see tests/run.sh): while 'luai_allocfail' is not
+** zero, every new block fails
+*/
+#if defined(LUAI_ALLOCFAIL)
+int luai_allocfail = 0;
+#define allocfail()	(luai_allocfail != 0)
+#else
+#define allocfail()	0
+#endif
+
+
+typedef struct SlabPage {
+  struct SlabPage *next, *prev;  /* circular list of pages of a class */
+  void *free;  /* list of free blocks */
+  char *bump;  /* first block never used */
+  int used;  /* number of blocks in use */
+  int nblocks;  /* number of blocks in the page */
+  int cls;  /* size class */
+} SlabPage;
+
+/* offset of the first block in a page */
+#define SLABHEAD	((sizeof(SlabPage) + 15) & ~(size_t)15)
+
+#define pageof(b)  \
+	((SlabPage *)((size_t)(b) & ~(size_t)(SLABPAGE - 1)))
+
+#define isfull(p)	((p)->used == (p)->nblocks)
+
+
+/*
+** Pages of each class form a circular list whose head is a page with
+** free blocks (if there is any): pages that fill up move to the end.
+*/
+typedef struct SlabHeap {
+  SlabPage *pages[NSLABCLASS];
+  char *spare;  /* pages mapped but not used yet */
+  int nspare;  /* number of pages in 'spare' */
+  BigHead *strays;  /* list of strays */
+  void *state;  /* block holding the Lua state */
+} SlabHeap;
+
+
+static void linkpage (SlabHeap *h, SlabPage *p, int athead) {
+  SlabPage *head = h->pages[p->cls];
+  if (head == NULL)
+    h->pages[p->cls] = p->next = p->prev = p;
+  else {  /* insert it before 'head' (which is the end of the list) */
+    p->next = head;
+    p->prev = head->prev;
+    head->prev->next = p;
+    head->prev = p;
+    if (athead) h->pages[p->cls] = p;
+  }
+}
+
+
+static void unlinkpage (SlabHeap *h, SlabPage *p) {
+  if (p->next == p)  /* only page? */
+    h->pages[p->cls] = NULL;
+  else {
+    p->prev->next = p->next;
+    p->next->prev = p->prev;
+    if (h->pages[p->cls] == p)
+      h->pages[p->cls] = p->next;
+  }
+}
+
+
+/*
+** Maps SLABCHUNK pages at once, aligned to SLABPAGE. Each page can
+** later be unmapped by itself.
+*/
+static int mapchunk (SlabHeap *h) {
+  size_t size = SLABCHUNK * SLABPAGE;
+  char *m = (char *)mmap(NULL, size + SLABPAGE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  char *a;
+  if (m == (char *)MAP_FAILED)
+    return 0;
+  a = (char *)(((size_t)m + SLABPAGE - 1) & ~(size_t)(SLABPAGE - 1));
+  if (a != m)  /* trim the excess before and after the aligned part */
+    munmap(m, a - m);
+  munmap(a + size, (m + size + SLABPAGE) - (a + size));
+  h->spare = a;
+  h->nspare = SLABCHUNK;
+  return 1;
+}
+
+
+static SlabPage *newpage (SlabHeap *h, int c) {
+  SlabPage *p;
+  if (h->nspare == 0 && !mapchunk(h))
+    return NULL;
+  p = (SlabPage *)h->spare;
+  h->spare += SLABPAGE;
+  h->nspare--;
+  p->free = NULL;
+  p->bump = (char *)p + SLABHEAD;
+  p->used = 0;
+  p->nblocks = (int)((SLABPAGE - SLABHEAD) / classsize(c));
+  p->cls = c;
+  linkpage(h, p, 1);
+  return p;
+}
+
+
+static void *slaballoc (SlabHeap *h, size_t sz) {
+  int c = sizeclass(sz);
+  SlabPage *p = h->pages[c];
+  void *b;
+  if (p == NULL || isfull(p)) {  /* no free blocks in this class? */
+    p = newpage(h, c);
+    if (p == NULL) return NULL;
+  }
+  if (p->free != NULL) {  /* reuse a free block */
+    b = p->free;
+    p->free = *(void **)b;
+  }
+  else {  /* take a new block */
+    b = p->bump;
+    p->bump += classsize(c);
+  }
+  if (++p->used == p->nblocks)  /* page is full? */
+    h->pages[c] = p->next;  /* move it to the end of the list */
+  return b;
+}
+
+
+static void slabfree (SlabHeap *h, void *b) {
+  SlabPage *p = pageof(b);
+  *(void **)b = p->free;
+  p->free = b;
+  if (isfull(p)) {  /* page was full? */
+    p->used--;
+    unlinkpage(h, p);
+    linkpage(h, p, 1);  /* it has free blocks now */
+  }
+  else if (--p->used == 0) {  /* page is empty? */
+    SlabPage *head = h->pages[p->cls];
+    SlabPage *other = (head != p) ? head : p->next;
+    if (other != p && !isfull(other)) {  /* other page has room? */
+      unlinkpage(h, p);
+      munmap(p, SLABPAGE);
+    }
+  }
+}
+
+
+/* removes 'bh' from the strays; returns whether it was there */
+static int unlinkstray (SlabHeap *h, BigHead *bh) {
+  BigHead **p;
+  for (p = &h->strays; *p != NULL; p = &(*p)->next) {
+    if (*p == bh) {
+      *p = bh->next;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+/* kind of block 'b' with 'sz' bytes */
+static int kindof (SlabHeap *h, void *b, size_t sz) {
+  if (sz <= SLABMAX) {
+    BigHead *bh;
+    for (bh = h->strays; bh != NULL; bh = bh->next) {
+      if (bh == headof(b))
+        return (bh->mapped == 0) ? BMALLOC : BMMAP;
+    }
+    return BSLAB;
+  }
+  return (headof(b)->mapped == 0) ? BMALLOC : BMMAP;
+}
+
+
+static void *blockalloc (SlabHeap *h, size_t sz) {
+  BigHead *bh;
+  if (allocfail())
+    return NULL;
+  switch (blockkind(sz)) {
+    case BSLAB: return slaballoc(h, sz);
+    case BMALLOC: {
+      bh = (BigHead *)malloc(BIGHEAD + sz);
+      if (bh == NULL) return NULL;
+      bh->mapped = 0;
+      break;
+    }
+    default: {
+      bh = (BigHead *)mmap(NULL, BIGHEAD + sz, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (bh == (BigHead *)MAP_FAILED) return NULL;
+      bh->mapped = BIGHEAD + sz;
+      break;
+    }
+  }
+  return (char *)bh + BIGHEAD;
+}
+
+
+static void blockfree (SlabHeap *h, void *b, size_t sz) {
+  BigHead *bh = headof(b);
+  if (sz <= SLABMAX && !unlinkstray(h, bh))
+    slabfree(h, b);
+  else if (bh->mapped == 0)
+    free(bh);
+  else
+    munmap(bh, bh->mapped);
+}
+
+
+/*
+** Resizes in place a block from 'malloc' (with 'realloc') or a mapping
+** (only shrinking, by unmapping its tail), keeping its kind. Fails
+** only when growing.
+*/
+static void *bigresize (SlabHeap *h, void *b, size_t osize, size_t nsize) {
+  BigHead *bh = headof(b);
+  if (osize <= SLABMAX)
+    unlinkstray(h, bh);  /* (it may move or grow) */
+  if (bh->mapped == 0) {
+    BigHead *nbh = (BigHead *)realloc(bh, BIGHEAD + nsize);
+    if (nbh != NULL)
+      bh = nbh;
+    else if (nsize > osize) {  /* growing failed? */
+      nsize = osize;  /* block stays as it was */
+      b = NULL;
+    }
+  }
+  else {
+    size_t pg = (size_t)sysconf(_SC_PAGESIZE);
+    size_t keep = (BIGHEAD + nsize + pg - 1) & ~(pg - 1);  /* whole pages */
+    if (bh->mapped > keep) {
+      munmap((char *)bh + keep, bh->mapped - keep);  /* unmap the rest */
+      bh->mapped = keep;
+    }
+  }
+  if (nsize <= SLABMAX) {  /* a stray now? */
+    bh->next = h->strays;
+    h->strays = bh;
+  }
+  return (b == NULL) ? NULL : (char *)bh + BIGHEAD;
+}
+
+
+static void freeheap (SlabHeap *h) {
+  int c;
+  for (c = 0; c < NSLABCLASS; c++) {
+    SlabPage *p = h->pages[c];
+    if (p != NULL) {
+      p->prev->next = NULL;  /* break the circle */
+      while (p != NULL) {
+        SlabPage *next = p->next;
+        munmap(p, SLABPAGE);
+        p = next;
+      }
+    }
+  }
+  if (h->nspare > 0)
+    munmap(h->spare, h->nspare * SLABPAGE);
+  free(h);
+}
+
+
+static void *l_alloc (void *ud, void *ptr, size_t osize, size_t nsize) {
+  SlabHeap *h = (SlabHeap *)ud;
+  int okind, nkind;
+  void *newb;
+  if (ptr == NULL) {  /* new block */
+    if (nsize == 0) return NULL;
+    newb = blockalloc(h, nsize);
+    if (h->state == NULL) {  /* first block is the state */
+      if (newb == NULL)  /* 'lua_newstate' will fail */
+        freeheap(h);
+      else
+        h->state = newb;
+    }
+    return newb;
+  }
+  if (nsize == 0) {
+    int closing = (ptr == h->state);  /* freeing the state? */
+    blockfree(h, ptr, osize);
+    if (closing)
+      freeheap(h);  /* all blocks are free now */
+    return NULL;
+  }
+  okind = kindof(h, ptr, osize);
+  nkind = blockkind(nsize);
+  if (okind == BSLAB) {
+    if (nsize <= osize ||
+        (nkind == BSLAB && sizeclass(nsize) == sizeclass(osize)))
+      return ptr;  /* block is big enough */
+  }
+  else if (okind == nkind && (okind == BMALLOC || nsize <= osize))
+    return bigresize(h, ptr, osize, nsize);
+  newb = blockalloc(h, nsize);
+  if (newb == NULL)  /* a shrink keeps the block where it is */
+    return (nsize <= osize) ? bigresize(h, ptr, osize, nsize) : NULL;
+  memcpy(newb, ptr, (osize < nsize) ? osize : nsize);
+  blockfree(h, ptr, osize);
+  return newb;
+}
+
+
+/*
+** new state with a heap of its own; a copy of state 'from' if it is
+** not NULL
+*/
+static lua_State *newstate (lua_State *from) {
+  SlabHeap *h = (SlabHeap *)malloc(sizeof(SlabHeap));
+  int c;
+  if (h == NULL) return NULL;
+  for (c = 0; c < NSLABCLASS; c++)
+    h->pages[c] = NULL;
+  h->spare = NULL;
+  h->nspare = 0;
+  h->strays = NULL;
+  h->state = NULL;
+  return (from == NULL) ? lua_newstate(l_alloc, h)
+                        : lua_clonestate(from, l_alloc, h);
+}
+
+#else				/* }{ */
+
 static void *l_alloc (void *ud, void *ptr, size_t osize, size_t nsize) {
   (void)ud; (void)osize;  /* not used */
   if (nsize == 0) {
@@ -950,6 +1459,13 @@ static void *l_alloc (void *ud, void *ptr, size_t osize, size_t nsize) {
 }
 
 
+#define newstate(from)  \
+	((from) == NULL ? lua_newstate(l_alloc, NULL) \
+	                : lua_clonestate(from, l_alloc, NULL))
+
+#endif				/* } */
+
+
 static int panic (lua_State *L) {
   lua_writestringerror("PANIC: unprotected error in call to Lua API (%s)\n",
                         lua_tostring(L, -1));
@@ -958,12 +1474,26 @@ static int panic (lua_State *L) {
 
 
 LUALIB_API lua_State *luaL_newstate (void) {
-  lua_State *L = lua_newstate(l_alloc, NULL);
+  lua_State *L = newstate(NULL);
   if (L) lua_atpanic(L, &panic);
   return L;
 }
 
 
+/*
+** Copy of state 'L' (see 'lua_clonestate'), in a heap of its own.
+** Starting a state this way from one with its libraries and modules
+** already loaded is much faster than loading them again.
+*/
+LUALIB_API lua_State *luaL_clonestate (lua_State *L) {
+  lua_State *L1 = newstate(L);
+  if (L1) lua_atpanic(L1, &panic);
+  return L1;
+}
+
+/* }====================================================== */
+
+
 LUALIB_API void luaL_checkversion_ (lua_State *L, lua_Number ver, size_t sz) {
   const lua_Number *v = lua_version(L);
   if (sz != LUAL_NUMSIZES)  /* check numeric types */
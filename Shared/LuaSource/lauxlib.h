@@ -84,6 +84,7 @@ LUALIB_API int (luaL_loadbufferx) (lua_State *L, const char *buff, size_t sz,
 LUALIB_API int (luaL_loadstring) (lua_State *L, const char *s);
 
 LUALIB_API lua_State *(luaL_newstate) (void);
+LUALIB_API lua_State *(luaL_clonestate) (lua_State *L);
 
 LUALIB_API lua_Integer (luaL_len) (lua_State *L, int idx);
 
@@ -161,10 +162,40 @@ LUALIB_API void (luaL_addstring) (luaL_Buffer *B, const char *s);
 LUALIB_API void (luaL_addvalue) (luaL_Buffer *B);
 LUALIB_API void (luaL_pushresult) (luaL_Buffer *B);
 LUALIB_API void (luaL_pushresultsize) (luaL_Buffer *B, size_t sz);
+LUALIB_API void (luaL_buffclose) (luaL_Buffer *B);
 LUALIB_API char *(luaL_buffinitsize) (lua_State *L, luaL_Buffer *B, size_t sz);
 
 #define luaL_prepbuffer(B)	luaL_prepbuffsize(B, LUAL_BUFFERSIZE)
 
+LUALIB_API char *(luaL_growbuffer) (lua_State *L, char *b, size_t n,
+                                    size_t *size, size_t sz);
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** String buffers
+** =======================================================
+*/
+
+/*
+** A string buffer (created by 'string.buffer') is a userdata with
+** metatable 'LUA_BUFFERHANDLE' and structure 'luaL_StrBuffer'. Its
+** bytes are in a block from the state allocator (see
+** 'luaL_growbuffer'), so C code can consume them with no Lua string.
+*/
+
+#define LUA_BUFFERHANDLE	"string.buffer"
+
+
+typedef struct luaL_StrBuffer {
+  char *b;  /* bytes (NULL when 'size' is 0) */
+  size_t n;  /* number of bytes in use */
+  size_t size;  /* size of block 'b' */
+} luaL_StrBuffer;
+
 /* }====================================================== */
 
 
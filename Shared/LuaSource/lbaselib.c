@@ -170,26 +170,64 @@ static int luaB_rawset (lua_State *L) {
 }
 
 
+/*
+** pushes a table with the collector statistics (see 'lua_GCStats');
+** if 'reset', start collecting them anew
+*/
+static void gcstats (lua_State *L, int reset) {
+  lua_GCStats st;
+  lua_gcstats(L, &st, reset);
+  lua_createtable(L, 0, 8);
+  lua_pushinteger(L, (lua_Integer)st.steps);
+  lua_setfield(L, -2, "steps");
+  lua_pushinteger(L, (lua_Integer)st.cycles);
+  lua_setfield(L, -2, "cycles");
+  lua_pushinteger(L, (lua_Integer)st.minors);
+  lua_setfield(L, -2, "minors");
+  lua_pushinteger(L, (lua_Integer)st.swept);
+  lua_setfield(L, -2, "swept");
+  lua_pushinteger(L, (lua_Integer)st.p50);
+  lua_setfield(L, -2, "p50");
+  lua_pushinteger(L, (lua_Integer)st.p99);
+  lua_setfield(L, -2, "p99");
+  lua_pushinteger(L, (lua_Integer)st.max);
+  lua_setfield(L, -2, "max");
+  lua_pushinteger(L, (lua_Integer)st.time);
+  lua_setfield(L, -2, "time");
+}
+
+
 static int luaB_collectgarbage (lua_State *L) {
   static const char *const opts[] = {"stop", "restart", "collect",
     "count", "step", "setpause", "setstepmul",
-    "isrunning", NULL};
+    "isrunning", "strpause", "generational", "incremental",
+    "steptime", "overhead", "timing", "stats", NULL};
   static const int optsnum[] = {LUA_GCSTOP, LUA_GCRESTART, LUA_GCCOLLECT,
     LUA_GCCOUNT, LUA_GCSTEP, LUA_GCSETPAUSE, LUA_GCSETSTEPMUL,
-    LUA_GCISRUNNING};
+    LUA_GCISRUNNING, LUA_GCSTRPAUSE, LUA_GCGEN, LUA_GCINC,
+    LUA_GCSTEPTIME, LUA_GCOVERHEAD, LUA_GCTIMING, -1};
   int o = optsnum[luaL_checkoption(L, 1, "collect", opts)];
   int ex = (int)luaL_optinteger(L, 2, 0);
-  int res = lua_gc(L, o, ex);
+  int res;
+  if (o == -1) {  /* "stats" */
+    gcstats(L, ex);
+    return 1;
+  }
+  res = lua_gc(L, o, ex);
   switch (o) {
     case LUA_GCCOUNT: {
       int b = lua_gc(L, LUA_GCCOUNTB, 0);
       lua_pushnumber(L, (lua_Number)res + ((lua_Number)b/1024));
       return 1;
     }
-    case LUA_GCSTEP: case LUA_GCISRUNNING: {
+    case LUA_GCSTEP: case LUA_GCISRUNNING: case LUA_GCTIMING: {
       lua_pushboolean(L, res);
       return 1;
     }
+    case LUA_GCGEN: case LUA_GCINC: {  /* return previous mode */
+      lua_pushstring(L, (res == LUA_GCGEN) ? "generational" : "incremental");
+      return 1;
+    }
     default: {
       lua_pushinteger(L, res);
       return 1;
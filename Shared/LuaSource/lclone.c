@@ -0,0 +1,517 @@
+/*
+** $Id: lclone.c $
+** Copy of a whole Lua state into a new one
+** See Copyright Notice in lua.h
+*/
+
+#define lclone_c
+#define LUA_CORE
+
+#include "lprefix.h"
+
+
+#include <string.h>
+
+#include "lua.h"
+
+#include "ldo.h"
+#include "lfunc.h"
+#include "lgc.h"
+#include "lmem.h"
+#include "lobject.h"
+#include "lstate.h"
+#include "lstring.h"
+#include "ltable.h"
+#include "ltm.h"
+
+
+/*
+** A clone starts as a fresh state; then everything reachable from the
+** registry and from the global metatables of the original is copied
+** into it, in two phases: 'copyobj' makes an empty copy of an object
+** the first time it is seen, and 'fillobj' later copies its contents,
+** so that cycles and deep structures need neither recursion nor a
+** second look at the original.
+**
+** Table 'map' keeps, for the address of each original object (as a
+** light userdata), its copy; as all copies are in it, they are safe
+** from the emergency collections that may run while cloning. (The
+** collector of the new state is stopped otherwise, and an emergency
+** collection runs a whole cycle, so no barriers are needed.) It also
+** maps the address of each upvalue to its copy, so that closures
+** sharing an upvalue still share it in the clone.
+**
+** A userdata block is copied byte by byte, which is only right if it
+** points to nothing. The elements of typed arrays are moved to the copy
+** of their block (or of the array a slice shares them with); memory
+** of the host (see 'lua_pusharray') stays shared. Any other userdata
+** must have a metamethod '__clone', which 'finishobj' calls with the
+** copy and the address of the original (as a light userdata) to fix the
+** copy (or to raise an error, when it cannot be copied); without one,
+** the clone fails. Tables can have a '__clone' too. Other copies are
+** registered for finalization only after all that, so that no
+** finalizer sees a copy that still points into the original state.
+*/
+
+
+typedef struct Pending {
+  GCObject *o;  /* original object */
+  GCObject *c;  /* its copy */
+} Pending;
+
+
+typedef struct CloneState {
+  lua_State *L;  /* original state */
+  lua_State *L1;  /* new state */
+  Table *map;  /* copies and upvalues already made */
+  Pending *work;  /* objects whose contents were not copied yet */
+  int nwork;  /* number of entries in 'work' */
+  int sizework;  /* size of 'work' */
+} CloneState;
+
+
+static const TValue *lookup (CloneState *cs, void *p) {
+  TValue key;
+  setpvalue(&key, p);
+  return luaH_get(cs->map, &key);
+}
+
+
+/*
+** map 'p' to the value at the top of the stack (which keeps it safe
+** while the map grows) and pop it
+*/
+static void remember (CloneState *cs, void *p) {
+  lua_State *L1 = cs->L1;
+  TValue key;
+  setpvalue(&key, p);
+  setobj(L1, luaH_set(L1, cs->map, &key), L1->top - 1);
+  L1->top--;
+}
+
+
+static GCObject *copyobj (CloneState *cs, GCObject *o);
+
+
+/* whether 'u' can be copied (see the comment at the top of the file) */
+static int canclone (CloneState *cs, Udata *u) {
+  global_State *g = G(cs->L);
+  Table *mt = u->metatable;
+  return (mt != NULL && (mt == g->arraymt ||
+                         !ttisnil(luaH_getstr(mt, g->tmname[TM_CLONE]))));
+}
+
+
+static void copyvalue (CloneState *cs, TValue *res, const TValue *v) {
+  if (ttisinteger(v)) {  /* may be boxed */
+    setivalue(cs->L1, res, ivalue(v));
+  }
+  else if (!iscollectable(v)) {
+    setobj(cs->L1, res, v);
+  }
+  else {
+    GCObject *c = copyobj(cs, gcvalue(v));
+    setgcovalue(cs->L1, res, c);
+  }
+}
+
+
+static TString *copystr (CloneState *cs, TString *ts) {
+  return (ts == NULL) ? NULL : gco2ts(copyobj(cs, obj2gco(ts)));
+}
+
+
+/*
+** returns the copy of object 'o', creating it (empty) if needed
+*/
+static GCObject *copyobj (CloneState *cs, GCObject *o) {
+  lua_State *L1 = cs->L1;
+  const TValue *c;
+  GCObject *o1;
+  if (o->tt == LUA_TSHRSTR) {  /* short strings are interned anyway */
+    TString *ts = gco2ts(o);
+    return obj2gco(luaS_newlstr(L1, getstr(ts), ts->len));
+  }
+  c = lookup(cs, o);
+  if (!ttisnil(c))  /* already copied? */
+    return gcvalue(c);
+  switch (o->tt) {
+    case LUA_TLNGSTR: {  /* views become plain strings */
+      TString *ts = gco2ts(o);
+      setsvalue2s(L1, L1->top, luaS_newlstr(L1, getstr(ts), ts->len));
+      break;
+    }
+    case LUA_TTABLE: {
+      Table *t = gco2t(o);
+      Table *t1 = isshaped(t)  /* will get its keys in the same order */
+                ? luaH_newrecord(L1, &G(L1)->shaperoot, t->shape->nkeys)
+                : luaH_new(L1);
+      sethvalue2s(L1, L1->top, t1);
+      break;
+    }
+    case LUA_TLCL: {
+      LClosure *cl = luaF_newLclosure(L1, gco2lcl(o)->nupvalues);
+      setclLvalue(L1, L1->top, cl);
+      break;
+    }
+    case LUA_TCCL: {
+      CClosure *ccl = gco2ccl(o);
+      CClosure *cl = luaF_newCclosure(L1, ccl->nupvalues);
+      int i;
+      cl->f = ccl->f;
+      for (i = 0; i < cl->nupvalues; i++)
+        setnilvalue(&cl->upvalue[i]);
+      setclCvalue(L1, L1->top, cl);
+      break;
+    }
+    case LUA_TUSERDATA: {
+      Udata *u = gco2u(o);
+      Udata *u1;
+      if (!canclone(cs, u))
+        luaD_throw(L1, LUA_ERRRUN);  /* would share what it points to */
+      u1 = luaS_newudata(L1, u->len);
+      memcpy(getudatamem(u1), getudatamem(u), u->len);
+      setuvalue(L1, L1->top, u1);
+      break;
+    }
+    case LUA_TPROTO: {
+      Proto *p = luaF_newproto(L1);
+      setgcovalue(L1, L1->top, obj2gco(p));  /* not a Lua value, but as
+                                                 good as one for the map */
+      break;
+    }
+    default: {  /* a coroutine (the main thread is mapped in advance) */
+      lua_assert(o->tt == LUA_TTHREAD);
+      luaD_throw(L1, LUA_ERRRUN);  /* cannot copy a running thread */
+    }
+  }
+  o1 = gcvalue(L1->top);
+  L1->top++;
+  remember(cs, o);
+  luaM_growvector(L1, cs->work, cs->nwork, cs->sizework, Pending, MAX_INT,
+                  "objects");
+  cs->work[cs->nwork].o = o;
+  cs->work[cs->nwork].c = o1;
+  cs->nwork++;
+  return o1;
+}
+
+
+static void filltable (CloneState *cs, Table *t, Table *t1) {
+  lua_State *L1 = cs->L1;
+  int i;
+  if (t->metatable)
+    t1->metatable = gco2t(copyobj(cs, obj2gco(t->metatable)));
+  if (isshaped(t)) {  /* insert keys in slot order to get the same shape */
+    for (i = 0; i < t->shape->nkeys; i++) {
+      setsvalue2s(L1, L1->top, copystr(cs, t->shape->keys[i]));
+      L1->top++;
+      copyvalue(cs, L1->top, &t->array[i]);
+      L1->top++;
+      setobj(L1, luaH_set(L1, t1, L1->top - 2), L1->top - 1);
+      L1->top -= 2;
+    }
+  }
+  else {
+    int nhash = 0;
+    for (i = 0; i < sizenode(t); i++)
+      if (!ttisnil(gval(gnode(t, i)))) nhash++;
+    luaH_resize(L1, t1, t->sizearray, nhash);
+    for (i = 0; i < cast_int(t->sizearray); i++)
+      copyvalue(cs, &t1->array[i], &t->array[i]);
+    for (i = 0; i < sizenode(t); i++) {
+      Node *n = gnode(t, i);
+      if (!ttisnil(gval(n))) {
+        copyvalue(cs, L1->top, gkey(n));
+        L1->top++;
+        copyvalue(cs, L1->top, gval(n));
+        L1->top++;
+        setobj(L1, luaH_set(L1, t1, L1->top - 2), L1->top - 1);
+        L1->top -= 2;
+      }
+    }
+  }
+  invalidateTMcache(t1);
+}
+
+
+/*
+** returns the copy of upvalue 'uv' for closure 'cl1', creating it if
+** needed (with 'cl1' already using it, so that its value is safe)
+*/
+static void copyupval (CloneState *cs, LClosure *cl1, int i, UpVal *uv) {
+  lua_State *L1 = cs->L1;
+  const TValue *c = lookup(cs, uv);
+  if (!ttisnil(c)) {  /* shared with a closure already copied? */
+    UpVal *uv1 = cast(UpVal *, pvalue(c));
+    cl1->upvals[i] = uv1;
+    uv1->refcount++;
+  }
+  else {  /* open upvalues of the main thread become closed */
+    UpVal *uv1 = luaM_new(L1, UpVal);
+    uv1->refcount = 1;
+    uv1->v = &uv1->u.value;
+    setnilvalue(uv1->v);
+    cl1->upvals[i] = uv1;
+    setpvalue(L1->top, uv1);
+    L1->top++;
+    remember(cs, uv);
+    copyvalue(cs, uv1->v, uv->v);
+  }
+}
+
+
+static void fillproto (CloneState *cs, Proto *f, Proto *f1) {
+  lua_State *L1 = cs->L1;
+  int i, n;
+  f1->source = copystr(cs, f->source);
+  f1->linedefined = f->linedefined;
+  f1->lastlinedefined = f->lastlinedefined;
+  f1->numparams = f->numparams;
+  f1->is_vararg = f->is_vararg;
+  f1->maxstacksize = f->maxstacksize;
+  n = f->sizecode;
+  f1->code = luaM_newvector(L1, n, Instruction);
+  f1->sizecode = n;
+  memcpy(f1->code, f->code, n * sizeof(Instruction));
+  n = f->sizek;
+  f1->k = luaM_newvector(L1, n, TValue);
+  f1->sizek = n;
+  for (i = 0; i < n; i++)
+    setnilvalue(&f1->k[i]);
+  for (i = 0; i < n; i++)
+    copyvalue(cs, &f1->k[i], &f->k[i]);
+  n = f->sizeupvalues;
+  f1->upvalues = luaM_newvector(L1, n, Upvaldesc);
+  f1->sizeupvalues = n;
+  for (i = 0; i < n; i++)
+    f1->upvalues[i].name = NULL;
+  for (i = 0; i < n; i++) {
+    f1->upvalues[i].instack = f->upvalues[i].instack;
+    f1->upvalues[i].idx = f->upvalues[i].idx;
+    f1->upvalues[i].name = copystr(cs, f->upvalues[i].name);
+  }
+  n = f->sizep;
+  f1->p = luaM_newvector(L1, n, Proto *);
+  f1->sizep = n;
+  for (i = 0; i < n; i++)
+    f1->p[i] = NULL;
+  for (i = 0; i < n; i++)
+    f1->p[i] = gco2p(copyobj(cs, obj2gco(f->p[i])));
+  n = f->sizelineinfo;
+  f1->lineinfo = luaM_newvector(L1, n, int);
+  f1->sizelineinfo = n;
+  memcpy(f1->lineinfo, f->lineinfo, n * sizeof(int));
+  n = f->sizelocvars;
+  f1->locvars = luaM_newvector(L1, n, LocVar);
+  f1->sizelocvars = n;
+  for (i = 0; i < n; i++)
+    f1->locvars[i].varname = NULL;
+  for (i = 0; i < n; i++) {
+    f1->locvars[i].startpc = f->locvars[i].startpc;
+    f1->locvars[i].endpc = f->locvars[i].endpc;
+    f1->locvars[i].varname = copystr(cs, f->locvars[i].varname);
+  }
+}
+
+
+static void filludata (CloneState *cs, Udata *u, Udata *u1) {
+  lua_State *L1 = cs->L1;
+  TValue uv;
+  u1->metatable = gco2t(copyobj(cs, obj2gco(u->metatable)));
+  getuservalue(cs->L, u, &uv);
+  copyvalue(cs, L1->top, &uv);
+  setuservalue(L1, u1, L1->top);
+}
+
+
+static void fillobj (CloneState *cs, GCObject *o, GCObject *c) {
+  int i;
+  switch (o->tt) {
+    case LUA_TTABLE:
+      filltable(cs, gco2t(o), gco2t(c));
+      break;
+    case LUA_TLCL: {
+      LClosure *cl = gco2lcl(o), *cl1 = gco2lcl(c);
+      cl1->p = gco2p(copyobj(cs, obj2gco(cl->p)));
+      for (i = 0; i < cl->nupvalues; i++) {
+        if (cl->upvals[i] != NULL)
+          copyupval(cs, cl1, i, cl->upvals[i]);
+      }
+      break;
+    }
+    case LUA_TCCL: {
+      CClosure *cl = gco2ccl(o), *cl1 = gco2ccl(c);
+      for (i = 0; i < cl->nupvalues; i++)
+        copyvalue(cs, &cl1->upvalue[i], &cl->upvalue[i]);
+      break;
+    }
+    case LUA_TUSERDATA:
+      filludata(cs, gco2u(o), gco2u(c));
+      break;
+    case LUA_TPROTO:
+      fillproto(cs, gco2p(o), gco2p(c));
+      break;
+    default:  /* strings have no contents to fill */
+      lua_assert(o->tt == LUA_TLNGSTR);
+  }
+}
+
+
+/*
+** the elements of typed array 'u' in the new state: in the copy of its
+** own block or, for a slice, of the block of the array it came from;
+** elements anywhere else belong to the host and stay where they are
+*/
+static void *arraydata (CloneState *cs, Udata *u) {
+  char *data = cast(char *, gettarray(u)->data);
+  for (;;) {
+    char *mem = cast(char *, getudatamem(u));
+    TValue uv;
+    if (mem <= data && data <= mem + u->len) {  /* in this block? */
+      Udata *u1 = gco2u(gcvalue(lookup(cs, obj2gco(u))));
+      return cast(char *, getudatamem(u1)) + (data - mem);
+    }
+    getuservalue(cs->L, u, &uv);
+    if (!ttisfulluserdata(&uv) || uvalue(&uv)->metatable != G(cs->L)->arraymt)
+      return data;  /* not a slice */
+    u = uvalue(&uv);
+  }
+}
+
+
+static Table *metatable (GCObject *o) {
+  switch (o->tt) {
+    case LUA_TTABLE: return gco2t(o)->metatable;
+    case LUA_TUSERDATA: return gco2u(o)->metatable;
+    default: return NULL;
+  }
+}
+
+
+/*
+** Makes copy 'c' of object 'o' ready for use once all contents are
+** copied (see the comment at the top of the file). A copy fixed by its
+** '__clone' owns what it points to, so it is registered for
+** finalization at once; if a later '__clone' fails, closing the new
+** state releases it.
+*/
+static void finishobj (CloneState *cs, GCObject *o, GCObject *c) {
+  lua_State *L1 = cs->L1;
+  Table *mt = metatable(c);
+  if (mt == NULL)
+    return;
+  if (mt == G(L1)->arraymt && c->tt == LUA_TUSERDATA)
+    gettarray(gco2u(c))->data = arraydata(cs, gco2u(o));
+  else {
+    const TValue *tm = luaH_getstr(mt, G(L1)->tmname[TM_CLONE]);
+    if (!ttisnil(tm)) {  /* call '__clone(c, o)' */
+      setobj2s(L1, L1->top, tm);
+      setgcovalue(L1, L1->top + 1, c);
+      setpvalue(L1->top + 2, (c->tt == LUA_TUSERDATA)
+                             ? getudatamem(gco2u(o)) : cast(void *, o));
+      L1->top += 3;
+      luaD_call(L1, L1->top - 3, 0, 0);
+      luaC_checkfinalizer(L1, c, mt);
+    }
+  }
+}
+
+
+static Table *copymt (CloneState *cs, Table *mt) {
+  return (mt == NULL) ? NULL : gco2t(copyobj(cs, obj2gco(mt)));
+}
+
+
+static void f_clone (lua_State *L1, void *ud) {
+  CloneState *cs = cast(CloneState *, ud);
+  global_State *g = G(cs->L);
+  global_State *g1 = G(L1);
+  TValue registry;
+  int i;
+  GCObject *o;
+  int n = 0;
+  luaD_checkstack(L1, 4);  /* enough for the map and three temporaries */
+  for (o = g->allgc; o != NULL; o = o->next) n++;
+  for (o = g->finobj; o != NULL; o = o->next) n++;
+  if (g1->strt.size < g->strt.size)  /* avoid growing it step by step */
+    luaS_resize(L1, g->strt.size);
+  cs->map = luaH_new(L1);
+  sethvalue2s(L1, L1->top, cs->map);  /* anchor it */
+  L1->top++;
+  luaH_resize(L1, cs->map, 0, n);  /* room for a copy of everything */
+  cs->work = luaM_newvector(L1, n, Pending);
+  cs->sizework = n;
+  setthvalue(L1, L1->top, L1);  /* the main thread is the new one */
+  L1->top++;
+  remember(cs, obj2gco(g->mainthread));
+  copyvalue(cs, &registry, &g->l_registry);
+  for (i = 0; i < LUA_NUMTAGS; i++)
+    g1->mt[i] = copymt(cs, g->mt[i]);
+  g1->arraymt = copymt(cs, g->arraymt);
+  for (i = 0; i < cs->nwork; i++)  /* copy contents ('work' may grow) */
+    fillobj(cs, cs->work[i].o, cs->work[i].c);
+  setobj(L1, &g1->l_registry, &registry);  /* '__clone's may need it */
+  for (i = 0; i < cs->nwork; i++)  /* metatables are complete now */
+    finishobj(cs, cs->work[i].o, cs->work[i].c);
+  for (i = 0; i < cs->nwork; i++) {  /* all copies are valid now */
+    GCObject *c = cs->work[i].c;
+    Table *mt = metatable(c);
+    if (mt != NULL)
+      luaC_checkfinalizer(L1, c, mt);
+  }
+  L1->top--;  /* remove map */
+  if (g->gcmode != KGC_INC)
+    luaC_changemode(L1, KGC_GEN);
+}
+
+
+/*
+** Creates a new state, with allocator 'f', holding a copy of everything
+** reachable in state 'L' from its registry (globals, loaded modules,
+** metatables). Returns NULL if it cannot allocate memory or if among
+** the objects to copy there is a coroutine other than the main thread
+** or a userdata that cannot be copied.
+*/
+LUA_API lua_State *lua_clonestate (lua_State *L, lua_Alloc f, void *ud) {
+  lua_State *L1;
+  CloneState cs;
+  lua_lock(L);
+  L1 = lua_newstate(f, ud);
+  if (L1 != NULL) {
+    global_State *g = G(L);
+    global_State *g1 = G(L1);
+    int status;
+    cs.L = L;
+    cs.L1 = L1;
+    cs.map = NULL;
+    cs.work = NULL;
+    cs.nwork = cs.sizework = 0;
+    g1->gcrunning = 0;  /* collect nothing while copying */
+    status = luaD_rawrunprotected(L1, f_clone, &cs);
+    luaM_freearray(L1, cs.work, cs.sizework);
+    if (status != LUA_OK) {
+      lua_close(L1);
+      L1 = NULL;
+    }
+    else {
+      g1->panic = g->panic;
+      g1->jiton = g->jiton;
+      g1->gcpause = g->gcpause;
+      g1->gcstepmul = g->gcstepmul;
+      g1->genminormul = g->genminormul;
+      g1->genmajormul = g->genmajormul;
+      g1->gcsteptime = g->gcsteptime;
+      g1->gcoverhead = g->gcoverhead;
+      g1->gctiming = g->gctiming;
+      /* everything is live: let the heap grow before the first cycle */
+      g1->GCestimate = gettotalbytes(g1);
+      if (g1->gcmode == KGC_INC)
+        luaE_setdebt(g1, -cast(l_mem, g1->GCestimate));
+      g1->gcrunning = g->gcrunning;
+    }
+  }
+  lua_unlock(L);
+  return L1;
+}
+
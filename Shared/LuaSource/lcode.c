@@ -36,12 +36,12 @@
 #define hasjumps(e)	((e)->t != (e)->f)
 
 
-static int tonumeral(expdesc *e, TValue *v) {
+static int tonumeral(lua_State *L, expdesc *e, TValue *v) {
   if (e->t != NO_JUMP || e->f != NO_JUMP)
     return 0;  /* not a numeral */
   switch (e->k) {
     case VKINT:
-      if (v) setivalue(v, e->u.ival);
+      if (v) setivalue(L, v, e->u.ival);
       return 1;
     case VKFLT:
       if (v) setfltvalue(v, e->u.nval);
@@ -326,7 +326,7 @@ static int addk (FuncState *fs, TValue *key, TValue *v) {
   k = fs->nk;
   /* numerical value does not need GC barrier;
      table has no metatable, so it does not need to invalidate cache */
-  setivalue(idx, k);
+  setivalue(L, idx, k);
   luaM_growvector(L, f->k, k, f->sizek, TValue, MAXARG_Ax, "constants");
   while (oldsize < f->sizek) setnilvalue(&f->k[oldsize++]);
   setobj(L, &f->k[k], v);
@@ -351,7 +351,7 @@ int luaK_stringK (FuncState *fs, TString *s) {
 int luaK_intK (FuncState *fs, lua_Integer n) {
   TValue k, o;
   setpvalue(&k, cast(void*, cast(size_t, n)));
-  setivalue(&o, n);
+  setivalue(fs->ls->L, &o, n);
   return addk(fs, &k, &o);
 }
 
@@ -746,7 +746,7 @@ void luaK_indexed (FuncState *fs, expdesc *t, expdesc *k) {
 /*
 ** return false if folding can raise an error
 */
-static int validop (int op, TValue *v1, TValue *v2) {
+static int validop (lua_State *L, int op, TValue *v1, TValue *v2) {
   switch (op) {
     case LUA_OPBAND: case LUA_OPBOR: case LUA_OPBXOR:
     case LUA_OPSHL: case LUA_OPSHR: case LUA_OPBNOT: {  /* conversion errors */
@@ -765,9 +765,11 @@ static int validop (int op, TValue *v1, TValue *v2) {
 */
 static int constfolding (FuncState *fs, int op, expdesc *e1, expdesc *e2) {
   TValue v1, v2, res;
-  if (!tonumeral(e1, &v1) || !tonumeral(e2, &v2) || !validop(op, &v1, &v2))
+  lua_State *L = fs->ls->L;
+  if (!tonumeral(L, e1, &v1) || !tonumeral(L, e2, &v2) ||
+      !validop(L, op, &v1, &v2))
     return 0;  /* non-numeric operands or not safe to fold */
-  luaO_arith(fs->ls->L, op, &v1, &v2, &res);  /* does operation */
+  luaO_arith(L, op, &v1, &v2, &res);  /* does operation */
   if (ttisinteger(&res)) {
     e1->k = VKINT;
     e1->u.ival = ivalue(&res);
@@ -870,7 +872,7 @@ void luaK_infix (FuncState *fs, BinOpr op, expdesc *v) {
     case OPR_MOD: case OPR_POW:
     case OPR_BAND: case OPR_BOR: case OPR_BXOR:
     case OPR_SHL: case OPR_SHR: {
-      if (!tonumeral(v, NULL)) luaK_exp2RK(fs, v);
+      if (!tonumeral(fs->ls->L, v, NULL)) luaK_exp2RK(fs, v);
       break;
     }
     default: {
@@ -952,3 +954,45 @@ void luaK_setlist (FuncState *fs, int base, int nelems, int tostore) {
   fs->freereg = base + 1;  /* free registers with list values */
 }
 
+
+/*
+** superinstruction for the pair 'first'-'second' ('first' itself if
+** the pair is not fused)
+*/
+static OpCode fusedop (OpCode first, OpCode second) {
+  switch (first) {
+    case OP_MOVE:
+      return (second == OP_MOVE) ? OP_MOVEMOVE :
+             (second == OP_CALL) ? OP_MOVECALL : first;
+    case OP_LOADK:
+      return (second == OP_CALL) ? OP_LOADKCALL : first;
+    case OP_GETUPVAL:
+      return (second == OP_MOVE) ? OP_GETUPVALMOVE : first;
+    case OP_GETTABUP:
+      return (second == OP_MOVE) ? OP_GETTABUPMOVE :
+             (second == OP_GETTABLE) ? OP_GETTABUPGETTABLE : first;
+    case OP_SELF:
+      return (second == OP_LOADK) ? OP_SELFLOADK : first;
+    default: return first;
+  }
+}
+
+
+/*
+** Peephole pass over the finished code of 'f': the first instruction
+** of each frequent pair becomes a superinstruction, which also runs
+** the second one. (These pairs are the most frequent ones in typical
+** modeling scripts: argument moves, calls with a constant or moved
+** last argument, global and method lookups.)
+*/
+void luaK_fuse (Proto *f) {
+  int pc;
+  for (pc = 0; pc + 1 < f->sizecode; pc++) {
+    OpCode op = GET_OPCODE(f->code[pc]);
+    OpCode fused = fusedop(op, GET_OPCODE(f->code[pc + 1]));
+    if (fused != op) {
+      SET_OPCODE(f->code[pc], fused);
+      pc++;  /* the second instruction runs within this one */
+    }
+  }
+}
@@ -409,6 +409,18 @@ static int db_traceback (lua_State *L) {
 }
 
 
+/*
+** debug.jit([on]): turns the JIT compiler on or off; returns whether
+** it is on
+*/
+static int db_jit (lua_State *L) {
+  int what = lua_isnoneornil(L, 1) ? LUA_JITISON
+           : lua_toboolean(L, 1) ? LUA_JITON : LUA_JITOFF;
+  lua_pushboolean(L, lua_jit(L, what));
+  return 1;
+}
+
+
 static const luaL_Reg dblib[] = {
   {"debug", db_debug},
   {"getuservalue", db_getuservalue},
@@ -418,6 +430,7 @@ static const luaL_Reg dblib[] = {
   {"getregistry", db_getregistry},
   {"getmetatable", db_getmetatable},
   {"getupvalue", db_getupvalue},
+  {"jit", db_jit},
   {"upvaluejoin", db_upvaluejoin},
   {"upvalueid", db_upvalueid},
   {"setuservalue", db_setuservalue},
@@ -344,7 +344,7 @@ static int findsetreg (Proto *p, int lastpc, int reg) {
   int jmptarget = 0;  /* any code before this address is conditional */
   for (pc = 0; pc < lastpc; pc++) {
     Instruction i = p->code[pc];
-    OpCode op = GET_OPCODE(i);
+    OpCode op = GET_BASEOP(i);
     int a = GETARG_A(i);
     switch (op) {
       case OP_LOADNIL: {
@@ -394,7 +394,7 @@ static const char *getobjname (Proto *p, int lastpc, int reg,
   pc = findsetreg(p, lastpc, reg);
   if (pc != -1) {  /* could find instruction? */
     Instruction i = p->code[pc];
-    OpCode op = GET_OPCODE(i);
+    OpCode op = GET_BASEOP(i);
     switch (op) {
       case OP_MOVE: {
         int b = GETARG_B(i);  /* move from 'b' to 'a' */
@@ -447,7 +447,7 @@ static const char *getfuncname (lua_State *L, CallInfo *ci, const char **name) {
     *name = "?";
     return "hook";
   }
-  switch (GET_OPCODE(i)) {
+  switch (GET_BASEOP(i)) {
     case OP_CALL:
     case OP_TAILCALL:  /* get function name */
       return getobjname(p, pc, GETARG_A(i), name);
@@ -465,7 +465,7 @@ static const char *getfuncname (lua_State *L, CallInfo *ci, const char **name) {
     case OP_ADD: case OP_SUB: case OP_MUL: case OP_MOD:
     case OP_POW: case OP_DIV: case OP_IDIV: case OP_BAND:
     case OP_BOR: case OP_BXOR: case OP_SHL: case OP_SHR: {
-      int offset = cast_int(GET_OPCODE(i)) - cast_int(OP_ADD);  /* ORDER OP */
+      int offset = cast_int(GET_BASEOP(i)) - cast_int(OP_ADD);  /* ORDER OP */
       tm = cast(TMS, offset + cast_int(TM_ADD));  /* ORDER TM */
       break;
     }
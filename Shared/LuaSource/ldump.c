@@ -15,6 +15,7 @@
 #include "lua.h"
 
 #include "lobject.h"
+#include "lopcodes.h"
 #include "lstate.h"
 #include "lundump.h"
 
@@ -86,9 +87,17 @@ static void DumpString (const TString *s, DumpState *D) {
 }
 
 
+/*
+** dump code with quickened instructions in their generic form
+*/
 static void DumpCode (const Proto *f, DumpState *D) {
+  int i;
   DumpInt(f->sizecode, D);
-  DumpVector(f->code, f->sizecode, D);
+  for (i = 0; i < f->sizecode; i++) {
+    Instruction inst = f->code[i];
+    SET_OPCODE(inst, GET_BASEOP(inst));
+    DumpVar(inst, D);
+  }
 }
 
 
@@ -16,6 +16,7 @@
 
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
@@ -104,6 +105,9 @@ Proto *luaF_newproto (lua_State *L) {
   f->p = NULL;
   f->sizep = 0;
   f->code = NULL;
+  f->fcache = NULL;
+  f->jit = NULL;
+  f->jitcount = LUAI_JITHOT;
   f->cache = NULL;
   f->sizecode = 0;
   f->lineinfo = NULL;
@@ -124,6 +128,10 @@ Proto *luaF_newproto (lua_State *L) {
 
 void luaF_freeproto (lua_State *L, Proto *f) {
   luaM_freearray(L, f->code, f->sizecode);
+  if (f->fcache != NULL)
+    luaM_freearray(L, f->fcache, f->sizecode);
+  if (f->jit != NULL)
+    luaJ_free(L, f);
   luaM_freearray(L, f->p, f->sizep);
   luaM_freearray(L, f->k, f->sizek);
   luaM_freearray(L, f->lineinfo, f->sizelineinfo);
@@ -11,6 +11,7 @@
 
 
 #include <string.h>
+#include <time.h>
 
 #include "lua.h"
 
@@ -60,12 +61,13 @@
 
 
 /*
-** 'makewhite' erases all color bits then sets only the current white
-** bit
+** 'makewhite' erases all color and age bits then sets only the current
+** white bit
 */
 #define maskcolors	(~(bitmask(BLACKBIT) | WHITEBITS))
+#define maskgcbits	(maskcolors & ~AGEBITS)
 #define makewhite(g,x)	\
- (x->marked = cast_byte((x->marked & maskcolors) | luaC_white(g)))
+ (x->marked = cast_byte((x->marked & maskgcbits) | luaC_white(g)))
 
 #define white2gray(x)	resetbits(x->marked, WHITEBITS)
 #define black2gray(x)	resetbit(x->marked, BLACKBIT)
@@ -86,6 +88,12 @@
 #define markobject(g,t) \
   { if ((t) && iswhite(t)) reallymarkobject(g, obj2gco(t)); }
 
+/*
+** true while the survivors of a major collection are being turned old
+** (see 'atomic2gen'); until then, any black object may be old.
+*/
+#define isoldsweep(g)	((g)->gcmode == KGC_GEN && (g)->sweepgc != NULL)
+
 static void reallymarkobject (global_State *g, GCObject *o);
 
 
@@ -101,6 +109,9 @@ static void reallymarkobject (global_State *g, GCObject *o);
 */
 #define gnodelast(h)	gnode(h, cast(size_t, sizenode(h)))
 
+/* number of values in the array part (the slots, in shape mode) */
+#define arraysize(h)	(isshaped(h) ? (h)->shape->nkeys : (h)->sizearray)
+
 
 /*
 ** link collectable object 'o' into list pointed by 'p'
@@ -132,6 +143,10 @@ static int iscleared (global_State *g, const TValue *o) {
     markobject(g, tsvalue(o));  /* strings are 'values', so are never weak */
     return 0;
   }
+  else if (ttisinteger(o)) {  /* a boxed integer (see 'luaO_boxint') */
+    markobject(g, gcvalue(o));  /* is a 'value' too */
+    return 0;
+  }
   else return iswhite(gcvalue(o));
 }
 
@@ -140,13 +155,19 @@ static int iscleared (global_State *g, const TValue *o) {
 ** barrier that moves collector forward, that is, mark the white object
 ** being pointed by a black object. (If in sweep phase, clear the black
 ** object to white [sweep it] to avoid other barrier calls for this
-** same object.)
+** same object.) In generational mode, an old object cannot point to a
+** young one, so the young one becomes old too.
 */
 void luaC_barrier_ (lua_State *L, GCObject *o, GCObject *v) {
   global_State *g = G(L);
   lua_assert(isblack(o) && iswhite(v) && !isdead(g, v) && !isdead(g, o));
-  if (keepinvariant(g))  /* must keep invariant? */
+  if (keepinvariant(g)) {  /* must keep invariant? */
     reallymarkobject(g, v);  /* restore invariant */
+    if (isold(o) || isoldsweep(g)) {
+      lua_assert(!isold(v));  /* white object could not be old */
+      setage(v, G_OLD0);  /* restore generational invariant */
+    }
+  }
   else {  /* sweep phase */
     lua_assert(issweepphase(g));
     makewhite(g, o);  /* mark main obj. as white to avoid other barriers */
@@ -156,13 +177,18 @@ void luaC_barrier_ (lua_State *L, GCObject *o, GCObject *v) {
 
 /*
 ** barrier that moves collector backward, that is, mark the black object
-** pointing to a white object as gray again.
+** pointing to a white object as gray again. In generational mode, the
+** table is old and becomes "touched"; if it was touched in the previous
+** cycle, it is still in 'grayagain'.
 */
 void luaC_barrierback_ (lua_State *L, Table *t) {
   global_State *g = G(L);
   lua_assert(isblack(t) && !isdead(g, t));
   black2gray(t);  /* make table gray (again) */
-  linkgclist(t, g->grayagain);
+  if (getage(t) != G_TOUCHED2)  /* not already in gray list? */
+    linkgclist(t, g->grayagain);
+  if (isold(t) || isoldsweep(g))  /* generational mode? */
+    setage(t, G_TOUCHED1);  /* touched in current cycle */
 }
 
 
@@ -170,14 +196,18 @@ void luaC_barrierback_ (lua_State *L, Table *t) {
 ** barrier for assignments to closed upvalues. Because upvalues are
 ** shared among closures, it is impossible to know the color of all
 ** closures pointing to it. So, we assume that the object being assigned
-** must be marked.
+** must be marked. For the same reason, in generational mode we assume
+** that some of these closures are old, so the object becomes old too.
 */
 void luaC_upvalbarrier_ (lua_State *L, UpVal *uv) {
   global_State *g = G(L);
   GCObject *o = gcvalue(uv->v);
   lua_assert(!upisopen(uv));  /* ensured by macro luaC_upvalbarrier */
-  if (keepinvariant(g))
+  if (keepinvariant(g)) {
     markobject(g, o);
+    if (g->gcmode == KGC_GEN && !isold(o))
+      setage(o, G_OLD0);
+  }
 }
 
 
@@ -185,6 +215,7 @@ void luaC_fix (lua_State *L, GCObject *o) {
   global_State *g = G(L);
   lua_assert(g->allgc == o);  /* object must be 1st in 'allgc' list! */
   white2gray(o);  /* they will be gray forever */
+  setage(o, G_OLD);  /* and old forever */
   g->allgc = o->next;  /* remove object from 'allgc' list */
   o->next = g->fixedgc;  /* link it to 'fixedgc' list */
   g->fixedgc = o;
@@ -230,8 +261,19 @@ static void reallymarkobject (global_State *g, GCObject *o) {
     case LUA_TLNGSTR: {
       gray2black(o);
       g->GCmemtrav += sizestring(gco2ts(o));
+      if (isview(gco2ts(o))) {  /* a view keeps its parent alive */
+        o = obj2gco(viewparent(gco2ts(o)));
+        if (iswhite(o)) goto reentry;
+      }
       break;
     }
+#if defined(LUA_NANBOXING)
+    case LUA_TNUMINT: {  /* integer box */
+      gray2black(o);
+      g->GCmemtrav += sizeof(IntBox);
+      break;
+    }
+#endif
     case LUA_TUSERDATA: {
       TValue uvalue;
       markobject(g, gco2u(o)->metatable);  /* mark its metatable */
@@ -276,6 +318,7 @@ static void markmt (global_State *g) {
   int i;
   for (i=0; i < LUA_NUMTAGS; i++)
     markobject(g, g->mt[i]);
+  markobject(g, g->arraymt);
 }
 
 
@@ -338,6 +381,25 @@ static void restartcollection (global_State *g) {
 ** =======================================================
 */
 
+/*
+** In generational mode, a table touched in this cycle goes back to
+** 'grayagain' (as gray), so that the next minor collection visits it
+** again; one touched in the previous cycle becomes old. Any other table
+** is black at the end of its traversal, so that barriers can see it.
+*/
+static void genlink (global_State *g, Table *h) {
+  if (getage(h) == G_TOUCHED1) {  /* touched in this cycle? */
+    black2gray(h);
+    linkgclist(h, g->grayagain);  /* link it back in 'grayagain' */
+  }
+  else {
+    gray2black(h);  /* a weak table is still gray */
+    if (getage(h) == G_TOUCHED2)
+      changeage(h, G_TOUCHED2, G_OLD);  /* advance age */
+  }
+}
+
+
 /*
 ** Traverse a table with weak values and link it to proper list. During
 ** propagate phase, keep it in 'grayagain' list, to be revisited in the
@@ -348,7 +410,7 @@ static void traverseweakvalue (global_State *g, Table *h) {
   Node *n, *limit = gnodelast(h);
   /* if there is array part, assume it may have white values (it is not
      worth traversing it now just to check) */
-  int hasclears = (h->sizearray > 0);
+  int hasclears = (arraysize(h) > 0);
   for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part */
     checkdeadkey(n);
     if (ttisnil(gval(n)))  /* entry is empty? */
@@ -364,6 +426,8 @@ static void traverseweakvalue (global_State *g, Table *h) {
     linkgclist(h, g->grayagain);  /* must retraverse it in atomic phase */
   else if (hasclears)
     linkgclist(h, g->weak);  /* has to be cleared later */
+  else
+    genlink(g, h);
 }
 
 
@@ -383,8 +447,9 @@ static int traverseephemeron (global_State *g, Table *h) {
   int hasww = 0;  /* true if table has entry "white-key -> white-value" */
   Node *n, *limit = gnodelast(h);
   unsigned int i;
-  /* traverse array part */
-  for (i = 0; i < h->sizearray; i++) {
+  /* traverse array part (shape keys are strings, which are never
+     cleared, so slots are just like it) */
+  for (i = 0; i < arraysize(h); i++) {
     if (valiswhite(&h->array[i])) {
       marked = 1;
       reallymarkobject(g, gcvalue(&h->array[i]));
@@ -412,6 +477,8 @@ static int traverseephemeron (global_State *g, Table *h) {
     linkgclist(h, g->ephemeron);  /* have to propagate again */
   else if (hasclears)  /* table has white keys? */
     linkgclist(h, g->allweak);  /* may have to clean white keys */
+  else
+    genlink(g, h);
   return marked;
 }
 
@@ -419,7 +486,7 @@ static int traverseephemeron (global_State *g, Table *h) {
 static void traversestrongtable (global_State *g, Table *h) {
   Node *n, *limit = gnodelast(h);
   unsigned int i;
-  for (i = 0; i < h->sizearray; i++)  /* traverse array part */
+  for (i = 0; i < arraysize(h); i++)  /* traverse array part */
     markvalue(g, &h->array[i]);
   for (n = gnode(h, 0); n < limit; n++) {  /* traverse hash part */
     checkdeadkey(n);
@@ -431,6 +498,7 @@ static void traversestrongtable (global_State *g, Table *h) {
       markvalue(g, gval(n));  /* mark value */
     }
   }
+  genlink(g, h);
 }
 
 
@@ -438,6 +506,11 @@ static lu_mem traversetable (global_State *g, Table *h) {
   const char *weakkey, *weakvalue;
   const TValue *mode = gfasttm(g, h->metatable, TM_MODE);
   markobject(g, h->metatable);
+  if (isshaped(h)) {  /* shape keys are always strong */
+    int i;
+    for (i = 0; i < h->shape->nkeys; i++)
+      markobject(g, h->shape->keys[i]);
+  }
   if (mode && ttisstring(mode) &&  /* is there a weak mode? */
       ((weakkey = strchr(svalue(mode), 'k')),
        (weakvalue = strchr(svalue(mode), 'v')),
@@ -452,7 +525,7 @@ static lu_mem traversetable (global_State *g, Table *h) {
   }
   else  /* not weak */
     traversestrongtable(g, h);
-  return sizeof(Table) + sizeof(TValue) * h->sizearray +
+  return sizeof(Table) + sizeof(TValue) * arraysize(h) +
                          sizeof(Node) * cast(size_t, sizenode(h));
 }
 
@@ -471,6 +544,7 @@ static int traverseproto (global_State *g, Proto *f) {
   for (i = 0; i < f->sizelocvars; i++)  /* mark local-variable names */
     markobject(g, f->locvars[i].varname);
   return sizeof(Proto) + sizeof(Instruction) * f->sizecode +
+                         (f->fcache ? sizeof(FieldCache) * f->sizecode : 0) +
                          sizeof(Proto *) * f->sizep +
                          sizeof(TValue) * f->sizek +
                          sizeof(int) * f->sizelineinfo +
@@ -534,12 +608,13 @@ static lu_mem traversethread (global_State *g, lua_State *th) {
 
 /*
 ** traverse one gray object, turning it to black (except for threads,
-** which are always gray).
+** which are always gray). (In generational mode, tables touched in the
+** previous cycle are black but still in the list.)
 */
 static void propagatemark (global_State *g) {
   lu_mem size;
   GCObject *o = g->gray;
-  lua_assert(isgray(o));
+  lua_assert(isgray(o) || getage(o) == G_TOUCHED2);
   gray2black(o);
   switch (o->tt) {
     case LUA_TTABLE: {
@@ -639,7 +714,7 @@ static void clearvalues (global_State *g, GCObject *l, GCObject *f) {
     Table *h = gco2t(l);
     Node *n, *limit = gnodelast(h);
     unsigned int i;
-    for (i = 0; i < h->sizearray; i++) {
+    for (i = 0; i < arraysize(h); i++) {
       TValue *o = &h->array[i];
       if (iscleared(g, o))  /* value was collected? */
         setnilvalue(o);  /* remove value */
@@ -674,6 +749,8 @@ static void freeLclosure (lua_State *L, LClosure *cl) {
 
 
 static void freeobj (lua_State *L, GCObject *o) {
+  global_State *g = G(L);
+  l_mem olddebt = g->GCdebt;
   switch (o->tt) {
     case LUA_TPROTO: luaF_freeproto(L, gco2p(o)); break;
     case LUA_TLCL: {
@@ -694,13 +771,19 @@ static void freeobj (lua_State *L, GCObject *o) {
       luaM_freemem(L, o, sizestring(gco2ts(o)));
       break;
     }
+#if defined(LUA_NANBOXING)
+    case LUA_TNUMINT: luaM_free(L, gco2ib(o)); break;
+#endif
     default: lua_assert(0);
   }
+  g->gcstats.swept += olddebt - g->GCdebt;  /* memory released */
 }
 
 
 #define sweepwholelist(L,p)	sweeplist(L,p,MAX_LUMEM)
 static GCObject **sweeplist (lua_State *L, GCObject **p, lu_mem count);
+static GCObject **sweep2oldtolive (lua_State *L, GCObject **p);
+static void setold (global_State *g, GCObject *o);
 
 
 /*
@@ -722,7 +805,7 @@ static GCObject **sweeplist (lua_State *L, GCObject **p, lu_mem count) {
       freeobj(L, curr);  /* erase 'curr' */
     }
     else {  /* change mark to 'white' */
-      curr->marked = cast_byte((marked & maskcolors) | white);
+      curr->marked = cast_byte((marked & maskgcbits) | white);
       p = &curr->next;  /* go to next element */
     }
   }
@@ -760,7 +843,8 @@ static void checkSizes (lua_State *L, global_State *g) {
   if (g->gckind != KGC_EMERGENCY) {
     l_mem olddebt = g->GCdebt;
     luaZ_freebuffer(L, &g->buff);  /* free concatenation buffer */
-    if (g->strt.nuse < g->strt.size / 4)  /* string table too big? */
+    if (g->strt.nuse < g->strt.size / 4 &&  /* string table too big? */
+        g->strt.oldhash == NULL)  /* and not being resized? */
       luaS_resize(L, g->strt.size / 2);  /* shrink it a little */
     g->GCestimate += g->GCdebt - olddebt;  /* update estimate */
   }
@@ -776,6 +860,8 @@ static GCObject *udata2finalize (global_State *g) {
   resetbit(o->marked, FINALIZEDBIT);  /* object is "normal" again */
   if (issweepphase(g))
     makewhite(g, o);  /* "sweep" object */
+  else if (getage(o) == G_OLD1)
+    g->firstold1 = o;  /* it is the first OLD1 object in the list */
   return o;
 }
 
@@ -855,17 +941,22 @@ static GCObject **findlast (GCObject **p) {
 
 /*
 ** move all unreachable objects (or 'all' objects) that need
-** finalization from list 'finobj' to list 'tobefnz' (to be finalized)
+** finalization from list 'finobj' to list 'tobefnz' (to be finalized).
+** (Note that objects after 'finobjold1' cannot be white, so they
+** don't need to be traversed. In incremental mode, 'finobjold1' is NULL,
+** so the whole list is traversed.)
 */
 static void separatetobefnz (global_State *g, int all) {
   GCObject *curr;
   GCObject **p = &g->finobj;
   GCObject **lastnext = findlast(&g->tobefnz);
-  while ((curr = *p) != NULL) {  /* traverse all finalizable objects */
+  while ((curr = *p) != g->finobjold1) {  /* traverse all finalizable objects */
     lua_assert(tofinalize(curr));
     if (!(iswhite(curr) || all))  /* not being collected? */
       p = &curr->next;  /* don't bother with it */
     else {
+      if (curr == g->finobjsur)  /* removing 'finobjsur'? */
+        g->finobjsur = curr->next;  /* correct it */
       *p = curr->next;  /* remove 'curr' from 'finobj' list */
       curr->next = *lastnext;  /* link at the end of 'tobefnz' list */
       *lastnext = curr;
@@ -875,6 +966,27 @@ static void separatetobefnz (global_State *g, int all) {
 }
 
 
+/*
+** If pointer 'p' points to 'o', move it to the next element.
+*/
+static void checkpointer (GCObject **p, GCObject *o) {
+  if (o == *p)
+    *p = o->next;
+}
+
+
+/*
+** Correct pointers to objects inside 'allgc' list when
+** object 'o' is being removed from the list.
+*/
+static void correctpointers (global_State *g, GCObject *o) {
+  checkpointer(&g->survival, o);
+  checkpointer(&g->old1, o);
+  checkpointer(&g->reallyold, o);
+  checkpointer(&g->firstold1, o);
+}
+
+
 /*
 ** if object 'o' has a finalizer, remove it from 'allgc' list (must
 ** search the list to find it) and link it in 'finobj' list.
@@ -891,6 +1003,15 @@ void luaC_checkfinalizer (lua_State *L, GCObject *o, Table *mt) {
       if (g->sweepgc == &o->next)  /* should not remove 'sweepgc' object */
         g->sweepgc = sweeptolive(L, g->sweepgc, NULL);  /* change 'sweepgc' */
     }
+    else {
+      if (isoldsweep(g)) {  /* 'o' may not be old yet */
+        if (g->sweepgc == &o->next)  /* should not remove 'sweepgc' object */
+          g->sweepgc = sweep2oldtolive(L, g->sweepgc);
+        if (!iswhite(o) && getage(o) == G_NEW)  /* not swept yet? */
+          setold(g, o);  /* turn it old now, as it leaves 'allgc' */
+      }
+      correctpointers(g, o);
+    }
     /* search for pointer pointing to 'o' */
     for (p = &g->allgc; *p != o; p = &(*p)->next) { /* empty */ }
     *p = o->next;  /* remove 'o' from 'allgc' list */
@@ -904,6 +1025,483 @@ void luaC_checkfinalizer (lua_State *L, GCObject *o, Table *mt) {
 
 
 
+/*
+** {======================================================
+** Generational Collector
+** =======================================================
+*/
+
+static l_mem atomic (lua_State *L);
+static int entersweep (lua_State *L);
+static void incstep (lua_State *L, global_State *g, l_mem debt);
+
+
+/*
+** Turn a surviving object old to enter generational mode. All threads
+** ---which are now old---must be in a gray list. So must weak tables,
+** which the collector keeps gray (so changes to them went without
+** barriers); they become "touched". Tables touched since the atomic
+** step are already in 'grayagain' (see 'luaC_barrierback_').
+** Everything else is not in a gray list and is black. (A live white
+** object is a dead string that was reused after the atomic step.)
+*/
+static void setold (global_State *g, GCObject *o) {
+  if (o->tt == LUA_TTHREAD) {  /* threads must be watched */
+    lua_State *th = gco2th(o);
+    lua_assert(isgray(th));
+    setage(o, G_OLD);
+    linkgclist(th, g->grayagain);  /* insert into 'grayagain' list */
+  }
+  else if (getage(o) == G_TOUCHED1)  /* already in 'grayagain'? */
+    return;
+  else if (isgray(o)) {  /* weak table */
+    Table *h = gco2t(o);
+    setage(o, G_TOUCHED1);
+    linkgclist(h, g->grayagain);
+  }
+  else {  /* everything else is black */
+    resetbits(o->marked, WHITEBITS);
+    gray2black(o);
+    setage(o, G_OLD);
+  }
+}
+
+
+/*
+** Sweep at most 'count' elements of a list of objects to enter
+** generational mode. Deletes dead objects and turns the non dead to
+** old. Return where to continue the traversal or NULL if list is
+** finished.
+*/
+static GCObject **sweep2old (lua_State *L, GCObject **p, lu_mem count) {
+  global_State *g = G(L);
+  int ow = otherwhite(g);
+  while (*p != NULL && count-- > 0) {
+    GCObject *curr = *p;
+    if (isdeadm(ow, curr->marked)) {  /* is 'curr' dead? */
+      *p = curr->next;  /* remove 'curr' from list */
+      freeobj(L, curr);  /* erase 'curr' */
+    }
+    else {  /* all surviving objects become old */
+      setold(g, curr);
+      p = &curr->next;  /* go to next element */
+    }
+  }
+  return (*p == NULL) ? NULL : p;
+}
+
+
+/*
+** sweep a list to old until a live object (or end of list)
+*/
+static GCObject **sweep2oldtolive (lua_State *L, GCObject **p) {
+  GCObject **old = p;
+  do {
+    p = sweep2old(L, p, 1);
+  } while (p == old);
+  return p;
+}
+
+
+/*
+** Sweep for generational mode. Delete dead objects. (Because the
+** collection is not incremental, there are no "new white" objects
+** during the sweep. So, any white object must be dead.) For
+** non-dead objects, advance their ages and clear the color of
+** new objects. (Old objects keep their colors.)
+** The ages of G_TOUCHED1 and G_TOUCHED2 objects cannot be advanced
+** here, because these old-generation objects are usually not swept
+** here.  They will all be advanced in 'correctgraylist'. That function
+** will also remove objects turned white here from any gray list.
+*/
+static GCObject **sweepgen (lua_State *L, global_State *g, GCObject **p,
+                            GCObject *limit, GCObject **pfirstold1) {
+  static const lu_byte nextage[] = {
+    G_SURVIVAL,  /* from G_NEW */
+    G_OLD1,      /* from G_SURVIVAL */
+    G_OLD1,      /* from G_OLD0 */
+    G_OLD,       /* from G_OLD1 */
+    G_OLD,       /* from G_OLD (do not change) */
+    G_TOUCHED1,  /* from G_TOUCHED1 (do not change) */
+    G_TOUCHED2   /* from G_TOUCHED2 (do not change) */
+  };
+  int white = luaC_white(g);
+  GCObject *curr;
+  while ((curr = *p) != limit) {
+    if (iswhite(curr)) {  /* is 'curr' dead? */
+      lua_assert(!isold(curr) && isdead(g, curr));
+      *p = curr->next;  /* remove 'curr' from list */
+      freeobj(L, curr);  /* erase 'curr' */
+    }
+    else {  /* correct mark and age */
+      if (getage(curr) == G_NEW) {  /* new objects go back to white */
+        curr->marked = cast_byte((curr->marked & maskgcbits) | white);
+        setage(curr, G_SURVIVAL);
+      }
+      else {  /* all other objects will be old, and so keep their color */
+        setage(curr, nextage[getage(curr)]);
+        if (getage(curr) == G_OLD1 && *pfirstold1 == NULL)
+          *pfirstold1 = curr;  /* first OLD1 object in the list */
+      }
+      p = &curr->next;  /* go to next element */
+    }
+  }
+  return p;
+}
+
+
+/*
+** Traverse a list making all its elements white and clearing their
+** age. In incremental mode, all objects are 'new' all the time,
+** except for fixed strings (which are always old).
+*/
+static void whitelist (global_State *g, GCObject *p) {
+  int white = luaC_white(g);
+  for (; p != NULL; p = p->next)
+    p->marked = cast_byte((p->marked & maskgcbits) | white);
+}
+
+
+/* field 'gclist' of a gray object */
+static GCObject **getgclist (GCObject *o) {
+  switch (o->tt) {
+    case LUA_TTABLE: return &gco2t(o)->gclist;
+    case LUA_TLCL: return &gco2lcl(o)->gclist;
+    case LUA_TCCL: return &gco2ccl(o)->gclist;
+    case LUA_TTHREAD: return &gco2th(o)->gclist;
+    case LUA_TPROTO: return &gco2p(o)->gclist;
+    default: lua_assert(0); return NULL;
+  }
+}
+
+
+/*
+** Correct a list of gray objects. Return pointer to where rest of the
+** list should be linked.
+** Because this correction is done after sweeping, young objects might
+** be turned white and still be in the list. They are only removed.
+** 'TOUCHED1' objects are advanced to 'TOUCHED2' and remain on the list;
+** Non-white threads also remain on the list; 'TOUCHED2' objects become
+** regular old; they and anything else are removed from the list.
+*/
+static GCObject **correctgraylist (GCObject **p) {
+  GCObject *curr;
+  while ((curr = *p) != NULL) {
+    GCObject **next = getgclist(curr);
+    if (iswhite(curr))
+      *p = *next;  /* remove all white objects */
+    else if (getage(curr) == G_TOUCHED1) {  /* touched in this cycle? */
+      lua_assert(isgray(curr));
+      gray2black(curr);  /* make it black, for next barrier */
+      changeage(curr, G_TOUCHED1, G_TOUCHED2);
+      p = next;  /* keep it in the list and go to next element */
+    }
+    else if (curr->tt == LUA_TTHREAD) {
+      lua_assert(isgray(curr));
+      p = next;  /* keep non-white threads on the list */
+    }
+    else {  /* everything else is removed */
+      lua_assert(isold(curr));  /* young objects should be white here */
+      if (getage(curr) == G_TOUCHED2)  /* advance from TOUCHED2... */
+        changeage(curr, G_TOUCHED2, G_OLD);  /* ... to OLD */
+      gray2black(curr);  /* make object black (to be removed) */
+      *p = *next;
+    }
+  }
+  return p;
+}
+
+
+/*
+** Correct all gray lists, coalescing them into 'grayagain'.
+*/
+static void correctgraylists (global_State *g) {
+  GCObject **list = correctgraylist(&g->grayagain);
+  *list = g->weak; g->weak = NULL;
+  list = correctgraylist(list);
+  *list = g->allweak; g->allweak = NULL;
+  list = correctgraylist(list);
+  *list = g->ephemeron; g->ephemeron = NULL;
+  correctgraylist(list);
+}
+
+
+/*
+** Mark black 'OLD1' objects when starting a new young collection.
+** Gray objects are already in some gray list, and so will be visited
+** in the atomic step.
+*/
+static void markold (global_State *g, GCObject *from, GCObject *to) {
+  GCObject *p;
+  for (p = from; p != to; p = p->next) {
+    if (getage(p) == G_OLD1) {
+      lua_assert(!iswhite(p));
+      changeage(p, G_OLD1, G_OLD);  /* now they are old */
+      if (isblack(p)) {
+        black2gray(p);
+        reallymarkobject(g, p);
+      }
+    }
+  }
+}
+
+
+/*
+** Finish a young-generation collection. (Only major collections shrink
+** the string table: after a minor one, its use says little about the
+** strings really alive, and the table would shrink just to grow again.)
+*/
+static void finishgencycle (lua_State *L, global_State *g) {
+  correctgraylists(g);
+  g->gcstate = GCSpropagate;  /* skip restart */
+  if (g->gckind != KGC_EMERGENCY)
+    callallpendingfinalizers(L, 1);
+}
+
+
+/*
+** Does a young collection. First, mark 'OLD1' objects. Then does the
+** atomic step. Then, sweep all lists and advance pointers. Finally,
+** finish the collection.
+*/
+static void youngcollection (lua_State *L, global_State *g) {
+  GCObject **psurvival;  /* to point to first non-dead survival object */
+  GCObject *dummy;  /* dummy out parameter to 'sweepgen' */
+  lua_assert(g->gcstate == GCSpropagate);
+  if (g->firstold1) {  /* are there regular OLD1 objects? */
+    markold(g, g->firstold1, g->reallyold);  /* mark them */
+    g->firstold1 = NULL;  /* no more OLD1 objects (for now) */
+  }
+  markold(g, g->finobj, g->finobjrold);
+  markold(g, g->tobefnz, NULL);
+  atomic(L);
+
+  /* sweep nursery and get a pointer to its last live element */
+  g->gcstate = GCSswpallgc;
+  psurvival = sweepgen(L, g, &g->allgc, g->survival, &g->firstold1);
+  /* sweep 'survival' */
+  sweepgen(L, g, psurvival, g->old1, &g->firstold1);
+  g->reallyold = g->old1;
+  g->old1 = *psurvival;  /* 'survival' survivals are old now */
+  g->survival = g->allgc;  /* all news are survivals */
+
+  /* repeat for 'finobj' lists */
+  dummy = NULL;  /* no 'firstold1' optimization for 'finobj' lists */
+  psurvival = sweepgen(L, g, &g->finobj, g->finobjsur, &dummy);
+  /* sweep 'survival' */
+  sweepgen(L, g, psurvival, g->finobjold1, &dummy);
+  g->finobjrold = g->finobjold1;
+  g->finobjold1 = *psurvival;  /* 'survival' survivals are old now */
+  g->finobjsur = g->finobj;  /* all news are survivals */
+
+  sweepgen(L, g, &g->tobefnz, NULL, &dummy);
+  finishgencycle(L, g);
+  g->gcstats.minors++;
+}
+
+
+/*
+** Clears all gray lists, sweeps objects, and prepare sublists to enter
+** generational mode. The sweeps remove dead objects and turn all
+** surviving objects to old (see 'setold'). The main thread is not in
+** 'allgc', so it is handled apart.
+** Only the (usually short) lists of objects with finalizers and the
+** first survivor in 'allgc' are swept here; 'oldsweepstep' sweeps the
+** rest of 'allgc' in small steps, before the first minor collection.
+** Objects created meanwhile go before that first survivor, in the
+** young part of 'allgc'.
+*/
+static void atomic2gen (lua_State *L, global_State *g) {
+  g->gray = g->grayagain = NULL;
+  g->weak = g->allweak = g->ephemeron = NULL;
+  g->gcstate = GCSswpallgc;
+  sweep2old(L, &g->finobj, MAX_LUMEM);
+  g->finobjrold = g->finobjold1 = g->finobjsur = g->finobj;
+  sweep2old(L, &g->tobefnz, MAX_LUMEM);
+
+  /* everything alive from the first survivor on will be old */
+  g->sweepgc = sweep2oldtolive(L, &g->allgc);
+  g->reallyold = g->old1 = g->survival = g->allgc;
+  g->firstold1 = NULL;  /* there are no OLD1 objects anywhere */
+
+  setage(g->mainthread, G_OLD);
+  linkgclist(g->mainthread, g->grayagain);
+  g->gcmode = KGC_GEN;
+  g->GCestimate = gettotalbytes(g);  /* base for memory control */
+  finishgencycle(L, g);
+  g->gcstats.cycles++;
+}
+
+
+/*
+** Set debt for the next minor collection, which will happen when
+** memory grows 'genminormul'%.
+*/
+static void setminordebt (global_State *g) {
+  luaE_setdebt(g, -(cast(l_mem, (gettotalbytes(g) / 100)) * g->genminormul));
+}
+
+
+/*
+** Turns old some more survivors of the last major collection, paying
+** 'debt' work units. After the last one, minor collections can start.
+*/
+static void oldsweepstep (lua_State *L, global_State *g, l_mem debt) {
+  while (g->sweepgc != NULL && debt > -GCSTEPSIZE) {
+    l_mem olddebt = g->GCdebt;
+    g->sweepgc = sweep2old(L, g->sweepgc, GCSWEEPMAX);
+    g->GCestimate += g->GCdebt - olddebt;  /* update estimate */
+    debt -= GCSWEEPMAX * GCSWEEPCOST;
+  }
+  if (g->sweepgc != NULL)  /* still something to sweep? */
+    luaE_setdebt(g, (debt / g->gcstepmul) * STEPMULADJ);
+  else {
+    checkSizes(L, g);
+    setminordebt(g);
+  }
+}
+
+
+/*
+** Enter generational mode. Must go until the end of an atomic cycle
+** to ensure that all objects are correctly marked and weak tables
+** are cleared. Then, turn all objects into old and finishes the
+** collection.
+*/
+static l_mem entergen (lua_State *L, global_State *g) {
+  l_mem work;
+  luaC_runtilstate(L, bitmask(GCSpause));  /* prepare to start a new cycle */
+  luaC_runtilstate(L, bitmask(GCSpropagate));  /* start new cycle */
+  work = atomic(L);  /* propagates all and then do the atomic stuff */
+  atomic2gen(L, g);
+  oldsweepstep(L, g, MAX_LMEM);  /* turn all survivors old at once */
+  return work;
+}
+
+
+/*
+** Enter incremental mode. Turn all objects white, make all
+** intermediate lists point to NULL (to avoid invalid pointers),
+** and go to the pause state.
+*/
+static void enterinc (lua_State *L, global_State *g) {
+  if (g->sweepgc != NULL) {  /* survivors still being turned old? */
+    sweepwholelist(L, g->sweepgc);  /* finish removing dead objects */
+    g->sweepgc = NULL;
+  }
+  whitelist(g, g->allgc);
+  g->reallyold = g->old1 = g->survival = g->firstold1 = NULL;
+  whitelist(g, g->finobj);
+  whitelist(g, g->tobefnz);
+  g->finobjrold = g->finobjold1 = g->finobjsur = NULL;
+  makewhite(g, g->mainthread);
+  g->gcstate = GCSpause;
+  g->gcmode = KGC_INC;
+}
+
+
+/*
+** Change collector mode to 'newmode'. An incremental major collection
+** ('KGC_GENMAJOR') simply goes on as an incremental cycle.
+*/
+void luaC_changemode (lua_State *L, int newmode) {
+  global_State *g = G(L);
+  if (newmode != g->gcmode) {  /* does it need to change? */
+    if (g->gcmode == KGC_GEN)  /* doing minor collections? */
+      enterinc(L, g);  /* go back to incremental mode */
+    else
+      g->gcmode = KGC_INC;
+    if (newmode == KGC_GEN)  /* entering generational mode? */
+      entergen(L, g);
+  }
+}
+
+
+/*
+** Does a full collection in generational mode.
+*/
+static l_mem fullgen (lua_State *L, global_State *g) {
+  enterinc(L, g);
+  return entergen(L, g);
+}
+
+
+/*
+** Starts an incremental major collection. Nothing is dead yet (the
+** last minor collection swept the young objects), so the sweep that
+** starts the cycle only turns all objects white and clears their ages,
+** giving an ordinary incremental cycle in mode 'KGC_GENMAJOR'. Its
+** atomic step decides whether to go back to minor collections (see
+** 'checkmajorminor').
+*/
+static void minor2inc (lua_State *L, global_State *g) {
+  g->GCmajorminor = g->GCestimate;  /* memory after last major */
+  g->gcmode = KGC_GENMAJOR;
+  g->reallyold = g->old1 = g->survival = g->firstold1 = NULL;
+  g->finobjrold = g->finobjold1 = g->finobjsur = NULL;
+  entersweep(L);
+}
+
+
+/*
+** Called at the end of the atomic step of every incremental cycle.
+** In mode 'KGC_GENMAJOR', the collection goes back to minor collections
+** when it is going to free at least half of what the program allocated
+** since the last major collection ('GCmajorminor'); its survivors then
+** become old (see 'atomic2gen'). Otherwise the program is building up
+** its data, and the collector stays incremental until a cycle frees
+** enough memory.
+*/
+static int checkmajorminor (lua_State *L, global_State *g) {
+  if (g->gcmode == KGC_GENMAJOR) {
+    lu_mem total = gettotalbytes(g);
+    lu_mem added = (total > g->GCmajorminor) ? total - g->GCmajorminor : 0;
+    lu_mem tobecollected = (total > g->GCmarked) ? total - g->GCmarked : 0;
+    if (tobecollected > added / 2) {
+      atomic2gen(L, g);
+      return 1;
+    }
+  }
+  g->GCmajorminor = g->GCmarked;  /* base for next check */
+  return 0;
+}
+
+
+/*
+** Does a generational "step", paying 'debt' work units.
+** Usually, this means doing a minor collection and setting the debt to
+** make another collection when memory grows 'genminormul'% larger.
+**
+** However, if memory grows 'genmajormul'% larger than it was at the
+** end of the last major collection (kept in 'GCestimate'), the function
+** starts a major collection. Major collections are incremental, so
+** that a large heap is not traversed in one go; only their atomic step
+** stops the program. After one, the first steps turn its survivors old
+** (see 'atomic2gen').
+**
+** 'GCdebt <= 0' means an explicit call to GC step with "size" zero;
+** in that case, do a minor collection.
+*/
+static void genstep (lua_State *L, global_State *g, l_mem debt) {
+  lu_mem majorbase = g->GCestimate;  /* memory after last major collection */
+  lu_mem majorinc = (majorbase / 100) * g->genmajormul;
+  if (g->sweepgc != NULL)  /* survivors of last major not all old yet? */
+    oldsweepstep(L, g, debt);
+  else if (g->GCdebt > 0 && gettotalbytes(g) > majorbase + majorinc) {
+    minor2inc(L, g);  /* start a major collection */
+    incstep(L, g, debt);  /* and do a first step */
+  }
+  else {  /* regular case; do a minor collection */
+    youngcollection(L, g);
+    setminordebt(g);
+    g->GCestimate = majorbase;  /* preserve base value */
+  }
+}
+
+/* }====================================================== */
+
+
+
 /*
 ** {======================================================
 ** GC control
@@ -916,13 +1514,18 @@ void luaC_checkfinalizer (lua_State *L, GCObject *o, Table *mt) {
 ** will start when memory use hits threshold. (Division by 'estimate'
 ** should be OK: it cannot be zero (because Lua cannot even start with
 ** less than PAUSEADJ bytes).
+** With time-bounded steps, the pause uses half the allowed overhead,
+** leaving the other half for what the program allocates during the
+** cycle.
 */
 static void setpause (global_State *g) {
   l_mem threshold, debt;
   l_mem estimate = g->GCestimate / PAUSEADJ;  /* adjust 'estimate' */
+  int pause = (g->gcsteptime > 0) ? PAUSEADJ + g->gcoverhead / 2
+                                  : g->gcpause;
   lua_assert(estimate > 0);
-  threshold = (g->gcpause < MAX_LMEM / estimate)  /* overflow? */
-            ? estimate * g->gcpause  /* no overflow */
+  threshold = (pause < MAX_LMEM / estimate)  /* overflow? */
+            ? estimate * pause  /* no overflow */
             : MAX_LMEM;  /* overflow; truncate to maximum */
   debt = gettotalbytes(g) - threshold;
   luaE_setdebt(g, debt);
@@ -949,6 +1552,7 @@ static int entersweep (lua_State *L) {
 
 void luaC_freeallobjects (lua_State *L) {
   global_State *g = G(L);
+  luaC_changemode(L, KGC_INC);
   separatetobefnz(g, 1);  /* separate all objects with finalizers */
   lua_assert(g->finobj == NULL);
   callallpendingfinalizers(L, 0);
@@ -967,6 +1571,7 @@ static l_mem atomic (lua_State *L) {
   l_mem work;
   GCObject *origweak, *origall;
   GCObject *grayagain = g->grayagain;  /* save original list */
+  g->grayagain = NULL;
   lua_assert(g->ephemeron == NULL && g->weak == NULL);
   lua_assert(!iswhite(g->mainthread));
   g->gcstate = GCSinsideatomic;
@@ -975,6 +1580,10 @@ static l_mem atomic (lua_State *L) {
   /* registry and global metatables may be changed by API */
   markvalue(g, &g->l_registry);
   markmt(g);  /* mark global metatables */
+#if defined(LUA_NANBOXING)
+  if (g->lastbox != NULL)  /* newest integer box may be in use by C code */
+    markobject(g, g->lastbox);
+#endif
   /* remark occasional upvalues of (maybe) dead threads */
   remarkupvals(g);
   propagateall(g);  /* propagate changes */
@@ -1028,9 +1637,10 @@ static lu_mem singlestep (lua_State *L) {
   global_State *g = G(L);
   switch (g->gcstate) {
     case GCSpause: {
-      g->GCmemtrav = g->strt.size * sizeof(GCObject*);
+      g->GCmemtrav = (g->strt.size + g->strt.oldsize) * sizeof(GCObject*);
       restartcollection(g);
       g->gcstate = GCSpropagate;
+      g->GCmarked = g->GCmemtrav;
       return g->GCmemtrav;
     }
     case GCSpropagate: {
@@ -1039,6 +1649,7 @@ static lu_mem singlestep (lua_State *L) {
       propagatemark(g);
        if (g->gray == NULL)  /* no more gray objects? */
         g->gcstate = GCSatomic;  /* finish propagate phase */
+      g->GCmarked += g->GCmemtrav;
       return g->GCmemtrav;  /* memory traversed in this step */
     }
     case GCSatomic: {
@@ -1046,6 +1657,9 @@ static lu_mem singlestep (lua_State *L) {
       int sw;
       propagateall(g);  /* make sure gray list is empty */
       work = atomic(L);  /* work is what was traversed by 'atomic' */
+      g->GCmarked += work;
+      if (checkmajorminor(L, g))  /* back to minor collections? */
+        return work;
       sw = entersweep(L);
       g->GCestimate = gettotalbytes(g);  /* first estimate */;
       return work + sw * GCSWEEPCOST;
@@ -1072,6 +1686,7 @@ static lu_mem singlestep (lua_State *L) {
       }
       else {  /* emergency mode or no more finalizers */
         g->gcstate = GCSpause;  /* finish collection */
+        g->gcstats.cycles++;
         return 0;
       }
     }
@@ -1104,18 +1719,130 @@ static l_mem getdebt (global_State *g) {
 }
 
 /*
-** performs a basic GC step when collector is running
+** Work still pending in the current cycle, estimated from the live
+** memory of the last one: what is left to mark plus about the cost of
+** the sweep phases.
 */
-void luaC_step (lua_State *L) {
-  global_State *g = G(L);
-  l_mem debt = getdebt(g);  /* GC deficit (be paid now) */
-  if (!g->gcrunning) {  /* not running? */
-    luaE_setdebt(g, -GCSTEPSIZE * 10);  /* avoid being called too often */
+static l_mem pendingwork (global_State *g) {
+  l_mem estimate = cast(l_mem, g->GCestimate);
+  l_mem sweep = estimate / 8;
+  if (g->gcstate == GCSpropagate &&
+      estimate > cast(l_mem, g->GCmarked))  /* still marking? */
+    return estimate - cast(l_mem, g->GCmarked) + sweep;
+  else
+    return sweep;
+}
+
+
+/*
+** 'luai_gcclock' gives the time, in microseconds, used for time-bounded
+** steps and step statistics. It must be a monotonic wall clock: 'clock'
+** counts the CPU time of all threads in the process, so in a threaded
+** host it does not measure how long a step took. ISO C has nothing
+** better, so 'clock' is only the last resort.
+*/
+#if !defined(luai_gcclock)	/* { */
+
+#if defined(__APPLE__)		/* { */
+
+#define luai_gcclock()  \
+	cast(lu_mem, clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000)
+
+#elif defined(LUA_USE_POSIX) && defined(CLOCK_MONOTONIC)	/* }{ */
+
+static lu_mem luai_gcclock (void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return cast(lu_mem, ts.tv_sec) * 1000000 + cast(lu_mem, ts.tv_nsec / 1000);
+}
+
+#else				/* }{ */
+
+#define luai_gcclock()	\
+	cast(lu_mem, cast(double, clock()) * (1e6 / CLOCKS_PER_SEC))
+
+#endif				/* } */
+
+#endif				/* } */
+
+
+/*
+** Performs an incremental step bounded by time instead of by work: it
+** keeps doing single steps until 'gcsteptime' microseconds have passed
+** or the cycle ends. To avoid reading the clock too often, it checks
+** it only when the collector changes state or after each chunk of the
+** work expected to fit in a quarter of that time. (A work unit costs
+** much more time when sweeping than when marking, so there is a rate
+** for each.) Then, it sets the debt so that the program can allocate,
+** before the next step, its share of the memory left before the heap
+** exceeds the live data by 'gcoverhead'%, given how many similar steps
+** the rest of the cycle should take. The atomic step and the traversal
+** of a single object cannot be split, so they may still overrun the
+** limit.
+*/
+static void pacedstep (lua_State *L, global_State *g) {
+  lu_mem limit = cast(lu_mem, g->gcsteptime);
+  lu_mem start = luai_gcclock();
+  lu_mem elapsed = 0;
+  int phase = issweepphase(g);
+  lu_byte state = g->gcstate;
+  l_mem work = 0;
+  l_mem next = 0;
+  for (;;) {
+    work += singlestep(L);
+    if (g->gcmode == KGC_GEN) {  /* back to generational mode? */
+      elapsed = luai_gcclock() - start;
+      /* spend the time left turning survivors old */
+      oldsweepstep(L, g, (elapsed < limit)
+               ? cast(l_mem, (limit - elapsed) * g->gcworkrate[1]) : 0);
+      return;
+    }
+    if (g->gcstate == GCSpause)
+      break;
+    if (work >= next || g->gcstate != state) {  /* time to check clock? */
+      l_mem chunk = cast(l_mem, (g->gcworkrate[issweepphase(g)] * limit) / 4);
+      elapsed = luai_gcclock() - start;
+      if (elapsed >= limit)
+        break;
+      state = g->gcstate;
+      next = work + ((chunk > GCSTEPSIZE) ? chunk : GCSTEPSIZE);
+    }
+  }
+  elapsed = luai_gcclock() - start;
+  if (elapsed > 0 && phase == issweepphase(g)) {  /* update rate */
+    lu_mem *rate = &g->gcworkrate[phase];
+    *rate = (*rate + cast(lu_mem, work) / elapsed) / 2;  /* (smoothed) */
+  }
+  if (g->gcstate == GCSpause)
+    setpause(g);  /* pause until next cycle */
+  else {
+    l_mem estimate = cast(l_mem, g->GCestimate) / 100;
+    l_mem room = estimate * (100 + g->gcoverhead) -
+                 cast(l_mem, gettotalbytes(g));
+    l_mem nsteps = pendingwork(g) / (work + 1) + 1;  /* steps to go */
+    l_mem debt = (room > 0) ? room / nsteps : 0;
+    luaE_setdebt(g, -((debt > GCSTEPSIZE) ? debt : GCSTEPSIZE));
+    runafewfinalizers(L);
+  }
+}
+
+
+/*
+** performs a basic incremental step (which may end an incremental
+** major collection, going back to generational mode)
+*/
+static void incstep (lua_State *L, global_State *g, l_mem debt) {
+  if (g->gcsteptime > 0) {  /* steps bounded by time? */
+    pacedstep(L, g);
     return;
   }
   do {  /* repeat until pause or enough "credit" (negative debt) */
     lu_mem work = singlestep(L);  /* perform one single step */
     debt -= work;
+    if (g->gcmode == KGC_GEN) {  /* back to generational mode? */
+      oldsweepstep(L, g, debt);  /* pay the rest turning survivors old */
+      return;
+    }
   } while (debt > -GCSTEPSIZE && g->gcstate != GCSpause);
   if (g->gcstate == GCSpause)
     setpause(g);  /* pause until next cycle */
@@ -1128,18 +1855,96 @@ void luaC_step (lua_State *L) {
 
 
 /*
-** Performs a full GC cycle; if 'isemergency', set a flag to avoid
-** some operations which could change the interpreter state in some
-** unexpected ways (running finalizers and shrinking some structures).
+** Collector statistics. Step times are kept in a histogram (see
+** 'GCStats'), so percentiles are rounded up to the end of a bucket.
+*/
+
+static int timebucket (lu_mem t) {
+  int e = 2;  /* 't' is in [2^e, 2^(e+1)) */
+  if (t < 4) return cast_int(t);
+  while ((t >> e) >= 2) e++;
+  if (e > GCHISTSIZE / 4)
+    return GCHISTSIZE - 1;
+  return 4 * (e - 1) + cast_int((t >> (e - 2)) & 3);
+}
+
+
+static lu_mem bucketlimit (int b) {  /* largest time in bucket 'b' */
+  int e;
+  if (b < 4) return cast(lu_mem, b);
+  e = b / 4 + 1;
+  return (cast(lu_mem, 4 + b % 4 + 1) << (e - 2)) - 1;
+}
+
+
+static void recordstep (global_State *g, lu_mem t) {
+  GCStats *st = &g->gcstats;
+  st->hist[timebucket(t)]++;
+  st->steps++;
+  st->totaltime += t;
+  if (t > st->maxtime) st->maxtime = t;
+}
+
+
+static lu_mem percentile (GCStats *st, int p) {
+  lu_mem rank = (st->steps * p + 99) / 100;  /* rank of wanted step */
+  lu_mem count = 0;
+  int b;
+  if (st->steps == 0) return 0;
+  for (b = 0; b < GCHISTSIZE; b++) {
+    count += st->hist[b];
+    if (count >= rank) {
+      lu_mem t = bucketlimit(b);
+      return (t < st->maxtime) ? t : st->maxtime;
+    }
+  }
+  return st->maxtime;
+}
+
+
+void luaC_getstats (lua_State *L, lua_GCStats *res, int reset) {
+  GCStats *st = &G(L)->gcstats;
+  res->steps = cast(size_t, st->steps);
+  res->cycles = cast(size_t, st->cycles);
+  res->minors = cast(size_t, st->minors);
+  res->swept = cast(size_t, st->swept);
+  res->p50 = cast(size_t, percentile(st, 50));
+  res->p99 = cast(size_t, percentile(st, 99));
+  res->max = cast(size_t, st->maxtime);
+  res->time = cast(size_t, st->totaltime);
+  if (reset)
+    memset(st, 0, sizeof(*st));
+}
+
+
+/*
+** performs a basic GC step when collector is running
+*/
+void luaC_step (lua_State *L) {
+  global_State *g = G(L);
+  l_mem debt = getdebt(g);  /* GC deficit (be paid now) */
+  lu_mem start = (g->gctiming) ? luai_gcclock() : 0;
+  if (g->strt.oldhash != NULL)  /* resizing the string table? */
+    luaS_resizestep(L, STRRESIZESTEP * 4);
+  if (!g->gcrunning)  /* not running? */
+    luaE_setdebt(g, -GCSTEPSIZE * 10);  /* avoid being called too often */
+  else if (g->gcmode == KGC_GEN)
+    genstep(L, g, debt);
+  else  /* incremental mode or incremental major collection */
+    incstep(L, g, debt);
+  if (g->gctiming)
+    recordstep(g, luai_gcclock() - start);
+}
+
+
+/*
+** Performs a full GC cycle in incremental mode.
 ** Before running the collection, check 'keepinvariant'; if it is true,
 ** there may be some objects marked as black, so the collector has
 ** to sweep all objects to turn them back to white (as white has not
 ** changed, nothing will be collected).
 */
-void luaC_fullgc (lua_State *L, int isemergency) {
-  global_State *g = G(L);
-  lua_assert(g->gckind == KGC_NORMAL);
-  if (isemergency) g->gckind = KGC_EMERGENCY;  /* set flag */
+static void fullinc (lua_State *L, global_State *g) {
   if (keepinvariant(g)) {  /* black objects? */
     entersweep(L); /* sweep everything to turn them back to white */
   }
@@ -1150,10 +1955,30 @@ void luaC_fullgc (lua_State *L, int isemergency) {
   /* estimate must be correct after a full GC cycle */
   lua_assert(g->GCestimate == gettotalbytes(g));
   luaC_runtilstate(L, bitmask(GCSpause));  /* finish collection */
-  g->gckind = KGC_NORMAL;
   setpause(g);
 }
 
+
+/*
+** Performs a full GC cycle; if 'isemergency', set a flag to avoid
+** some operations which could change the interpreter state in some
+** unexpected ways (running finalizers and shrinking some structures).
+*/
+void luaC_fullgc (lua_State *L, int isemergency) {
+  global_State *g = G(L);
+  lua_assert(g->gckind == KGC_NORMAL);
+  if (isemergency) g->gckind = KGC_EMERGENCY;  /* set flag */
+  if (g->gcmode == KGC_GEN)
+    fullgen(L, g);
+  else {  /* an incremental major collection ends like any other cycle */
+    lu_byte mode = g->gcmode;
+    g->gcmode = KGC_INC;  /* do not go back to minor collections midway */
+    fullinc(L, g);
+    g->gcmode = mode;
+  }
+  g->gckind = KGC_NORMAL;
+}
+
 /* }====================================================== */
 
 
@@ -22,6 +22,14 @@
 ** allweak, ephemeron) so that it can be visited again before finishing
 ** the collection cycle. These lists have no meaning when the invariant
 ** is not being enforced (e.g., sweep phase).
+**
+** In generational mode, each object also has an age (see below). A
+** minor collection traverses only young objects plus old objects
+** that were "touched" (made to point to young ones) since the last
+** one; old objects are black, so the barriers find the touched ones.
+** Major collections are ordinary incremental cycles, interleaved with
+** the program; afterwards, their survivors are turned old in small
+** steps too.
 */
 
 
@@ -79,6 +87,7 @@
 #define WHITE1BIT	1  /* object is white (type 1) */
 #define BLACKBIT	2  /* object is black */
 #define FINALIZEDBIT	3  /* object has been marked for finalization */
+/* bits 4-6 are the object age (generational mode) */
 /* bit 7 is currently used by tests (luaL_checkmemory) */
 
 #define WHITEBITS	bit2mask(WHITE0BIT, WHITE1BIT)
@@ -101,6 +110,48 @@
 #define luaC_white(g)	cast(lu_byte, (g)->currentwhite & WHITEBITS)
 
 
+/*
+** Object ages in generational mode. A new object survives its first
+** minor collection to become a survival and its second one to become
+** old. An old object that gets a barrier is "touched"; it stays in a
+** gray list until the next two minor collections have traversed it.
+** Objects that become old inside one cycle (OLD0, by a forward barrier,
+** and OLD1, in the next cycle) may still point to young objects, so
+** they are traversed once more before being really old.
+*/
+#define G_NEW		0	/* created in current cycle */
+#define G_SURVIVAL	1	/* created in previous cycle */
+#define G_OLD0		2	/* marked old by frw. barrier in this cycle */
+#define G_OLD1		3	/* first full cycle as old */
+#define G_OLD		4	/* really old object (not to be visited) */
+#define G_TOUCHED1	5	/* old object touched this cycle */
+#define G_TOUCHED2	6	/* old object touched in previous cycle */
+
+#define AGEBITS		(7 << 4)  /* all age bits (111 << 4) */
+
+#define getage(o)	(((o)->marked & AGEBITS) >> 4)
+#define setage(o,a)  ((o)->marked = cast_byte(((o)->marked & (~AGEBITS)) | \
+                                              ((a) << 4)))
+#define isold(o)	(getage(o) > G_SURVIVAL)
+
+#define changeage(o,f,t)  \
+	check_exp(getage(o) == (f), (o)->marked ^= (((f)^(t)) << 4))
+
+
+/* default values for the generational parameters (in percentages) */
+#if !defined(LUAI_GENMINORMUL)
+#define LUAI_GENMINORMUL	20	/* allocation between minor collections */
+#endif
+#if !defined(LUAI_GENMAJORMUL)
+#define LUAI_GENMAJORMUL	100	/* growth of old memory before a major */
+#endif
+
+/* default heap overhead (in percentage) for time-bounded steps */
+#if !defined(LUAI_GCOVERHEAD)
+#define LUAI_GCOVERHEAD		100
+#endif
+
+
 #define luaC_condGC(L,c) \
 	{if (G(L)->GCdebt > 0) {c;}; condchangemem(L);}
 #define luaC_checkGC(L)		luaC_condGC(L, luaC_step(L);)
@@ -133,6 +184,8 @@ LUAI_FUNC void luaC_barrierback_ (lua_State *L, Table *o);
 LUAI_FUNC void luaC_upvalbarrier_ (lua_State *L, UpVal *uv);
 LUAI_FUNC void luaC_checkfinalizer (lua_State *L, GCObject *o, Table *mt);
 LUAI_FUNC void luaC_upvdeccount (lua_State *L, UpVal *uv);
+LUAI_FUNC void luaC_changemode (lua_State *L, int newmode);
+LUAI_FUNC void luaC_getstats (lua_State *L, lua_GCStats *st, int reset);
 
 
 #endif
@@ -215,6 +215,22 @@ static int f_gc (lua_State *L) {
 }
 
 
+static int io_noclose (lua_State *L);
+
+
+/*
+** __clone (see 'lua_clonestate'): closed files and the standard files,
+** which are never closed, can be copied into a cloned state; any other
+** file would be closed by both states
+*/
+static int f_clone (lua_State *L) {
+  LStream *p = tolstream(L);
+  if (!isclosed(p) && p->closef != &io_noclose)
+    return luaL_error(L, "cannot clone an open file");
+  return 0;
+}
+
+
 /*
 ** function to close regular files
 */
@@ -509,6 +525,28 @@ static int read_chars (lua_State *L, FILE *f, size_t n) {
 }
 
 
+/*
+** reads into the typed array at 'arg', as many elements as the file has
+** up to its size, and returns how many it read
+*/
+static int read_array (lua_State *L, FILE *f, int arg) {
+  int kind;
+  size_t n;
+  void *p;
+  luaL_argcheck(L, lua_isarray(L, arg), arg, "invalid format");
+  p = lua_toarray(L, arg, &kind, &n);
+  if (n == 0) {  /* like 'read(0)': fails only at end of file */
+    int c = getc(f);
+    ungetc(c, f);
+    lua_pushinteger(L, 0);
+    return (c != EOF);
+  }
+  n = fread(p, lua_arrayelemsize(kind), n, f);
+  lua_pushinteger(L, (lua_Integer)n);
+  return (n > 0);
+}
+
+
 static int g_read (lua_State *L, FILE *f, int first) {
   int nargs = lua_gettop(L) - 1;
   int success;
@@ -526,6 +564,8 @@ static int g_read (lua_State *L, FILE *f, int first) {
         size_t l = (size_t)luaL_checkinteger(L, n);
         success = (l == 0) ? test_eof(L, f) : read_chars(L, f, l);
       }
+      else if (lua_type(L, n) == LUA_TUSERDATA)
+        success = read_array(L, f, n);
       else {
         const char *p = luaL_checkstring(L, n);
         if (*p == '*') p++;  /* skip optional '*' (for compatibility) */
@@ -604,6 +644,9 @@ static int g_write (lua_State *L, FILE *f, int arg) {
   int nargs = lua_gettop(L) - arg;
   int status = 1;
   for (; nargs--; arg++) {
+    int kind;
+    size_t n;
+    void *p;
     if (lua_type(L, arg) == LUA_TNUMBER) {
       /* optimization: could be done exactly as for strings */
       int len = lua_isinteger(L, arg)
@@ -611,9 +654,20 @@ static int g_write (lua_State *L, FILE *f, int arg) {
                 : fprintf(f, LUA_NUMBER_FMT, lua_tonumber(L, arg));
       status = status && (len > 0);
     }
+    else if (lua_isarray(L, arg)) {
+      /* typed array: write its memory as it is */
+      p = lua_toarray(L, arg, &kind, &n);
+      status = status && (fwrite(p, lua_arrayelemsize(kind), n, f) == n);
+    }
+    else if ((p = luaL_testudata(L, arg, LUA_BUFFERHANDLE)) != NULL) {
+      /* string buffer: write its bytes with no intermediate string */
+      luaL_StrBuffer *sb = (luaL_StrBuffer *)p;
+      status = status && (fwrite(sb->b, sizeof(char), sb->n, f) == sb->n);
+    }
     else {
       size_t l;
-      const char *s = luaL_checklstring(L, arg, &l);
+      const char *s = lua_toview(L, arg, &l);  /* no need for a '\0' */
+      if (s == NULL) luaL_checklstring(L, arg, &l);  /* raise the error */
       status = status && (fwrite(s, sizeof(char), l, f) == l);
     }
   }
@@ -706,6 +760,7 @@ static const luaL_Reg flib[] = {
   {"setvbuf", f_setvbuf},
   {"write", f_write},
   {"__gc", f_gc},
+  {"__clone", f_clone},
   {"__tostring", f_tostring},
   {NULL, NULL}
 };
@@ -0,0 +1,1300 @@
+/*
+** $Id: ljit.c $
+** Baseline compiler from Lua bytecode to x86-64 machine code
+** See Copyright Notice in lua.h
+*/
+
+#define ljit_c
+#define LUA_CORE
+
+#if !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE  /* for MAP_ANONYMOUS */
+#endif
+
+#include "lprefix.h"
+
+
+#include "lua.h"
+
+#include "ljit.h"
+
+
+#if defined(LUAI_JIT)	/* { */
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "ldo.h"
+#include "lfunc.h"
+#include "lgc.h"
+#include "lmem.h"
+#include "lopcodes.h"
+#include "lstring.h"
+#include "ltable.h"
+#include "ltm.h"
+#include "lvm.h"
+
+
+/*
+** A hot function (see 'luaJ_ready') is compiled as a whole, one
+** instruction after the other. The machine code goes into a chunk of
+** executable memory shared with other functions (see 'JitHeap'); the
+** 'JitCode' header, with the offset of the code of each instruction,
+** is an ordinary block of the state. The code of simple
+** instructions and the common cases of arithmetic, comparisons, loops
+** and array accesses is inline; everything else calls a helper below,
+** which does what 'luaV_execute' does for that instruction. The code
+** keeps 'savedpc' up to date before calling a helper, so errors, hooks,
+** the debug library and yields see the same frame as in the interpreter.
+**
+** The machine code never calls a Lua function nor returns to a Lua
+** caller by itself: it returns to 'luaV_execute' (see LUAJ_CALL and
+** LUAJ_RETURN), which enters the machine code of the next frame.
+** Therefore it may start at any instruction: its prologue jumps to the
+** code of the instruction at 'savedpc'. It also gives the frame back to
+** the interpreter (LUAJ_EXIT) for tail calls and when a line or count
+** hook is set.
+*/
+
+typedef struct JitCode {
+  struct JitChunk *chunk;  /* chunk with the machine code */
+  lu_byte *code;  /* machine code (it starts with the prologue) */
+  int n;  /* number of entries in 'pcoff' */
+  unsigned int pcoff[1];  /* offset of the code of each instruction */
+} JitCode;
+
+#define sizejitcode(n)	(offsetof(JitCode, pcoff) + (n) * sizeof(unsigned int))
+
+
+/* prologue of the machine code of a function */
+typedef int (*JitEntry) (lua_State *L, CallInfo *ci, const void *code);
+
+/* any helper called by the machine code */
+typedef void (*Helper) (void);
+
+
+
+/*
+** {======================================================
+** Helpers
+** =======================================================
+*/
+
+#define RA(i)	(base+GETARG_A(i))
+#define RB(i)	(base+GETARG_B(i))
+#define RKB(i)	(ISK(GETARG_B(i)) ? k+INDEXK(GETARG_B(i)) : base+GETARG_B(i))
+#define RKC(i)	(ISK(GETARG_C(i)) ? k+INDEXK(GETARG_C(i)) : base+GETARG_C(i))
+
+#define checkGC(L,c)  \
+  { luaC_condGC(L,{L->top = (c);  /* limit of live values */ \
+                   luaC_step(L); \
+                   L->top = L->ci->top;})  /* restore top */ \
+    luai_threadyield(L); }
+
+
+/* OP_GETTABUP, OP_GETTABLE, and OP_SELF */
+static void h_index (lua_State *L, Instruction i, TValue *k,
+                     FieldCache *fc) {
+  CallInfo *ci = L->ci;
+  StkId base = ci->u.l.base;
+  StkId ra = RA(i);
+  TValue *rc = RKC(i);
+  const TValue *t;
+  if (GET_BASEOP(i) == OP_GETTABUP)
+    t = clLvalue(ci->func)->upvals[GETARG_B(i)]->v;
+  else {
+    t = RB(i);
+    if (GET_BASEOP(i) == OP_SELF)
+      setobjs2s(L, ra + 1, t);
+  }
+  if (isfieldkey(GETARG_C(i), rc)) {
+    const TValue *v = fastfield(t, rc, fc);
+    if (v != NULL) { setobj2s(L, ra, v); }
+    else luaV_getfield(L, t, rc, ra, fc);
+  }
+  else
+    luaV_gettable(L, t, rc, ra);
+}
+
+
+/* OP_SETTABUP and OP_SETTABLE */
+static void h_newindex (lua_State *L, Instruction i, TValue *k,
+                        FieldCache *fc) {
+  CallInfo *ci = L->ci;
+  StkId base = ci->u.l.base;
+  TValue *rb = RKB(i);
+  TValue *rc = RKC(i);
+  const TValue *t = (GET_BASEOP(i) == OP_SETTABUP)
+                    ? clLvalue(ci->func)->upvals[GETARG_A(i)]->v : RA(i);
+  if (isfieldkey(GETARG_B(i), rb)) {
+    TValue *v = cast(TValue *, fastfield(t, rb, fc));
+    if (v != NULL) {
+      setobj2t(L, v, rc);
+      invalidateTMcache(hvalue(t));
+      luaC_barrierback(L, hvalue(t), rc);
+    }
+    else luaV_setfield(L, t, rb, rc, fc);
+  }
+  else
+    luaV_settable(L, t, rb, rc);
+}
+
+
+static void h_loadnil (lua_State *L, Instruction i) {
+  StkId ra = L->ci->u.l.base + GETARG_A(i);
+  int b = GETARG_B(i);
+  do {
+    setnilvalue(ra++);
+  } while (b--);
+}
+
+
+static void h_setupval (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  UpVal *uv = clLvalue(ci->func)->upvals[GETARG_B(i)];
+  setobj(L, uv->v, ci->u.l.base + GETARG_A(i));
+  luaC_upvalbarrier(L, uv);
+}
+
+
+static void h_newtable (lua_State *L, Instruction i) {
+  StkId ra = L->ci->u.l.base + GETARG_A(i);
+  int b = GETARG_B(i);
+  int c = GETARG_C(i);
+  Table *t;
+  if (b == 0 && luaO_fb2int(c) <= MAXSHAPEKEYS) {  /* a record? */
+    t = luaH_newrecord(L, &G(L)->shaperoot, luaO_fb2int(c));
+    sethvalue(L, ra, t);
+  }
+  else {
+    t = luaH_new(L);
+    sethvalue(L, ra, t);
+    if (b != 0 || c != 0)
+      luaH_resize(L, t, luaO_fb2int(b), luaO_fb2int(c));
+  }
+  checkGC(L, ra + 1);
+}
+
+
+/* arithmetic and bitwise operators (same order as LUA_OPADD...) */
+static void h_arith (lua_State *L, Instruction i, TValue *k) {
+  StkId base = L->ci->u.l.base;
+  int op = cast_int(GET_BASEOP(i) - OP_ADD) + LUA_OPADD;
+  TValue *rb = RKB(i);
+  TValue *rc = (op == LUA_OPUNM || op == LUA_OPBNOT) ? rb : RKC(i);
+  luaO_arith(L, op, rb, rc, RA(i));
+}
+
+
+static void h_not (lua_State *L, Instruction i) {
+  StkId base = L->ci->u.l.base;
+  int res = l_isfalse(RB(i));  /* next assignment may change this value */
+  setbvalue(RA(i), res);
+}
+
+
+static void h_len (lua_State *L, Instruction i) {
+  StkId base = L->ci->u.l.base;
+  luaV_objlen(L, RA(i), RB(i));
+}
+
+
+static void h_concat (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  int b = GETARG_B(i);
+  int c = GETARG_C(i);
+  StkId ra, rb;
+  L->top = ci->u.l.base + c + 1;  /* mark the end of concat operands */
+  luaV_concat(L, c - b + 1);
+  ra = ci->u.l.base + GETARG_A(i);  /* stack may have moved */
+  rb = ci->u.l.base + b;
+  setobjs2s(L, ra, rb);
+  checkGC(L, (ra >= rb ? ra + 1 : rb));
+  L->top = ci->top;  /* restore top */
+}
+
+
+/* OP_EQ, OP_LT, and OP_LE: value of the comparison */
+static int h_compare (lua_State *L, Instruction i, TValue *k) {
+  StkId base = L->ci->u.l.base;
+  TValue *rb = RKB(i);
+  TValue *rc = RKC(i);
+  switch (GET_BASEOP(i)) {
+    case OP_EQ: return cast_int(luaV_equalobj(L, rb, rc));
+    case OP_LT: return luaV_lessthan(L, rb, rc);
+    default: return luaV_lessequal(L, rb, rc);
+  }
+}
+
+
+/* OP_JMP closing upvalues */
+static void h_close (lua_State *L, Instruction i) {
+  luaF_close(L, L->ci->u.l.base + GETARG_A(i) - 1);
+}
+
+
+/* returns whether it pushed the frame of a Lua function */
+static int h_call (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  StkId ra = ci->u.l.base + GETARG_A(i);
+  int b = GETARG_B(i);
+  int nresults = GETARG_C(i) - 1;
+  if (b != 0) L->top = ra+b;  /* else previous instruction set top */
+  if (luaD_precall(L, ra, nresults)) {  /* C function? */
+    if (nresults >= 0) L->top = ci->top;  /* adjust results */
+    return 0;
+  }
+  return 1;
+}
+
+
+static void h_return (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  StkId base = ci->u.l.base;
+  StkId ra = RA(i);
+  int b = GETARG_B(i);
+  if (b != 0) L->top = ra+b-1;
+  if (clLvalue(ci->func)->p->sizep > 0) luaF_close(L, base);
+  b = luaD_poscall(L, ra);
+  if (b && (ci->callstatus & CIST_REENTRY))  /* caller runs Lua code? */
+    L->top = L->ci->top;
+}
+
+
+static void h_forprep (lua_State *L, Instruction i) {
+  luaV_forprep(L, L->ci->u.l.base + GETARG_A(i));
+}
+
+
+/* floating loop of OP_FORLOOP; returns whether it goes on */
+static int h_forloop (lua_State *L, Instruction i) {
+  StkId ra = L->ci->u.l.base + GETARG_A(i);
+  lua_Number step = fltvalue(ra + 2);
+  lua_Number idx = luai_numadd(L, fltvalue(ra), step); /* inc. index */
+  lua_Number limit = fltvalue(ra + 1);
+  if (luai_numlt(0, step) ? luai_numle(idx, limit)
+                          : luai_numle(limit, idx)) {
+    setfltvalue(ra, idx);  /* update internal index... */
+    setfltvalue(ra + 3, idx);  /* ...and external index */
+    return 1;
+  }
+  return 0;
+}
+
+
+static void h_tforcall (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  StkId ra = ci->u.l.base + GETARG_A(i);
+  StkId cb = ra + 3;  /* call base */
+  setobjs2s(L, cb+2, ra+2);
+  setobjs2s(L, cb+1, ra+1);
+  setobjs2s(L, cb, ra);
+  L->top = cb + 3;  /* func. + 2 args (state and index) */
+  luaD_call(L, cb, GETARG_C(i), 1);
+  L->top = ci->top;
+}
+
+
+static void h_setlist (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  StkId ra = ci->u.l.base + GETARG_A(i);
+  int n = GETARG_B(i);
+  int c = GETARG_C(i);
+  unsigned int last;
+  Table *h;
+  if (n == 0) n = cast_int(L->top - ra) - 1;
+  if (c == 0) {  /* real C is in the next instruction */
+    lua_assert(GET_OPCODE(*ci->u.l.savedpc) == OP_EXTRAARG);
+    c = GETARG_Ax(*ci->u.l.savedpc);
+  }
+  h = hvalue(ra);
+  last = ((c-1)*LFIELDS_PER_FLUSH) + n;
+  if (last > h->sizearray)  /* needs more space? */
+    luaH_resizearray(L, h, last);  /* pre-allocate it at once */
+  for (; n > 0; n--) {
+    TValue *val = ra+n;
+    luaH_setint(L, h, last--, val);
+    luaC_barrierback(L, h, val);
+  }
+  L->top = ci->top;  /* correct top (in case of previous open call) */
+}
+
+
+static void h_closure (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  StkId ra = ci->u.l.base + GETARG_A(i);
+  LClosure *cl = clLvalue(ci->func);
+  luaV_closure(L, cl->p->p[GETARG_Bx(i)], cl->upvals, ci->u.l.base, ra);
+  checkGC(L, ra + 1);
+}
+
+
+static void h_vararg (lua_State *L, Instruction i) {
+  CallInfo *ci = L->ci;
+  StkId base = ci->u.l.base;
+  StkId ra = RA(i);
+  int b = GETARG_B(i) - 1;
+  int j;
+  int n = cast_int(base - ci->func) - clLvalue(ci->func)->p->numparams - 1;
+  if (b < 0) {  /* B == 0? */
+    b = n;  /* get all var. arguments */
+    luaD_checkstack(L, n);
+    base = ci->u.l.base;  /* previous call may change the stack */
+    ra = RA(i);
+    L->top = ra + n;
+  }
+  for (j = 0; j < b; j++) {
+    if (j < n) {
+      setobjs2s(L, ra + j, base - n + j);
+    }
+    else {
+      setnilvalue(ra + j);
+    }
+  }
+}
+
+/* }====================================================== */
+
+
+
+/*
+** {======================================================
+** Code emission
+** =======================================================
+*/
+
+/* x86-64 registers */
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+       R8, R9, R10, R11, R12, R13, R14, R15 };
+
+/* registers kept by the machine code (all callee-saved) */
+#define RL	RBX	/* the running lua_State */
+#define RCI	R12	/* its CallInfo */
+#define RBASE	R13	/* 'ci->u.l.base' (reloaded after each helper) */
+#define RK	R14	/* constants of the function */
+#define RCL	R15	/* running closure */
+
+/* condition codes (JMP means no condition) */
+enum { CC_O, CC_NO, CC_B, CC_AE, CC_E, CC_NE, CC_BE, CC_A,
+       CC_S, CC_NS, CC_P, CC_NP, CC_L, CC_GE, CC_LE, CC_G, JMP };
+
+
+/* exits of the machine code, numbered after the last instruction */
+#define XCALL	0	/* return LUAJ_CALL */
+#define XRETURN	1	/* return LUAJ_RETURN */
+#define XEXIT	2	/* return LUAJ_EXIT */
+#define NEXITS	3
+
+#define exitpc(J,x)	((J)->p->sizecode + (x))
+
+
+/* OP_LOADNIL of this many registers calls a helper */
+#define MAXINLINENIL	16
+
+/* maximum size of the code of one instruction */
+#define MAXINSTRSIZE	1024
+
+#define TVSIZE		cast_int(sizeof(TValue))
+#define TTOFF		cast_int(offsetof(TValue, tt_))
+#define reg(x)		((x) * TVSIZE)
+
+#define CIOFF(f)	cast_int(offsetof(CallInfo, f))
+
+
+/* a jump (rel32 at 'pos') to the code of instruction 'target' */
+typedef struct Fixup {
+  size_t pos;
+  int target;
+} Fixup;
+
+
+/*
+** The machine code of all functions of a state shares big chunks of
+** executable memory, so that thousands of small functions do not take
+** one mapping (and at least one page) each. New code goes at the end
+** of the first chunk; a chunk is unmapped when the code of all its
+** functions has been freed. The buffers where the compiler assembles
+** a function are kept from one compilation to the next. Everything but
+** the chunks themselves comes from the state allocator.
+*/
+typedef struct JitChunk {
+  struct JitChunk *next;
+  lu_byte *mem;
+  size_t size;
+  size_t used;  /* bytes in use at the start of 'mem' */
+  int nlive;  /* number of functions with code in this chunk */
+} JitChunk;
+
+
+typedef struct JitHeap {
+  JitChunk *chunks;
+  lu_byte *code;  /* buffer for the machine code */
+  size_t sizecode;
+  unsigned int *pcoff;  /* offset of each instruction and exit */
+  int sizepcoff;
+  Fixup *fix;
+  int sizefix;
+} JitHeap;
+
+
+/* minimum size of a chunk of executable memory */
+#if !defined(LUAI_JITCHUNK)
+#define LUAI_JITCHUNK	(256 * 1024)
+#endif
+
+
+typedef struct JitState {
+  lua_State *L;
+  JitHeap *h;  /* its buffers hold the function being compiled */
+  Proto *p;
+  lu_byte *code;  /* 'h->code' */
+  size_t n;  /* bytes in 'code' */
+  unsigned int *pcoff;  /* 'h->pcoff' */
+  int nfix;  /* number of jumps in 'h->fix' */
+} JitState;
+
+
+/* where a (register or constant) operand lives */
+typedef struct Operand {
+  int base;  /* RBASE or RK */
+  int disp;
+  const TValue *k;  /* value of a constant (NULL for a register) */
+} Operand;
+
+
+static void eb (JitState *J, int b) {
+  J->code[J->n++] = cast(lu_byte, b);
+}
+
+
+static void e32 (JitState *J, int v) {
+  unsigned int u = cast(unsigned int, v);
+  memcpy(J->code + J->n, &u, 4);
+  J->n += 4;
+}
+
+
+static void e64 (JitState *J, size_t v) {
+  memcpy(J->code + J->n, &v, 8);
+  J->n += 8;
+}
+
+
+static void rex (JitState *J, int w, int reg, int rm) {
+  int r = (w ? 8 : 0) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+  if (r != 0) eb(J, 0x40 | r);
+}
+
+
+static void opcode (JitState *J, int op) {
+  if (op > 0xff) eb(J, op >> 8);  /* two-byte opcode (0F xx) */
+  eb(J, op & 0xff);
+}
+
+
+/* 'op' with register (or extension) 'reg' and memory at 'rm' + 'disp' */
+static void emitm (JitState *J, int pfx, int w, int op, int reg, int rm,
+                   int disp) {
+  int mod = (disp == 0 && (rm & 7) != RBP) ? 0
+          : (-128 <= disp && disp <= 127) ? 1 : 2;
+  if (pfx) eb(J, pfx);
+  rex(J, w, reg, rm);
+  opcode(J, op);
+  eb(J, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
+  if ((rm & 7) == RSP) eb(J, 0x24);  /* SIB for RSP and R12 */
+  if (mod == 1) eb(J, disp);
+  else if (mod == 2) e32(J, disp);
+}
+
+
+/* 'op' with registers 'reg' and 'rm' */
+static void emitr (JitState *J, int pfx, int w, int op, int reg, int rm) {
+  if (pfx) eb(J, pfx);
+  rex(J, w, reg, rm);
+  opcode(J, op);
+  eb(J, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+
+#define load64(J,r,rm,d)	emitm(J, 0, 1, 0x8B, r, rm, d)
+#define store64(J,r,rm,d)	emitm(J, 0, 1, 0x89, r, rm, d)
+#define load32(J,r,rm,d)	emitm(J, 0, 0, 0x8B, r, rm, d)
+#define movrr(J,dst,src)	emitr(J, 0, 1, 0x89, src, dst)
+#define testrr(J,r)		emitr(J, 0, 1, 0x85, r, r)
+#define calleax(J)		emitr(J, 0, 0, 0xFF, 2, RAX)
+
+/* SSE2: movups (copy of a whole TValue), movsd, and arithmetic on xmm */
+#define loadtv(J,rm,d)		emitm(J, 0, 0, 0x0F10, 0, rm, d)
+#define storetv(J,rm,d)		emitm(J, 0, 0, 0x0F11, 0, rm, d)
+#define loadsd(J,x,rm,d)	emitm(J, 0xF2, 0, 0x0F10, x, rm, d)
+#define storesd(J,x,rm,d)	emitm(J, 0xF2, 0, 0x0F11, x, rm, d)
+#define cvtsd(J,x,rm,d)		emitm(J, 0xF2, 1, 0x0F2A, x, rm, d)
+#define ucomisd(J,x,rm,d)	emitm(J, 0x66, 0, 0x0F2E, x, rm, d)
+
+
+static void movimm64 (JitState *J, int r, size_t v) {
+  rex(J, 1, 0, r);
+  eb(J, 0xB8 + (r & 7));
+  e64(J, v);
+}
+
+
+static void movimm32 (JitState *J, int r, unsigned int v) {
+  rex(J, 0, 0, r);
+  eb(J, 0xB8 + (r & 7));
+  e32(J, cast_int(v));
+}
+
+
+/* 32-bit 'cmp' of memory with a small constant */
+static void cmpmem (JitState *J, int rm, int disp, int v) {
+  lua_assert(-128 <= v && v <= 127);
+  emitm(J, 0, 0, 0x83, 7, rm, disp);
+  eb(J, v);
+}
+
+
+/* 32-bit 'mov' of a constant to memory */
+static void setmem (JitState *J, int rm, int disp, int v) {
+  emitm(J, 0, 0, 0xC7, 0, rm, disp);
+  e32(J, v);
+}
+
+
+#define cmptag(J,o,t)	cmpmem(J, (o).base, (o).disp + TTOFF, t)
+#define settag(J,rm,d,t)	setmem(J, rm, (d) + TTOFF, t)
+
+
+/* copy a TValue */
+static void copytv (JitState *J, int drm, int ddisp, int srm, int sdisp) {
+  loadtv(J, srm, sdisp);
+  storetv(J, drm, ddisp);
+}
+
+
+/* jump with condition 'cc' to a label not known yet; returns its fixup */
+static size_t jfwd (JitState *J, int cc) {
+  if (cc == JMP) eb(J, 0xE9);
+  else { eb(J, 0x0F); eb(J, 0x80 | cc); }
+  e32(J, 0);
+  return J->n - 4;
+}
+
+
+/* make jump 'pos' go to the current position */
+static void here (JitState *J, size_t pos) {
+  int rel = cast_int(J->n - (pos + 4));
+  memcpy(J->code + pos, &rel, 4);
+}
+
+
+static void hereall (JitState *J, size_t *pos, int n) {
+  while (n-- > 0) here(J, pos[n]);
+}
+
+
+/* jump with condition 'cc' to the code of instruction 'target' */
+static void jpc (JitState *J, int cc, int target) {
+  JitHeap *h = J->h;
+  size_t pos = jfwd(J, cc);
+  luaM_growvector(J->L, h->fix, J->nfix, h->sizefix, Fixup, MAX_INT, "jumps");
+  h->fix[J->nfix].pos = pos;
+  h->fix[J->nfix++].target = target;
+}
+
+
+static Operand rk (JitState *J, int x) {
+  Operand o;
+  if (ISK(x)) {
+    o.base = RK;
+    o.disp = INDEXK(x) * TVSIZE;
+    o.k = &J->p->k[INDEXK(x)];
+  }
+  else {
+    o.base = RBASE;
+    o.disp = reg(x);
+    o.k = NULL;
+  }
+  return o;
+}
+
+
+static void setsavedpc (JitState *J, int pc) {
+  movimm64(J, RAX, cast(size_t, J->p->code + pc));
+  store64(J, RAX, RCI, CIOFF(u.l.savedpc));
+}
+
+
+/*
+** call 'h'(L, i, k, aux) for instruction 'pc', with 'savedpc' pointing
+** to the next instruction, as in the interpreter
+*/
+static void callhelper (JitState *J, int pc, Helper h, const void *aux) {
+  setsavedpc(J, pc + 1);
+  movrr(J, RDI, RL);
+  movimm32(J, RSI, J->p->code[pc]);
+  movrr(J, RDX, RK);
+  if (aux != NULL) movimm64(J, RCX, cast(size_t, aux));
+  movimm64(J, RAX, cast(size_t, h));
+  calleax(J);
+  load64(J, RBASE, RCI, CIOFF(u.l.base));  /* stack may have moved */
+}
+
+
+/* test for hooks that only the interpreter runs */
+static void testhooks (JitState *J) {
+  emitm(J, 0, 0, 0xF6, 0, RL, cast_int(offsetof(lua_State, hookmask)));
+  eb(J, LUA_MASKLINE | LUA_MASKCOUNT);
+}
+
+
+/* jump back to instruction 'target' (a loop) */
+static void jumpback (JitState *J, int target) {
+  testhooks(J);
+  jpc(J, CC_E, target);
+  setsavedpc(J, target);  /* else let the interpreter go on */
+  jpc(J, JMP, exitpc(J, XEXIT));
+}
+
+
+static void jump (JitState *J, int pc, int target) {
+  if (target <= pc) jumpback(J, target);
+  else jpc(J, JMP, target);
+}
+
+
+/* load number 'o' as a float into 'x' (jumping to 'slow' otherwise) */
+static void loadnum (JitState *J, Operand o, int x, size_t *slow,
+                     int *ns) {
+  if (o.k != NULL) {  /* a constant is known to be a number */
+    if (ttisfloat(o.k)) loadsd(J, x, o.base, o.disp);
+    else cvtsd(J, x, o.base, o.disp);
+  }
+  else {
+    size_t notflt, done;
+    cmptag(J, o, LUA_TNUMFLT);
+    notflt = jfwd(J, CC_NE);
+    loadsd(J, x, o.base, o.disp);
+    done = jfwd(J, JMP);
+    here(J, notflt);
+    cmptag(J, o, LUA_TNUMINT);
+    slow[(*ns)++] = jfwd(J, CC_NE);
+    cvtsd(J, x, o.base, o.disp);
+    here(J, done);
+  }
+}
+
+
+/* OP_ADD, OP_SUB, OP_MUL, and OP_DIV on numbers */
+static void emitarith (JitState *J, int pc, Instruction i, OpCode op) {
+  static const int intop[] = {0x03, 0x2B, 0x0FAF};  /* add, sub, imul */
+  static const int fltop[] = {0x0F58, 0x0F5C, 0x0F59};  /* ...sd */
+  Operand b = rk(J, GETARG_B(i));
+  Operand c = rk(J, GETARG_C(i));
+  int ra = reg(GETARG_A(i));
+  size_t slow[4], done[2];
+  int ns = 0;
+  int nd = 0;
+  if ((b.k != NULL && !ttisnumber(b.k)) || (c.k != NULL && !ttisnumber(c.k))) {
+    callhelper(J, pc, cast(Helper, h_arith), NULL);  /* never numbers */
+    return;
+  }
+  if (op != OP_DIV && !(b.k != NULL && ttisfloat(b.k)) &&
+                      !(c.k != NULL && ttisfloat(c.k))) {  /* integers? */
+    size_t toflt[2];
+    int nt = 0;
+    if (b.k == NULL) { cmptag(J, b, LUA_TNUMINT); toflt[nt++] = jfwd(J, CC_NE); }
+    if (c.k == NULL) { cmptag(J, c, LUA_TNUMINT); toflt[nt++] = jfwd(J, CC_NE); }
+    load64(J, RAX, b.base, b.disp);
+    emitm(J, 0, 1, intop[op - OP_ADD], RAX, c.base, c.disp);
+    store64(J, RAX, RBASE, ra);
+    settag(J, RBASE, ra, LUA_TNUMINT);
+    done[nd++] = jfwd(J, JMP);
+    hereall(J, toflt, nt);
+  }
+  loadnum(J, b, 0, slow, &ns);
+  loadnum(J, c, 1, slow, &ns);
+  emitr(J, 0xF2, 0, (op == OP_DIV) ? 0x0F5E : fltop[op - OP_ADD], 0, 1);
+  storesd(J, 0, RBASE, ra);
+  settag(J, RBASE, ra, LUA_TNUMFLT);
+  done[nd++] = jfwd(J, JMP);
+  hereall(J, slow, ns);
+  callhelper(J, pc, cast(Helper, h_arith), NULL);
+  hereall(J, done, nd);
+}
+
+
+/*
+** OP_EQ, OP_LT, and OP_LE: the next instruction is a jump, which runs
+** when the comparison gives A; otherwise skip it
+*/
+static void emitcompare (JitState *J, int pc, Instruction i, OpCode op) {
+  /* conditions to skip the jump for A == 0 and A == 1 */
+  static const int intskip[3][2] = {{CC_E, CC_NE}, {CC_L, CC_GE},
+                                    {CC_LE, CC_G}};
+  static const int fltskip[2][2] = {{CC_A, CC_BE}, {CC_AE, CC_B}};
+  Operand b = rk(J, GETARG_B(i));
+  Operand c = rk(J, GETARG_C(i));
+  int a = GETARG_A(i);
+  int skip = pc + 2;
+  size_t slow[4];
+  int ns = 0;
+  int isint = !(b.k != NULL && !ttisinteger(b.k)) &&
+              !(c.k != NULL && !ttisinteger(c.k));
+  int isflt = op != OP_EQ && !(b.k != NULL && !ttisfloat(b.k)) &&
+                             !(c.k != NULL && !ttisfloat(c.k));
+  lua_assert(a == 0 || a == 1);
+  if (isint) {
+    size_t next[2];
+    int nn = 0;
+    if (b.k == NULL) { cmptag(J, b, LUA_TNUMINT); next[nn++] = jfwd(J, CC_NE); }
+    if (c.k == NULL) { cmptag(J, c, LUA_TNUMINT); next[nn++] = jfwd(J, CC_NE); }
+    load64(J, RAX, b.base, b.disp);
+    emitm(J, 0, 1, 0x3B, RAX, c.base, c.disp);  /* cmp rax, c */
+    jpc(J, intskip[op - OP_EQ][a], skip);
+    jpc(J, JMP, pc + 1);
+    if (isflt) hereall(J, next, nn);
+    else while (nn > 0) slow[ns++] = next[--nn];
+  }
+  if (isflt) {
+    if (b.k == NULL) { cmptag(J, b, LUA_TNUMFLT); slow[ns++] = jfwd(J, CC_NE); }
+    if (c.k == NULL) { cmptag(J, c, LUA_TNUMFLT); slow[ns++] = jfwd(J, CC_NE); }
+    loadsd(J, 0, c.base, c.disp);
+    ucomisd(J, 0, b.base, b.disp);  /* compares c with b (NaN: unordered) */
+    jpc(J, fltskip[op - OP_LT][a], skip);
+    jpc(J, JMP, pc + 1);
+  }
+  hereall(J, slow, ns);
+  callhelper(J, pc, cast(Helper, h_compare), NULL);
+  emitr(J, 0, 0, 0x83, 7, RAX);  /* cmp eax, a */
+  eb(J, a);
+  jpc(J, CC_NE, skip);
+}
+
+
+/*
+** OP_TEST and OP_TESTSET: skip the next instruction (a jump) when the
+** value is false and C is true, or the value is true and C is false
+*/
+static void emittest (JitState *J, int pc, Instruction i, int isset) {
+  Operand o = rk(J, isset ? GETARG_B(i) : GETARG_A(i));
+  int skip = pc + 2;
+  size_t l;
+  cmptag(J, o, LUA_TNIL);
+  if (GETARG_C(i)) {  /* skip if false */
+    jpc(J, CC_E, skip);
+    cmptag(J, o, LUA_TBOOLEAN);
+    l = jfwd(J, CC_NE);
+    cmpmem(J, o.base, o.disp, 0);
+    jpc(J, CC_E, skip);
+  }
+  else {  /* skip if true */
+    l = jfwd(J, CC_E);
+    cmptag(J, o, LUA_TBOOLEAN);
+    jpc(J, CC_NE, skip);
+    cmpmem(J, o.base, o.disp, 0);
+    jpc(J, CC_NE, skip);
+  }
+  here(J, l);
+  if (isset)
+    copytv(J, RBASE, reg(GETARG_A(i)), o.base, o.disp);
+}
+
+
+/*
+** address in RCX of the slot of the array part of table 't' for
+** integer 'key' (jumping to 'slow' if out of the array); leaves the
+** table in RAX
+*/
+static void arrayslot (JitState *J, Operand t, Operand key, size_t *slow,
+                       int *ns) {
+  cmptag(J, t, ctb(LUA_TTABLE));
+  slow[(*ns)++] = jfwd(J, CC_NE);
+  if (key.k == NULL) {
+    cmptag(J, key, LUA_TNUMINT);
+    slow[(*ns)++] = jfwd(J, CC_NE);
+  }
+  load64(J, RAX, t.base, t.disp);
+  load64(J, RCX, key.base, key.disp);
+  emitr(J, 0, 1, 0xFF, 1, RCX);  /* dec rcx */
+  load32(J, RDX, RAX, cast_int(offsetof(Table, sizearray)));
+  emitr(J, 0, 1, 0x39, RDX, RCX);  /* cmp rcx, rdx (unsigned) */
+  slow[(*ns)++] = jfwd(J, CC_AE);
+  emitr(J, 0, 1, 0xC1, 4, RCX);  /* shl rcx, 4 */
+  eb(J, 4);
+  lua_assert(TVSIZE == 16);
+  emitm(J, 0, 1, 0x03, RCX, RAX, cast_int(offsetof(Table, array)));
+  cmpmem(J, RCX, TTOFF, LUA_TNIL);  /* empty slot? (maybe a metamethod) */
+  slow[(*ns)++] = jfwd(J, CC_E);
+}
+
+
+/* key of a table access worth an inline array access? */
+#define isarraykey(o)	((o).k == NULL || ttisinteger((o).k))
+
+
+static void emitgettable (JitState *J, int pc, Instruction i,
+                          FieldCache *fc) {
+  Operand t = rk(J, GETARG_B(i));
+  Operand key = rk(J, GETARG_C(i));
+  if (isarraykey(key)) {
+    size_t slow[4], done;
+    int ns = 0;
+    arrayslot(J, t, key, slow, &ns);
+    copytv(J, RBASE, reg(GETARG_A(i)), RCX, 0);
+    done = jfwd(J, JMP);
+    hereall(J, slow, ns);
+    callhelper(J, pc, cast(Helper, h_index), fc);
+    here(J, done);
+  }
+  else
+    callhelper(J, pc, cast(Helper, h_index), fc);
+}
+
+
+static void emitsettable (JitState *J, int pc, Instruction i,
+                          FieldCache *fc) {
+  Operand t = rk(J, GETARG_A(i));
+  Operand key = rk(J, GETARG_B(i));
+  Operand val = rk(J, GETARG_C(i));
+  if (isarraykey(key)) {
+    size_t slow[5], done;
+    int ns = 0;
+    arrayslot(J, t, key, slow, &ns);
+    if (val.k == NULL || iscollectable(val.k)) {  /* may need a barrier? */
+      emitm(J, 0, 0, 0xF6, 0, RAX, cast_int(offsetof(Table, marked)));
+      eb(J, bitmask(BLACKBIT));
+      slow[ns++] = jfwd(J, CC_NE);  /* black table: let the helper do it */
+    }
+    copytv(J, RCX, 0, val.base, val.disp);
+    done = jfwd(J, JMP);
+    hereall(J, slow, ns);
+    callhelper(J, pc, cast(Helper, h_newindex), fc);
+    here(J, done);
+  }
+  else
+    callhelper(J, pc, cast(Helper, h_newindex), fc);
+}
+
+
+static void emitforloop (JitState *J, int pc, Instruction i) {
+  int ra = reg(GETARG_A(i));
+  int target = pc + 1 + GETARG_sBx(i);
+  size_t flt, neg, cont, exit1, exit2, exit3;
+  cmpmem(J, RBASE, ra + TTOFF, LUA_TNUMINT);  /* integer loop? */
+  flt = jfwd(J, CC_NE);
+  load64(J, RAX, RBASE, ra);  /* index */
+  load64(J, RCX, RBASE, ra + reg(2));  /* step */
+  emitr(J, 0, 1, 0x01, RCX, RAX);  /* add rax, rcx */
+  testrr(J, RCX);
+  neg = jfwd(J, CC_LE);
+  emitm(J, 0, 1, 0x3B, RAX, RBASE, ra + reg(1));  /* cmp rax, limit */
+  exit1 = jfwd(J, CC_G);
+  cont = jfwd(J, JMP);
+  here(J, neg);
+  emitm(J, 0, 1, 0x3B, RAX, RBASE, ra + reg(1));
+  exit2 = jfwd(J, CC_L);
+  here(J, cont);
+  store64(J, RAX, RBASE, ra);  /* update internal index... */
+  store64(J, RAX, RBASE, ra + reg(3));  /* ...and external index */
+  settag(J, RBASE, ra + reg(3), LUA_TNUMINT);
+  jumpback(J, target);
+  here(J, flt);  /* floating loop */
+  callhelper(J, pc, cast(Helper, h_forloop), NULL);
+  emitr(J, 0, 0, 0x85, RAX, RAX);  /* test eax, eax */
+  exit3 = jfwd(J, CC_E);
+  jumpback(J, target);
+  here(J, exit1); here(J, exit2); here(J, exit3);
+}
+
+
+static void emitinstr (JitState *J, int pc) {
+  Proto *p = J->p;
+  Instruction i = p->code[pc];
+  OpCode op = GET_BASEOP(i);
+  int ra = reg(GETARG_A(i));
+  FieldCache *fc = &p->fcache[pc];
+  switch (op) {
+    case OP_MOVE: {
+      copytv(J, RBASE, ra, RBASE, reg(GETARG_B(i)));
+      break;
+    }
+    case OP_LOADK: {
+      copytv(J, RBASE, ra, RK, GETARG_Bx(i) * TVSIZE);
+      break;
+    }
+    case OP_LOADKX: {
+      lua_assert(GET_OPCODE(p->code[pc + 1]) == OP_EXTRAARG);
+      copytv(J, RBASE, ra, RK, GETARG_Ax(p->code[pc + 1]) * TVSIZE);
+      break;
+    }
+    case OP_LOADBOOL: {
+      setmem(J, RBASE, ra, GETARG_B(i));
+      settag(J, RBASE, ra, LUA_TBOOLEAN);
+      if (GETARG_C(i)) jpc(J, JMP, pc + 2);  /* skip next instruction */
+      break;
+    }
+    case OP_LOADNIL: {
+      int b;
+      if (GETARG_B(i) >= MAXINLINENIL)
+        callhelper(J, pc, cast(Helper, h_loadnil), NULL);
+      else for (b = 0; b <= GETARG_B(i); b++)
+        settag(J, RBASE, ra + reg(b), LUA_TNIL);
+      break;
+    }
+    case OP_GETUPVAL: {
+      load64(J, RAX, RCL, cast_int(offsetof(LClosure, upvals)) +
+                          GETARG_B(i) * cast_int(sizeof(UpVal *)));
+      load64(J, RAX, RAX, cast_int(offsetof(UpVal, v)));
+      copytv(J, RBASE, ra, RAX, 0);
+      break;
+    }
+    case OP_GETTABLE: {
+      emitgettable(J, pc, i, fc);
+      break;
+    }
+    case OP_SETTABLE: {
+      emitsettable(J, pc, i, fc);
+      break;
+    }
+    case OP_GETTABUP: case OP_SELF: {
+      callhelper(J, pc, cast(Helper, h_index), fc);
+      break;
+    }
+    case OP_SETTABUP: {
+      callhelper(J, pc, cast(Helper, h_newindex), fc);
+      break;
+    }
+    case OP_SETUPVAL: {
+      callhelper(J, pc, cast(Helper, h_setupval), NULL);
+      break;
+    }
+    case OP_NEWTABLE: {
+      callhelper(J, pc, cast(Helper, h_newtable), NULL);
+      break;
+    }
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: {
+      emitarith(J, pc, i, op);
+      break;
+    }
+    case OP_MOD: case OP_POW: case OP_IDIV: case OP_BAND: case OP_BOR:
+    case OP_BXOR: case OP_SHL: case OP_SHR: case OP_UNM: case OP_BNOT: {
+      callhelper(J, pc, cast(Helper, h_arith), NULL);
+      break;
+    }
+    case OP_NOT: {
+      callhelper(J, pc, cast(Helper, h_not), NULL);
+      break;
+    }
+    case OP_LEN: {
+      callhelper(J, pc, cast(Helper, h_len), NULL);
+      break;
+    }
+    case OP_CONCAT: {
+      callhelper(J, pc, cast(Helper, h_concat), NULL);
+      break;
+    }
+    case OP_JMP: {
+      if (GETARG_A(i) > 0)  /* close upvalues? */
+        callhelper(J, pc, cast(Helper, h_close), NULL);
+      jump(J, pc, pc + 1 + GETARG_sBx(i));
+      break;
+    }
+    case OP_EQ: case OP_LT: case OP_LE: {
+      emitcompare(J, pc, i, op);
+      break;
+    }
+    case OP_TEST: case OP_TESTSET: {
+      emittest(J, pc, i, op == OP_TESTSET);
+      break;
+    }
+    case OP_CALL: {
+      callhelper(J, pc, cast(Helper, h_call), NULL);
+      emitr(J, 0, 0, 0x85, RAX, RAX);  /* test eax, eax */
+      jpc(J, CC_NE, exitpc(J, XCALL));  /* Lua function? */
+      testhooks(J);  /* the C function may have set a hook */
+      jpc(J, CC_NE, exitpc(J, XEXIT));
+      break;
+    }
+    case OP_TAILCALL: {  /* done by the interpreter */
+      setsavedpc(J, pc);
+      jpc(J, JMP, exitpc(J, XEXIT));
+      break;
+    }
+    case OP_RETURN: {
+      callhelper(J, pc, cast(Helper, h_return), NULL);
+      jpc(J, JMP, exitpc(J, XRETURN));
+      break;
+    }
+    case OP_FORLOOP: {
+      emitforloop(J, pc, i);
+      break;
+    }
+    case OP_FORPREP: {
+      callhelper(J, pc, cast(Helper, h_forprep), NULL);
+      jpc(J, JMP, pc + 1 + GETARG_sBx(i));
+      break;
+    }
+    case OP_TFORCALL: {
+      callhelper(J, pc, cast(Helper, h_tforcall), NULL);
+      break;  /* go on with the OP_TFORLOOP that follows */
+    }
+    case OP_TFORLOOP: {
+      size_t done;
+      cmpmem(J, RBASE, ra + reg(1) + TTOFF, LUA_TNIL);
+      done = jfwd(J, CC_E);
+      copytv(J, RBASE, ra, RBASE, ra + reg(1));  /* save control variable */
+      jumpback(J, pc + 1 + GETARG_sBx(i));
+      here(J, done);
+      break;
+    }
+    case OP_SETLIST: {
+      callhelper(J, pc, cast(Helper, h_setlist), NULL);
+      break;
+    }
+    case OP_CLOSURE: {
+      callhelper(J, pc, cast(Helper, h_closure), NULL);
+      break;
+    }
+    case OP_VARARG: {
+      callhelper(J, pc, cast(Helper, h_vararg), NULL);
+      break;
+    }
+    case OP_EXTRAARG: {  /* used by the previous instruction */
+      break;
+    }
+    default: lua_assert(0);
+  }
+}
+
+
+static void emitprologue (JitState *J) {
+  static const int saved[] = {RBX, R12, R13, R14, R15};
+  int r;
+  for (r = 0; r < 5; r++) {  /* push callee-saved registers */
+    rex(J, 0, 0, saved[r]);
+    eb(J, 0x50 + (saved[r] & 7));
+  }
+  movrr(J, RL, RDI);
+  movrr(J, RCI, RSI);
+  load64(J, RBASE, RCI, CIOFF(u.l.base));
+  movimm64(J, RK, cast(size_t, J->p->k));
+  load64(J, RCL, RCI, CIOFF(func));
+  load64(J, RCL, RCL, 0);  /* closure (gc field of the TValue) */
+  emitr(J, 0, 0, 0xFF, 4, RDX);  /* jmp rdx (code of the instruction) */
+}
+
+
+static void emitexits (JitState *J) {
+  static const int saved[] = {R15, R14, R13, R12, RBX};
+  size_t done[2];
+  int r;
+  J->pcoff[exitpc(J, XCALL)] = cast(unsigned int, J->n);
+  movimm32(J, RAX, LUAJ_CALL);
+  done[0] = jfwd(J, JMP);
+  J->pcoff[exitpc(J, XRETURN)] = cast(unsigned int, J->n);
+  movimm32(J, RAX, LUAJ_RETURN);
+  done[1] = jfwd(J, JMP);
+  J->pcoff[exitpc(J, XEXIT)] = cast(unsigned int, J->n);
+  movimm32(J, RAX, LUAJ_EXIT);
+  here(J, done[0]); here(J, done[1]);
+  for (r = 0; r < 5; r++) {  /* pop callee-saved registers */
+    rex(J, 0, 0, saved[r]);
+    eb(J, 0x58 + (saved[r] & 7));
+  }
+  eb(J, 0xC3);  /* ret */
+}
+
+
+/* make room for the code of one more instruction */
+static void growcode (JitState *J) {
+  JitHeap *h = J->h;
+  if (h->sizecode - J->n < MAXINSTRSIZE) {
+    size_t size = h->sizecode * 2 + MAXINSTRSIZE;
+    luaM_reallocvector(J->L, h->code, h->sizecode, size, lu_byte);
+    h->sizecode = size;
+    J->code = h->code;
+  }
+}
+
+
+static JitHeap *getheap (lua_State *L) {
+  global_State *g = G(L);
+  if (g->jit == NULL) {
+    JitHeap *h = luaM_new(L, JitHeap);
+    h->chunks = NULL;
+    h->code = NULL;
+    h->sizecode = 0;
+    h->pcoff = NULL;
+    h->sizepcoff = 0;
+    h->fix = NULL;
+    h->sizefix = 0;
+    g->jit = h;
+  }
+  return g->jit;
+}
+
+
+/* add a chunk with room for at least 'size' bytes of code */
+static JitChunk *newchunk (lua_State *L, JitHeap *h, size_t size) {
+  JitChunk *c = luaM_new(L, JitChunk);
+  void *mem;
+  if (size < LUAI_JITCHUNK)
+    size = LUAI_JITCHUNK;
+  mem = mmap(NULL, size, PROT_READ | PROT_EXEC,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    luaM_free(L, c);
+    return NULL;
+  }
+  c->mem = cast(lu_byte *, mem);
+  c->size = size;
+  c->used = 0;
+  c->nlive = 0;
+  c->next = h->chunks;
+  h->chunks = c;
+  return c;
+}
+
+
+static void freechunk (lua_State *L, JitChunk *c) {
+  munmap(c->mem, c->size);
+  luaM_free(L, c);
+}
+
+
+/*
+** Copy the code into executable memory, resolving the jumps. The chunk
+** is writable only while the code is copied; changing the protection
+** of a whole mapping does not split it, so that does not fail.
+*/
+static JitCode *install (JitState *J) {
+  lua_State *L = J->L;
+  JitHeap *h = J->h;
+  JitChunk *c = h->chunks;
+  int n = J->p->sizecode + NEXITS;
+  size_t size = (J->n + 15) & ~cast(size_t, 15);  /* keep code aligned */
+  JitCode *jc;
+  int i;
+  for (i = 0; i < J->nfix; i++) {
+    Fixup *f = &h->fix[i];
+    int rel = cast_int(J->pcoff[f->target]) - cast_int(f->pos + 4);
+    memcpy(J->code + f->pos, &rel, 4);
+  }
+  if (c == NULL || c->size - c->used < size) {
+    c = newchunk(L, h, size);
+    if (c == NULL)
+      return NULL;
+  }
+  jc = cast(JitCode *, luaM_malloc(L, sizejitcode(n)));
+  jc->chunk = c;
+  jc->code = c->mem + c->used;
+  jc->n = n;
+  memcpy(jc->pcoff, J->pcoff, n * sizeof(unsigned int));
+  mprotect(c->mem, c->size, PROT_READ | PROT_WRITE);
+  memcpy(jc->code, J->code, J->n);
+  mprotect(c->mem, c->size, PROT_READ | PROT_EXEC);
+  c->used += size;
+  c->nlive++;
+  return jc;
+}
+
+/* }====================================================== */
+
+
+
+/*
+** Compile 'p'. When that is not possible (no executable memory), 'p'
+** will not be tried again for a long while. Memory errors are raised
+** as usual.
+*/
+int luaJ_compile (lua_State *L, Proto *p) {
+  JitState J;
+  JitCode *jc;
+  int n = p->sizecode + NEXITS;
+  int pc;
+  if (p->fcache == NULL) {  /* create the inline caches */
+    FieldCache *fc = luaM_newvector(L, p->sizecode, FieldCache);
+    for (pc = 0; pc < p->sizecode; pc++)
+      fc[pc].slot = fc[pc].tmslot = 0;
+    p->fcache = fc;
+  }
+  J.L = L;
+  J.h = getheap(L);
+  J.p = p;
+  J.n = 0;
+  J.nfix = 0;
+  if (J.h->sizepcoff < n) {
+    luaM_reallocvector(L, J.h->pcoff, J.h->sizepcoff, n, unsigned int);
+    J.h->sizepcoff = n;
+  }
+  J.pcoff = J.h->pcoff;
+  J.code = J.h->code;
+  growcode(&J);
+  emitprologue(&J);
+  for (pc = 0; pc < p->sizecode; pc++) {
+    growcode(&J);
+    J.pcoff[pc] = cast(unsigned int, J.n);
+    emitinstr(&J, pc);
+    lua_assert(J.n - J.pcoff[pc] <= MAXINSTRSIZE);
+  }
+  growcode(&J);
+  emitexits(&J);
+  jc = install(&J);
+  if (jc == NULL) {
+    p->jitcount = INT_MAX;
+    return 0;
+  }
+  p->jit = jc;
+  return 1;
+}
+
+
+int luaJ_execute (lua_State *L, CallInfo *ci) {
+  Proto *p = clLvalue(ci->func)->p;
+  JitCode *jc = p->jit;
+  JitEntry entry = cast(JitEntry, jc->code);
+  lua_assert(ci == L->ci && isLua(ci));
+  return entry(L, ci, jc->code + jc->pcoff[ci->u.l.savedpc - p->code]);
+}
+
+
+void luaJ_free (lua_State *L, Proto *p) {
+  JitHeap *h = G(L)->jit;
+  JitCode *jc = p->jit;
+  JitChunk *c = jc->chunk;
+  luaM_freemem(L, jc, sizejitcode(jc->n));
+  p->jit = NULL;
+  if (--c->nlive == 0) {
+    if (c == h->chunks)  /* chunk for new code? */
+      c->used = 0;  /* keep it */
+    else {
+      JitChunk **pc = &h->chunks;
+      while (*pc != c) pc = &(*pc)->next;
+      *pc = c->next;
+      freechunk(L, c);
+    }
+  }
+}
+
+
+void luaJ_close (lua_State *L) {
+  JitHeap *h = G(L)->jit;
+  if (h != NULL) {
+    while (h->chunks != NULL) {
+      JitChunk *c = h->chunks;
+      lua_assert(c->nlive == 0);
+      h->chunks = c->next;
+      freechunk(L, c);
+    }
+    luaM_freearray(L, h->code, h->sizecode);
+    luaM_freearray(L, h->pcoff, h->sizepcoff);
+    luaM_freearray(L, h->fix, h->sizefix);
+    luaM_free(L, h);
+    G(L)->jit = NULL;
+  }
+}
+
+#endif			/* } */
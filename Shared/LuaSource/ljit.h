@@ -0,0 +1,70 @@
+/*
+** $Id: ljit.h $
+** Baseline compiler from Lua bytecode to x86-64 machine code
+** See Copyright Notice in lua.h
+*/
+
+#ifndef ljit_h
+#define ljit_h
+
+
+#include "lobject.h"
+#include "lstate.h"
+
+
+/*
+** The compiler needs x86-64, 'mmap', and errors raised with 'longjmp'
+** (a C++ exception cannot unwind through generated code), and it
+** knows only the default layout of values (not LUA_NANBOXING). Define
+** LUA_NOJIT to leave it out.
+**
+** Apple platforms are left out on purpose: iOS does not let an app
+** make memory executable, and under the hardened runtime macOS wants
+** MAP_JIT, the 'allow-jit' entitlement and 'pthread_jit_write_protect_np'
+** around every write to code, none of which this compiler does (and
+** Apple silicon is not x86-64 anyway). There the interpreter runs all
+** code.
+*/
+#if defined(__APPLE__)
+/* no JIT */
+#elif defined(__x86_64__) && defined(__linux__) && \
+    !defined(__cplusplus) && !defined(LUA_NOJIT) && !defined(LUA_NANBOXING)
+#define LUAI_JIT
+#endif
+
+
+/* number of calls and loop iterations that make a function hot */
+#if !defined(LUAI_JITHOT)
+#define LUAI_JITHOT	64
+#endif
+
+
+/* results of 'luaJ_execute' */
+#define LUAJ_CALL	0	/* called a Lua function (its frame is 'L->ci') */
+#define LUAJ_RETURN	1	/* function returned */
+#define LUAJ_EXIT	2	/* interpreter must go on from 'savedpc' */
+
+
+#if defined(LUAI_JIT)
+
+/*
+** 'p' has machine code (compiling it if it just became hot) and 'L'
+** has no line or count hook, which only the interpreter runs
+*/
+#define luaJ_ready(L,p)  \
+	(G(L)->jiton && !((L)->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) && \
+	 ((p)->jit != NULL || (--(p)->jitcount == 0 && luaJ_compile(L, p))))
+
+LUAI_FUNC int luaJ_compile (lua_State *L, Proto *p);
+LUAI_FUNC int luaJ_execute (lua_State *L, CallInfo *ci);
+LUAI_FUNC void luaJ_free (lua_State *L, Proto *p);
+LUAI_FUNC void luaJ_close (lua_State *L);
+
+#else
+
+#define luaJ_free(L,p)	((void)(L), (void)(p))
+#define luaJ_close(L)	((void)(L))
+
+#endif
+
+#endif
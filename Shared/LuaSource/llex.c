@@ -226,7 +226,7 @@ static void buffreplace (LexState *ls, char from, char to) {
 #endif
 
 
-#define buff2num(b,o)	(luaO_str2num(luaZ_buffer(b), o) != 0)
+#define buff2num(L,b,o)	(luaO_str2num(L, luaZ_buffer(b), o) != 0)
 
 /*
 ** in case of format error, try to change decimal point separator to
@@ -236,7 +236,7 @@ static void trydecpoint (LexState *ls, TValue *o) {
   char old = ls->decpoint;
   ls->decpoint = l_getlocaledecpoint();
   buffreplace(ls, old, ls->decpoint);  /* try new decimal separator */
-  if (!buff2num(ls->buff, o)) {
+  if (!buff2num(ls->L, ls->buff, o)) {
     /* format error with correct decimal point: no more options */
     buffreplace(ls, ls->decpoint, '.');  /* undo change (for error message) */
     lexerror(ls, "malformed number", TK_FLT);
@@ -268,7 +268,7 @@ static int read_numeral (LexState *ls, SemInfo *seminfo) {
   }
   save(ls, '\0');
   buffreplace(ls, '.', ls->decpoint);  /* follow locale for decimal point */
-  if (!buff2num(ls->buff, &obj))  /* format error? */
+  if (!buff2num(ls->L, ls->buff, &obj))  /* format error? */
     trydecpoint(ls, &obj); /* try to update decimal point separator */
   if (ttisinteger(&obj)) {
     seminfo->i = ivalue(&obj);
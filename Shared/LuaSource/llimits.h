@@ -113,6 +113,16 @@ typedef LUAI_UACINT l_uacInt;
 #define cast_uchar(i)	cast(unsigned char, (i))
 
 
+/*
+** hint that a condition is (almost) always true
+*/
+#if defined(__GNUC__)
+#define l_likely(x)	__builtin_expect(((x) != 0), 1)
+#else
+#define l_likely(x)	(x)
+#endif
+
+
 /* cast a signed lua_Integer to lua_Unsigned */
 #if !defined(l_castS2U)
 #define l_castS2U(i)	((lua_Unsigned)(i))
@@ -175,6 +185,15 @@ typedef unsigned long Instruction;
 #endif
 
 
+/*
+** number of buckets moved from the old to the new string table on each
+** step of an incremental resize (see 'luaS_resize')
+*/
+#if !defined(STRRESIZESTEP)
+#define STRRESIZESTEP	4
+#endif
+
+
 /* minimum size for string buffer */
 #if !defined(LUA_MINBUFFER)
 #define LUA_MINBUFFER	32
@@ -290,6 +290,382 @@ static int math_type (lua_State *L) {
 }
 
 
+/*
+** {==================================================================
+** Bulk math over typed arrays (see 'lua_newarray')
+** ===================================================================
+*/
+
+/*
+** The kernels work on arrays of doubles. On x86 the SSE4.1 and AVX2
+** versions are compiled with target attributes and chosen at run time
+** from the CPU features; on AArch64 NEON is always there.
+*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LUAI_VMATHX86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define LUAI_VMATHNEON
+#include <arm_neon.h>
+#endif
+
+
+typedef void (*VKernel) (double *d, const double *a, const double *b,
+                         const double *c, size_t n);
+
+typedef struct VKernels {
+  VKernel sqrt, floor, abs, min, max, clamp, lerp, muladd, fma;
+} VKernels;
+
+
+/* scalar kernels */
+#define VK(name)	vk_##name##_c
+#define VATTR		/* empty */
+#define VW		1
+#define vec		double
+#define VLOAD(p)	(*(p))
+#define VSTORE(p,v)	(*(p) = (v))
+#define VADD(a,b)	((a) + (b))
+#define VSUB(a,b)	((a) - (b))
+#define VMUL(a,b)	((a) * (b))
+#define VMIN(a,b)	((b) < (a) ? (b) : (a))
+#define VMAX(a,b)	((a) < (b) ? (b) : (a))
+#define VSQRT(a)	sqrt(a)
+#define VFLOOR(a)	floor(a)
+#define VABS(a)		fabs(a)
+#if !defined(LUA_USE_C89)
+#define VFMA(a,b,c)	fma(a, b, c)
+#else
+#define VFMA(a,b,c)	((a) * (b) + (c))  /* no single rounding in C89 */
+#endif
+#include "lmathvec.h"
+#undef VK
+#undef VATTR
+#undef VW
+#undef vec
+#undef VLOAD
+#undef VSTORE
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VMIN
+#undef VMAX
+#undef VSQRT
+#undef VFLOOR
+#undef VABS
+#undef VFMA
+
+#if !defined(LUAI_VMATHNEON)
+static const VKernels vk_c = {
+  vk_sqrt_c, vk_floor_c, vk_abs_c, vk_min_c, vk_max_c, vk_clamp_c,
+  vk_lerp_c, vk_muladd_c, vk_fma_c
+};
+#endif
+
+
+#if defined(LUAI_VMATHX86)
+
+/* SSE4.1 kernels (2 doubles per vector) */
+#define VK(name)	vk_##name##_sse
+#define VATTR		__attribute__((target("sse4.1")))
+#define VW		2
+#define vec		__m128d
+#define VLOAD(p)	_mm_loadu_pd(p)
+#define VSTORE(p,v)	_mm_storeu_pd(p, v)
+#define VADD(a,b)	_mm_add_pd(a, b)
+#define VSUB(a,b)	_mm_sub_pd(a, b)
+#define VMUL(a,b)	_mm_mul_pd(a, b)
+#define VMIN(a,b)	_mm_min_pd(b, a)	/* 'b < a ? b : a' */
+#define VMAX(a,b)	_mm_max_pd(b, a)	/* 'a < b ? b : a' */
+#define VSQRT(a)	_mm_sqrt_pd(a)
+#define VFLOOR(a)	_mm_floor_pd(a)
+#define VABS(a)		_mm_andnot_pd(_mm_set1_pd(-0.0), a)
+#include "lmathvec.h"
+#undef VK
+#undef VATTR
+#undef VW
+#undef vec
+#undef VLOAD
+#undef VSTORE
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VMIN
+#undef VMAX
+#undef VSQRT
+#undef VFLOOR
+#undef VABS
+
+/* AVX2 kernels (4 doubles per vector), also using FMA */
+#define VK(name)	vk_##name##_avx
+#define VATTR		__attribute__((target("avx2,fma")))
+#define VW		4
+#define vec		__m256d
+#define VLOAD(p)	_mm256_loadu_pd(p)
+#define VSTORE(p,v)	_mm256_storeu_pd(p, v)
+#define VADD(a,b)	_mm256_add_pd(a, b)
+#define VSUB(a,b)	_mm256_sub_pd(a, b)
+#define VMUL(a,b)	_mm256_mul_pd(a, b)
+#define VMIN(a,b)	_mm256_min_pd(b, a)
+#define VMAX(a,b)	_mm256_max_pd(b, a)
+#define VSQRT(a)	_mm256_sqrt_pd(a)
+#define VFLOOR(a)	_mm256_floor_pd(a)
+#define VABS(a)		_mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define VFMA(a,b,c)	_mm256_fmadd_pd(a, b, c)
+#include "lmathvec.h"
+
+static const VKernels vk_sse = {
+  vk_sqrt_sse, vk_floor_sse, vk_abs_sse, vk_min_sse, vk_max_sse,
+  vk_clamp_sse, vk_lerp_sse, vk_muladd_sse, vk_fma_c
+};
+
+static const VKernels vk_avx = {
+  vk_sqrt_avx, vk_floor_avx, vk_abs_avx, vk_min_avx, vk_max_avx,
+  vk_clamp_avx, vk_lerp_avx, vk_muladd_avx, vk_fma_avx
+};
+
+static const VKernels *getkernels (void) {
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return &vk_avx;
+  else if (__builtin_cpu_supports("sse4.1"))
+    return &vk_sse;
+  else
+    return &vk_c;
+}
+
+#elif defined(LUAI_VMATHNEON)
+
+/* NEON kernels (2 doubles per vector) */
+#define VK(name)	vk_##name##_neon
+#define VATTR		/* empty */
+#define VW		2
+#define vec		float64x2_t
+#define VLOAD(p)	vld1q_f64(p)
+#define VSTORE(p,v)	vst1q_f64(p, v)
+#define VADD(a,b)	vaddq_f64(a, b)
+#define VSUB(a,b)	vsubq_f64(a, b)
+#define VMUL(a,b)	vmulq_f64(a, b)
+#define VMIN(a,b)	vbslq_f64(vcltq_f64(b, a), b, a)
+#define VMAX(a,b)	vbslq_f64(vcltq_f64(a, b), b, a)
+#define VSQRT(a)	vsqrtq_f64(a)
+#define VFLOOR(a)	vrndmq_f64(a)
+#define VABS(a)		vabsq_f64(a)
+#define VFMA(a,b,c)	vfmaq_f64(c, a, b)
+#include "lmathvec.h"
+
+static const VKernels vk_neon = {
+  vk_sqrt_neon, vk_floor_neon, vk_abs_neon, vk_min_neon, vk_max_neon,
+  vk_clamp_neon, vk_lerp_neon, vk_muladd_neon, vk_fma_neon
+};
+
+#define getkernels()	(&vk_neon)
+
+#else
+
+#define getkernels()	(&vk_c)
+
+#endif
+
+
+/* 'sin' and 'cos' have no vector instructions; they loop over libm */
+static void vk_sin (double *d, const double *a, const double *b,
+                    const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) d[i] = sin(a[i]);
+  (void)b; (void)c;
+}
+
+
+static void vk_cos (double *d, const double *a, const double *b,
+                    const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) d[i] = cos(a[i]);
+  (void)b; (void)c;
+}
+
+
+/* elements converted in each step, when an array does not hold doubles */
+#define VCHUNK		256
+
+
+/* an operand: a typed array or a number (when 'p' is NULL) */
+typedef struct VArg {
+  const char *p;
+  int kind;
+  double buff[VCHUNK];
+} VArg;
+
+
+static void checkvarg (lua_State *L, int arg, size_t n, VArg *v) {
+  size_t an;
+  v->p = (const char *)lua_toarray(L, arg, &v->kind, &an);
+  if (lua_isarray(L, arg))
+    luaL_argcheck(L, an == n, arg, "array size mismatch");
+  else {  /* a number, used for all elements */
+    double x = (double)luaL_checknumber(L, arg);
+    size_t i;
+    for (i = 0; i < VCHUNK; i++) v->buff[i] = x;
+  }
+}
+
+
+/* pointer to elements [i, i + m) of 'v' as doubles */
+static const double *loadvarg (VArg *v, size_t i, size_t m) {
+  size_t k;
+  if (v->p == NULL)
+    return v->buff;
+  switch (v->kind) {
+    case LUA_AFLOAT64: return (const double *)v->p + i;
+    case LUA_AFLOAT32: {
+      const float *p = (const float *)v->p + i;
+      for (k = 0; k < m; k++) v->buff[k] = (double)p[k];
+      break;
+    }
+    case LUA_AINT32: {
+      const int *p = (const int *)v->p + i;
+      for (k = 0; k < m; k++) v->buff[k] = (double)p[k];
+      break;
+    }
+    default: {
+      const unsigned char *p = (const unsigned char *)v->p + i;
+      for (k = 0; k < m; k++) v->buff[k] = (double)p[k];
+      break;
+    }
+  }
+  return v->buff;
+}
+
+
+/*
+** Checks the operands of 'vapply' against its destination, the 'n'
+** elements of kind 'kind' at 'p'. An operand that is the destination
+** itself (same memory, same element size) is fine in chunks. Any other
+** overlap needs the elements computed one at a time, in the direction
+** that reads each element of the operand before it is overwritten:
+** returns 1 for front to back, -1 for back to front, 0 if there is no
+** such overlap. Raises an error when no direction works (operands on
+** both sides of the destination, or with another element size).
+*/
+static int vdirection (lua_State *L, const char *p, int kind, size_t n,
+                       const VArg *args, const int *argi) {
+  size_t ds = lua_arrayelemsize(kind);
+  int dir = 0;
+  int j;
+  for (j = 0; j < 3; j++) {
+    const char *q = args[j].p;
+    size_t qs;
+    int jdir;
+    if (argi[j] == 0 || q == NULL || n == 0)
+      continue;  /* absent, a number, or no elements */
+    qs = lua_arrayelemsize(args[j].kind);
+    if (q + n * qs <= p || p + n * ds <= q || (q == p && qs == ds))
+      continue;  /* no overlap, or the destination itself */
+    jdir = (p < q) ? 1 : -1;
+    if (qs != ds || (dir != 0 && jdir != dir))
+      luaL_argerror(L, argi[j], "array overlaps the destination");
+    dir = jdir;
+  }
+  return dir;
+}
+
+
+/*
+** Computes 'd[i] = f(a[i], b[i], c[i])' over the float array at index
+** 'd'; the other arguments (0 when absent) are arrays with the same
+** size or numbers. Operands may overlap the destination (see
+** 'vdirection'). Returns the destination array.
+*/
+static int vapply (lua_State *L, VKernel f, int d, int a, int b, int c) {
+  double dbuff[VCHUNK];
+  VArg args[3];
+  const double *op[3];
+  int argi[3];
+  int kind, j, dir;
+  size_t n, i, k, m;
+  char *p = (char *)lua_toarray(L, d, &kind, &n);
+  luaL_argcheck(L, lua_isarray(L, d) && (kind == LUA_AFLOAT64 ||
+                                 kind == LUA_AFLOAT32), d,
+                   "float array expected");
+  argi[0] = a; argi[1] = b; argi[2] = c;
+  for (j = 0; j < 3; j++)
+    if (argi[j] != 0) checkvarg(L, argi[j], n, &args[j]);
+  dir = vdirection(L, p, kind, n, args, argi);
+  for (k = 0; k < n; k += m) {
+    double *dst;
+    if (dir == 0) {  /* chunks, front to back */
+      i = k;
+      m = (n - i < VCHUNK) ? n - i : VCHUNK;
+    }
+    else {  /* one element at a time, in direction 'dir' */
+      i = (dir > 0) ? k : n - 1 - k;
+      m = 1;
+    }
+    dst = (kind == LUA_AFLOAT64) ? (double *)p + i : dbuff;
+    for (j = 0; j < 3; j++)
+      op[j] = (argi[j] != 0) ? loadvarg(&args[j], i, m) : NULL;
+    f(dst, op[0], op[1], op[2], m);
+    if (kind == LUA_AFLOAT32) {
+      float *e = (float *)p + i;
+      size_t l;
+      for (l = 0; l < m; l++) e[l] = (float)dbuff[l];
+    }
+  }
+  lua_pushvalue(L, d);
+  return 1;
+}
+
+
+static int math_vsin (lua_State *L) {
+  return vapply(L, vk_sin, 1, 2, 0, 0);
+}
+
+static int math_vcos (lua_State *L) {
+  return vapply(L, vk_cos, 1, 2, 0, 0);
+}
+
+static int math_vsqrt (lua_State *L) {
+  return vapply(L, getkernels()->sqrt, 1, 2, 0, 0);
+}
+
+static int math_vfloor (lua_State *L) {
+  return vapply(L, getkernels()->floor, 1, 2, 0, 0);
+}
+
+static int math_vabs (lua_State *L) {
+  return vapply(L, getkernels()->abs, 1, 2, 0, 0);
+}
+
+static int math_vmin (lua_State *L) {
+  return vapply(L, getkernels()->min, 1, 2, 3, 0);
+}
+
+static int math_vmax (lua_State *L) {
+  return vapply(L, getkernels()->max, 1, 2, 3, 0);
+}
+
+/* math.vclamp(dst, x, lo, hi) */
+static int math_vclamp (lua_State *L) {
+  return vapply(L, getkernels()->clamp, 1, 2, 3, 4);
+}
+
+/* math.vlerp(dst, a, b, t): a + (b - a)*t */
+static int math_vlerp (lua_State *L) {
+  return vapply(L, getkernels()->lerp, 1, 2, 3, 4);
+}
+
+/* math.vfma(dst, a, b, c): a*b + c with a single rounding */
+static int math_vfma (lua_State *L) {
+  return vapply(L, getkernels()->fma, 1, 2, 3, 4);
+}
+
+/* math.vaxpy(a, x, y): y = a*x + y */
+static int math_vaxpy (lua_State *L) {
+  return vapply(L, getkernels()->muladd, 3, 1, 2, 3);
+}
+
+/* }================================================================== */
+
+
 /*
 ** {==================================================================
 ** Deprecated functions (for compatibility only)
@@ -367,6 +743,17 @@ static const luaL_Reg mathlib[] = {
   {"sqrt",  math_sqrt},
   {"tan",   math_tan},
   {"type", math_type},
+  {"vsin",  math_vsin},
+  {"vcos",  math_vcos},
+  {"vsqrt", math_vsqrt},
+  {"vfloor", math_vfloor},
+  {"vabs",  math_vabs},
+  {"vmin",  math_vmin},
+  {"vmax",  math_vmax},
+  {"vclamp", math_vclamp},
+  {"vlerp", math_vlerp},
+  {"vfma",  math_vfma},
+  {"vaxpy", math_vaxpy},
 #if defined(LUA_COMPAT_MATHLIB)
   {"atan2", math_atan},
   {"cosh",   math_cosh},
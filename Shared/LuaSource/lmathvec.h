@@ -0,0 +1,123 @@
+/*
+** $Id: lmathvec.h $
+** Kernels of the bulk math functions, compiled once per instruction
+** set by 'lmathlib.c'
+** See Copyright Notice in lua.h
+*/
+
+
+/*
+** Each kernel computes 'd[i] = f(a[i], b[i], c[i])' for 'i' in [0, n).
+** The including file defines 'VK(name)' (the name of a kernel), 'VATTR'
+** (attributes for its functions), 'VW' (elements per vector), 'vec'
+** (the vector type), and the vector operations below; 'VMIN(a,b)' is
+** 'b < a ? b : a' and 'VMAX(a,b)' is 'a < b ? b : a' (also with NaNs),
+** as 'math.min(a, b)' and 'math.max(a, b)', so that all versions give
+** the same results as those functions. 'VFMA(a,b,c)', computing
+** 'a*b + c' with a single rounding, is optional. A version with 'VW'
+** greater than 1 finishes the last elements with the scalar kernels.
+*/
+
+#if VW > 1
+#define VTAIL(name)	if (i < n) vk_##name##_c(d + i, VA(a), VA(b), VA(c), n - i)
+#define VA(p)		((p) ? (p) + i : NULL)
+#else
+#define VTAIL(name)	((void)0)
+#endif
+
+
+static VATTR void VK(sqrt) (double *d, const double *a, const double *b,
+                            const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VSQRT(VLOAD(a + i)));
+  VTAIL(sqrt);
+  (void)b; (void)c;
+}
+
+
+static VATTR void VK(floor) (double *d, const double *a, const double *b,
+                             const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VFLOOR(VLOAD(a + i)));
+  VTAIL(floor);
+  (void)b; (void)c;
+}
+
+
+static VATTR void VK(abs) (double *d, const double *a, const double *b,
+                           const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VABS(VLOAD(a + i)));
+  VTAIL(abs);
+  (void)b; (void)c;
+}
+
+
+static VATTR void VK(min) (double *d, const double *a, const double *b,
+                           const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VMIN(VLOAD(a + i), VLOAD(b + i)));
+  VTAIL(min);
+  (void)c;
+}
+
+
+static VATTR void VK(max) (double *d, const double *a, const double *b,
+                           const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VMAX(VLOAD(a + i), VLOAD(b + i)));
+  VTAIL(max);
+  (void)c;
+}
+
+
+/* clamp 'a' to ['b', 'c']: 'math.min(math.max(a, b), c)' */
+static VATTR void VK(clamp) (double *d, const double *a, const double *b,
+                             const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VMIN(VMAX(VLOAD(a + i), VLOAD(b + i)), VLOAD(c + i)));
+  VTAIL(clamp);
+}
+
+
+/* 'a + (b - a)*c' */
+static VATTR void VK(lerp) (double *d, const double *a, const double *b,
+                            const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW) {
+    vec x = VLOAD(a + i);
+    VSTORE(d + i, VADD(x, VMUL(VSUB(VLOAD(b + i), x), VLOAD(c + i))));
+  }
+  VTAIL(lerp);
+}
+
+
+/* 'a*b + c', rounding the product */
+static VATTR void VK(muladd) (double *d, const double *a, const double *b,
+                              const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VADD(VMUL(VLOAD(a + i), VLOAD(b + i)), VLOAD(c + i)));
+  VTAIL(muladd);
+}
+
+
+#if defined(VFMA)
+static VATTR void VK(fma) (double *d, const double *a, const double *b,
+                           const double *c, size_t n) {
+  size_t i;
+  for (i = 0; i + VW <= n; i += VW)
+    VSTORE(d + i, VFMA(VLOAD(a + i), VLOAD(b + i), VLOAD(c + i)));
+  VTAIL(fma);
+}
+#endif
+
+
+#undef VTAIL
+#undef VA
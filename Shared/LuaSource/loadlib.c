@@ -313,6 +313,23 @@ static int gctm (lua_State *L) {
 }
 
 
+/*
+** __clone tag method for CLIBS table (see 'lua_clonestate'): the copy
+** in a cloned state will unload its handles too, so it loads each
+** library again to hold a reference of its own
+*/
+static int clonetm (lua_State *L) {
+  lua_pushnil(L);  /* first key */
+  while (lua_next(L, 1)) {
+    lua_pop(L, 1);  /* pop handle */
+    if (lua_type(L, -1) == LUA_TSTRING &&  /* CLIBS[path]? */
+        lsys_load(L, lua_tostring(L, -1), 0) == NULL)
+      return lua_error(L);  /* error message is on the stack */
+  }
+  return 0;
+}
+
+
 
 /* error codes for 'lookforfunc' */
 #define ERRLIB		1
@@ -751,9 +768,11 @@ static void createsearcherstable (lua_State *L) {
 */
 static void createclibstable (lua_State *L) {
   lua_newtable(L);  /* create CLIBS table */
-  lua_createtable(L, 0, 1);  /* create metatable for CLIBS */
+  lua_createtable(L, 0, 2);  /* create metatable for CLIBS */
   lua_pushcfunction(L, gctm);
   lua_setfield(L, -2, "__gc");  /* set finalizer for CLIBS table */
+  lua_pushcfunction(L, clonetm);
+  lua_setfield(L, -2, "__clone");
   lua_setmetatable(L, -2);
   lua_rawsetp(L, LUA_REGISTRYINDEX, &CLIBS);  /* set CLIBS table in registry */
 }
@@ -10,6 +10,7 @@
 #include "lprefix.h"
 
 
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,6 +21,7 @@
 #include "lctype.h"
 #include "ldebug.h"
 #include "ldo.h"
+#include "lgc.h"
 #include "lmem.h"
 #include "lobject.h"
 #include "lstate.h"
@@ -31,6 +33,33 @@
 LUAI_DDEF const TValue luaO_nilobject_ = {NILCONSTANT};
 
 
+#if defined(LUA_NANBOXING)
+
+/* raw type tags for NaN-boxing tags (see 'rttype') */
+LUAI_DDEF const lu_byte luaO_nbtt[16] = {
+  LUA_TNIL, ctb(LUA_TLCL), ctb(LUA_TCCL), ctb(LUA_TSHRSTR),
+  ctb(LUA_TLNGSTR), ctb(LUA_TNUMINT), ctb(LUA_TTABLE), LUA_TNIL,  /* GCO */
+  LUA_TNIL, LUA_TNIL, LUA_TBOOLEAN, LUA_TLIGHTUSERDATA,
+  LUA_TLCF, LUA_TNUMINT, LUA_TDEADKEY, LUA_TNIL
+};
+
+
+/*
+** Set 'o' to an integer too large for the payload of a boxed value.
+** The box is a plain collectable object with no references. The
+** collector keeps the newest box alive, so that C code may hold it in
+** a local value (e.g., a table key) across an allocation.
+*/
+void luaO_boxint (lua_State *L, TValue *o, lua_Integer i) {
+  GCObject *b = luaC_newobj(L, LUA_TNUMINT, sizeof(IntBox));
+  gco2ib(b)->i = i;
+  G(L)->lastbox = b;
+  val_(o).u = nbmake(NBT_INTBOX, cast(size_t, b));
+}
+
+#endif
+
+
 /*
 ** converts an integer to a "floating point byte", represented as
 ** (eeeeexxx), where the real value is (1xxx) * 2^(eeeee - 1) if
@@ -121,7 +150,7 @@ void luaO_arith (lua_State *L, int op, const TValue *p1, const TValue *p2,
     case LUA_OPBNOT: {  /* operate only on integers */
       lua_Integer i1; lua_Integer i2;
       if (tointeger(p1, &i1) && tointeger(p2, &i2)) {
-        setivalue(res, intarith(L, op, i1, i2));
+        setivalue(L, res, intarith(L, op, i1, i2));
         return;
       }
       else break;  /* go to the end */
@@ -137,7 +166,7 @@ void luaO_arith (lua_State *L, int op, const TValue *p1, const TValue *p2,
     default: {  /* other operations */
       lua_Number n1; lua_Number n2;
       if (ttisinteger(p1) && ttisinteger(p2)) {
-        setivalue(res, intarith(L, op, ivalue(p1), ivalue(p2)));
+        setivalue(L, res, intarith(L, op, ivalue(p1), ivalue(p2)));
         return;
       }
       else if (tonumber(p1, &n1) && tonumber(p2, &n2)) {
@@ -236,8 +265,184 @@ static lua_Number lua_strx2number (const char *s, char **endptr) {
 /* }====================================================== */
 
 
+/*
+** {==================================================================
+** Exact decimal conversions
+** ===================================================================
+*/
+
+/*
+** With 'double' floats and 128-bit integers, decimal numerals are read
+** and floats are formatted (see 'luaO_fmtfloat') with exact integer
+** arithmetic on powers of 5, giving the correctly rounded results of
+** 'strtod' and 'sprintf' without calling them. Values that would need
+** more than 128 bits still go to the C library.
+*/
+#if defined(LUA_REAL_DOUBLE) && defined(__SIZEOF_INT128__)
+#define EXACTDEC
+#endif
+
+
+#if defined(EXACTDEC)	/* { */
+
+#include <locale.h>
+
+typedef unsigned long long l_u64;
+typedef unsigned __int128 l_u128;
+
+/* powers of 5 that fit in 64 bits */
+static const l_u64 fivepow[28] = {
+  1ULL, 5ULL, 25ULL,
+  125ULL, 625ULL, 3125ULL,
+  15625ULL, 78125ULL, 390625ULL,
+  1953125ULL, 9765625ULL, 48828125ULL,
+  244140625ULL, 1220703125ULL, 6103515625ULL,
+  30517578125ULL, 152587890625ULL, 762939453125ULL,
+  3814697265625ULL, 19073486328125ULL, 95367431640625ULL,
+  476837158203125ULL, 2384185791015625ULL, 11920928955078125ULL,
+  59604644775390625ULL, 298023223876953125ULL, 1490116119384765625ULL,
+  7450580596923828125ULL
+};
+
+/* largest power of 5 computed by 'pow5x' */
+#define MAXPOW5		54
+
+/* 10^0 .. 10^19 */
+static const l_u64 tenpow[20] = {
+  1ULL, 10ULL, 100ULL,
+  1000ULL, 10000ULL, 100000ULL,
+  1000000ULL, 10000000ULL, 100000000ULL,
+  1000000000ULL, 10000000000ULL, 100000000000ULL,
+  1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+  1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+  1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static l_u128 pow5x (int k) {
+  lua_assert(0 <= k && k <= MAXPOW5);
+  return (k <= 27) ? fivepow[k] : (l_u128)fivepow[27] * fivepow[k - 27];
+}
+
+
+/* number of significant bits in 'a' */
+static int nbits128 (l_u128 a) {
+  l_u64 hi = (l_u64)(a >> 64);
+  if (hi != 0) return 128 - __builtin_clzll(hi);
+  else if ((l_u64)a != 0) return 64 - __builtin_clzll((l_u64)a);
+  else return 0;
+}
+
+
+
+
+#if !defined(l_getlocaledecpoint)
+#define l_getlocaledecpoint()	(localeconv()->decimal_point[0])
+#endif
+
+
+/* powers of 10 that are exact doubles */
+static const double tendbl[23] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5,
+  1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+  1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/*
+** 'n * 2^e' rounded half to even to a double; 'sticky' tells whether
+** nonzero bits below 'n' were lost (so that 'n' is not a tie)
+*/
+static double roundexact (l_u128 n, int e, int sticky) {
+  int sh = nbits128(n) - 53;
+  if (sh > 0) {
+    l_u128 rem = n & ((((l_u128)1) << sh) - 1);
+    l_u128 half = ((l_u128)1) << (sh - 1);
+    n >>= sh;
+    e += sh;
+    if (rem > half || (rem == half && (sticky || (n & 1)))) n++;
+  }
+  return ldexp((double)(l_u64)n, e);
+}
+
+
+/*
+** Reads a decimal numeral as 'w * 10^q', with its (at most 19)
+** significant digits in 'w'. If 'w < 2^53' and '|q| <= 22', 'w' and
+** '10^|q|' are exact doubles and one operation rounds correctly;
+** otherwise, the value is rounded with 'roundexact' when it fits in
+** 128 bits. Returns NULL for anything else (including invalid
+** numerals), which then goes to 'lua_str2number'.
+*/
+static const char *l_str2dexact (const char *s, lua_Number *result) {
+  l_u64 w = 0;
+  int nd = 0;  /* number of significant digits in 'w' */
+  int q = 0;  /* decimal exponent */
+  int any = 0;  /* read any digit? */
+  int neg;
+  while (lisspace(cast_uchar(*s))) s++;  /* skip initial spaces */
+  neg = isneg(&s);
+  for (; lisdigit(cast_uchar(*s)); s++, any = 1) {
+    if (w == 0 && *s == '0') continue;  /* leading zero */
+    else if (nd++ == 19) return NULL;  /* too many digits */
+    w = w * 10 + (*s - '0');
+  }
+  if (*s == '.') {
+    if (l_getlocaledecpoint() != '.') return NULL;
+    for (s++; lisdigit(cast_uchar(*s)); s++, any = 1) {
+      if (w == 0 && *s == '0') q--;  /* leading zero */
+      else if (nd < 19) {
+        w = w * 10 + (*s - '0');
+        nd++; q--;
+      }
+      else if (*s != '0') return NULL;  /* too many digits */
+    }
+  }
+  if (!any) return NULL;
+  if (*s == 'e' || *s == 'E') {
+    int x = 0;
+    int eneg;
+    s++;
+    eneg = isneg(&s);
+    if (!lisdigit(cast_uchar(*s))) return NULL;
+    for (; lisdigit(cast_uchar(*s)); s++) {
+      if (x < 10000) x = x * 10 + (*s - '0');
+    }
+    q += eneg ? -x : x;
+  }
+  while (lisspace(cast_uchar(*s))) s++;  /* skip trailing spaces */
+  if (*s != '\0') return NULL;
+  if (w == 0)
+    *result = 0.0;
+  else if (w <= (1ULL << 53) && -22 <= q && q <= 22)
+    *result = (q >= 0) ? (double)w * tendbl[q] : (double)w / tendbl[-q];
+  else if (q >= 0) {
+    if (q > MAXPOW5 || nbits128(w) + nbits128(pow5x(q)) > 128) return NULL;
+    *result = roundexact(pow5x(q) * w, q, 0);
+  }
+  else {  /* 'w / (5^-q * 2^-q)' */
+    l_u128 d, n;
+    int k = 127 - nbits128(w);
+    if (-q > 31) return NULL;  /* quotient would have less than 55 bits */
+    d = pow5x(-q);
+    n = (l_u128)w << k;
+    *result = roundexact(n / d, q - k, n % d != 0);
+  }
+  if (neg) *result = -*result;
+  return s;
+}
+
+#endif	/* } */
+
+/* }================================================================== */
+
+
 static const char *l_str2d (const char *s, lua_Number *result) {
   char *endptr;
+#if defined(EXACTDEC)
+  const char *e = l_str2dexact(s, result);  /* common decimal numerals */
+  if (e != NULL) return e;
+#endif
   if (strpbrk(s, "nN"))  /* reject 'inf' and 'nan' */
     return NULL;
   else if (strpbrk(s, "xX"))  /* hex? */
@@ -279,21 +484,40 @@ static const char *l_str2int (const char *s, lua_Integer *result) {
 }
 
 
-size_t luaO_str2num (const char *s, TValue *o) {
-  lua_Integer i; lua_Number n;
+/*
+** Convert string 's' to a number without building a Lua value, so
+** that callers that only read the result need no state: an integer
+** goes to '*i' (with '*isint' true) and a float to '*n'. Returns the
+** string size, or 0 if the conversion failed.
+*/
+size_t luaO_rawstr2num (const char *s, lua_Integer *i, lua_Number *n,
+                        int *isint) {
   const char *e;
-  if ((e = l_str2int(s, &i)) != NULL) {  /* try as an integer */
-    setivalue(o, i);
-  }
-  else if ((e = l_str2d(s, &n)) != NULL) {  /* else try as a float */
-    setfltvalue(o, n);
-  }
+  if ((e = l_str2int(s, i)) != NULL)  /* try as an integer */
+    *isint = 1;
+  else if ((e = l_str2d(s, n)) != NULL)  /* else try as a float */
+    *isint = 0;
   else
     return 0;  /* conversion failed */
   return (e - s + 1);  /* success; return string size */
 }
 
 
+size_t luaO_str2num (lua_State *L, const char *s, TValue *o) {
+  lua_Integer i; lua_Number n; int isint;
+  size_t sz = luaO_rawstr2num(s, &i, &n, &isint);
+  if (sz == 0)
+    return 0;  /* conversion failed */
+  else if (isint) {
+    setivalue(L, o, i);
+  }
+  else {
+    setfltvalue(o, n);
+  }
+  return sz;
+}
+
+
 int luaO_utf8esc (char *buff, unsigned long x) {
   int n = 1;  /* number of bytes put in buffer (backwards) */
   lua_assert(x <= 0x10FFFF);
@@ -312,6 +536,218 @@ int luaO_utf8esc (char *buff, unsigned long x) {
 }
 
 
+/*
+** {==================================================================
+** Float formatting
+** ===================================================================
+*/
+
+/*
+** Conversions '%.<p>e', '%.<p>f' and '%.<p>g': the float, scaled by a
+** power of 10, is rounded half to even with exact integer arithmetic,
+** so that the result is byte for byte that of a 'sprintf' that rounds
+** correctly (as glibc's).
+*/
+#if defined(EXACTDEC)	/* { */
+
+/* two-digit decimal representations of 0 .. 99 */
+static const char digits2[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+
+/*
+** Computes in '*r' the value 'm * 2^e * 10^s' (with 'm < 2^53') rounded
+** half to even; returns 0 if that does not fit in 128 bits.
+*/
+static int scaleround (l_u64 m, int e, int s, l_u128 *r) {
+  l_u128 n, q;
+  if (s >= 0) {  /* m * 5^s * 2^(e + s) */
+    if (s > MAXPOW5 || nbits128(pow5x(s)) + 53 > 127) return 0;
+    n = pow5x(s) * m;
+    e += s;
+    if (e >= 0) {
+      if (nbits128(n) + e > 127) return 0;
+      *r = n << e;
+    }
+    else if (-e >= 128)  /* 'n' is smaller than half the unit? */
+      *r = 0;
+    else {
+      l_u128 rem = n & ((((l_u128)1) << -e) - 1);
+      l_u128 half = ((l_u128)1) << (-e - 1);
+      *r = n >> -e;
+      if (rem > half || (rem == half && (*r & 1))) (*r)++;
+    }
+  }
+  else {  /* m * 2^(e + s) / 5^-s */
+    if (-s > MAXPOW5) return 0;
+    q = pow5x(-s);
+    e += s;
+    if (e >= 0) {
+      if (53 + e > 127) return 0;
+      n = (l_u128)m << e;
+    }
+    else {
+      if (nbits128(q) - e > 127) return 0;
+      n = m;
+      q <<= -e;
+    }
+    *r = n / q;
+    n -= *r * q;  /* remainder */
+    if (n > q - n || (n == q - n && (*r & 1))) (*r)++;
+  }
+  return 1;
+}
+
+
+/* writes the 'n' last decimal digits of 'v' (with leading zeros) */
+static void putdigits (char *buff, l_u64 v, int n) {
+  while (n >= 2) {
+    n -= 2;
+    memcpy(buff + n, digits2 + (v % 100) * 2, 2);
+    v /= 100;
+  }
+  if (n > 0) buff[0] = cast(char, '0' + v % 10);
+}
+
+
+/* writes the decimal digits of 'v'; returns their number */
+static int putu128 (char *buff, l_u128 v) {
+  int n = 1;
+  if (v >= tenpow[19]) {  /* 'v < 2^127', so 'v / 10^19' fits in 64 bits */
+    n = putu128(buff, v / tenpow[19]);
+    putdigits(buff + n, (l_u64)(v % tenpow[19]), 19);
+    return n + 19;
+  }
+  while (n < 20 && (l_u64)v >= tenpow[n]) n++;
+  putdigits(buff, (l_u64)v, n);
+  return n;
+}
+
+
+/*
+** writes the 'nd' digits 'dig', whose value is '0.dig * 10^point', with
+** 'nfrac' digits after the point
+*/
+static char *putfixed (char *p, const char *dig, int nd, int point,
+                       int nfrac) {
+  int i;
+  if (point <= 0)
+    *p++ = '0';
+  for (i = 0; i < point; i++)
+    *p++ = (i < nd) ? dig[i] : '0';
+  if (nfrac > 0) {
+    *p++ = '.';
+    for (i = point; i < point + nfrac; i++)
+      *p++ = (0 <= i && i < nd) ? dig[i] : '0';
+  }
+  return p;
+}
+
+
+/* writes the 'nd' digits 'dig' as 'd.ddde+xx' */
+static char *putexp (char *p, const char *dig, int nd, int exp10, int e) {
+  *p++ = dig[0];
+  if (nd > 1) {
+    *p++ = '.';
+    memcpy(p, dig + 1, nd - 1);
+    p += nd - 1;
+  }
+  *p++ = cast(char, e);
+  if (exp10 < 0) { *p++ = '-'; exp10 = -exp10; }
+  else *p++ = '+';
+  if (exp10 >= 100) {
+    *p++ = cast(char, '0' + exp10 / 100);
+    exp10 %= 100;
+  }
+  memcpy(p, digits2 + exp10 * 2, 2);
+  return p + 2;
+}
+
+
+/*
+** Formats 'x' with conversion 'conv' and precision 'prec'; returns the
+** length of the result, or 0 if it needs 'sprintf'.
+*/
+static int fmtfloat (char *buff, double x, int conv, int prec) {
+  char dig[48];  /* decimal digits of the result */
+  char *p = buff;
+  l_u64 bits, m;
+  l_u128 r;
+  int e, nd;
+  memcpy(&bits, &x, sizeof(bits));
+  m = bits & ((1ULL << 52) - 1);
+  e = cast_int((bits >> 52) & 0x7ff);
+  if (e == 0x7ff) return 0;  /* infinity or NaN */
+  else if (e == 0) e = -1074;  /* zero or subnormal */
+  else { m |= 1ULL << 52; e -= 1075; }
+  if (bits >> 63) *p++ = '-';
+  if (conv == 'f') {
+    if (!scaleround(m, e, prec, &r)) return 0;
+    nd = putu128(dig, r);
+    p = putfixed(p, dig, nd, nd - prec, prec);
+  }
+  else {
+    int isg = (conv == 'g' || conv == 'G');
+    int upper = (conv == 'E' || conv == 'G');
+    int ns = isg ? (prec == 0 ? 1 : prec) : prec + 1;  /* digits */
+    int exp10 = 0;
+    if (conv != 'e' && !isg && !upper) return 0;
+    else if (ns > 17) return 0;
+    if (m != 0) {
+      /* 'x' is in [2^b, 2^(b + 1)), so 'exp10' is 'b*log10(2)' or above */
+      int b = nbits128(m) + e - 1;
+      exp10 = cast_int(l_floor(b * 0.30102999566398120));
+      for (;;) {  /* get 'ns' digits, correcting 'exp10' if needed */
+        if (!scaleround(m, e, ns - 1 - exp10, &r)) return 0;
+        if (r >= tenpow[ns]) exp10++;
+        else if (r < tenpow[ns - 1]) exp10--;
+        else break;
+      }
+    }
+    else r = 0;
+    putdigits(dig, (l_u64)r, ns);
+    nd = ns;
+    if (!isg)
+      p = putexp(p, dig, nd, exp10, upper ? 'E' : 'e');
+    else {  /* '%g' removes trailing zeros */
+      int fixed = (-4 <= exp10 && exp10 < ns);
+      int mind = fixed && exp10 >= 0 ? exp10 + 1 : 1;  /* digits to keep */
+      while (nd > mind && dig[nd - 1] == '0') nd--;
+      if (fixed)
+        p = putfixed(p, dig, nd, exp10 + 1, nd - exp10 - 1);
+      else
+        p = putexp(p, dig, nd, exp10, upper ? 'E' : 'e');
+    }
+  }
+  *p = '\0';
+  return cast_int(p - buff);
+}
+
+#endif								/* } */
+
+
+/*
+** Writes into 'buff' float 'x' formatted as with "%.<prec><conv>",
+** where 'conv' is one of 'e', 'E', 'f', 'g', 'G'; returns the length
+** of the result
+*/
+int luaO_fmtfloat (char *buff, lua_Number x, int conv, int prec) {
+  char form[] = "%.*" LUA_NUMBER_FRMLEN "g";
+#if defined(EXACTDEC)
+  int len = fmtfloat(buff, x, conv, prec);
+  if (len > 0) return len;
+#endif
+  form[sizeof(form) - 2] = cast(char, conv);
+  return sprintf(buff, form, prec, (LUAI_UACNUMBER)x);
+}
+
+/* }================================================================== */
+
+
 /* maximum length of the conversion of a number to a string */
 #define MAXNUMBER2STR	50
 
@@ -326,7 +762,11 @@ void luaO_tostring (lua_State *L, StkId obj) {
   if (ttisinteger(obj))
     len = lua_integer2str(buff, ivalue(obj));
   else {
+#if defined(LUAI_NUMFMTPREC)
+    len = luaO_fmtfloat(buff, fltvalue(obj), 'g', LUAI_NUMFMTPREC);
+#else
     len = lua_number2str(buff, fltvalue(obj));
+#endif
 #if !defined(LUA_COMPAT_FLOATSTRING)
     if (buff[strspn(buff, "-0123456789")] == '\0') {  /* looks like an int? */
       buff[len++] = '.';
@@ -368,12 +808,12 @@ const char *luaO_pushvfstring (lua_State *L, const char *fmt, va_list argp) {
         break;
       }
       case 'd': {
-        setivalue(L->top++, va_arg(argp, int));
+        setivalue(L, L->top++, va_arg(argp, int));
         luaO_tostring(L, L->top - 1);
         break;
       }
       case 'I': {
-        setivalue(L->top++, cast(lua_Integer, va_arg(argp, l_uacInt)));
+        setivalue(L, L->top++, cast(lua_Integer, va_arg(argp, l_uacInt)));
         luaO_tostring(L, L->top - 1);
         break;
       }
@@ -103,6 +103,8 @@ typedef union Value Value;
 ** an actual value plus a tag with its type.
 */
 
+#if !defined(LUA_NANBOXING)	/* { */
+
 #define TValuefields	Value value_; int tt_
 
 typedef struct lua_TValue TValue;
@@ -118,6 +120,85 @@ typedef struct lua_TValue TValue;
 /* raw type tag of a TValue */
 #define rttype(o)	((o)->tt_)
 
+#else				/* }{ */
+
+/*
+** NaN boxing (see LUA_NANBOXING in 'luaconf.h'): a value is a single
+** 64-bit word. A float is kept as itself, with every NaN turned into
+** the canonical NB_NAN of its sign (so that it prints as in the default
+** layout); any other value is a NaN that no arithmetic
+** produces, whose 16 high bits ('nbtag') say what it is and whose 48
+** low bits hold a pointer, a boolean, or a small integer. Tags
+** 0x7FF9-0x7FFF are collectable objects, tags 0xFFF9-0xFFFE are not.
+** An integer that does not fit in 48 bits lives in an 'IntBox'.
+*/
+
+#if !defined(LUA_REAL_DOUBLE) || ((LUA_MAXINTEGER >> 31) >> 31) != 1
+#error "LUA_NANBOXING needs 64-bit integers and 'double' floats"
+#endif
+
+#define TValuefields	Value value_
+
+typedef struct lua_TValue TValue;
+
+
+/* an integer box and an inline integer differ only in the high bit */
+#define NBT_LCL		0x7FF9
+#define NBT_CCL		0x7FFA
+#define NBT_SHRSTR	0x7FFB
+#define NBT_LNGSTR	0x7FFC
+#define NBT_INTBOX	0x7FFD
+#define NBT_TABLE	0x7FFE
+#define NBT_GCO		0x7FFF	/* other objects (type in their header) */
+#define NBT_NIL		0xFFF9
+#define NBT_BOOLEAN	0xFFFA
+#define NBT_LUD		0xFFFB
+#define NBT_LCF		0xFFFC
+#define NBT_INT		0xFFFD
+#define NBT_DEADKEY	0xFFFE
+
+#define nbmake(t,p)	((cast(lua_Unsigned, t) << 48) | cast(lua_Unsigned, p))
+
+#define NB_PAYLOAD	((l_castS2U(1) << 48) - 1)
+#define NB_INTSIGN	(l_castS2U(1) << 47)
+#define NB_NAN		nbmake(0x7FF8, 0)	/* 'ttisfloat' ignores the sign */
+#define NB_SIGN		(l_castS2U(1) << 63)
+#define NB_NIL		nbmake(NBT_NIL, 0)
+
+
+/* macro defining a nil value */
+#define NILCONSTANT	{NB_NIL}
+
+
+#define val_(o)		((o)->value_)
+
+#define nbtag(o)	cast_int(val_(o).u >> 48)
+#define nbpayload(o)	(val_(o).u & NB_PAYLOAD)
+#define nbpointer(o)	cast(void *, cast(size_t, nbpayload(o)))
+
+/* whether tag of 'o' is in the range [a, b] */
+#define nbtagin(o,a,b)	(cast(unsigned int, nbtag(o) - (a)) <= (b) - (a))
+
+/* whether 'o' is an object of type 't' with tag NBT_GCO */
+#define nbisgco(o,t)	(nbtag(o) == NBT_GCO && gcvalue(o)->tt == (t))
+
+/* tag for a collectable object of type 'tt' */
+#define nbgctag(tt) \
+	((tt) == LUA_TTABLE ? NBT_TABLE : (tt) == LUA_TSHRSTR ? NBT_SHRSTR : \
+	 (tt) == LUA_TLNGSTR ? NBT_LNGSTR : (tt) == LUA_TLCL ? NBT_LCL : \
+	 (tt) == LUA_TCCL ? NBT_CCL : (tt) == LUA_TNUMINT ? NBT_INTBOX : NBT_GCO)
+
+
+/* raw type tag of a TValue (see 'luaO_nbtt') */
+#define rttype(o)  \
+	(ttisfloat(o) ? LUA_TNUMFLT : \
+	 nbtag(o) == NBT_GCO ? ctb(gcvalue(o)->tt) : \
+	 cast_int(luaO_nbtt[(nbtag(o) & 7) | ((nbtag(o) >> 12) & 8)]))
+
+LUAI_DDEC const lu_byte luaO_nbtt[16];
+
+#endif				/* } */
+
 /* tag with no variants (bits 0-3) */
 #define novariant(x)	((x) & 0x0F)
 
@@ -128,6 +209,8 @@ typedef struct lua_TValue TValue;
 #define ttnov(o)	(novariant(rttype(o)))
 
 
+#if !defined(LUA_NANBOXING)	/* { */
+
 /* Macros to test type */
 #define checktag(o,t)		(rttype(o) == (t))
 #define checktype(o,t)		(ttnov(o) == (t))
@@ -176,6 +259,61 @@ typedef struct lua_TValue TValue;
 #define iscollectable(o)	(rttype(o) & BIT_ISCOLLECTABLE)
 
 
+#else				/* }{ */
+
+/* Macros to test type */
+#define checktype(o,t)		(ttnov(o) == (t))
+#define ttisnumber(o)		(ttisfloat(o) || ttisinteger(o))
+#define ttisfloat(o)		((val_(o).u & nbmake(0x7FFF, 0)) < nbmake(0x7FF9, 0))
+#define ttisinteger(o)		((nbtag(o) & 0x7FFF) == NBT_INTBOX)
+#define ttisnil(o)		(val_(o).u == NB_NIL)
+#define ttisboolean(o)		(nbtag(o) == NBT_BOOLEAN)
+#define ttislightuserdata(o)	(nbtag(o) == NBT_LUD)
+#define ttisstring(o)		nbtagin(o, NBT_SHRSTR, NBT_LNGSTR)
+#define ttisshrstring(o)	(nbtag(o) == NBT_SHRSTR)
+#define ttislngstring(o)	(nbtag(o) == NBT_LNGSTR)
+#define ttistable(o)		(nbtag(o) == NBT_TABLE)
+#define ttisfunction(o)		(ttisclosure(o) || ttislcf(o))
+#define ttisclosure(o)		nbtagin(o, NBT_LCL, NBT_CCL)
+#define ttisCclosure(o)		(nbtag(o) == NBT_CCL)
+#define ttisLclosure(o)		(nbtag(o) == NBT_LCL)
+#define ttislcf(o)		(nbtag(o) == NBT_LCF)
+#define ttisfulluserdata(o)	nbisgco(o, LUA_TUSERDATA)
+#define ttisthread(o)		nbisgco(o, LUA_TTHREAD)
+#define ttisdeadkey(o)		(nbtag(o) == NBT_DEADKEY)
+
+
+/* Macros to access values */
+#define ivalue(o)	check_exp(ttisinteger(o), l_likely(nbtag(o) == NBT_INT) ? \
+	l_castU2S(nbpayload(o) ^ NB_INTSIGN) - l_castU2S(NB_INTSIGN) : \
+	gco2ib(gcvalue(o))->i)
+#define fltvalue(o)	check_exp(ttisfloat(o), val_(o).n)
+#define nvalue(o)	check_exp(ttisnumber(o), \
+	(ttisinteger(o) ? cast_num(ivalue(o)) : fltvalue(o)))
+#define gcvalue(o)	check_exp(iscollectable(o), cast(GCObject *, nbpointer(o)))
+#define pvalue(o)	check_exp(ttislightuserdata(o), nbpointer(o))
+#define tsvalue(o)	check_exp(ttisstring(o), cast(TString *, nbpointer(o)))
+#define uvalue(o)	check_exp(ttisfulluserdata(o), gco2u(gcvalue(o)))
+#define clvalue(o)	check_exp(ttisclosure(o), cast(Closure *, nbpointer(o)))
+#define clLvalue(o)	check_exp(ttisLclosure(o), cast(LClosure *, nbpointer(o)))
+#define clCvalue(o)	check_exp(ttisCclosure(o), cast(CClosure *, nbpointer(o)))
+#define fvalue(o)	check_exp(ttislcf(o), \
+	cast(lua_CFunction, cast(size_t, nbpayload(o))))
+#define hvalue(o)	check_exp(ttistable(o), cast(Table *, nbpointer(o)))
+#define bvalue(o)	check_exp(ttisboolean(o), cast_int(nbpayload(o)))
+#define thvalue(o)	check_exp(ttisthread(o), gco2th(gcvalue(o)))
+/* a dead value may get the 'gc' field, but cannot access its contents */
+#define deadvalue(o)	check_exp(ttisdeadkey(o), nbpointer(o))
+
+#define l_isfalse(o)	(ttisnil(o) || (ttisboolean(o) && bvalue(o) == 0))
+
+
+#define iscollectable(o)	nbtagin(o, NBT_LCL, NBT_GCO)
+
+
+#endif				/* } */
+
+
 /* Macros for internal tests */
 #define righttt(obj)		(ttype(obj) == gcvalue(obj)->tt)
 
@@ -184,14 +322,16 @@ typedef struct lua_TValue TValue;
 			(righttt(obj) && !isdead(g,gcvalue(obj))))
 
 
+#if !defined(LUA_NANBOXING)	/* { */
+
 /* Macros to set values */
 #define settt_(o,t)	((o)->tt_=(t))
 
 #define setfltvalue(obj,x) \
   { TValue *io=(obj); val_(io).n=(x); settt_(io, LUA_TNUMFLT); }
 
-#define setivalue(obj,x) \
-  { TValue *io=(obj); val_(io).i=(x); settt_(io, LUA_TNUMINT); }
+#define setivalue(L,obj,x) \
+  { TValue *io=(obj); val_(io).i=(x); (void)L; settt_(io, LUA_TNUMINT); }
 
 #define setnilvalue(obj) settt_(obj, LUA_TNIL)
 
@@ -242,6 +382,75 @@ typedef struct lua_TValue TValue;
 
 
 
+#else				/* }{ */
+
+/* Macros to set values */
+#define setfltvalue(obj,x) \
+  { TValue *io=(obj); lua_Number n_=(x); \
+    val_(io).n = n_; \
+    if (luai_numisnan(n_)) val_(io).u = (val_(io).u & NB_SIGN) | NB_NAN; }
+
+#define setivalue(L,obj,x) \
+  { TValue *io=(obj); lua_Integer i_=(x); \
+    if (l_likely(l_castS2U(i_) + NB_INTSIGN <= NB_PAYLOAD)) \
+      val_(io).u = nbmake(NBT_INT, l_castS2U(i_) & NB_PAYLOAD); \
+    else luaO_boxint(L, io, i_); }
+
+#define setnilvalue(obj) (val_(obj).u = NB_NIL)
+
+/* pointers must fit in the payload (only 'luaK_intK' cuts them on purpose) */
+#define setnbpointer(obj,t,x) \
+  (val_(obj).u = nbmake(t, cast(size_t, (x)) & NB_PAYLOAD))
+
+#define setfvalue(obj,x)	setnbpointer(obj, NBT_LCF, x)
+
+#define setpvalue(obj,x)	setnbpointer(obj, NBT_LUD, x)
+
+#define setbvalue(obj,x) \
+  { TValue *io=(obj); val_(io).u = nbmake(NBT_BOOLEAN, (x) != 0); }
+
+#define setgcovalue(L,obj,x) \
+  { TValue *io = (obj); GCObject *i_g=(x); \
+    setnbpointer(io, nbgctag(i_g->tt), i_g); }
+
+#define setsvalue(L,obj,x) \
+  { TValue *io = (obj); TString *x_ = (x); \
+    setnbpointer(io, nbgctag(x_->tt), x_); \
+    checkliveness(G(L),io); }
+
+#define setuvalue(L,obj,x) \
+  { TValue *io = (obj); Udata *x_ = (x); \
+    setnbpointer(io, NBT_GCO, x_); \
+    checkliveness(G(L),io); }
+
+#define setthvalue(L,obj,x) \
+  { TValue *io = (obj); lua_State *x_ = (x); \
+    setnbpointer(io, NBT_GCO, x_); \
+    checkliveness(G(L),io); }
+
+#define setclLvalue(L,obj,x) \
+  { TValue *io = (obj); LClosure *x_ = (x); \
+    setnbpointer(io, NBT_LCL, x_); \
+    checkliveness(G(L),io); }
+
+#define setclCvalue(L,obj,x) \
+  { TValue *io = (obj); CClosure *x_ = (x); \
+    setnbpointer(io, NBT_CCL, x_); \
+    checkliveness(G(L),io); }
+
+#define sethvalue(L,obj,x) \
+  { TValue *io = (obj); Table *x_ = (x); \
+    setnbpointer(io, NBT_TABLE, x_); \
+    checkliveness(G(L),io); }
+
+#define setdeadvalue(obj) \
+	(val_(obj).u = nbmake(NBT_DEADKEY, val_(obj).u & NB_PAYLOAD))
+
+
+
+#endif				/* } */
+
+
 #define setobj(L,obj1,obj2) \
 	{ TValue *io1=(obj1); *io1 = *(obj2); \
 	  (void)L; checkliveness(G(L),io1); }
@@ -276,6 +485,8 @@ typedef struct lua_TValue TValue;
 */
 
 
+#if !defined(LUA_NANBOXING)	/* { */
+
 union Value {
   GCObject *gc;    /* collectable objects */
   void *p;         /* light userdata */
@@ -285,6 +496,24 @@ union Value {
   lua_Number n;    /* float numbers */
 };
 
+#else				/* }{ */
+
+union Value {
+  lua_Unsigned u;  /* boxed values (see 'nbtag') */
+  lua_Number n;    /* float numbers */
+};
+
+
+/*
+** Integer that does not fit in the payload of a boxed value
+*/
+typedef struct IntBox {
+  CommonHeader;
+  lua_Integer i;
+} IntBox;
+
+#endif				/* } */
+
 
 struct lua_TValue {
   TValuefields;
@@ -318,13 +547,28 @@ typedef union UTString {
 } UTString;
 
 
+/*
+** Bits in field 'extra' of long strings. A view is a long string whose
+** bytes are a range of another string, its parent, which it keeps in
+** field 'hnext' (not used by other long strings); the address of its
+** first byte follows its header, and its bytes are not followed by a
+** '\0'. (Reserved words, numbered in 'extra' of short strings, never
+** reach bit 'LSTRVIEW'.)
+*/
+#define LSTRHASH	1	/* string has its hash */
+#define LSTRVIEW	0x80	/* string is a view */
+
+#define isview(ts)	((ts)->extra & LSTRVIEW)
+#define viewparent(ts)	check_exp(isview(ts), (ts)->hnext)
+#define viewaddr(ts)	(*cast(const char **, getaddrstr(ts)))
+
+
 /*
 ** Get the actual string (array of bytes) from a 'TString'.
-** (Access to 'extra' ensures that value is really a 'TString'.)
 */
 #define getaddrstr(ts)	(cast(char *, (ts)) + sizeof(UTString))
 #define getstr(ts)  \
-  check_exp(sizeof((ts)->extra), cast(const char*, getaddrstr(ts)))
+  (isview(ts) ? viewaddr(ts) : cast(const char*, getaddrstr(ts)))
 
 /* get the actual string (array of bytes) from a Lua value */
 #define svalue(o)       getstr(tsvalue(o))
@@ -352,6 +596,19 @@ typedef union UUdata {
 } UUdata;
 
 
+/*
+** Header of typed arrays (full userdata with the metatable set by
+** 'lua_setarraymetatable'), at the start of their memory block. The
+** elements follow the header or, for arrays made by 'lua_pusharray',
+** are in memory owned by the host.
+*/
+typedef struct TArray {
+  void *data;  /* elements */
+  size_t n;  /* number of elements */
+  int kind;  /* type of the elements (LUA_AFLOAT64, etc.) */
+} TArray;
+
+
 /*
 **  Get the address of memory block inside 'Udata'.
 ** (Access to 'ttuv_' ensures that value is really a 'Udata'.)
@@ -359,6 +616,10 @@ typedef union UUdata {
 #define getudatamem(u)  \
   check_exp(sizeof((u)->ttuv_), (cast(char*, (u)) + sizeof(UUdata)))
 
+#define gettarray(u)	cast(TArray *, getudatamem(u))
+
+#if !defined(LUA_NANBOXING)	/* { */
+
 #define setuservalue(L,u,o) \
 	{ const TValue *io=(o); Udata *iu = (u); \
 	  iu->user_ = io->value_; iu->ttuv_ = io->tt_; \
@@ -370,6 +631,20 @@ typedef union UUdata {
 	  io->value_ = iu->user_; io->tt_ = iu->ttuv_; \
 	  checkliveness(G(L),io); }
 
+#else				/* }{ */
+
+/* a boxed value carries its own tag, so 'ttuv_' is not used */
+#define setuservalue(L,u,o) \
+	{ const TValue *io=(o); Udata *iu = (u); \
+	  iu->user_ = io->value_; checkliveness(G(L),io); }
+
+
+#define getuservalue(L,u,o) \
+	{ TValue *io=(o); const Udata *iu = (u); \
+	  io->value_ = iu->user_; checkliveness(G(L),io); }
+
+#endif				/* } */
+
 
 /*
 ** Description of an upvalue for function prototypes
@@ -392,6 +667,17 @@ typedef struct LocVar {
 } LocVar;
 
 
+/*
+** Inline cache of an instruction that accesses a field with a constant
+** short-string key (see 'luaV_getfield'): indices of the nodes where the
+** key and the '__index' metamethod were last found
+*/
+typedef struct FieldCache {
+  int slot;  /* node of the key in the table that had it */
+  int tmslot;  /* node of '__index' in the metatable */
+} FieldCache;
+
+
 /*
 ** Function Prototypes
 */
@@ -410,6 +696,9 @@ typedef struct Proto {
   int lastlinedefined;
   TValue *k;  /* constants used by the function */
   Instruction *code;
+  FieldCache *fcache;  /* inline caches ('sizecode' entries, or NULL) */
+  struct JitCode *jit;  /* machine code (or NULL) */
+  int jitcount;  /* calls and loop iterations left to become hot */
   struct Proto **p;  /* functions defined inside the function */
   int *lineinfo;  /* map from opcodes to source lines (debug information) */
   LocVar *locvars;  /* information about local variables (debug information) */
@@ -473,10 +762,17 @@ typedef union TKey {
 
 
 /* copy a value into a key without messing up field 'next' */
+#if !defined(LUA_NANBOXING)
 #define setnodekey(L,key,obj) \
 	{ TKey *k_=(key); const TValue *io_=(obj); \
 	  k_->nk.value_ = io_->value_; k_->nk.tt_ = io_->tt_; \
 	  (void)L; checkliveness(G(L),io_); }
+#else
+#define setnodekey(L,key,obj) \
+	{ TKey *k_=(key); const TValue *io_=(obj); \
+	  k_->nk.value_ = io_->value_; \
+	  (void)L; checkliveness(G(L),io_); }
+#endif
 
 
 typedef struct Node {
@@ -485,14 +781,41 @@ typedef struct Node {
 } Node;
 
 
+/*
+** Shapes (key layouts shared by tables built with the same short-string
+** keys in the same order). A table in shape mode has no hash part and
+** an empty array part; the value for key 'shape->keys[i]' lives in
+** 'array[i]'. Shapes form a tree whose root is the empty shape.
+** Unused entries in 'keys' are NULL, so that checking a key at a given
+** slot needs no bound other than MAXSHAPEKEYS.
+*/
+#define MAXSHAPEKEYS	8
+
+typedef struct Shape {
+  struct Shape *parent;  /* this shape without its last key */
+  struct Shape *kids;  /* shapes with one more key */
+  struct Shape *next;  /* next shape in list 'parent->kids' */
+  int refcount;  /* number of tables and kids using this shape */
+  lu_byte nkeys;  /* number of keys */
+  lu_byte nkids;  /* length of list 'kids' */
+  TString *keys[MAXSHAPEKEYS];  /* keys, in slot order */
+} Shape;
+
+
 typedef struct Table {
   CommonHeader;
   lu_byte flags;  /* 1<<p means tagmethod(p) is not present */
   lu_byte lsizenode;  /* log2 of size of 'node' array */
   unsigned int sizearray;  /* size of 'array' array */
   TValue *array;  /* array part */
+  Shape *shape;  /* key layout of a table in shape mode, or NULL */
   Node *node;
+#if !defined(LUA_SWISSTABLE)
   Node *lastfree;  /* any free position is before this position */
+#else
+  unsigned int nempty;  /* empty nodes that can still take a key */
+#endif
+  unsigned int lenhint;  /* last boundary found by 'luaH_getn' */
   struct Table *metatable;
   GCObject *gclist;
 } Table;
@@ -527,8 +850,14 @@ LUAI_FUNC int luaO_utf8esc (char *buff, unsigned long x);
 LUAI_FUNC int luaO_ceillog2 (unsigned int x);
 LUAI_FUNC void luaO_arith (lua_State *L, int op, const TValue *p1,
                            const TValue *p2, TValue *res);
-LUAI_FUNC size_t luaO_str2num (const char *s, TValue *o);
+LUAI_FUNC size_t luaO_str2num (lua_State *L, const char *s, TValue *o);
+LUAI_FUNC size_t luaO_rawstr2num (const char *s, lua_Integer *i,
+                                  lua_Number *n, int *isint);
+#if defined(LUA_NANBOXING)
+LUAI_FUNC void luaO_boxint (lua_State *L, TValue *o, lua_Integer i);
+#endif
 LUAI_FUNC int luaO_hexavalue (int c);
+LUAI_FUNC int luaO_fmtfloat (char *buff, lua_Number x, int conv, int prec);
 LUAI_FUNC void luaO_tostring (lua_State *L, StkId obj);
 LUAI_FUNC const char *luaO_pushvfstring (lua_State *L, const char *fmt,
                                                        va_list argp);
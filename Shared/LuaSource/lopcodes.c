@@ -65,6 +65,22 @@ LUAI_DDEF const char *const luaP_opnames[NUM_OPCODES+1] = {
   "CLOSURE",
   "VARARG",
   "EXTRAARG",
+  "ADDINT",
+  "ADDFLT",
+  "SUBINT",
+  "SUBFLT",
+  "MULINT",
+  "MULFLT",
+  "DIVFLT",
+  "LTINT",
+  "LTFLT",
+  "MOVEMOVE",
+  "MOVECALL",
+  "LOADKCALL",
+  "GETUPVALMOVE",
+  "GETTABUPMOVE",
+  "GETTABUPGETTABLE",
+  "SELFLOADK",
   NULL
 };
 
@@ -120,5 +136,89 @@ LUAI_DDEF const lu_byte luaP_opmodes[NUM_OPCODES] = {
  ,opmode(0, 1, OpArgU, OpArgN, iABx)		/* OP_CLOSURE */
  ,opmode(0, 1, OpArgU, OpArgN, iABC)		/* OP_VARARG */
  ,opmode(0, 0, OpArgU, OpArgU, iAx)		/* OP_EXTRAARG */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_ADDINT */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_ADDFLT */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_SUBINT */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_SUBFLT */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_MULINT */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_MULFLT */
+ ,opmode(0, 1, OpArgK, OpArgK, iABC)		/* OP_DIVFLT */
+ ,opmode(1, 0, OpArgK, OpArgK, iABC)		/* OP_LTINT */
+ ,opmode(1, 0, OpArgK, OpArgK, iABC)		/* OP_LTFLT */
+ ,opmode(0, 1, OpArgR, OpArgN, iABC)		/* OP_MOVEMOVE */
+ ,opmode(0, 1, OpArgR, OpArgN, iABC)		/* OP_MOVECALL */
+ ,opmode(0, 1, OpArgK, OpArgN, iABx)		/* OP_LOADKCALL */
+ ,opmode(0, 1, OpArgU, OpArgN, iABC)		/* OP_GETUPVALMOVE */
+ ,opmode(0, 1, OpArgU, OpArgK, iABC)		/* OP_GETTABUPMOVE */
+ ,opmode(0, 1, OpArgU, OpArgK, iABC)		/* OP_GETTABUPGETTABLE */
+ ,opmode(0, 1, OpArgR, OpArgK, iABC)		/* OP_SELFLOADK */
 };
 
+
+/* generic opcode of each opcode (ORDER OP) */
+
+LUAI_DDEF const lu_byte luaP_baseop[NUM_OPCODES] = {
+  OP_MOVE         /* OP_MOVE */
+ ,OP_LOADK        /* OP_LOADK */
+ ,OP_LOADKX       /* OP_LOADKX */
+ ,OP_LOADBOOL     /* OP_LOADBOOL */
+ ,OP_LOADNIL      /* OP_LOADNIL */
+ ,OP_GETUPVAL     /* OP_GETUPVAL */
+ ,OP_GETTABUP     /* OP_GETTABUP */
+ ,OP_GETTABLE     /* OP_GETTABLE */
+ ,OP_SETTABUP     /* OP_SETTABUP */
+ ,OP_SETUPVAL     /* OP_SETUPVAL */
+ ,OP_SETTABLE     /* OP_SETTABLE */
+ ,OP_NEWTABLE     /* OP_NEWTABLE */
+ ,OP_SELF         /* OP_SELF */
+ ,OP_ADD          /* OP_ADD */
+ ,OP_SUB          /* OP_SUB */
+ ,OP_MUL          /* OP_MUL */
+ ,OP_MOD          /* OP_MOD */
+ ,OP_POW          /* OP_POW */
+ ,OP_DIV          /* OP_DIV */
+ ,OP_IDIV         /* OP_IDIV */
+ ,OP_BAND         /* OP_BAND */
+ ,OP_BOR          /* OP_BOR */
+ ,OP_BXOR         /* OP_BXOR */
+ ,OP_SHL          /* OP_SHL */
+ ,OP_SHR          /* OP_SHR */
+ ,OP_UNM          /* OP_UNM */
+ ,OP_BNOT         /* OP_BNOT */
+ ,OP_NOT          /* OP_NOT */
+ ,OP_LEN          /* OP_LEN */
+ ,OP_CONCAT       /* OP_CONCAT */
+ ,OP_JMP          /* OP_JMP */
+ ,OP_EQ           /* OP_EQ */
+ ,OP_LT           /* OP_LT */
+ ,OP_LE           /* OP_LE */
+ ,OP_TEST         /* OP_TEST */
+ ,OP_TESTSET      /* OP_TESTSET */
+ ,OP_CALL         /* OP_CALL */
+ ,OP_TAILCALL     /* OP_TAILCALL */
+ ,OP_RETURN       /* OP_RETURN */
+ ,OP_FORLOOP      /* OP_FORLOOP */
+ ,OP_FORPREP      /* OP_FORPREP */
+ ,OP_TFORCALL     /* OP_TFORCALL */
+ ,OP_TFORLOOP     /* OP_TFORLOOP */
+ ,OP_SETLIST      /* OP_SETLIST */
+ ,OP_CLOSURE      /* OP_CLOSURE */
+ ,OP_VARARG       /* OP_VARARG */
+ ,OP_EXTRAARG     /* OP_EXTRAARG */
+ ,OP_ADD          /* OP_ADDINT */
+ ,OP_ADD          /* OP_ADDFLT */
+ ,OP_SUB          /* OP_SUBINT */
+ ,OP_SUB          /* OP_SUBFLT */
+ ,OP_MUL          /* OP_MULINT */
+ ,OP_MUL          /* OP_MULFLT */
+ ,OP_DIV          /* OP_DIVFLT */
+ ,OP_LT           /* OP_LTINT */
+ ,OP_LT           /* OP_LTFLT */
+ ,OP_MOVE         /* OP_MOVEMOVE */
+ ,OP_MOVE         /* OP_MOVECALL */
+ ,OP_LOADK        /* OP_LOADKCALL */
+ ,OP_GETUPVAL     /* OP_GETUPVALMOVE */
+ ,OP_GETTABUP     /* OP_GETTABUPMOVE */
+ ,OP_GETTABUP     /* OP_GETTABUPGETTABLE */
+ ,OP_SELF         /* OP_SELFLOADK */
+};
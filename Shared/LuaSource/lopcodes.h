@@ -228,11 +228,31 @@ OP_CLOSURE,/*	A Bx	R(A) := closure(KPROTO[Bx])			*/
 
 OP_VARARG,/*	A B	R(A), R(A+1), ..., R(A+B-2) = vararg		*/
 
-OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*/
+OP_EXTRAARG,/*	Ax	extra (larger) argument for previous opcode	*/
+
+/* quickened instructions (see note below) */
+OP_ADDINT,/*	A B C	R(A) := RK(B) + RK(C)	(integers)		*/
+OP_ADDFLT,/*	A B C	R(A) := RK(B) + RK(C)	(floats)		*/
+OP_SUBINT,/*	A B C	R(A) := RK(B) - RK(C)	(integers)		*/
+OP_SUBFLT,/*	A B C	R(A) := RK(B) - RK(C)	(floats)		*/
+OP_MULINT,/*	A B C	R(A) := RK(B) * RK(C)	(integers)		*/
+OP_MULFLT,/*	A B C	R(A) := RK(B) * RK(C)	(floats)		*/
+OP_DIVFLT,/*	A B C	R(A) := RK(B) / RK(C)	(numbers)		*/
+OP_LTINT,/*	A B C	if ((RK(B) <  RK(C)) ~= A) then pc++ (integers)	*/
+OP_LTFLT,/*	A B C	if ((RK(B) <  RK(C)) ~= A) then pc++ (floats)	*/
+
+/* superinstructions (see note below) */
+OP_MOVEMOVE,/*	A B	MOVE, then the MOVE that follows		*/
+OP_MOVECALL,/*	A B	MOVE, then the CALL that follows		*/
+OP_LOADKCALL,/*	A Bx	LOADK, then the CALL that follows		*/
+OP_GETUPVALMOVE,/* A B	GETUPVAL, then the MOVE that follows		*/
+OP_GETTABUPMOVE,/* A B C	GETTABUP, then the MOVE that follows		*/
+OP_GETTABUPGETTABLE,/* A B C	GETTABUP, then the GETTABLE that follows	*/
+OP_SELFLOADK/*	A B C	SELF, then the LOADK that follows		*/
 } OpCode;
 
 
-#define NUM_OPCODES	(cast(int, OP_EXTRAARG) + 1)
+#define NUM_OPCODES	(cast(int, OP_SELFLOADK) + 1)
 
 
 
@@ -257,6 +277,20 @@ OP_EXTRAARG/*	Ax	extra (larger) argument for previous opcode	*/
 
   (*) All 'skips' (pc++) assume that next instruction is a jump.
 
+  (*) Quickened opcodes (OP_ADDINT to OP_LTFLT) are never generated by
+  the compiler. 'luaV_execute' rewrites (quickens) a generic instruction
+  in place into one of them after seeing operands of the matching types,
+  and rewrites it back when the types change. The 'FLT' variants accept
+  a float operand mixed with an integer one (as in 'x * 2'); OP_DIVFLT
+  accepts any two numbers. Use 'GET_BASEOP' wherever the original
+  instruction is needed (debug information, precompiled chunks).
+
+  (*) Superinstructions (OP_MOVEMOVE to OP_SELFLOADK) are written by
+  'luaK_fuse' over the first instruction of a frequent pair; they run
+  that instruction and then the one after it without a new dispatch.
+  The second instruction is kept unchanged, as jumps may go to it.
+  'GET_BASEOP' also gives the original opcode of a superinstruction.
+
 ===========================================================================*/
 
 
@@ -288,6 +322,12 @@ LUAI_DDEC const lu_byte luaP_opmodes[NUM_OPCODES];
 LUAI_DDEC const char *const luaP_opnames[NUM_OPCODES+1];  /* opcode names */
 
 
+LUAI_DDEC const lu_byte luaP_baseop[NUM_OPCODES];
+
+/* generic opcode of a (possibly quickened or fused) instruction */
+#define GET_BASEOP(i)	(cast(OpCode, luaP_baseop[GET_OPCODE(i)]))
+
+
 /* number of list items to accumulate before a SETLIST instruction */
 #define LFIELDS_PER_FLUSH	50
 
@@ -20,6 +20,7 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
 #include "llex.h"
 #include "lmem.h"
 #include "lstate.h"
@@ -240,9 +241,12 @@ static void close_state (lua_State *L) {
   global_State *g = G(L);
   luaF_close(L, L->stack);  /* close all upvalues for this thread */
   luaC_freeallobjects(L);  /* collect all objects */
+  luaJ_close(L);
+  luaH_freeshapes(L);
   if (g->version)  /* closing a fully built state? */
     luai_userstateclose(L);
   luaM_freearray(L, G(L)->strt.hash, G(L)->strt.size);
+  luaM_freearray(L, G(L)->strt.oldhash, G(L)->strt.oldsize);
   luaZ_freebuffer(L, &g->buff);
   freestack(L);
   lua_assert(gettotalbytes(g) == sizeof(LG));
@@ -308,16 +312,30 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->mainthread = L;
   g->seed = makeseed(L);
   g->gcrunning = 0;  /* no GC while building state */
+#if defined(LUAI_JIT)
+  g->jiton = 1;
+#else
+  g->jiton = 0;
+#endif
   g->GCestimate = 0;
   g->strt.size = g->strt.nuse = 0;
-  g->strt.hash = NULL;
+  g->strt.hash = g->strt.oldhash = NULL;
+  g->strt.oldsize = g->strt.moved = g->strt.maxpause = 0;
+  g->shaperoot.parent = g->shaperoot.kids = g->shaperoot.next = NULL;
+  g->shaperoot.refcount = 0;
+  g->shaperoot.nkeys = g->shaperoot.nkids = 0;
+  for (i=0; i < MAXSHAPEKEYS; i++) g->shaperoot.keys[i] = NULL;
   setnilvalue(&g->l_registry);
   luaZ_initbuffer(L, &g->buff);
   g->panic = NULL;
   g->version = NULL;
   g->gcstate = GCSpause;
   g->gckind = KGC_NORMAL;
+  g->gcmode = KGC_INC;
   g->allgc = g->finobj = g->tobefnz = g->fixedgc = NULL;
+  g->survival = g->old1 = g->reallyold = g->firstold1 = NULL;
+  g->finobjsur = g->finobjold1 = g->finobjrold = NULL;
+  g->GCmarked = g->GCmajorminor = 0;
   g->sweepgc = NULL;
   g->gray = g->grayagain = NULL;
   g->weak = g->ephemeron = g->allweak = NULL;
@@ -327,7 +345,19 @@ LUA_API lua_State *lua_newstate (lua_Alloc f, void *ud) {
   g->gcfinnum = 0;
   g->gcpause = LUAI_GCPAUSE;
   g->gcstepmul = LUAI_GCMUL;
+  g->genminormul = LUAI_GENMINORMUL;
+  g->genmajormul = LUAI_GENMAJORMUL;
+  g->gcsteptime = 0;
+  g->gcoverhead = LUAI_GCOVERHEAD;
+  g->gcworkrate[0] = g->gcworkrate[1] = 0;
+  g->gctiming = 0;
+  memset(&g->gcstats, 0, sizeof(g->gcstats));
   for (i=0; i < LUA_NUMTAGS; i++) g->mt[i] = NULL;
+  g->arraymt = NULL;
+  g->jit = NULL;
+#if defined(LUA_NANBOXING)
+  g->lastbox = NULL;
+#endif
   if (luaD_rawrunprotected(L, f_luaopen, NULL) != LUA_OK) {
     /* memory allocation error: free partial state */
     close_state(L);
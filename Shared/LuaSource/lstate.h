@@ -26,6 +26,14 @@
 ** 'tobefnz': all objects ready to be finalized; 
 ** 'fixedgc': all objects that are not to be collected (currently
 ** only small strings, such as reserved words).
+**
+** In generational mode, 'allgc' is kept in age order: objects created
+** since the last collection, then those from the cycle before
+** (starting at 'survival'), then the ones that became old in the last
+** collection (starting at 'old1'), then the really old ones (starting
+** at 'reallyold'), which minor collections do not sweep. 'finobj' has
+** the same parts, starting at 'finobjsur', 'finobjold1' and
+** 'finobjrold'.
 
 */
 
@@ -45,14 +53,45 @@ struct lua_longjmp;  /* defined in ldo.c */
 #define KGC_NORMAL	0
 #define KGC_EMERGENCY	1	/* gc was forced by an allocation failure */
 
+/* modes of Garbage Collection */
+#define KGC_INC		0	/* incremental gc */
+#define KGC_GEN		1	/* generational gc */
+#define KGC_GENMAJOR	2	/* generational gc doing an incremental major */
+
 
+/*
+** While the string table is being resized, its previous buckets stay
+** in 'oldhash'; buckets before 'moved' have been moved to 'hash'.
+*/
 typedef struct stringtable {
   TString **hash;
   int nuse;  /* number of elements */
   int size;
+  TString **oldhash;  /* buckets being moved to 'hash' (or NULL) */
+  int oldsize;
+  int moved;  /* number of buckets already moved from 'oldhash' */
+  int maxpause;  /* most strings moved by one resize step */
 } stringtable;
 
 
+/*
+** Collector statistics. 'hist' counts steps by duration: times below 4
+** microseconds have one bucket each; above that, each power of 2 is
+** split in 4 buckets.
+*/
+#define GCHISTSIZE	128
+
+typedef struct GCStats {
+  lu_mem hist[GCHISTSIZE];  /* histogram of step times */
+  lu_mem steps;  /* number of timed steps */
+  lu_mem cycles;  /* number of complete major cycles */
+  lu_mem minors;  /* number of minor collections */
+  lu_mem swept;  /* bytes freed */
+  lu_mem maxtime;  /* longest step */
+  lu_mem totaltime;  /* time spent in timed steps */
+} GCStats;
+
+
 /*
 ** Information about a call.
 ** When a thread yields, 'func' is adjusted to pretend that the
@@ -113,12 +152,15 @@ typedef struct global_State {
   lu_mem GCmemtrav;  /* memory traversed by the GC */
   lu_mem GCestimate;  /* an estimate of the non-garbage memory in use */
   stringtable strt;  /* hash table for strings */
+  Shape shaperoot;  /* empty shape (root of all table shapes) */
   TValue l_registry;
   unsigned int seed;  /* randomized seed for hashes */
   lu_byte currentwhite;
   lu_byte gcstate;  /* state of garbage collector */
   lu_byte gckind;  /* kind of GC running */
+  lu_byte gcmode;  /* incremental or generational */
   lu_byte gcrunning;  /* true if GC is running */
+  lu_byte jiton;  /* true if the JIT compiler is on */
   GCObject *allgc;  /* list of all collectable objects */
   GCObject **sweepgc;  /* current position of sweep in list */
   GCObject *finobj;  /* list of collectable objects with finalizers */
@@ -129,17 +171,39 @@ typedef struct global_State {
   GCObject *allweak;  /* list of all-weak tables */
   GCObject *tobefnz;  /* list of userdata to be GC */
   GCObject *fixedgc;  /* list of objects not to be collected */
+  /* fields for generational collector */
+  GCObject *survival;  /* start of objects that survived one GC cycle */
+  GCObject *old1;  /* start of old1 objects */
+  GCObject *reallyold;  /* objects more than one cycle old ("really old") */
+  GCObject *firstold1;  /* first OLD1 object in the list (if any) */
+  GCObject *finobjsur;  /* list of survival objects with finalizers */
+  GCObject *finobjold1;  /* list of old1 objects with finalizers */
+  GCObject *finobjrold;  /* list of really old objects with finalizers */
+  lu_mem GCmarked;  /* memory marked in the current cycle */
+  lu_mem GCmajorminor;  /* live memory after the last major collection */
   struct lua_State *twups;  /* list of threads with open upvalues */
   Mbuffer buff;  /* temporary buffer for string concatenation */
   unsigned int gcfinnum;  /* number of finalizers to call in each GC step */
   int gcpause;  /* size of pause between successive GCs */
   int gcstepmul;  /* GC 'granularity' */
+  int genminormul;  /* control for minor generational collections */
+  int genmajormul;  /* control for major generational collections */
+  int gcsteptime;  /* maximum time for a step (0 for work-based steps) */
+  int gcoverhead;  /* heap growth allowed over live data in paced steps */
+  lu_mem gcworkrate[2];  /* work per microsecond marking and sweeping */
+  lu_byte gctiming;  /* true if steps are being timed */
+  GCStats gcstats;
   lua_CFunction panic;  /* to be called in unprotected errors */
   struct lua_State *mainthread;
   const lua_Number *version;  /* pointer to version number */
   TString *memerrmsg;  /* memory-error message */
   TString *tmname[TM_N];  /* array with tag-method names */
   struct Table *mt[LUA_NUMTAGS];  /* metatables for basic types */
+  struct Table *arraymt;  /* metatable of typed arrays (or NULL) */
+  struct JitHeap *jit;  /* memory of the JIT compiler (or NULL) */
+#if defined(LUA_NANBOXING)
+  GCObject *lastbox;  /* newest integer box (see 'luaO_boxint') */
+#endif
 } global_State;
 
 
@@ -186,6 +250,9 @@ union GCUnion {
   struct Table h;
   struct Proto p;
   struct lua_State th;  /* thread */
+#if defined(LUA_NANBOXING)
+  struct IntBox ib;
+#endif
 };
 
 
@@ -202,6 +269,9 @@ union GCUnion {
 #define gco2t(o)  check_exp((o)->tt == LUA_TTABLE, &((cast_u(o))->h))
 #define gco2p(o)  check_exp((o)->tt == LUA_TPROTO, &((cast_u(o))->p))
 #define gco2th(o)  check_exp((o)->tt == LUA_TTHREAD, &((cast_u(o))->th))
+#if defined(LUA_NANBOXING)
+#define gco2ib(o)  check_exp((o)->tt == LUA_TNUMINT, &((cast_u(o))->ib))
+#endif
 
 
 /* macro to convert a Lua object into a GCObject */
@@ -10,6 +10,7 @@
 #include "lprefix.h"
 
 
+#include <limits.h>
 #include <string.h>
 
 #include "lua.h"
@@ -23,15 +24,6 @@
 
 
 
-/*
-** Lua will use at most ~(2^LUAI_HASHLIMIT) bytes from a string to
-** compute its hash
-*/
-#if !defined(LUAI_HASHLIMIT)
-#define LUAI_HASHLIMIT		5
-#endif
-
-
 /*
 ** equality for long strings
 */
@@ -44,43 +36,208 @@ int luaS_eqlngstr (TString *a, TString *b) {
 }
 
 
+/*
+** {======================================================
+** Hash function
+** =======================================================
+*/
+
+/*
+** Strings are hashed a 64-bit word at a time, covering all their bytes,
+** with the multiply-and-fold mixing of wyhash: 'mum' replaces 'a' and
+** 'b' with the low and high halves of their 128-bit product. Compilers
+** without 'long long' hash one byte at a time.
+*/
+#if defined(LLONG_MAX)	/* { */
+
+typedef unsigned long long l_uint64;
+
+#define HK0	0xa0761d6478bd642fULL
+#define HK1	0xe7037ed1a0b428dbULL
+#define HK2	0x8ebc6af09c88c6e3ULL
+#define HK3	0x589965cc75374cc3ULL
+
+
+static void mum (l_uint64 *a, l_uint64 *b) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 r = cast(unsigned __int128, *a) * *b;
+  *a = cast(l_uint64, r);
+  *b = cast(l_uint64, r >> 64);
+#else
+  l_uint64 ha = *a >> 32, hb = *b >> 32;
+  l_uint64 la = *a & 0xffffffffu, lb = *b & 0xffffffffu;
+  l_uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  l_uint64 t = rl + (rm0 << 32);
+  l_uint64 c = (t < rl);
+  l_uint64 lo = t + (rm1 << 32);
+  c += (lo < t);
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+
+static l_uint64 mix (l_uint64 a, l_uint64 b) {
+  mum(&a, &b);
+  return a ^ b;
+}
+
+
+/* unaligned reads (compilers turn these 'memcpy's into single loads) */
+static l_uint64 read64 (const char *p) {
+  l_uint64 v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static l_uint64 read32 (const char *p) {
+  unsigned int v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+
+unsigned int luaS_hash (const char *str, size_t l, unsigned int seed) {
+  l_uint64 s = mix(seed ^ HK0, HK1);
+  l_uint64 a, b;
+  if (l <= 16) {
+    if (l >= 4) {  /* two (maybe overlapping) pairs of 32-bit words */
+      size_t k = (l >> 3) << 2;
+      a = (read32(str) << 32) | read32(str + k);
+      b = (read32(str + l - 4) << 32) | read32(str + l - 4 - k);
+    }
+    else if (l > 0) {
+      a = (cast(l_uint64, cast_byte(str[0])) << 16) |
+          (cast(l_uint64, cast_byte(str[l >> 1])) << 8) |
+           cast(l_uint64, cast_byte(str[l - 1]));
+      b = 0;
+    }
+    else a = b = 0;
+  }
+  else {
+    size_t i = l;
+    const char *p = str;
+    if (i > 48) {  /* three independent lanes */
+      l_uint64 s1 = s, s2 = s;
+      do {
+        s = mix(read64(p) ^ HK1, read64(p + 8) ^ s);
+        s1 = mix(read64(p + 16) ^ HK2, read64(p + 24) ^ s1);
+        s2 = mix(read64(p + 32) ^ HK3, read64(p + 40) ^ s2);
+        p += 48; i -= 48;
+      } while (i > 48);
+      s ^= s1 ^ s2;
+    }
+    while (i > 16) {
+      s = mix(read64(p) ^ HK1, read64(p + 8) ^ s);
+      p += 16; i -= 16;
+    }
+    a = read64(p + i - 16);  /* last 16 bytes (maybe overlapping) */
+    b = read64(p + i - 8);
+  }
+  a ^= HK1; b ^= s;
+  mum(&a, &b);
+  return cast(unsigned int, mix(a ^ HK0 ^ l, b ^ HK1));
+}
+
+#else	/* }{ */
+
 unsigned int luaS_hash (const char *str, size_t l, unsigned int seed) {
   unsigned int h = seed ^ cast(unsigned int, l);
-  size_t l1;
-  size_t step = (l >> LUAI_HASHLIMIT) + 1;
-  for (l1 = l; l1 >= step; l1 -= step)
-    h = h ^ ((h<<5) + (h>>2) + cast_byte(str[l1 - 1]));
+  for (; l > 0; l--)
+    h ^= ((h<<5) + (h>>2) + cast_byte(str[l - 1]));
   return h;
 }
 
+#endif	/* } */
+
 
 /*
-** resizes the string table
+** Long strings get their hashes only when used as keys; until then,
+** their 'hash' field keeps the seed.
 */
-void luaS_resize (lua_State *L, int newsize) {
-  int i;
-  stringtable *tb = &G(L)->strt;
-  if (newsize > tb->size) {  /* grow table if needed */
-    luaM_reallocvector(L, tb->hash, tb->size, newsize, TString *);
-    for (i = tb->size; i < newsize; i++)
-      tb->hash[i] = NULL;
+unsigned int luaS_hashlongstr (TString *ts) {
+  lua_assert(ts->tt == LUA_TLNGSTR);
+  if (!(ts->extra & LSTRHASH)) {  /* no hash? */
+    ts->hash = luaS_hash(getstr(ts), ts->len, ts->hash);
+    ts->extra |= LSTRHASH;  /* now it has its hash */
+  }
+  return ts->hash;
+}
+
+/* }====================================================== */
+
+
+/*
+** list of the bucket where strings with hash 'h' are (or go): while
+** the table is being resized, buckets not moved yet are still in
+** 'oldhash'
+*/
+static TString **strlist (stringtable *tb, unsigned int h) {
+  if (tb->oldhash != NULL) {
+    int i = lmod(h, tb->oldsize);
+    if (i >= tb->moved)  /* bucket not moved yet? */
+      return &tb->oldhash[i];
   }
-  for (i = 0; i < tb->size; i++) {  /* rehash */
-    TString *p = tb->hash[i];
-    tb->hash[i] = NULL;
+  return &tb->hash[lmod(h, tb->size)];
+}
+
+
+/*
+** moves 'n' buckets of the old table to the new one, freeing the old
+** table after its last bucket
+*/
+void luaS_resizestep (lua_State *L, int n) {
+  stringtable *tb = &G(L)->strt;
+  int count = 0;  /* number of strings moved */
+  lua_assert(tb->oldhash != NULL);
+  for (; n > 0 && tb->moved < tb->oldsize; n--) {
+    TString *p = tb->oldhash[tb->moved];
+    int i;
+    for (i = tb->moved; i < tb->size; i += tb->oldsize)
+      tb->hash[i] = NULL;  /* clear new buckets whose first source is this */
+    tb->oldhash[tb->moved++] = NULL;
     while (p) {  /* for each node in the list */
       TString *hnext = p->hnext;  /* save next */
-      unsigned int h = lmod(p->hash, newsize);  /* new position */
+      unsigned int h = lmod(p->hash, tb->size);  /* new position */
       p->hnext = tb->hash[h];  /* chain it */
       tb->hash[h] = p;
       p = hnext;
+      count++;
     }
   }
-  if (newsize < tb->size) {  /* shrink table if needed */
-    /* vanishing slice should be empty */
-    lua_assert(tb->hash[newsize] == NULL && tb->hash[tb->size - 1] == NULL);
-    luaM_reallocvector(L, tb->hash, tb->size, newsize, TString *);
+  if (count > tb->maxpause)
+    tb->maxpause = count;
+  if (tb->moved == tb->oldsize) {  /* all moved? */
+    luaM_freearray(L, tb->oldhash, tb->oldsize);
+    tb->oldhash = NULL;
+    tb->oldsize = tb->moved = 0;
   }
+}
+
+
+/*
+** resizes the string table. To avoid a long pause with large tables,
+** only allocates the new buckets here; the old ones move a few at a
+** time, with each new short string and each GC step. A new bucket is
+** cleared when the first old bucket that maps to it moves; until then,
+** 'strlist' never reaches it.
+*/
+void luaS_resize (lua_State *L, int newsize) {
+  int i;
+  stringtable *tb = &G(L)->strt;
+  TString **newhash;
+  if (tb->oldhash != NULL)  /* still moving from a previous resize? */
+    luaS_resizestep(L, tb->oldsize);  /* finish it */
+  newhash = luaM_newvector(L, newsize, TString *);
+  if (tb->size > 0) {  /* anything to move? */
+    tb->oldhash = tb->hash;
+    tb->oldsize = tb->size;
+  }
+  else {  /* first table */
+    for (i = 0; i < newsize; i++)
+      newhash[i] = NULL;
+  }
+  tb->hash = newhash;
   tb->size = newsize;
 }
 
@@ -108,7 +265,7 @@ static TString *createstrobj (lua_State *L, const char *str, size_t l,
 
 void luaS_remove (lua_State *L, TString *ts) {
   stringtable *tb = &G(L)->strt;
-  TString **p = &tb->hash[lmod(ts->hash, tb->size)];
+  TString **p = strlist(tb, ts->hash);
   while (*p != ts)  /* find previous element */
     p = &(*p)->hnext;
   *p = (*p)->hnext;  /* remove element from its list */
@@ -123,7 +280,10 @@ static TString *internshrstr (lua_State *L, const char *str, size_t l) {
   TString *ts;
   global_State *g = G(L);
   unsigned int h = luaS_hash(str, l, g->seed);
-  TString **list = &g->strt.hash[lmod(h, g->strt.size)];
+  TString **list;
+  if (g->strt.oldhash != NULL)  /* resizing the table? */
+    luaS_resizestep(L, STRRESIZESTEP);
+  list = strlist(&g->strt, h);
   for (ts = *list; ts != NULL; ts = ts->hnext) {
     if (l == ts->len &&
         (memcmp(str, getstr(ts), l * sizeof(char)) == 0)) {
@@ -135,7 +295,7 @@ static TString *internshrstr (lua_State *L, const char *str, size_t l) {
   }
   if (g->strt.nuse >= g->strt.size && g->strt.size <= MAX_INT/2) {
     luaS_resize(L, g->strt.size * 2);
-    list = &g->strt.hash[lmod(h, g->strt.size)];  /* recompute with new size */
+    list = strlist(&g->strt, h);  /* recompute with new size */
   }
   ts = createstrobj(L, str, l, LUA_TSHRSTR, h);
   ts->hnext = *list;
@@ -167,6 +327,42 @@ TString *luaS_new (lua_State *L, const char *str) {
 }
 
 
+/*
+** new string with the 'l' bytes of 's' starting at 'i'. A long result
+** is a view sharing the bytes of 's' (or of the parent of 's'), so that
+** taking it costs no copy; short strings are always internalized.
+*/
+TString *luaS_newview (lua_State *L, TString *s, size_t i, size_t l) {
+  const char *str = getstr(s) + i;
+  lua_assert(i <= s->len && l <= s->len - i);
+  if (l <= LUAI_MAXSHORTLEN)  /* short string? */
+    return internshrstr(L, str, l);
+  else if (l == s->len)  /* the whole string? */
+    return s;
+  else {
+    TString *ts = gco2ts(luaC_newobj(L, LUA_TLNGSTR, sizeview));
+    ts->len = l;
+    ts->hash = G(L)->seed;
+    ts->extra = LSTRVIEW;
+    ts->hnext = isview(s) ? viewparent(s) : s;
+    viewaddr(ts) = str;
+    return ts;
+  }
+}
+
+
+/*
+** new string with a copy of the bytes of view 'ts' (which does not
+** keep the parent of 'ts' alive)
+*/
+TString *luaS_materialize (lua_State *L, TString *ts) {
+  TString *s = createstrobj(L, getstr(ts), ts->len, LUA_TLNGSTR, ts->hash);
+  lua_assert(isview(ts));
+  s->extra = ts->extra & LSTRHASH;  /* keep its hash, if already computed */
+  return s;
+}
+
+
 Udata *luaS_newudata (lua_State *L, size_t s) {
   Udata *u;
   GCObject *o;
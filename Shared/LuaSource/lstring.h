@@ -13,7 +13,8 @@
 
 
 #define sizelstring(l)  (sizeof(union UTString) + ((l) + 1) * sizeof(char))
-#define sizestring(s)	sizelstring((s)->len)
+#define sizeview	(sizeof(union UTString) + sizeof(char *))
+#define sizestring(s)	(isview(s) ? sizeview : sizelstring((s)->len))
 
 #define sizeludata(l)	(sizeof(union UUdata) + (l))
 #define sizeudata(u)	sizeludata((u)->len)
@@ -35,12 +36,17 @@
 
 
 LUAI_FUNC unsigned int luaS_hash (const char *str, size_t l, unsigned int seed);
+LUAI_FUNC unsigned int luaS_hashlongstr (TString *ts);
 LUAI_FUNC int luaS_eqlngstr (TString *a, TString *b);
 LUAI_FUNC void luaS_resize (lua_State *L, int newsize);
+LUAI_FUNC void luaS_resizestep (lua_State *L, int n);
 LUAI_FUNC void luaS_remove (lua_State *L, TString *ts);
 LUAI_FUNC Udata *luaS_newudata (lua_State *L, size_t s);
 LUAI_FUNC TString *luaS_newlstr (lua_State *L, const char *str, size_t l);
 LUAI_FUNC TString *luaS_new (lua_State *L, const char *str);
+LUAI_FUNC TString *luaS_newview (lua_State *L, TString *s, size_t i,
+                                                         size_t l);
+LUAI_FUNC TString *luaS_materialize (lua_State *L, TString *ts);
 
 
 #endif
@@ -46,9 +46,21 @@
 
 
 
+/*
+** Gets string argument 'arg' like 'luaL_checklstring', but without
+** copying a string view: the result may not be '\0'-terminated.
+*/
+static const char *checkview (lua_State *L, int arg, size_t *l) {
+  const char *s = lua_toview(L, arg, l);
+  if (s == NULL)  /* not a string? */
+    s = luaL_checklstring(L, arg, l);  /* raise the error */
+  return s;
+}
+
+
 static int str_len (lua_State *L) {
   size_t l;
-  luaL_checklstring(L, 1, &l);
+  checkview(L, 1, &l);
   lua_pushinteger(L, (lua_Integer)l);
   return 1;
 }
@@ -64,13 +76,14 @@ static lua_Integer posrelat (lua_Integer pos, size_t len) {
 
 static int str_sub (lua_State *L) {
   size_t l;
-  const char *s = luaL_checklstring(L, 1, &l);
-  lua_Integer start = posrelat(luaL_checkinteger(L, 2), l);
-  lua_Integer end = posrelat(luaL_optinteger(L, 3, -1), l);
+  lua_Integer start, end;
+  checkview(L, 1, &l);
+  start = posrelat(luaL_checkinteger(L, 2), l);
+  end = posrelat(luaL_optinteger(L, 3, -1), l);
   if (start < 1) start = 1;
   if (end > (lua_Integer)l) end = l;
   if (start <= end)
-    lua_pushlstring(L, s + start - 1, (size_t)(end - start + 1));
+    lua_pushview(L, 1, (size_t)start - 1, (size_t)(end - start + 1));
   else lua_pushliteral(L, "");
   return 1;
 }
@@ -79,7 +92,7 @@ static int str_sub (lua_State *L) {
 static int str_reverse (lua_State *L) {
   size_t l, i;
   luaL_Buffer b;
-  const char *s = luaL_checklstring(L, 1, &l);
+  const char *s = checkview(L, 1, &l);
   char *p = luaL_buffinitsize(L, &b, l);
   for (i = 0; i < l; i++)
     p[i] = s[l - i - 1];
@@ -92,7 +105,7 @@ static int str_lower (lua_State *L) {
   size_t l;
   size_t i;
   luaL_Buffer b;
-  const char *s = luaL_checklstring(L, 1, &l);
+  const char *s = checkview(L, 1, &l);
   char *p = luaL_buffinitsize(L, &b, l);
   for (i=0; i<l; i++)
     p[i] = tolower(uchar(s[i]));
@@ -105,7 +118,7 @@ static int str_upper (lua_State *L) {
   size_t l;
   size_t i;
   luaL_Buffer b;
-  const char *s = luaL_checklstring(L, 1, &l);
+  const char *s = checkview(L, 1, &l);
   char *p = luaL_buffinitsize(L, &b, l);
   for (i=0; i<l; i++)
     p[i] = toupper(uchar(s[i]));
@@ -116,7 +129,7 @@ static int str_upper (lua_State *L) {
 
 static int str_rep (lua_State *L) {
   size_t l, lsep;
-  const char *s = luaL_checklstring(L, 1, &l);
+  const char *s = checkview(L, 1, &l);
   lua_Integer n = luaL_checkinteger(L, 2);
   const char *sep = luaL_optlstring(L, 3, "", &lsep);
   if (n <= 0) lua_pushliteral(L, "");
@@ -142,7 +155,7 @@ static int str_rep (lua_State *L) {
 
 static int str_byte (lua_State *L) {
   size_t l;
-  const char *s = luaL_checklstring(L, 1, &l);
+  const char *s = checkview(L, 1, &l);
   lua_Integer posi = posrelat(luaL_optinteger(L, 2, 1), l);
   lua_Integer pose = posrelat(luaL_optinteger(L, 3, posi), l);
   int n, i;
@@ -209,9 +222,10 @@ static int str_dump (lua_State *L) {
 typedef struct MatchState {
   int matchdepth;  /* control for recursive depth (to avoid C stack overflow) */
   const char *src_init;  /* init of source string */
-  const char *src_end;  /* end ('\0') of source string */
+  const char *src_end;  /* end of source string */
   const char *p_end;  /* end ('\0') of pattern */
   lua_State *L;
+  int src;  /* index of source string (captures are views of it) */
   int level;  /* total number of captures (finished or unfinished) */
   struct {
     const char *init;
@@ -450,14 +464,15 @@ static const char *match (MatchState *ms, const char *s, const char *p) {
             break;
           }
           case 'f': {  /* frontier? */
-            const char *ep; char previous;
+            const char *ep; char previous, current;
             p += 2;
             if (*p != '[')
               luaL_error(ms->L, "missing '[' after '%%f' in pattern");
             ep = classend(ms, p);  /* points to what is next */
             previous = (s == ms->src_init) ? '\0' : *(s - 1);
+            current = (s == ms->src_end) ? '\0' : *s;
             if (!matchbracketclass(uchar(previous), p, ep - 1) &&
-               matchbracketclass(uchar(*s), p, ep - 1)) {
+               matchbracketclass(uchar(current), p, ep - 1)) {
               p = ep; goto init;  /* return match(ms, s, ep); */
             }
             s = NULL;  /* match failed */
@@ -519,6 +534,579 @@ static const char *match (MatchState *ms, const char *s, const char *p) {
 }
 
 
+/*
+** A pattern is compiled into a sequence of items, one for each step
+** of 'match', ending with an item I_END; 'cmatch' follows exactly the
+** steps of 'match' over these items, without decoding the pattern
+** again. Sets without class escapes become bitsets (class results
+** depend on the locale, so they are still computed while matching).
+** Malformed patterns are not compiled, so that 'match' raises their
+** errors at the same points as before.
+*/
+
+/* kinds of items */
+#define I_END		0	/* end of pattern */
+#define I_ANY		1	/* '.' */
+#define I_CHAR		2	/* a single character */
+#define I_CLASS		3	/* a class like '%a' */
+#define I_SET		4	/* a set '[...]', as a bitset */
+#define I_BRACKET	5	/* a set '[...]' with class escapes */
+#define I_OPEN		6	/* '(' */
+#define I_POSITION	7	/* '()' */
+#define I_CLOSE		8	/* ')' */
+#define I_DOLLAR	9	/* '$' at the end of the pattern */
+#define I_BALANCE	10	/* '%bxy' */
+#define I_FRONTIER	11	/* '%f[...]' */
+#define I_BACKREF	12	/* '%0' to '%9' */
+
+/* items that match a single character */
+#define issingle(op)	(I_ANY <= (op) && (op) <= I_BRACKET)
+
+/* size of a bitset with all characters */
+#define SETSIZE		(UCHAR_MAX / CHAR_BIT + 1)
+
+#define testset(set,c)	((set)[(c) / CHAR_BIT] & (1u << ((c) % CHAR_BIT)))
+
+
+typedef struct PItem {
+  unsigned char op;  /* kind of item */
+  unsigned char rep;  /* suffix ('*', '+', '-', '?') or 0 */
+  unsigned char c, c2;  /* character, class, capture or '%b' delimiters */
+  const unsigned char *set;  /* bitset of I_SET and I_FRONTIER (or NULL) */
+  const char *p, *ep;  /* '[' and end of a set in the pattern copy */
+} PItem;
+
+
+/*
+** A compiled pattern, with its items followed by their bitsets and
+** by a copy of the pattern (without the anchor)
+*/
+typedef struct Pattern {
+  unsigned int stamp;  /* time of last use (see 'getpattern') */
+  unsigned char anchor;  /* pattern starts with '^' */
+  unsigned char skip;  /* first item must match a character */
+  PItem item[1];
+} Pattern;
+
+
+/* name of the metatable of compiled patterns in the registry */
+#define PATTERNMT	"_PATTERN"
+
+
+typedef struct CompState {
+  const char *p_end;  /* end ('\0') of pattern */
+  PItem *item;  /* next item to fill (NULL when only counting) */
+  unsigned char *set;  /* next bitset to fill */
+  int nitems;  /* number of items */
+  int nsets;  /* number of bitsets */
+} CompState;
+
+
+/* like 'classend', but returns NULL for a malformed class */
+static const char *cclassend (const char *p, const char *p_end) {
+  switch (*p++) {
+    case L_ESC: {
+      return (p == p_end) ? NULL : p+1;
+    }
+    case '[': {
+      if (*p == '^') p++;
+      do {  /* look for a ']' */
+        if (p == p_end)
+          return NULL;
+        if (*(p++) == L_ESC && p < p_end)
+          p++;  /* skip escapes (e.g. '%]') */
+      } while (*p != ']');
+      return p+1;
+    }
+    default: {
+      return p;
+    }
+  }
+}
+
+
+/* check whether set '[p, ec]' has class escapes (as 'matchbracketclass') */
+static int hasclasses (const char *p, const char *ec) {
+  if (*(p+1) == '^')
+    p++;
+  while (++p < ec) {
+    if (*p == L_ESC) {
+      p++;
+      if (isalpha(uchar(*p)))
+        return 1;
+    }
+    else if ((*(p+1) == '-') && (p+2 < ec))
+      p+=2;
+  }
+  return 0;
+}
+
+
+static void compileset (CompState *cs, PItem *it, const char *p,
+                                                  const char *ep) {
+  it->p = p;
+  it->ep = ep;
+  if (hasclasses(p, ep - 1)) {
+    if (it->op == I_SET)
+      it->op = I_BRACKET;
+  }
+  else {
+    cs->nsets++;
+    if (cs->set != NULL) {
+      int c;
+      memset(cs->set, 0, SETSIZE);
+      for (c = 0; c <= UCHAR_MAX; c++) {
+        if (matchbracketclass(c, p, ep - 1))
+          cs->set[c / CHAR_BIT] |= 1u << (c % CHAR_BIT);
+      }
+      it->set = cs->set;
+      cs->set += SETSIZE;
+    }
+  }
+}
+
+
+/*
+** Compiles pattern 'p' (already without its anchor) into 'cs->item',
+** or only counts its items and bitsets when 'cs->item' is NULL.
+** Returns 0 if the pattern is malformed.
+*/
+static int compile (CompState *cs, const char *p) {
+  for (;;) {
+    PItem it;
+    it.rep = it.c = it.c2 = 0;
+    it.set = NULL;
+    it.p = it.ep = NULL;
+    if (p == cs->p_end)
+      it.op = I_END;
+    else switch (*p) {
+      case '(': {
+        if (*(p + 1) == ')') {
+          it.op = I_POSITION; p += 2;
+        }
+        else {
+          it.op = I_OPEN; p++;
+        }
+        break;
+      }
+      case ')': {
+        it.op = I_CLOSE; p++;
+        break;
+      }
+      case '$': {
+        if ((p + 1) != cs->p_end)
+          goto dflt;
+        it.op = I_DOLLAR; p++;
+        break;
+      }
+      case L_ESC: {
+        switch (*(p + 1)) {
+          case 'b': {
+            if (p + 2 >= cs->p_end - 1)
+              return 0;  /* missing arguments to '%b' */
+            it.op = I_BALANCE;
+            it.c = uchar(*(p + 2));
+            it.c2 = uchar(*(p + 3));
+            p += 4;
+            break;
+          }
+          case 'f': {
+            const char *ep;
+            p += 2;
+            if (*p != '[' || (ep = cclassend(p, cs->p_end)) == NULL)
+              return 0;
+            it.op = I_FRONTIER;
+            compileset(cs, &it, p, ep);
+            p = ep;
+            break;
+          }
+          case '0': case '1': case '2': case '3':
+          case '4': case '5': case '6': case '7':
+          case '8': case '9': {
+            it.op = I_BACKREF;
+            it.c = uchar(*(p + 1));
+            p += 2;
+            break;
+          }
+          default: goto dflt;
+        }
+        break;
+      }
+      default: dflt: {
+        const char *ep = cclassend(p, cs->p_end);
+        if (ep == NULL)
+          return 0;
+        switch (*p) {
+          case '.': it.op = I_ANY; break;
+          case L_ESC: {
+            it.op = isalpha(uchar(*(p + 1))) ? I_CLASS : I_CHAR;
+            it.c = uchar(*(p + 1));
+            break;
+          }
+          case '[': it.op = I_SET; compileset(cs, &it, p, ep); break;
+          default: it.op = I_CHAR; it.c = uchar(*p); break;
+        }
+        if (*ep == '*' || *ep == '+' || *ep == '-' || *ep == '?') {
+          it.rep = uchar(*ep);
+          ep++;
+        }
+        p = ep;
+        break;
+      }
+    }
+    cs->nitems++;
+    if (cs->item != NULL)
+      *cs->item++ = it;
+    if (it.op == I_END)
+      return 1;
+  }
+}
+
+
+/*
+** Compiles pattern 'p' into a new userdata on the stack; returns NULL
+** (pushing nothing) if the pattern is malformed.
+*/
+static Pattern *newpattern (lua_State *L, const char *p, size_t lp) {
+  CompState cs;
+  Pattern *pt;
+  char *copy;
+  int anchor = (*p == '^');
+  if (anchor) {
+    p++; lp--;  /* skip anchor character */
+  }
+  cs.p_end = p + lp;
+  cs.item = NULL;
+  cs.set = NULL;
+  cs.nitems = cs.nsets = 0;
+  if (!compile(&cs, p))  /* first pass only counts items and sets */
+    return NULL;
+  pt = (Pattern *)lua_newuserdata(L, sizeof(Pattern) +
+                  (cs.nitems - 1) * sizeof(PItem) + cs.nsets * SETSIZE + lp + 1);
+  luaL_setmetatable(L, PATTERNMT);
+  cs.item = pt->item;
+  cs.set = (unsigned char *)(pt->item + cs.nitems);
+  copy = (char *)(cs.set + cs.nsets * SETSIZE);
+  memcpy(copy, p, lp + 1);  /* copy pattern with its '\0' */
+  cs.p_end = copy + lp;
+  cs.nitems = cs.nsets = 0;
+  compile(&cs, copy);
+  pt->stamp = 0;
+  pt->anchor = (unsigned char)anchor;
+  pt->skip = !anchor && issingle(pt->item[0].op) &&
+             (pt->item[0].rep == 0 || pt->item[0].rep == '+');
+  return pt;
+}
+
+
+static int csinglematch (MatchState *ms, const char *s, const PItem *it) {
+  if (s >= ms->src_end)
+    return 0;
+  else {
+    int c = uchar(*s);
+    switch (it->op) {
+      case I_ANY: return 1;
+      case I_CHAR: return (it->c == c);
+      case I_CLASS: return match_class(c, it->c);
+      case I_SET: return testset(it->set, c);
+      default: return matchbracketclass(c, it->p, it->ep - 1);
+    }
+  }
+}
+
+
+/* recursive function */
+static const char *cmatch (MatchState *ms, const char *s, const PItem *it);
+
+
+static const char *cmax_expand (MatchState *ms, const char *s,
+                                  const PItem *it) {
+  ptrdiff_t i = 0;  /* counts maximum expand for item */
+  if (it->op == I_ANY)
+    i = ms->src_end - s;
+  else {
+    while (csinglematch(ms, s + i, it))
+      i++;
+  }
+  /* keeps trying to match with the maximum repetitions */
+  while (i>=0) {
+    const char *res = cmatch(ms, (s+i), it + 1);
+    if (res) return res;
+    i--;  /* else didn't match; reduce 1 repetition to try again */
+  }
+  return NULL;
+}
+
+
+static const char *cmin_expand (MatchState *ms, const char *s,
+                                  const PItem *it) {
+  for (;;) {
+    const char *res = cmatch(ms, s, it + 1);
+    if (res != NULL)
+      return res;
+    else if (csinglematch(ms, s, it))
+      s++;  /* try with one more repetition */
+    else return NULL;
+  }
+}
+
+
+static const char *cstart_capture (MatchState *ms, const char *s,
+                                     const PItem *it, int what) {
+  const char *res;
+  int level = ms->level;
+  if (level >= LUA_MAXCAPTURES) luaL_error(ms->L, "too many captures");
+  ms->capture[level].init = s;
+  ms->capture[level].len = what;
+  ms->level = level+1;
+  if ((res=cmatch(ms, s, it)) == NULL)  /* match failed? */
+    ms->level--;  /* undo capture */
+  return res;
+}
+
+
+static const char *cend_capture (MatchState *ms, const char *s,
+                                   const PItem *it) {
+  int l = capture_to_close(ms);
+  const char *res;
+  ms->capture[l].len = s - ms->capture[l].init;  /* close capture */
+  if ((res = cmatch(ms, s, it)) == NULL)  /* match failed? */
+    ms->capture[l].len = CAP_UNFINISHED;  /* undo capture */
+  return res;
+}
+
+
+static const char *cmatchbalance (MatchState *ms, const char *s,
+                                    const PItem *it) {
+  if (s >= ms->src_end || uchar(*s) != it->c) return NULL;
+  else {
+    int cont = 1;
+    while (++s < ms->src_end) {
+      if (uchar(*s) == it->c2) {
+        if (--cont == 0) return s+1;
+      }
+      else if (uchar(*s) == it->c) cont++;
+    }
+  }
+  return NULL;  /* string ends out of balance */
+}
+
+
+static int cfrontier (MatchState *ms, const char *s, const PItem *it) {
+  int previous = (s == ms->src_init) ? '\0' : uchar(*(s - 1));
+  int current = (s == ms->src_end) ? '\0' : uchar(*s);
+  if (it->set != NULL)
+    return !testset(it->set, previous) && testset(it->set, current);
+  else
+    return !matchbracketclass(previous, it->p, it->ep - 1) &&
+           matchbracketclass(current, it->p, it->ep - 1);
+}
+
+
+static const char *cmatch (MatchState *ms, const char *s, const PItem *it) {
+  if (ms->matchdepth-- == 0)
+    luaL_error(ms->L, "pattern too complex");
+  init: /* using goto's to optimize tail recursion */
+  switch (it->op) {
+    case I_END: break;
+    case I_OPEN: {
+      s = cstart_capture(ms, s, it + 1, CAP_UNFINISHED);
+      break;
+    }
+    case I_POSITION: {
+      s = cstart_capture(ms, s, it + 1, CAP_POSITION);
+      break;
+    }
+    case I_CLOSE: {
+      s = cend_capture(ms, s, it + 1);
+      break;
+    }
+    case I_DOLLAR: {
+      s = (s == ms->src_end) ? s : NULL;  /* check end of string */
+      break;
+    }
+    case I_BALANCE: {
+      s = cmatchbalance(ms, s, it);
+      if (s != NULL) {
+        it++; goto init;
+      }
+      break;
+    }
+    case I_FRONTIER: {
+      if (cfrontier(ms, s, it)) {
+        it++; goto init;
+      }
+      s = NULL;  /* match failed */
+      break;
+    }
+    case I_BACKREF: {
+      s = match_capture(ms, s, it->c);
+      if (s != NULL) {
+        it++; goto init;
+      }
+      break;
+    }
+    default: {  /* single char class plus optional suffix */
+      if (!csinglematch(ms, s, it)) {
+        if (it->rep == '*' || it->rep == '?' || it->rep == '-') {
+          it++; goto init;  /* accept empty */
+        }
+        else  /* '+' or no suffix */
+          s = NULL;  /* fail */
+      }
+      else {  /* matched once */
+        switch (it->rep) {
+          case '?': {
+            const char *res;
+            if ((res = cmatch(ms, s + 1, it + 1)) != NULL)
+              s = res;
+            else {
+              it++; goto init;
+            }
+            break;
+          }
+          case '+':  /* 1 or more repetitions */
+            s++;  /* 1 match already done */
+            /* go through */
+          case '*':  /* 0 or more repetitions */
+            s = cmax_expand(ms, s, it);
+            break;
+          case '-':  /* 0 or more repetitions (minimum) */
+            s = cmin_expand(ms, s, it);
+            break;
+          default:  /* no suffix */
+            s++; it++; goto init;
+        }
+      }
+      break;
+    }
+  }
+  ms->matchdepth++;
+  return s;
+}
+
+
+/*
+** Skips the positions where a pattern whose first item must match a
+** character cannot start a match ('memchr' finds a literal)
+*/
+static const char *firstcandidate (MatchState *ms, const char *s,
+                                     const Pattern *pt) {
+  const PItem *it = pt->item;
+  if (it->op == I_CHAR) {
+    s = (const char *)memchr(s, it->c, ms->src_end - s);
+    return (s != NULL) ? s : ms->src_end;
+  }
+  while (s < ms->src_end && !csinglematch(ms, s, it))
+    s++;
+  return s;
+}
+
+
+/*
+** Compiled patterns are kept in a cache, the first upvalue of the
+** pattern functions: a userdata whose user value maps patterns to
+** their compilations. When the cache is full, the least recently used
+** pattern is dropped.
+*/
+#if !defined(LUA_MAXPATTERNS)
+#define LUA_MAXPATTERNS		64
+#endif
+
+typedef struct PCache {
+  unsigned int clock;  /* number of uses of the cache */
+  int n;  /* number of patterns in the cache */
+} PCache;
+
+
+/*
+** Metamethods '__clone' (see 'lua_clonestate'). The copy of the cache
+** in a cloned state needs no change; the copy of a compiled pattern
+** must point to its own bitsets and pattern copy instead of those of
+** the original.
+*/
+static int pc_clone (lua_State *L) {
+  (void)L;
+  return 0;
+}
+
+
+static int pt_clone (lua_State *L) {
+  Pattern *pt = (Pattern *)lua_touserdata(L, 1);
+  ptrdiff_t d = (char *)pt - (char *)lua_touserdata(L, 2);
+  PItem *it;
+  for (it = pt->item; it->op != I_END; it++) {
+    if (it->set != NULL)
+      it->set += d;
+    if (it->p != NULL) {
+      it->p += d;
+      it->ep += d;
+    }
+  }
+  return 0;
+}
+
+
+/* remove the least recently used pattern from cache table 't' */
+static void dropoldest (lua_State *L, int t, unsigned int clock) {
+  unsigned int maxage = 0;
+  lua_pushnil(L);  /* oldest pattern */
+  lua_pushnil(L);  /* first key */
+  while (lua_next(L, t)) {
+    unsigned int age = clock - ((Pattern *)lua_touserdata(L, -1))->stamp;
+    lua_pop(L, 1);  /* remove compiled pattern */
+    if (age >= maxage) {
+      maxage = age;
+      lua_pushvalue(L, -1);
+      lua_replace(L, -3);  /* new oldest pattern */
+    }
+  }
+  lua_pushnil(L);
+  lua_rawset(L, t);  /* cache[oldest] = nil */
+}
+
+
+/*
+** Pushes the compiled pattern for the string at index 'arg' (or nil,
+** if it is malformed) and returns it
+*/
+static const Pattern *getpattern (lua_State *L, int arg) {
+  PCache *pc = (PCache *)lua_touserdata(L, lua_upvalueindex(1));
+  Pattern *pt;
+  lua_getuservalue(L, lua_upvalueindex(1));  /* cache table */
+  lua_pushvalue(L, arg);
+  if (lua_rawget(L, -2) != LUA_TNIL)  /* already compiled? */
+    pt = (Pattern *)lua_touserdata(L, -1);
+  else {
+    size_t lp;
+    const char *p = lua_tolstring(L, arg, &lp);
+    lua_pop(L, 1);  /* remove nil */
+    pt = newpattern(L, p, lp);
+    if (pt == NULL)
+      lua_pushnil(L);
+    else {
+      int t = lua_absindex(L, -2);
+      if (pc->n < LUA_MAXPATTERNS)
+        pc->n++;
+      else
+        dropoldest(L, t, pc->clock);
+      lua_pushvalue(L, arg);
+      lua_pushvalue(L, -2);
+      lua_rawset(L, t);  /* cache[pattern] = compiled pattern */
+    }
+  }
+  lua_remove(L, -2);  /* remove cache table */
+  if (pt != NULL)
+    pt->stamp = ++pc->clock;
+  return pt;
+}
+
+
+/* match with the compiled pattern 'pt' or, when it is NULL, with 'p' */
+#define domatch(ms,s,p,pt)  \
+	((pt) != NULL ? cmatch(ms, s, (pt)->item) : match(ms, s, p))
+
+
 
 static const char *lmemfind (const char *s1, size_t l1,
                                const char *s2, size_t l2) {
@@ -546,7 +1134,7 @@ static void push_onecapture (MatchState *ms, int i, const char *s,
                                                     const char *e) {
   if (i >= ms->level) {
     if (i == 0)  /* ms->level == 0, too */
-      lua_pushlstring(ms->L, s, e - s);  /* add whole match */
+      lua_pushview(ms->L, ms->src, s - ms->src_init, e - s);  /* whole match */
     else
       luaL_error(ms->L, "invalid capture index %%%d", i + 1);
   }
@@ -556,7 +1144,7 @@ static void push_onecapture (MatchState *ms, int i, const char *s,
     if (l == CAP_POSITION)
       lua_pushinteger(ms->L, ms->capture[i].init - ms->src_init + 1);
     else
-      lua_pushlstring(ms->L, ms->capture[i].init, l);
+      lua_pushview(ms->L, ms->src, ms->capture[i].init - ms->src_init, l);
   }
 }
 
@@ -585,7 +1173,7 @@ static int nospecials (const char *p, size_t l) {
 
 static int str_find_aux (lua_State *L, int find) {
   size_t ls, lp;
-  const char *s = luaL_checklstring(L, 1, &ls);
+  const char *s = checkview(L, 1, &ls);
   const char *p = luaL_checklstring(L, 2, &lp);
   lua_Integer init = posrelat(luaL_optinteger(L, 3, 1), ls);
   if (init < 1) init = 1;
@@ -606,11 +1194,13 @@ static int str_find_aux (lua_State *L, int find) {
   else {
     MatchState ms;
     const char *s1 = s + init - 1;
+    const Pattern *pt = getpattern(L, 2);
     int anchor = (*p == '^');
     if (anchor) {
       p++; lp--;  /* skip anchor character */
     }
     ms.L = L;
+    ms.src = 1;
     ms.matchdepth = MAXCCALLS;
     ms.src_init = s;
     ms.src_end = s + ls;
@@ -619,7 +1209,9 @@ static int str_find_aux (lua_State *L, int find) {
       const char *res;
       ms.level = 0;
       lua_assert(ms.matchdepth == MAXCCALLS);
-      if ((res=match(&ms, s1, p)) != NULL) {
+      if (pt != NULL && pt->skip)
+        s1 = firstcandidate(&ms, s1, pt);
+      if ((res=domatch(&ms, s1, p, pt)) != NULL) {
         if (find) {
           lua_pushinteger(L, s1 - s + 1);  /* start */
           lua_pushinteger(L, res - s);   /* end */
@@ -648,10 +1240,12 @@ static int str_match (lua_State *L) {
 static int gmatch_aux (lua_State *L) {
   MatchState ms;
   size_t ls, lp;
-  const char *s = lua_tolstring(L, lua_upvalueindex(1), &ls);
+  const char *s = lua_toview(L, lua_upvalueindex(1), &ls);
   const char *p = lua_tolstring(L, lua_upvalueindex(2), &lp);
+  const Pattern *pt = (const Pattern *)lua_touserdata(L, lua_upvalueindex(4));
   const char *src;
   ms.L = L;
+  ms.src = lua_upvalueindex(1);
   ms.matchdepth = MAXCCALLS;
   ms.src_init = s;
   ms.src_end = s+ls;
@@ -662,7 +1256,9 @@ static int gmatch_aux (lua_State *L) {
     const char *e;
     ms.level = 0;
     lua_assert(ms.matchdepth == MAXCCALLS);
-    if ((e = match(&ms, src, p)) != NULL) {
+    if (pt != NULL && pt->skip)
+      src = firstcandidate(&ms, src, pt);
+    if ((e = domatch(&ms, src, p, pt)) != NULL) {
       lua_Integer newstart = e-s;
       if (e == src) newstart++;  /* empty match? go at least one position */
       lua_pushinteger(L, newstart);
@@ -675,11 +1271,15 @@ static int gmatch_aux (lua_State *L) {
 
 
 static int gmatch (lua_State *L) {
-  luaL_checkstring(L, 1);
+  checkview(L, 1, NULL);
   luaL_checkstring(L, 2);
   lua_settop(L, 2);
   lua_pushinteger(L, 0);
-  lua_pushcclosure(L, gmatch_aux, 3);
+  if (*lua_tostring(L, 2) == '^')  /* not an anchor for 'gmatch' */
+    lua_pushnil(L);  /* leave it to 'match' */
+  else
+    getpattern(L, 2);
+  lua_pushcclosure(L, gmatch_aux, 4);
   return 1;
 }
 
@@ -745,22 +1345,25 @@ static void add_value (MatchState *ms, luaL_Buffer *b, const char *s,
 
 static int str_gsub (lua_State *L) {
   size_t srcl, lp;
-  const char *src = luaL_checklstring(L, 1, &srcl);
+  const char *src = checkview(L, 1, &srcl);
   const char *p = luaL_checklstring(L, 2, &lp);
   int tr = lua_type(L, 3);
   lua_Integer max_s = luaL_optinteger(L, 4, srcl + 1);
   int anchor = (*p == '^');
   lua_Integer n = 0;
+  const Pattern *pt;
   MatchState ms;
   luaL_Buffer b;
   luaL_argcheck(L, tr == LUA_TNUMBER || tr == LUA_TSTRING ||
                    tr == LUA_TFUNCTION || tr == LUA_TTABLE, 3,
                       "string/function/table expected");
+  pt = getpattern(L, 2);
   luaL_buffinit(L, &b);
   if (anchor) {
     p++; lp--;  /* skip anchor character */
   }
   ms.L = L;
+  ms.src = 1;
   ms.matchdepth = MAXCCALLS;
   ms.src_init = src;
   ms.src_end = src+srcl;
@@ -769,7 +1372,12 @@ static int str_gsub (lua_State *L) {
     const char *e;
     ms.level = 0;
     lua_assert(ms.matchdepth == MAXCCALLS);
-    e = match(&ms, src, p);
+    if (pt != NULL && pt->skip) {  /* copy what cannot start a match */
+      const char *c = firstcandidate(&ms, src, pt);
+      luaL_addlstring(&b, src, c - src);
+      src = c;
+    }
+    e = domatch(&ms, src, p, pt);
     if (e) {
       n++;
       add_value(&ms, &b, src, e, tr);
@@ -869,22 +1477,39 @@ static void addlenmod (char *form, const char *lenmod) {
 }
 
 
-static int str_format (lua_State *L) {
+/*
+** precision of float format 'form' ("%.<prec><conv>"), or -1 if it has
+** flags or a width (or is a '%a', whose precision has no default)
+*/
+static int plainprecision (const char *form) {
+  const char *p = form + 1;
+  int prec = 6;  /* default */
+  if (*p == '.') {
+    prec = 0;
+    while (isdigit(uchar(*++p)))
+      prec = prec * 10 + (*p - '0');
+  }
+  return (p[1] == '\0' && tolower(uchar(*p)) != 'a') ? prec : -1;
+}
+
+
+/*
+** adds to 'b' the result of formatting the arguments after 'arg' with
+** the format at 'arg'
+*/
+static void addformat (lua_State *L, luaL_Buffer *b, int arg) {
   int top = lua_gettop(L);
-  int arg = 1;
   size_t sfl;
   const char *strfrmt = luaL_checklstring(L, arg, &sfl);
   const char *strfrmt_end = strfrmt+sfl;
-  luaL_Buffer b;
-  luaL_buffinit(L, &b);
   while (strfrmt < strfrmt_end) {
     if (*strfrmt != L_ESC)
-      luaL_addchar(&b, *strfrmt++);
+      luaL_addchar(b, *strfrmt++);
     else if (*++strfrmt == L_ESC)
-      luaL_addchar(&b, *strfrmt++);  /* %% */
+      luaL_addchar(b, *strfrmt++);  /* %% */
     else { /* format item */
       char form[MAX_FORMAT];  /* to store the format ('%...') */
-      char *buff = luaL_prepbuffsize(&b, MAX_ITEM);  /* to put formatted item */
+      char *buff = luaL_prepbuffsize(b, MAX_ITEM);  /* to put formatted item */
       int nb = 0;  /* number of bytes in added item */
       if (++arg > top)
         luaL_argerror(L, arg, "no value");
@@ -906,12 +1531,18 @@ static int str_format (lua_State *L) {
 #endif
         case 'e': case 'E': case 'f':
         case 'g': case 'G': {
-          addlenmod(form, LUA_NUMBER_FRMLEN);
-          nb = sprintf(buff, form, luaL_checknumber(L, arg));
+          lua_Number n = luaL_checknumber(L, arg);
+          int prec = plainprecision(form);
+          if (prec >= 0)  /* no flags nor width? */
+            nb = lua_formatfloat(L, buff, n, *(strfrmt - 1), prec);
+          else {
+            addlenmod(form, LUA_NUMBER_FRMLEN);
+            nb = sprintf(buff, form, n);
+          }
           break;
         }
         case 'q': {
-          addquoted(L, &b, arg);
+          addquoted(L, b, arg);
           break;
         }
         case 's': {
@@ -920,7 +1551,7 @@ static int str_format (lua_State *L) {
           if (!strchr(form, '.') && l >= 100) {
             /* no precision and string is too long to be formatted;
                keep original string */
-            luaL_addvalue(&b);
+            luaL_addvalue(b);
             break;
           }
           else {
@@ -930,13 +1561,20 @@ static int str_format (lua_State *L) {
           }
         }
         default: {  /* also treat cases 'pnLlh' */
-          return luaL_error(L, "invalid option '%%%c' to 'format'",
-                               *(strfrmt - 1));
+          luaL_error(L, "invalid option '%%%c' to 'format'",
+                        *(strfrmt - 1));
         }
       }
-      luaL_addsize(&b, nb);
+      luaL_addsize(b, nb);
     }
   }
+}
+
+
+static int str_format (lua_State *L) {
+  luaL_Buffer b;
+  luaL_buffinit(L, &b);
+  addformat(L, &b, 1);
   luaL_pushresult(&b);
   return 1;
 }
@@ -1384,18 +2022,201 @@ static int str_unpack (lua_State *L) {
 
 /* }====================================================== */
 
+/*
+** {======================================================
+** STRING BUFFERS
+** =======================================================
+*/
+
+#define tosbuf(L,i)	((luaL_StrBuffer *)luaL_checkudata(L, i, LUA_BUFFERHANDLE))
+
+
+/* returns a pointer to 'sz' free bytes at the end of buffer 'sb' */
+static char *sbprep (lua_State *L, luaL_StrBuffer *sb, size_t sz) {
+  if (sb->size - sb->n < sz)
+    sb->b = luaL_growbuffer(L, sb->b, sb->n, &sb->size, sz);
+  return sb->b + sb->n;
+}
+
+
+static void sbadd (lua_State *L, luaL_StrBuffer *sb, const char *s,
+                   size_t l) {
+  if (l > 0) {  /* empty 'memcpy' is not that cheap */
+    memcpy(sbprep(L, sb, l), s, l * sizeof(char));
+    sb->n += l;
+  }
+}
+
+
+/* string.buffer([size]): a new empty buffer, with room for 'size' bytes */
+static int sb_new (lua_State *L) {
+  lua_Integer sz = luaL_optinteger(L, 1, 0);
+  luaL_StrBuffer *sb;
+  luaL_argcheck(L, 0 <= sz && (lua_Unsigned)sz < MAXSIZE, 1, "invalid size");
+  sb = (luaL_StrBuffer *)lua_newuserdata(L, sizeof(luaL_StrBuffer));
+  sb->b = NULL;
+  sb->n = sb->size = 0;
+  luaL_setmetatable(L, LUA_BUFFERHANDLE);
+  if (sz > 0)
+    sbprep(L, sb, (size_t)sz);
+  return 1;
+}
+
+
+/* b:put(...): appends strings, numbers, or the contents of buffers */
+static int sb_put (lua_State *L) {
+  luaL_StrBuffer *sb = tosbuf(L, 1);
+  int top = lua_gettop(L);
+  int i;
+  for (i = 2; i <= top; i++) {
+    luaL_StrBuffer *other;
+    size_t l;
+    if (lua_type(L, i) != LUA_TUSERDATA ||
+        (other = (luaL_StrBuffer *)luaL_testudata(L, i,
+                                                  LUA_BUFFERHANDLE)) == NULL) {
+      const char *s = checkview(L, i, &l);
+      sbadd(L, sb, s, l);
+    }
+    else if ((l = other->n) > 0) {  /* (may be 'sb' itself) */
+      char *p = sbprep(L, sb, l);
+      memcpy(p, other->b, l * sizeof(char));
+      sb->n += l;
+    }
+  }
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* b:putf(fmt, ...): appends 'string.format(fmt, ...)' */
+static int sb_putf (lua_State *L) {
+  luaL_StrBuffer *sb = tosbuf(L, 1);
+  luaL_Buffer b;
+  luaL_buffinit(L, &b);
+  addformat(L, &b, 2);
+  sbadd(L, sb, b.b, b.n);
+  luaL_buffclose(&b);  /* frees its box now */
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* b:rep(s, n [, sep]): appends 'string.rep(s, n, sep)' */
+static int sb_rep (lua_State *L) {
+  luaL_StrBuffer *sb = tosbuf(L, 1);
+  size_t l, lsep;
+  const char *s = luaL_checklstring(L, 2, &l);
+  lua_Integer n = luaL_checkinteger(L, 3);
+  const char *sep = luaL_optlstring(L, 4, "", &lsep);
+  if (n > 0) {
+    size_t totallen;
+    char *p;
+    if (l + lsep < l || l + lsep > MAXSIZE / n)  /* may overflow? */
+      return luaL_error(L, "resulting string too large");
+    totallen = (size_t)n * l + (size_t)(n - 1) * lsep;
+    p = sbprep(L, sb, totallen);
+    while (n-- > 1) {  /* first n-1 copies (followed by separator) */
+      memcpy(p, s, l * sizeof(char)); p += l;
+      if (lsep > 0) {
+        memcpy(p, sep, lsep * sizeof(char));
+        p += lsep;
+      }
+    }
+    memcpy(p, s, l * sizeof(char));  /* last copy */
+    sb->n += totallen;
+  }
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* b:reset(): empties the buffer, keeping its memory */
+static int sb_reset (lua_State *L) {
+  tosbuf(L, 1)->n = 0;
+  lua_settop(L, 1);
+  return 1;
+}
+
+
+/* b:tostring(): the contents of the buffer as a string */
+static int sb_tostring (lua_State *L) {
+  luaL_StrBuffer *sb = tosbuf(L, 1);
+  if (sb->n == 0)
+    lua_pushliteral(L, "");
+  else
+    lua_pushlstring(L, sb->b, sb->n);
+  return 1;
+}
+
+
+static int sb_len (lua_State *L) {
+  lua_pushinteger(L, (lua_Integer)tosbuf(L, 1)->n);
+  return 1;
+}
+
+
+static int sb_gc (lua_State *L) {
+  luaL_StrBuffer *sb = tosbuf(L, 1);
+  if (sb->b != NULL) {
+    void *ud;
+    lua_Alloc allocf = lua_getallocf(L, &ud);
+    allocf(ud, sb->b, sb->size, 0);
+    sb->b = NULL;
+    sb->n = sb->size = 0;
+  }
+  return 0;
+}
+
+
+/*
+** __clone (see 'lua_clonestate'): the copy of a buffer in a cloned state
+** gets a block of its own with the same bytes
+*/
+static int sb_clone (lua_State *L) {
+  luaL_StrBuffer *sb = tosbuf(L, 1);
+  const char *b = sb->b;  /* block of the original buffer */
+  size_t n = sb->n;
+  sb->b = NULL;
+  sb->n = sb->size = 0;
+  sbadd(L, sb, b, n);
+  return 0;
+}
+
+
+static const luaL_Reg sblib[] = {
+  {"put", sb_put},
+  {"putf", sb_putf},
+  {"rep", sb_rep},
+  {"reset", sb_reset},
+  {"tostring", sb_tostring},
+  {"__tostring", sb_tostring},
+  {"__len", sb_len},
+  {"__gc", sb_gc},
+  {"__clone", sb_clone},
+  {NULL, NULL}
+};
+
+
+static void createbuffmeta (lua_State *L) {
+  luaL_newmetatable(L, LUA_BUFFERHANDLE);  /* metatable for buffers */
+  lua_pushvalue(L, -1);  /* push metatable */
+  lua_setfield(L, -2, "__index");  /* metatable.__index = metatable */
+  luaL_setfuncs(L, sblib, 0);  /* add buffer methods to new metatable */
+  lua_pop(L, 1);  /* pop new metatable */
+}
+
+/* }====================================================== */
+
+
 
 static const luaL_Reg strlib[] = {
+  {"buffer", sb_new},
   {"byte", str_byte},
   {"char", str_char},
   {"dump", str_dump},
-  {"find", str_find},
   {"format", str_format},
-  {"gmatch", gmatch},
-  {"gsub", str_gsub},
   {"len", str_len},
   {"lower", str_lower},
-  {"match", str_match},
   {"rep", str_rep},
   {"reverse", str_reverse},
   {"sub", str_sub},
@@ -1407,6 +2228,35 @@ static const luaL_Reg strlib[] = {
 };
 
 
+/* functions that share the cache of compiled patterns */
+static const luaL_Reg patlib[] = {
+  {"find", str_find},
+  {"gmatch", gmatch},
+  {"gsub", str_gsub},
+  {"match", str_match},
+  {NULL, NULL}
+};
+
+
+static void createpatterncache (lua_State *L) {
+  PCache *pc;
+  luaL_newmetatable(L, PATTERNMT);  /* metatable for compiled patterns */
+  lua_pushcfunction(L, pt_clone);
+  lua_setfield(L, -2, "__clone");
+  lua_pop(L, 1);
+  pc = (PCache *)lua_newuserdata(L, sizeof(PCache));
+  pc->clock = 0;
+  pc->n = 0;
+  lua_createtable(L, 0, 1);  /* metatable for the cache */
+  lua_pushcfunction(L, pc_clone);
+  lua_setfield(L, -2, "__clone");
+  lua_setmetatable(L, -2);
+  lua_newtable(L);  /* table with compiled patterns */
+  lua_setuservalue(L, -2);
+  luaL_setfuncs(L, patlib, 1);  /* cache is their upvalue */
+}
+
+
 static void createmetatable (lua_State *L) {
   lua_createtable(L, 0, 1);  /* table to be metatable for strings */
   lua_pushliteral(L, "");  /* dummy string */
@@ -1424,7 +2274,9 @@ static void createmetatable (lua_State *L) {
 */
 LUAMOD_API int luaopen_string (lua_State *L) {
   luaL_newlib(L, strlib);
+  createpatterncache(L);
   createmetatable(L);
+  createbuffmeta(L);
   return 1;
 }
 
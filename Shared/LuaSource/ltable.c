@@ -21,6 +21,8 @@
 ** in its main position (i.e. the 'original' position that its hash gives
 ** to it), then the colliding element is in its own main position.
 ** Hence even when the load factor reaches 100%, performance remains good.
+** With LUA_SWISSTABLE, the hash part is an open-addressing table instead
+** (see 'Swiss hash part' below).
 */
 
 #include <float.h>
@@ -57,6 +59,14 @@
 #define MAXHBITS	(MAXABITS - 1)
 
 
+/*
+** Maximum number of kids of a shape. Tables adding a new key to a
+** shape that already has that many kids leave shape mode (this bounds
+** the searches and the memory used by tables that are dictionaries).
+*/
+#define MAXSHAPEKIDS	32
+
+
 #define hashpow2(t,n)		(gnode(t, lmod((n), sizenode(t))))
 
 #define hashstr(t,str)		hashpow2(t, (str)->hash)
@@ -74,15 +84,33 @@
 #define hashpointer(t,p)	hashmod(t, point2int(p))
 
 
-#define dummynode		(&dummynode_)
+#if !defined(LUA_SWISSTABLE)
 
-#define isdummy(n)		((n) == dummynode)
+#define dummynode		(&dummynode_)
 
 static const Node dummynode_ = {
   {NILCONSTANT},  /* value */
   {{NILCONSTANT, 0}}  /* key */
 };
 
+#else
+
+#define dummynode		(&dummynode_.n)
+
+/* the dummy node comes with the control bytes of an empty group */
+static const struct {
+  Node n;
+  lu_byte ctrl[16];
+} dummynode_ = {
+  {{NILCONSTANT}, {{NILCONSTANT, 0}}},
+  {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+   0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80}
+};
+
+#endif
+
+#define isdummy(n)		((n) == dummynode)
+
 
 /*
 ** Checks whether a float has a value representable as a lua_Integer
@@ -98,7 +126,7 @@ static int numisinteger (lua_Number x, lua_Integer *p) {
 /*
 ** hash for floating-point numbers
 */
-static Node *hashfloat (const Table *t, lua_Number n) {
+static int l_hashfloat (lua_Number n) {
   int i;
   n = l_mathop(frexp)(n, &i) * cast_num(INT_MAX - DBL_MAX_EXP);
   i += cast_int(n);
@@ -107,10 +135,18 @@ static Node *hashfloat (const Table *t, lua_Number n) {
       i = 0;  /* handle INT_MIN */
     i = -i;  /* must be a positive value */
   }
-  return hashmod(t, i);
+  return i;
 }
 
 
+#if !defined(LUA_SWISSTABLE)
+
+#define hashfloat(t,n)		hashmod(t, l_hashfloat(n))
+
+#define maxload(size)		(size)
+#define newnodes(L,size)	luaM_newvector(L, size, Node)
+#define freenodes(L,n,size)	luaM_freearray(L, n, size)
+
 
 /*
 ** returns the 'main' position of an element in a table (that is, the index
@@ -124,14 +160,8 @@ static Node *mainposition (const Table *t, const TValue *key) {
       return hashfloat(t, fltvalue(key));
     case LUA_TSHRSTR:
       return hashstr(t, tsvalue(key));
-    case LUA_TLNGSTR: {
-      TString *s = tsvalue(key);
-      if (s->extra == 0) {  /* no hash? */
-        s->hash = luaS_hash(getstr(s), s->len, s->hash);
-        s->extra = 1;  /* now it has its hash */
-      }
-      return hashstr(t, tsvalue(key));
-    }
+    case LUA_TLNGSTR:
+      return hashpow2(t, luaS_hashlongstr(tsvalue(key)));
     case LUA_TBOOLEAN:
       return hashboolean(t, bvalue(key));
     case LUA_TLIGHTUSERDATA:
@@ -144,6 +174,242 @@ static Node *mainposition (const Table *t, const TValue *key) {
 }
 
 
+static Node *getfreepos (Table *t) {
+  while (t->lastfree > t->node) {
+    t->lastfree--;
+    if (ttisnil(gkey(t->lastfree)))
+      return t->lastfree;
+  }
+  return NULL;  /* could not find a free place */
+}
+
+#else
+
+/*
+** {=============================================================
+** Swiss hash part
+** ==============================================================
+*/
+
+/*
+** The hash part is an open-addressing table in the style of Swiss
+** tables. Right after the node vector, in the same block, there is a
+** vector of control bytes, one per node: CTRL_EMPTY for a node that
+** never got a key, or 7 bits of the hash of the key in the node. A
+** search goes through groups of SWGROUP nodes: it compares all control
+** bytes of a group at once against the hash bits of the key, and only
+** nodes that match have their keys compared. A group with an empty node
+** ends the search. Groups are probed in triangular order, which visits
+** all groups when their number is a power of 2. Node vectors smaller
+** than a group have their control bytes padded with CTRL_EMPTY.
+** As in the chained hash part, a removed entry keeps its key with a nil
+** value (which the collector may turn into a dead key), so there are no
+** tombstones: a new key always takes an empty node, and entries with
+** nil values go away in the next rehash. Vectors larger than a group
+** keep at least 1/8 of their nodes empty, so searches are short and
+** always end.
+*/
+
+#define SWGROUP		16
+#define CTRL_EMPTY	0x80
+
+/* number of control bytes of a node vector with 'size' nodes */
+#define sizectrl(size)	((size) < SWGROUP ? SWGROUP : (size))
+
+/* size of the block with the nodes and control bytes of a hash part */
+#define sizeblock(size)	((size) * sizeof(Node) + sizectrl(size))
+
+/* maximum number of keys in a node vector with 'size' nodes */
+#define maxload(size)	((size) < SWGROUP ? (size) : (size) - (size) / 8)
+
+#define newnodes(L,size)  \
+	cast(Node *, luaM_newvector(L, sizeblock(size), lu_byte))
+#define freenodes(L,n,size)	luaM_freemem(L, n, sizeblock(size))
+
+#define gctrl(t)	cast(lu_byte *, gnode(t, sizenode(t)))
+
+/* number of groups of 't' minus 1 (a mask, as it is a power of 2) */
+#define groupmask(t)  \
+	(cast(unsigned int, sizectrl(sizenode(t))) / SWGROUP - 1)
+
+/* control byte and first group of a key with hash 'h' (see 'mixhash') */
+#define ctrlbyte(h)	cast_byte((h) & 0x7f)
+#define firstgroup(t,h)	(((h) >> 7) & groupmask(t))
+
+
+/*
+** 'matchbyte(g,b)' gives a mask with the nodes of a group whose control
+** byte is 'b' ('g' points to the control bytes of the group);
+** 'masknode(m)' is the index of the first node in mask 'm'.
+*/
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+typedef unsigned int GroupMask;
+
+static GroupMask matchbyte (const lu_byte *g, int b) {
+  __m128i c = _mm_loadu_si128(cast(const __m128i *, g));
+  return cast(GroupMask,
+           _mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(cast(char, b)))));
+}
+
+#define masknode(m)	__builtin_ctz(m)
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+#include <arm_neon.h>
+
+typedef uint64_t GroupMask;
+
+/* NEON has no 'movemask'; narrowing the comparison gives 4 bits per node */
+static GroupMask matchbyte (const lu_byte *g, int b) {
+  uint8x16_t eq = vceqq_u8(vld1q_u8(g), vdupq_n_u8(cast(uint8_t, b)));
+  uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(nib), 0) & 0x8888888888888888ULL;
+}
+
+#define masknode(m)	(__builtin_ctzll(m) >> 2)
+
+#else
+
+typedef unsigned int GroupMask;
+
+static GroupMask matchbyte (const lu_byte *g, int b) {
+  GroupMask m = 0;
+  int i;
+  for (i = 0; i < SWGROUP; i++) {
+    if (g[i] == b)
+      m |= 1u << i;
+  }
+  return m;
+}
+
+static int masknode (GroupMask m) {
+  int i = 0;
+  for (; (m & 1u) == 0; m >>= 1) i++;
+  return i;
+}
+
+#endif
+
+/* removes the first node from mask 'm' */
+#define masknext(m)	((m) &= (m) - 1)
+
+
+/*
+** runs 'body' for each node 'n' of table 't' whose control byte matches
+** hash 'h', in probe order, until the end of the probe sequence
+*/
+#define foreachmatch(t,h,n,body) {  \
+	const lu_byte *ctrl_ = gctrl(t);  \
+	unsigned int gm_ = groupmask(t);  \
+	unsigned int g_ = ((h) >> 7) & gm_, d_ = 0;  \
+	for (;;) {  \
+	  const lu_byte *gc_ = ctrl_ + g_ * SWGROUP;  \
+	  GroupMask m_;  \
+	  for (m_ = matchbyte(gc_, ctrlbyte(h)); m_ != 0; masknext(m_)) {  \
+	    Node *n = gnode(t, g_ * SWGROUP + masknode(m_));  \
+	    body  \
+	  }  \
+	  if (matchbyte(gc_, CTRL_EMPTY) != 0) break;  \
+	  g_ = (g_ + ++d_) & gm_;  \
+	} }
+
+
+/*
+** spreads the bits of a hash over the whole word (multiplicative
+** hashing), as both the control byte and the first group come from it
+*/
+static unsigned int mixhash (unsigned int h) {
+  h *= 0x9e3779b9u;
+  return h ^ (h >> 15);
+}
+
+
+#define inthash(i)  cast(unsigned int, \
+	l_castS2U(i) ^ (l_castS2U(i) >> (sizeof(lua_Unsigned) * CHAR_BIT / 2)))
+
+
+static unsigned int hashkey (const TValue *key) {
+  switch (ttype(key)) {
+    case LUA_TNUMINT:
+      return inthash(ivalue(key));
+    case LUA_TNUMFLT:
+      return cast(unsigned int, l_hashfloat(fltvalue(key)));
+    case LUA_TSHRSTR:
+      return tsvalue(key)->hash;
+    case LUA_TLNGSTR:
+      return luaS_hashlongstr(tsvalue(key));
+    case LUA_TBOOLEAN:
+      return cast(unsigned int, bvalue(key));
+    case LUA_TLIGHTUSERDATA:
+      return point2int(pvalue(key));
+    case LUA_TLCF:
+      return point2int(fvalue(key));
+    default:
+      return point2int(gcvalue(key));
+  }
+}
+
+
+static Node *getintnode (Table *t, lua_Integer key) {
+  unsigned int h = mixhash(inthash(key));
+  foreachmatch(t, h, n, {
+    if (ttisinteger(gkey(n)) && ivalue(gkey(n)) == key)
+      return n;
+  })
+  return NULL;
+}
+
+
+static Node *getstrnode (Table *t, TString *key) {
+  unsigned int h = mixhash(key->hash);
+  foreachmatch(t, h, n, {
+    const TValue *k = gkey(n);
+    if (ttisshrstring(k) && eqshrstr(tsvalue(k), key))
+      return n;
+  })
+  return NULL;
+}
+
+
+static Node *getgenericnode (Table *t, const TValue *key) {
+  unsigned int h = mixhash(hashkey(key));
+  foreachmatch(t, h, n, {
+    if (luaV_rawequalobj(gkey(n), key))
+      return n;
+  })
+  return NULL;
+}
+
+
+/*
+** gives to a new key with hash 'h' the first empty node in its probe
+** sequence, or returns NULL if the table must grow first
+*/
+static Node *getfreenode (Table *t, unsigned int h) {
+  lu_byte *ctrl = gctrl(t);
+  unsigned int gm = groupmask(t);
+  unsigned int g = firstgroup(t, h), d = 0;
+  GroupMask m;
+  if (t->nempty == 0)
+    return NULL;
+  while ((m = matchbyte(ctrl + g * SWGROUP, CTRL_EMPTY)) == 0)
+    g = (g + ++d) & gm;
+  /* (small vectors fill their nodes in order, so this is not padding) */
+  g = g * SWGROUP + masknode(m);
+  lua_assert(g < cast(unsigned int, sizenode(t)));
+  ctrl[g] = ctrlbyte(h);
+  t->nempty--;
+  return gnode(t, g);
+}
+
+/* }============================================================= */
+
+#endif
+
+
 /*
 ** returns the index for 'key' if 'key' is an appropriate key to live in
 ** the array part of the table, 0 otherwise.
@@ -158,6 +424,20 @@ static unsigned int arrayindex (const TValue *key) {
 }
 
 
+/*
+** returns the slot of short string 'key' in shape 's', or -1 if 's'
+** does not have that key
+*/
+static int shapeslot (const Shape *s, const TString *key) {
+  int i;
+  for (i = 0; i < s->nkeys; i++) {
+    if (eqshrstr(s->keys[i], key))
+      return i;
+  }
+  return -1;
+}
+
+
 /*
 ** returns the index of a 'key' for table traversals. First goes all
 ** elements in the array part, then elements in the hash part. The
@@ -166,9 +446,16 @@ static unsigned int arrayindex (const TValue *key) {
 static unsigned int findindex (lua_State *L, Table *t, StkId key) {
   unsigned int i;
   if (ttisnil(key)) return 0;  /* first iteration */
+  if (isshaped(t)) {  /* traversal goes through the slots */
+    int s = ttisshrstring(key) ? shapeslot(t->shape, tsvalue(key)) : -1;
+    if (s < 0)
+      luaG_runerror(L, "invalid key to 'next'");  /* key not found */
+    return s + 1;
+  }
   i = arrayindex(key);
   if (i != 0 && i <= t->sizearray)  /* is 'key' inside array part? */
     return i;  /* yes; that's the index */
+#if !defined(LUA_SWISSTABLE)
   else {
     int nx;
     Node *n = mainposition(t, key);
@@ -187,14 +474,47 @@ static unsigned int findindex (lua_State *L, Table *t, StkId key) {
       else n += nx;
     }
   }
+#else
+  else {
+    unsigned int h = mixhash(hashkey(key));
+    Node *dead = NULL;
+    foreachmatch(t, h, n, {
+      if (luaV_rawequalobj(gkey(n), key)) {
+        i = cast_int(n - gnode(t, 0));  /* key index in hash table */
+        /* hash elements are numbered after array ones */
+        return (i + 1) + t->sizearray;
+      }
+      else if (dead == NULL && ttisdeadkey(gkey(n)) && iscollectable(key) &&
+               deadvalue(gkey(n)) == gcvalue(key))
+        dead = n;
+    })
+    /* key may be dead already, but it is ok to use it in 'next'; as a
+       new key never reuses a dead node, the same key may also be alive
+       in a later node, which must win (or 'next' would loop) */
+    if (dead != NULL)
+      return cast_int(dead - gnode(t, 0)) + 1 + t->sizearray;
+    luaG_runerror(L, "invalid key to 'next'");  /* key not found */
+    return 0;  /* to avoid warnings */
+  }
+#endif
 }
 
 
 int luaH_next (lua_State *L, Table *t, StkId key) {
   unsigned int i = findindex(L, t, key);  /* find original element */
+  if (isshaped(t)) {  /* table in shape mode? */
+    for (; i < t->shape->nkeys; i++) {
+      if (!ttisnil(&t->array[i])) {  /* a non-nil value? */
+        setsvalue2s(L, key, t->shape->keys[i]);
+        setobj2s(L, key+1, &t->array[i]);
+        return 1;
+      }
+    }
+    return 0;  /* no more elements */
+  }
   for (; i < t->sizearray; i++) {  /* try first array part */
     if (!ttisnil(&t->array[i])) {  /* a non-nil value? */
-      setivalue(key, i + 1);
+      setivalue(L, key, i + 1);
       setobj2s(L, key+1, &t->array[i]);
       return 1;
     }
@@ -307,6 +627,35 @@ static void setarrayvector (lua_State *L, Table *t, unsigned int size) {
 }
 
 
+/*
+** empties all nodes of the hash part of 't', making them all free
+*/
+static void clearnodes (Table *t) {
+  int i;
+  int size = sizenode(t);
+  if (isdummy(t->node)) {
+#if defined(LUA_SWISSTABLE)
+    t->nempty = 0;  /* any new key must go through a rehash */
+#else
+    t->lastfree = t->node;  /* no free positions */
+#endif
+    return;
+  }
+  for (i = 0; i < size; i++) {
+    Node *n = gnode(t, i);
+    gnext(n) = 0;
+    setnilvalue(wgkey(n));
+    setnilvalue(gval(n));
+  }
+#if defined(LUA_SWISSTABLE)
+  memset(gctrl(t), CTRL_EMPTY, sizectrl(size));
+  t->nempty = maxload(size);
+#else
+  t->lastfree = gnode(t, size);  /* all positions are free */
+#endif
+}
+
+
 static void setnodevector (lua_State *L, Table *t, unsigned int size) {
   int lsize;
   if (size == 0) {  /* no elements to hash part? */
@@ -314,31 +663,190 @@ static void setnodevector (lua_State *L, Table *t, unsigned int size) {
     lsize = 0;
   }
   else {
-    int i;
     lsize = luaO_ceillog2(size);
+    if (size > cast(unsigned int, maxload(twoto(lsize))))  /* too many keys? */
+      lsize++;
     if (lsize > MAXHBITS)
       luaG_runerror(L, "table overflow");
     size = twoto(lsize);
-    t->node = luaM_newvector(L, size, Node);
-    for (i = 0; i < (int)size; i++) {
-      Node *n = gnode(t, i);
-      gnext(n) = 0;
-      setnilvalue(wgkey(n));
-      setnilvalue(gval(n));
-    }
+    t->node = newnodes(L, size);
   }
   t->lsizenode = cast_byte(lsize);
-  t->lastfree = gnode(t, size);  /* all positions are free */
+  clearnodes(t);
+}
+
+
+/*
+** {=============================================================
+** Shapes
+** ==============================================================
+*/
+
+/* size of the slot vector of a table whose shape has 'n' keys */
+#define sizeslots(n)  \
+	((n) == 0 ? 0 : (n) <= NINLINESLOTS ? NINLINESLOTS : MAXSHAPEKEYS)
+
+/* table was allocated with room for its slots (see 'luaH_newrecord')? */
+#define hasinlineroom(t)	((t)->flags & (1u << INLINEBIT))
+
+/* slot vector of 't' is in that room? */
+#define hasinlineslots(t)  \
+	(hasinlineroom(t) && (t)->array == cast(TValue *, (t) + 1))
+
+/* size of the memory block of table 't' */
+#define sizetable(t)  \
+	(sizeof(Table) + (hasinlineroom(t) ? NINLINESLOTS * sizeof(TValue) : 0))
+
+/* size of the slot vector of 't', with 'n' keys in its shape */
+#define slotsize(t,n)	(hasinlineslots(t) ? NINLINESLOTS : sizeslots(n))
+
+
+static void freeslots (lua_State *L, Table *t, TValue *slots, int n) {
+  if (slots != cast(TValue *, t + 1))  /* not in the table block? */
+    luaM_freearray(L, slots, sizeslots(n));
+}
+
+
+/*
+** returns the shape with the keys of 's' plus 'key', creating it if
+** needed, or NULL if 's' already has too many kids. Kids are kept in
+** most-recently-used order, so that common transitions are found first.
+*/
+static Shape *getkid (lua_State *L, Shape *s, TString *key) {
+  Shape **p = &s->kids;
+  Shape *ns;
+  for (ns = *p; ns != NULL; p = &ns->next, ns = *p) {
+    if (eqshrstr(ns->keys[s->nkeys], key)) {  /* found it? */
+      *p = ns->next;  /* move it to the front of the list */
+      ns->next = s->kids;
+      s->kids = ns;
+      return ns;
+    }
+  }
+  if (s->nkids >= MAXSHAPEKIDS)
+    return NULL;
+  ns = luaM_new(L, Shape);
+  ns->parent = s;
+  ns->kids = NULL;
+  ns->refcount = 0;
+  ns->nkeys = cast_byte(s->nkeys + 1);
+  ns->nkids = 0;
+  memcpy(ns->keys, s->keys, sizeof(ns->keys));  /* unused ones are NULL */
+  ns->keys[s->nkeys] = key;
+  ns->next = s->kids;  /* link it in the list of kids of 's' */
+  s->kids = ns;
+  s->nkids++;
+  s->refcount++;
+  return ns;
+}
+
+
+/*
+** a table or a kid stopped using shape 's'; frees the shapes left
+** without users (except the root, which lives in the global state).
+** Shape keys are not dereferenced here, as they may already be dead
+** when the last table using the shape is collected.
+*/
+static void releaseshape (lua_State *L, Shape *s) {
+  while (--s->refcount == 0 && s->parent != NULL) {
+    Shape *p = s->parent;
+    Shape **pp = &p->kids;
+    while (*pp != s) pp = &(*pp)->next;
+    *pp = s->next;  /* remove 's' from the list of its parent */
+    p->nkids--;
+    luaM_free(L, s);
+    s = p;  /* parent lost a kid */
+  }
 }
 
 
+/*
+** moves table 't' out of shape mode: its fields go to a new hash part
+** with room for 'extra' more keys. (The only allocation is done first,
+** so that an error leaves the table untouched.)
+*/
+static void unshape (lua_State *L, Table *t, int extra) {
+  Shape *s = t->shape;
+  TValue *slots = t->array;
+  int i;
+  if (s->nkeys > 0)
+    setnodevector(L, t, s->nkeys + extra);
+  t->shape = NULL;
+  t->array = NULL;
+  for (i = 0; i < s->nkeys; i++) {
+    if (!ttisnil(&slots[i])) {
+      TValue k;
+      setsvalue(L, &k, s->keys[i]);
+      /* there is room for all keys, so this does not allocate */
+      setobjt2t(L, luaH_newkey(L, t, &k), &slots[i]);
+    }
+  }
+  freeslots(L, t, slots, s->nkeys);
+  releaseshape(L, s);
+}
+
+
+/*
+** adds short string 'key' to table 't' in shape mode, moving the table
+** to the next shape. Returns the new (nil) slot, or NULL if the table
+** must leave shape mode.
+*/
+static TValue *shapenewkey (lua_State *L, Table *t, TString *key) {
+  Shape *s = t->shape;
+  Shape *ns;
+  int n = s->nkeys;
+  if (n == MAXSHAPEKEYS || (ns = getkid(L, s, key)) == NULL)
+    return NULL;
+  if (n == slotsize(t, n)) {  /* slot vector is full? */
+    if (hasinlineslots(t)) {  /* cannot reallocate it; move it out */
+      TValue *v = luaM_newvector(L, sizeslots(n + 1), TValue);
+      memcpy(v, t->array, n * sizeof(TValue));
+      t->array = v;
+    }
+    else
+      luaM_reallocvector(L, t->array, sizeslots(n), sizeslots(n + 1), TValue);
+  }
+  t->shape = ns;
+  ns->refcount++;
+  releaseshape(L, s);
+  setnilvalue(&t->array[n]);
+  return &t->array[n];
+}
+
+
+static void freekids (lua_State *L, Shape *s) {
+  while (s->kids != NULL) {
+    Shape *k = s->kids;
+    s->kids = k->next;
+    freekids(L, k);
+    luaM_free(L, k);
+  }
+}
+
+
+/*
+** frees the shapes that were left without tables by allocation errors
+** (all others are freed together with their last table)
+*/
+void luaH_freeshapes (lua_State *L) {
+  freekids(L, &G(L)->shaperoot);
+}
+
+/* }============================================================= */
+
+
 void luaH_resize (lua_State *L, Table *t, unsigned int nasize,
                                           unsigned int nhsize) {
   unsigned int i;
   int j;
-  unsigned int oldasize = t->sizearray;
-  int oldhsize = t->lsizenode;
-  Node *nold = t->node;  /* save old hash ... */
+  unsigned int oldasize;
+  int oldhsize;
+  Node *nold;
+  if (isshaped(t))  /* table in shape mode? */
+    unshape(L, t, 0);  /* fields go to the hash part first */
+  oldasize = t->sizearray;
+  oldhsize = t->lsizenode;
+  nold = t->node;  /* save old hash ... */
   if (nasize > oldasize)  /* array part must grow? */
     setarrayvector(L, t, nasize);
   /* create new hash part with appropriate size */
@@ -363,15 +871,47 @@ void luaH_resize (lua_State *L, Table *t, unsigned int nasize,
     }
   }
   if (!isdummy(nold))
-    luaM_freearray(L, nold, cast(size_t, twoto(oldhsize))); /* free old array */
+    freenodes(L, nold, cast(size_t, twoto(oldhsize))); /* free old array */
 }
 
 
 void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize) {
-  int nsize = isdummy(t->node) ? 0 : sizenode(t);
+  int nsize = isdummy(t->node) ? 0 : maxload(sizenode(t));
   luaH_resize(L, t, nasize, nsize);
 }
 
+/*
+** new key 'asize + 1' goes right after the array part: if that part is
+** full, doubles it instead of going through 'rehash', which counts all
+** keys in the table. Integer keys of the hash part that fall in the new
+** slice move to it. Returns the slot for the key, or NULL if the array
+** part has holes (then a rehash decides the new sizes).
+*/
+static TValue *growarray (lua_State *L, Table *t) {
+  unsigned int asize = t->sizearray;
+  unsigned int i;
+  int j;
+  if (asize > MAXASIZE / 2)
+    return NULL;
+  for (i = 0; i < asize; i++) {
+    if (ttisnil(&t->array[i]))
+      return NULL;
+  }
+  setarrayvector(L, t, (asize == 0) ? 1 : 2 * asize);
+  for (j = isdummy(t->node) ? 0 : sizenode(t) - 1; j >= 0 && asize > 0; j--) {
+    Node *n = gnode(t, j);
+    if (ttisinteger(gkey(n)) && !ttisnil(gval(n))) {
+      lua_Unsigned k = l_castS2U(ivalue(gkey(n))) - 1u;  /* array index */
+      if (asize < k && k < t->sizearray) {
+        setobjt2t(L, &t->array[k], gval(n));
+        setnilvalue(gval(n));  /* remove entry from the hash part */
+      }
+    }
+  }
+  return &t->array[asize];
+}
+
+
 /*
 ** nums[i] = number of keys 'k' where 2^(i - 1) < k <= 2^i
 */
@@ -404,32 +944,113 @@ Table *luaH_new (lua_State *L) {
   GCObject *o = luaC_newobj(L, LUA_TTABLE, sizeof(Table));
   Table *t = gco2t(o);
   t->metatable = NULL;
-  t->flags = cast_byte(~0);
+  t->flags = cast_byte(~(1u << INLINEBIT));
   t->array = NULL;
   t->sizearray = 0;
+  t->lenhint = 0;
+  t->shape = NULL;
   setnodevector(L, t, 0);
   return t;
 }
 
 
-void luaH_free (lua_State *L, Table *t) {
-  if (!isdummy(t->node))
-    luaM_freearray(L, t->node, cast(size_t, sizenode(t)));
-  luaM_freearray(L, t->array, t->sizearray);
-  luaM_free(L, t);
+/*
+** creates a table in shape mode with shape 's' and all its fields nil.
+** Used for table constructors without list items (records), which start
+** with the empty shape and get their fields one at a time. When the
+** record will have at most NINLINESLOTS fields ('nslots'), its slot
+** vector goes in the same memory block as the table.
+*/
+Table *luaH_newrecord (lua_State *L, Shape *s, int nslots) {
+  int inl = (0 < nslots && nslots <= NINLINESLOTS);
+  GCObject *o = luaC_newobj(L, LUA_TTABLE,
+                  sizeof(Table) + (inl ? NINLINESLOTS * sizeof(TValue) : 0));
+  Table *t = gco2t(o);
+  int i;
+  lua_assert(s->nkeys <= (inl ? nslots : 0));
+  t->metatable = NULL;
+  t->flags = cast_byte(~(1u << INLINEBIT));
+  t->array = NULL;
+  t->sizearray = 0;
+  t->lenhint = 0;
+  setnodevector(L, t, 0);
+  if (inl) {
+    t->flags |= cast_byte(1u << INLINEBIT);
+    t->array = cast(TValue *, t + 1);
+    for (i = 0; i < s->nkeys; i++)
+      setnilvalue(&t->array[i]);
+  }
+  t->shape = s;
+  s->refcount++;
+  return t;
 }
 
 
-static Node *getfreepos (Table *t) {
-  while (t->lastfree > t->node) {
-    t->lastfree--;
-    if (ttisnil(gkey(t->lastfree)))
-      return t->lastfree;
+/*
+** removes all entries from table 't', keeping its shape, its array part,
+** and its node vector for the next entries
+*/
+void luaH_clear (Table *t) {
+  unsigned int i;
+  unsigned int n = isshaped(t) ? t->shape->nkeys : t->sizearray;
+  for (i = 0; i < n; i++)
+    setnilvalue(&t->array[i]);
+  clearnodes(t);
+  t->lenhint = 0;
+}
+
+
+/*
+** makes the new table 'c' (anchored by the caller) a copy of table 't',
+** without its metatable. Array and slot vectors are copied as they are,
+** and so is the node vector, so no key is hashed again.
+*/
+void luaH_copy (lua_State *L, Table *c, Table *t) {
+  lua_assert(c->sizearray == 0 && !isshaped(c) && isdummy(c->node));
+  if (isshaped(t)) {
+    Shape *s = t->shape;
+    if (s->nkeys > 0) {
+      c->array = luaM_newvector(L, sizeslots(s->nkeys), TValue);
+      memcpy(c->array, t->array, s->nkeys * sizeof(TValue));
+    }
+    c->shape = s;
+    s->refcount++;
   }
-  return NULL;  /* could not find a free place */
+  else {
+    if (t->sizearray > 0) {
+      c->array = luaM_newvector(L, t->sizearray, TValue);
+      memcpy(c->array, t->array, t->sizearray * sizeof(TValue));
+      c->sizearray = t->sizearray;
+    }
+    if (!isdummy(t->node)) {
+      int size = sizenode(t);
+      setnodevector(L, c, maxload(size));  /* same size as in 't' */
+      lua_assert(sizenode(c) == size);
+#if defined(LUA_SWISSTABLE)
+      memcpy(c->node, t->node, sizeblock(size));  /* nodes and controls */
+      c->nempty = t->nempty;
+#else
+      memcpy(c->node, t->node, size * sizeof(Node));  /* 'next' is relative */
+      c->lastfree = gnode(c, t->lastfree - t->node);
+#endif
+    }
+  }
+  c->lenhint = t->lenhint;
 }
 
 
+void luaH_free (lua_State *L, Table *t) {
+  if (!isdummy(t->node))
+    freenodes(L, t->node, cast(size_t, sizenode(t)));
+  if (isshaped(t)) {
+    freeslots(L, t, t->array, t->shape->nkeys);
+    releaseshape(L, t->shape);
+  }
+  else
+    luaM_freearray(L, t->array, t->sizearray);
+  luaM_freemem(L, t, sizetable(t));
+}
+
 
 /*
 ** inserts a new key into a hash table; first, check whether key's main
@@ -448,10 +1069,34 @@ TValue *luaH_newkey (lua_State *L, Table *t, const TValue *key) {
     if (luai_numisnan(n))
       luaG_runerror(L, "table index is NaN");
     if (numisinteger(n, &k)) {  /* index is int? */
-      setivalue(&aux, k);
+      setivalue(L, &aux, k);
       key = &aux;  /* insert it as an integer */
     }
   }
+  if (isshaped(t)) {  /* table in shape mode? */
+    if (ttisshrstring(key)) {
+      TValue *slot = shapenewkey(L, t, tsvalue(key));
+      if (slot != NULL) {  /* key went to a new slot? */
+        luaC_barrierback(L, t, key);
+        return slot;
+      }
+    }
+    unshape(L, t, 1);  /* leave shape mode */
+  }
+  if (ttisinteger(key) &&
+      l_castS2U(ivalue(key)) - 1u == t->sizearray) {  /* appending? */
+    TValue *slot = growarray(L, t);
+    if (slot != NULL)
+      return slot;
+  }
+#if defined(LUA_SWISSTABLE)
+  mp = getfreenode(t, mixhash(hashkey(key)));
+  if (mp == NULL) {  /* no room for a new key? */
+    rehash(L, t, key);  /* grow table */
+    /* whatever called 'newkey' takes care of TM cache and GC barrier */
+    return luaH_set(L, t, key);  /* insert key into grown table */
+  }
+#else
   mp = mainposition(t, key);
   if (!ttisnil(gval(mp)) || isdummy(mp)) {  /* main position is taken? */
     Node *othern;
@@ -484,6 +1129,12 @@ TValue *luaH_newkey (lua_State *L, Table *t, const TValue *key) {
       mp = f;
     }
   }
+#endif
+  if (ttislngstring(key) && isview(tsvalue(key))) {
+    /* a key gets its own copy, so as not to keep the parent alive */
+    setsvalue(L, &aux, luaS_materialize(L, tsvalue(key)));
+    key = &aux;
+  }
   setnodekey(L, &mp->i_key, key);
   luaC_barrierback(L, t, key);
   lua_assert(ttisnil(gval(mp)));
@@ -499,6 +1150,10 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
   if (l_castS2U(key - 1) < t->sizearray)
     return &t->array[key - 1];
   else {
+#if defined(LUA_SWISSTABLE)
+    Node *n = getintnode(t, key);
+    return (n != NULL) ? gval(n) : luaO_nilobject;
+#else
     Node *n = hashint(t, key);
     for (;;) {  /* check whether 'key' is somewhere in the chain */
       if (ttisinteger(gkey(n)) && ivalue(gkey(n)) == key)
@@ -510,6 +1165,7 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
       }
     };
     return luaO_nilobject;
+#endif
   }
 }
 
@@ -518,8 +1174,17 @@ const TValue *luaH_getint (Table *t, lua_Integer key) {
 ** search function for short strings
 */
 const TValue *luaH_getstr (Table *t, TString *key) {
-  Node *n = hashstr(t, key);
+  Node *n;
   lua_assert(key->tt == LUA_TSHRSTR);
+  if (isshaped(t)) {  /* table in shape mode? */
+    int s = shapeslot(t->shape, key);
+    return (s >= 0) ? &t->array[s] : luaO_nilobject;
+  }
+#if defined(LUA_SWISSTABLE)
+  n = getstrnode(t, key);
+  return (n != NULL) ? gval(n) : luaO_nilobject;
+#else
+  n = hashstr(t, key);
   for (;;) {  /* check whether 'key' is somewhere in the chain */
     const TValue *k = gkey(n);
     if (ttisshrstring(k) && eqshrstr(tsvalue(k), key))
@@ -531,6 +1196,58 @@ const TValue *luaH_getstr (Table *t, TString *key) {
     }
   };
   return luaO_nilobject;
+#endif
+}
+
+
+/*
+** search function for short strings with an inline cache: '*slot' is
+** the index of the node where 'key' was found last time. That node is
+** checked first, and '*slot' is updated when the key is found somewhere
+** else. A stale index (e.g., after a rehash moved the key or freed the
+** node vector) only costs a regular search, as the node must still
+** hold 'key' to be a hit. For tables in shape mode, '*slot' is the index
+** of the key in the shape.
+*/
+const TValue *luaH_getstrcached (Table *t, TString *key, int *slot) {
+  Node *n;
+  lua_assert(key->tt == LUA_TSHRSTR);
+  if (isshaped(t)) {  /* table in shape mode? */
+    Shape *s = t->shape;
+    if (!(l_castS2U(*slot) < MAXSHAPEKEYS &&
+          eqshrstr(key, s->keys[*slot]))) {  /* cache miss? */
+      int i = shapeslot(s, key);
+      if (i < 0) return luaO_nilobject;
+      *slot = i;  /* update cache */
+    }
+    return &t->array[*slot];
+  }
+  if (l_castS2U(*slot) < l_castS2U(sizenode(t))) {
+    n = gnode(t, *slot);
+    if (ttisshrstring(gkey(n)) && eqshrstr(tsvalue(gkey(n)), key))
+      return gval(n);  /* cache hit */
+  }
+#if defined(LUA_SWISSTABLE)
+  n = getstrnode(t, key);
+  if (n == NULL) return luaO_nilobject;
+  *slot = cast_int(n - gnode(t, 0));  /* update cache */
+  return gval(n);
+#else
+  n = hashstr(t, key);
+  for (;;) {  /* check whether 'key' is somewhere in the chain */
+    const TValue *k = gkey(n);
+    if (ttisshrstring(k) && eqshrstr(tsvalue(k), key)) {
+      *slot = cast_int(n - gnode(t, 0));  /* update cache */
+      return gval(n);
+    }
+    else {
+      int nx = gnext(n);
+      if (nx == 0) break;
+      n += nx;
+    }
+  };
+  return luaO_nilobject;
+#endif
 }
 
 
@@ -549,6 +1266,10 @@ const TValue *luaH_get (Table *t, const TValue *key) {
       /* else go through */
     }
     default: {
+#if defined(LUA_SWISSTABLE)
+      Node *n = getgenericnode(t, key);
+      return (n != NULL) ? gval(n) : luaO_nilobject;
+#else
       Node *n = mainposition(t, key);
       for (;;) {  /* check whether 'key' is somewhere in the chain */
         if (luaV_rawequalobj(gkey(n), key))
@@ -560,6 +1281,7 @@ const TValue *luaH_get (Table *t, const TValue *key) {
         }
       };
       return luaO_nilobject;
+#endif
     }
   }
 }
@@ -584,7 +1306,7 @@ void luaH_setint (lua_State *L, Table *t, lua_Integer key, TValue *value) {
     cell = cast(TValue *, p);
   else {
     TValue k;
-    setivalue(&k, key);
+    setivalue(L, &k, key);
     cell = luaH_newkey(L, t, &k);
   }
   setobj2t(L, cell, value);
@@ -615,11 +1337,14 @@ static int unbound_search (Table *t, unsigned int j) {
 }
 
 
-/*
-** Try to find a boundary in table 't'. A 'boundary' is an integer index
-** such that t[i] is non-nil and t[i+1] is nil (and 0 if t[1] is nil).
-*/
-int luaH_getn (Table *t) {
+/* is 'j' a boundary of table 't'? */
+static int isboundary (Table *t, unsigned int j) {
+  return (j == 0 || !ttisnil(luaH_getint(t, j))) &&
+         ttisnil(luaH_getint(t, cast(lua_Integer, j) + 1));
+}
+
+
+static int findboundary (Table *t) {
   unsigned int j = t->sizearray;
   if (j > 0 && ttisnil(&t->array[j - 1])) {
     /* there is a boundary in the array part: (binary) search for it */
@@ -638,11 +1363,35 @@ int luaH_getn (Table *t) {
 }
 
 
+/*
+** Try to find a boundary in table 't'. A 'boundary' is an integer index
+** such that t[i] is non-nil and t[i+1] is nil (and 0 if t[1] is nil).
+** The last boundary found is tried first, and then the one after it,
+** which is the new boundary after an append.
+*/
+int luaH_getn (Table *t) {
+  unsigned int j = t->lenhint;
+  if (isboundary(t, j))
+    return cast_int(j);
+  else if (isboundary(t, j + 1))
+    j++;
+  else
+    j = cast(unsigned int, findboundary(t));
+  t->lenhint = j;
+  return cast_int(j);
+}
+
+
 
 #if defined(LUA_DEBUG)
 
 Node *luaH_mainposition (const Table *t, const TValue *key) {
+#if !defined(LUA_SWISSTABLE)
   return mainposition(t, key);
+#else
+  /* first node of the first group in its probe sequence */
+  return gnode(t, firstgroup(t, mixhash(hashkey(key))) * SWGROUP);
+#endif
 }
 
 int luaH_isdummy (Node *n) { return isdummy(n); }
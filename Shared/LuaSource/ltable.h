@@ -20,7 +20,33 @@
 
 #define wgkey(n)		(&(n)->i_key.nk)
 
-#define invalidateTMcache(t)	((t)->flags = 0)
+/*
+** Bit 7 of 'flags' is not used by the metamethod cache; it marks tables
+** allocated with room for NINLINESLOTS slots right after them.
+*/
+#define INLINEBIT	7
+#define NINLINESLOTS	4
+
+#define invalidateTMcache(t)	((t)->flags &= cast_byte(1u << INLINEBIT))
+
+
+#define isshaped(t)	((t)->shape != NULL)
+
+
+/*
+** value at slot 's' of table 't' if that slot holds the short string
+** 'key' with a non-nil value; NULL otherwise (see 'luaH_getstrcached').
+** A slot is a node index or, in shape mode, a key index in the shape.
+*/
+#define luaH_slotvalue(t,key,s)  \
+	(isshaped(t) ? \
+	 ((l_castS2U(s) < MAXSHAPEKEYS && \
+	   eqshrstr(key, (t)->shape->keys[s]) && \
+	   !ttisnil(&(t)->array[s])) ? &(t)->array[s] : NULL) : \
+	 ((l_castS2U(s) < l_castS2U(sizenode(t)) && \
+	   ttisshrstring(gkey(gnode(t, s))) && \
+	   eqshrstr(tsvalue(gkey(gnode(t, s))), key) && \
+	   !ttisnil(gval(gnode(t, s)))) ? gval(gnode(t, s)) : NULL))
 
 
 /* returns the key, given the value of a table entry */
@@ -32,10 +58,16 @@ LUAI_FUNC const TValue *luaH_getint (Table *t, lua_Integer key);
 LUAI_FUNC void luaH_setint (lua_State *L, Table *t, lua_Integer key,
                                                     TValue *value);
 LUAI_FUNC const TValue *luaH_getstr (Table *t, TString *key);
+LUAI_FUNC const TValue *luaH_getstrcached (Table *t, TString *key,
+                                                     int *slot);
 LUAI_FUNC const TValue *luaH_get (Table *t, const TValue *key);
 LUAI_FUNC TValue *luaH_newkey (lua_State *L, Table *t, const TValue *key);
 LUAI_FUNC TValue *luaH_set (lua_State *L, Table *t, const TValue *key);
 LUAI_FUNC Table *luaH_new (lua_State *L);
+LUAI_FUNC Table *luaH_newrecord (lua_State *L, Shape *s, int nslots);
+LUAI_FUNC void luaH_clear (Table *t);
+LUAI_FUNC void luaH_copy (lua_State *L, Table *c, Table *t);
+LUAI_FUNC void luaH_freeshapes (lua_State *L);
 LUAI_FUNC void luaH_resize (lua_State *L, Table *t, unsigned int nasize,
                                                     unsigned int nhsize);
 LUAI_FUNC void luaH_resizearray (lua_State *L, Table *t, unsigned int nasize);
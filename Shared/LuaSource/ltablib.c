@@ -153,6 +153,46 @@ static int tmove (lua_State *L) {
 }
 
 
+/*
+** creates a table with room for 'narr' array elements and 'nhash'
+** other fields
+*/
+static int tnew (lua_State *L) {
+  lua_Integer narr = luaL_checkinteger(L, 1);
+  lua_Integer nhash = luaL_optinteger(L, 2, 0);
+  luaL_argcheck(L, 0 <= narr && narr <= INT_MAX, 1, "out of range");
+  luaL_argcheck(L, 0 <= nhash && nhash <= INT_MAX, 2, "out of range");
+  lua_createtable(L, (int)narr, (int)nhash);
+  return 1;
+}
+
+
+/*
+** removes all entries from a table, without metamethods; the table
+** keeps its memory for new entries
+*/
+static int tclear (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_cleartable(L, 1);
+  return 0;
+}
+
+
+/*
+** shallow copy of a table, without metamethods; the copy gets the
+** same metatable
+*/
+static int tclone (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  if (luaL_getmetafield(L, 1, "__metatable") != LUA_TNIL)
+    return luaL_error(L, "cannot clone a table with a protected metatable");
+  lua_clonetable(L, 1);
+  if (lua_getmetatable(L, 1))
+    lua_setmetatable(L, -2);
+  return 1;
+}
+
+
 static void addfield (lua_State *L, luaL_Buffer *b, TabA *ta, lua_Integer i) {
   (*ta->geti)(L, 1, i);
   if (!lua_isstring(L, -1))
@@ -341,6 +381,9 @@ static const luaL_Reg tab_funcs[] = {
   {"remove", tremove},
   {"move", tmove},
   {"sort", sort},
+  {"new", tnew},
+  {"clear", tclear},
+  {"clone", tclone},
   {NULL, NULL}
 };
 
@@ -143,6 +143,7 @@ extern const char lua_ident[];
 LUA_API lua_State *(lua_newstate) (lua_Alloc f, void *ud);
 LUA_API void       (lua_close) (lua_State *L);
 LUA_API lua_State *(lua_newthread) (lua_State *L);
+LUA_API lua_State *(lua_clonestate) (lua_State *L, lua_Alloc f, void *ud);
 
 LUA_API lua_CFunction (lua_atpanic) (lua_State *L, lua_CFunction panicf);
 
@@ -180,6 +181,7 @@ LUA_API lua_Number      (lua_tonumberx) (lua_State *L, int idx, int *isnum);
 LUA_API lua_Integer     (lua_tointegerx) (lua_State *L, int idx, int *isnum);
 LUA_API int             (lua_toboolean) (lua_State *L, int idx);
 LUA_API const char     *(lua_tolstring) (lua_State *L, int idx, size_t *len);
+LUA_API const char     *(lua_toview) (lua_State *L, int idx, size_t *len);
 LUA_API size_t          (lua_rawlen) (lua_State *L, int idx);
 LUA_API lua_CFunction   (lua_tocfunction) (lua_State *L, int idx);
 LUA_API void	       *(lua_touserdata) (lua_State *L, int idx);
@@ -223,6 +225,8 @@ LUA_API void        (lua_pushnil) (lua_State *L);
 LUA_API void        (lua_pushnumber) (lua_State *L, lua_Number n);
 LUA_API void        (lua_pushinteger) (lua_State *L, lua_Integer n);
 LUA_API const char *(lua_pushlstring) (lua_State *L, const char *s, size_t len);
+LUA_API const char *(lua_pushview) (lua_State *L, int idx, size_t i,
+                                                          size_t len);
 LUA_API const char *(lua_pushstring) (lua_State *L, const char *s);
 LUA_API const char *(lua_pushvfstring) (lua_State *L, const char *fmt,
                                                       va_list argp);
@@ -245,6 +249,7 @@ LUA_API int (lua_rawgeti) (lua_State *L, int idx, lua_Integer n);
 LUA_API int (lua_rawgetp) (lua_State *L, int idx, const void *p);
 
 LUA_API void  (lua_createtable) (lua_State *L, int narr, int nrec);
+LUA_API void  (lua_clonetable) (lua_State *L, int idx);
 LUA_API void *(lua_newuserdata) (lua_State *L, size_t sz);
 LUA_API int   (lua_getmetatable) (lua_State *L, int objindex);
 LUA_API int  (lua_getuservalue) (lua_State *L, int idx);
@@ -262,6 +267,31 @@ LUA_API void  (lua_rawseti) (lua_State *L, int idx, lua_Integer n);
 LUA_API void  (lua_rawsetp) (lua_State *L, int idx, const void *p);
 LUA_API int   (lua_setmetatable) (lua_State *L, int objindex);
 LUA_API void  (lua_setuservalue) (lua_State *L, int idx);
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
+
+
+/*
+** typed arrays: contiguous C arrays seen from Lua as userdata with 't[i]'
+** (1-based), '#t', and the methods of the array library, which sets
+** their metatable
+*/
+
+#define LUA_AFLOAT64	0	/* elements are C 'double' */
+#define LUA_AFLOAT32	1	/* elements are C 'float' */
+#define LUA_AINT32	2	/* elements are C 'int' (32 bits) */
+#define LUA_AUINT8	3	/* elements are C 'unsigned char' */
+
+#define LUA_NUMAKINDS	4
+
+#define lua_arrayelemsize(k)  \
+	((k) == LUA_AFLOAT64 ? sizeof(double) : (k) == LUA_AFLOAT32 ? \
+	 sizeof(float) : (k) == LUA_AINT32 ? sizeof(int) : sizeof(char))
+
+LUA_API void *(lua_newarray) (lua_State *L, int kind, size_t n);
+LUA_API void  (lua_pusharray) (lua_State *L, int kind, void *data, size_t n);
+LUA_API int   (lua_isarray) (lua_State *L, int idx);
+LUA_API void *(lua_toarray) (lua_State *L, int idx, int *kind, size_t *n);
+LUA_API void  (lua_setarraymetatable) (lua_State *L);
 
 
 /*
@@ -306,10 +336,45 @@ LUA_API int (lua_isyieldable) (lua_State *L);
 #define LUA_GCSETPAUSE		6
 #define LUA_GCSETSTEPMUL	7
 #define LUA_GCISRUNNING		9
+#define LUA_GCSTRPAUSE		10
+#define LUA_GCGEN		11
+#define LUA_GCINC		12
+#define LUA_GCSTEPTIME		13
+#define LUA_GCOVERHEAD		14
+#define LUA_GCTIMING		15
 
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
 
+/*
+** collector statistics (times in microseconds; step times are only
+** collected while timing is on)
+*/
+typedef struct lua_GCStats {
+  size_t steps;  /* number of timed steps */
+  size_t cycles;  /* number of complete major cycles */
+  size_t minors;  /* number of minor collections */
+  size_t swept;  /* bytes freed by the collector */
+  size_t p50;  /* median step time */
+  size_t p99;  /* 99th percentile of step times */
+  size_t max;  /* longest step */
+  size_t time;  /* total time in timed steps */
+} lua_GCStats;
+
+LUA_API void (lua_gcstats) (lua_State *L, lua_GCStats *st, int reset);
+
+
+/*
+** JIT compiler options (the compiler only exists on x86-64 Linux)
+*/
+
+#define LUA_JITOFF		0
+#define LUA_JITON		1
+#define LUA_JITISON		2
+
+LUA_API int (lua_jit) (lua_State *L, int what);
+
+
 /*
 ** miscellaneous functions
 */
@@ -322,6 +387,8 @@ LUA_API void  (lua_concat) (lua_State *L, int n);
 LUA_API void  (lua_len)    (lua_State *L, int idx);
 
 LUA_API size_t   (lua_stringtonumber) (lua_State *L, const char *s);
+LUA_API int      (lua_formatfloat) (lua_State *L, char *buff, lua_Number n,
+                                   int conv, int prec);
 
 LUA_API lua_Alloc (lua_getallocf) (lua_State *L, void **ud);
 LUA_API void      (lua_setallocf) (lua_State *L, lua_Alloc f, void *ud);
@@ -36,6 +36,26 @@
 /* #define LUA_32BITS */
 
 
+/*
+@@ LUA_NANBOXING packs each Lua value in 8 bytes instead of 16, hiding
+** everything that is not a float in the payload of a NaN (see
+** 'lobject.h'). It needs 64-bit integers and 'double' floats; integers
+** that do not fit in 48 bits are kept in the heap. Light userdata and
+** light C functions must also fit in 48 bits, so do not use it where
+** pointers carry extra bits (e.g., pointer authentication on arm64e).
+** It leaves out the JIT compiler.
+*/
+/* #define LUA_NANBOXING */
+
+
+/*
+@@ LUA_SWISSTABLE replaces the chained hash part of tables with an
+** open-addressing one that keeps a control byte per node and compares
+** 16 of them at once (with SSE2 or NEON when available; see 'ltable.c').
+*/
+/* #define LUA_SWISSTABLE */
+
+
 /*
 @@ LUA_USE_C89 controls the use of non-ISO-C89 features.
 ** Define it if you want Lua to avoid the use of a few C99 features
@@ -415,6 +435,8 @@
 **
 @@ LUA_NUMBER_FRMLEN is the length modifier for writing floats.
 @@ LUA_NUMBER_FMT is the format for writing floats.
+@@ LUAI_NUMFMTPREC is the precision of LUA_NUMBER_FMT, when it is
+** a '%g' format that the core can do by itself (see 'luaO_fmtfloat').
 @@ lua_number2str converts a float to a string.
 **
 @@ l_mathop allows the addition of an 'l' or 'f' to all math operations.
@@ -457,6 +479,7 @@
 
 #define LUA_NUMBER_FRMLEN	""
 #define LUA_NUMBER_FMT		"%.14g"
+#define LUAI_NUMFMTPREC		14
 
 #define l_mathop(op)		op
 
@@ -14,6 +14,7 @@
 
 #include "lua.h"
 
+#include "lcode.h"
 #include "ldebug.h"
 #include "ldo.h"
 #include "lfunc.h"
@@ -105,6 +106,7 @@ static void LoadCode (LoadState *S, Proto *f) {
   f->code = luaM_newvector(S->L, n, Instruction);
   f->sizecode = n;
   LoadVector(S, f->code, n);
+  luaK_fuse(f);  /* dumps have only generic instructions */
 }
 
 
@@ -132,7 +134,7 @@ static void LoadConstants (LoadState *S, Proto *f) {
       setfltvalue(o, LoadNumber(S));
       break;
     case LUA_TNUMINT:
-      setivalue(o, LoadInteger(S));
+      setivalue(S->L, o, LoadInteger(S));
       break;
     case LUA_TSHRSTR:
     case LUA_TLNGSTR:
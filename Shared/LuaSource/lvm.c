@@ -21,6 +21,8 @@
 #include "ldo.h"
 #include "lfunc.h"
 #include "lgc.h"
+#include "ljit.h"
+#include "lmem.h"
 #include "lobject.h"
 #include "lopcodes.h"
 #include "lstate.h"
@@ -62,19 +64,48 @@ static int tofloat (const TValue *obj, lua_Number *n) {
 }
 
 
+/* longest string view that is converted in a buffer on the C stack */
+#define MAXVIEWNUM	200
+
+
+/*
+** Convert a string to a number with 'luaO_rawstr2num', which needs a
+** '\0' after the numeral; the bytes of a view (which have none) are
+** copied to a buffer first, on the C stack or, for long views, in a
+** block from the state allocator.
+*/
+static int l_str2num (lua_State *L, TString *ts, lua_Integer *i,
+                      lua_Number *n, int *isint) {
+  if (isview(ts)) {
+    char sbuff[MAXVIEWNUM + 1];
+    size_t len = ts->len;
+    char *buff = (len > MAXVIEWNUM) ? luaM_newvector(L, len + 1, char)
+                                    : sbuff;
+    int res;
+    memcpy(buff, getstr(ts), len);
+    buff[len] = '\0';
+    res = (luaO_rawstr2num(buff, i, n, isint) == len + 1);
+    if (buff != sbuff)
+      luaM_freearray(L, buff, len + 1);
+    return res;
+  }
+  return (luaO_rawstr2num(getstr(ts), i, n, isint) == ts->len + 1);
+}
+
+
 /*
 ** Try to convert a value to a float. The float case is already handled
 ** by the macro 'tonumber'.
 */
-int luaV_tonumber_ (const TValue *obj, lua_Number *n) {
-  TValue v;
+int luaV_tonumber_ (lua_State *L, const TValue *obj, lua_Number *n) {
+  lua_Integer i; int isint;
   if (ttisinteger(obj)) {
     *n = cast_num(ivalue(obj));
     return 1;
   }
   else if (cvt2num(obj) &&  /* string convertible to number? */
-            luaO_str2num(svalue(obj), &v) == tsvalue(obj)->len + 1) {
-    *n = nvalue(&v);  /* convert result of 'luaO_str2num' to a float */
+            l_str2num(L, tsvalue(obj), &i, n, &isint)) {
+    if (isint) *n = cast_num(i);  /* convert an integer result to a float */
     return 1;
   }
   else
@@ -88,8 +119,10 @@ int luaV_tonumber_ (const TValue *obj, lua_Number *n) {
 ** mode == 1: takes the floor of the number
 ** mode == 2: takes the ceil of the number
 */
-static int tointeger_aux (const TValue *obj, lua_Integer *p, int mode) {
+static int tointeger_aux (lua_State *L, const TValue *obj, lua_Integer *p,
+                          int mode) {
   TValue v;
+  lua_Number num; int isint;
  again:
   if (ttisfloat(obj)) {
     lua_Number n = fltvalue(obj);
@@ -106,9 +139,11 @@ static int tointeger_aux (const TValue *obj, lua_Integer *p, int mode) {
     return 1;
   }
   else if (cvt2num(obj) &&
-            luaO_str2num(svalue(obj), &v) == tsvalue(obj)->len + 1) {
+            l_str2num(L, tsvalue(obj), p, &num, &isint)) {
+    if (isint) return 1;  /* integer already in '*p' */
+    setfltvalue(&v, num);
     obj = &v;
-    goto again;  /* convert result from 'luaO_str2num' to an integer */
+    goto again;  /* convert float result to an integer */
   }
   return 0;  /* conversion failed */
 }
@@ -117,8 +152,8 @@ static int tointeger_aux (const TValue *obj, lua_Integer *p, int mode) {
 /*
 ** try to convert a value to an integer
 */
-int luaV_tointeger_ (const TValue *obj, lua_Integer *p) {
-  return tointeger_aux(obj, p, LUA_FLOORN2I);
+int luaV_tointeger_ (lua_State *L, const TValue *obj, lua_Integer *p) {
+  return tointeger_aux(L, obj, p, LUA_FLOORN2I);
 }
 
 
@@ -137,10 +172,10 @@ int luaV_tointeger_ (const TValue *obj, lua_Integer *p) {
 ** the extreme case when the initial value is LUA_MININTEGER, in which
 ** case the LUA_MININTEGER limit would still run the loop once.
 */
-static int forlimit (const TValue *obj, lua_Integer *p, lua_Integer step,
-                     int *stopnow) {
+static int forlimit (lua_State *L, const TValue *obj, lua_Integer *p,
+                     lua_Integer step, int *stopnow) {
   *stopnow = 0;  /* usually, let loops run */
-  if (!tointeger_aux(obj, p, (step < 0 ? 2 : 1))) {  /* not fit in integer? */
+  if (!tointeger_aux(L, obj, p, (step < 0 ? 2 : 1))) {  /* not fit in integer? */
     lua_Number n;  /* try to convert to float */
     if (!tonumber(obj, &n)) /* cannot convert to float? */
       return 0;  /* not a number */
@@ -157,6 +192,64 @@ static int forlimit (const TValue *obj, lua_Integer *p, lua_Integer step,
 }
 
 
+/*
+** {==================================================================
+** Typed arrays (see 'lua_newarray')
+** ===================================================================
+*/
+
+/* 'val = a[i]'; nil when 'i' is out of bounds */
+static void tarrayget (lua_State *L, const TArray *a, lua_Integer i,
+                       StkId val) {
+  size_t k = cast(size_t, l_castS2U(i) - 1u);
+  if (l_castS2U(i) - 1u >= a->n)
+    setnilvalue(val);
+  else switch (a->kind) {
+    case LUA_AFLOAT64: setfltvalue(val, cast_num(cast(double *, a->data)[k]));
+      break;
+    case LUA_AFLOAT32: setfltvalue(val, cast_num(cast(float *, a->data)[k]));
+      break;
+    case LUA_AINT32: setivalue(L, val, cast(int *, a->data)[k]);
+      break;
+    default: setivalue(L, val, cast(unsigned char *, a->data)[k]);
+      break;
+  }
+}
+
+
+/*
+** 'a[i] = v'. Integer elements get integral numbers modulo 2^bits; 'i'
+** must be within bounds, as typed arrays do not grow.
+*/
+static void tarrayset (lua_State *L, TArray *a, lua_Integer i,
+                       const TValue *v) {
+  size_t k = cast(size_t, l_castS2U(i) - 1u);
+  if (l_castS2U(i) - 1u >= a->n)
+    luaG_runerror(L, "array index out of range");
+  if (!ttisnumber(v))
+    luaG_runerror(L, "number expected to store in array, got %s",
+                     objtypename(v));
+  if (a->kind == LUA_AFLOAT64 || a->kind == LUA_AFLOAT32) {
+    lua_Number x = ttisfloat(v) ? fltvalue(v) : cast_num(ivalue(v));
+    if (a->kind == LUA_AFLOAT64)
+      cast(double *, a->data)[k] = cast(double, x);
+    else
+      cast(float *, a->data)[k] = cast(float, x);
+  }
+  else {
+    lua_Integer x;
+    if (!tointeger(v, &x))
+      luaG_tointerror(L, v, v);
+    if (a->kind == LUA_AINT32)
+      cast(int *, a->data)[k] = cast(int, cast(unsigned int, x));
+    else
+      cast(unsigned char *, a->data)[k] = cast(unsigned char, x);
+  }
+}
+
+/* }================================================================== */
+
+
 /*
 ** Main function for table access (invoking metamethods if needed).
 ** Compute 'val = t[key]'
@@ -175,6 +268,10 @@ void luaV_gettable (lua_State *L, const TValue *t, TValue *key, StkId val) {
       }
       /* else will try metamethod */
     }
+    else if (ttisinteger(key) && ttistarray(G(L), t)) {
+      tarrayget(L, gettarray(uvalue(t)), ivalue(key), val);
+      return;
+    }
     else if (ttisnil(tm = luaT_gettmbyobj(L, t, TM_INDEX)))
       luaG_typeerror(L, t, "index");  /* no metamethod */
     if (ttisfunction(tm)) {  /* metamethod is a function */
@@ -216,6 +313,10 @@ void luaV_settable (lua_State *L, const TValue *t, TValue *key, StkId val) {
       }
       /* else will try the metamethod */
     }
+    else if (ttisinteger(key) && ttistarray(G(L), t)) {
+      tarrayset(L, gettarray(uvalue(t)), ivalue(key), val);
+      return;
+    }
     else  /* not a table; check metamethod */
       if (ttisnil(tm = luaT_gettmbyobj(L, t, TM_NEWINDEX)))
         luaG_typeerror(L, t, "index");
@@ -230,18 +331,101 @@ void luaV_settable (lua_State *L, const TValue *t, TValue *key, StkId val) {
 }
 
 
+/*
+** Version of 'luaV_gettable' for a constant short-string key, using the
+** inline cache 'fc' of the instruction for the table that has the key
+** and for the '__index' field of the metatables along the way (as in
+** 'box:set', where 'box' is a userdata whose metatable is its own
+** '__index').
+*/
+void luaV_getfield (lua_State *L, const TValue *t, TValue *key, StkId val,
+                    FieldCache *fc) {
+  TString *name = tsvalue(key);
+  int loop;  /* counter to avoid infinite loops */
+  lua_assert(ttisshrstring(key));
+  for (loop = 0; loop < MAXTAGLOOP; loop++) {
+    Table *mt;
+    const TValue *tm;
+    if (ttistable(t)) {  /* 't' is a table? */
+      Table *h = hvalue(t);
+      const TValue *res = luaH_getstrcached(h, name, &fc->slot);
+      mt = h->metatable;
+      if (!ttisnil(res) ||  /* result is not nil? */
+          mt == NULL || (mt->flags & (1u << TM_INDEX))) {  /* or no TM? */
+        setobj2s(L, val, res);  /* result is the raw get */
+        return;
+      }
+    }
+    else if (ttisfulluserdata(t))
+      mt = uvalue(t)->metatable;
+    else
+      mt = G(L)->mt[ttnov(t)];
+    tm = (mt == NULL) ? luaO_nilobject
+         : luaH_getstrcached(mt, G(L)->tmname[TM_INDEX], &fc->tmslot);
+    if (ttisnil(tm)) {  /* no metamethod? */
+      if (!ttistable(t))
+        luaG_typeerror(L, t, "index");
+      mt->flags |= cast_byte(1u << TM_INDEX);  /* cache this fact */
+      setnilvalue(val);  /* result is the raw (nil) get */
+      return;
+    }
+    if (ttisfunction(tm)) {  /* metamethod is a function */
+      luaT_callTM(L, tm, t, key, val, 1);
+      return;
+    }
+    t = tm;  /* else repeat access over 'tm' */
+  }
+  luaG_runerror(L, "gettable chain too long; possible loop");
+}
+
+
+/*
+** Version of 'luaV_settable' for a constant short-string key. Only the
+** assignment to a table without a '__newindex' metamethod is handled
+** here; everything else goes through 'luaV_settable'.
+*/
+void luaV_setfield (lua_State *L, const TValue *t, TValue *key, StkId val,
+                    FieldCache *fc) {
+  lua_assert(ttisshrstring(key));
+  if (ttistable(t)) {
+    Table *h = hvalue(t);
+    TValue *slot = cast(TValue *,
+                        luaH_getstrcached(h, tsvalue(key), &fc->slot));
+    if (!ttisnil(slot) ||  /* previous value is not nil? */
+        fasttm(L, h->metatable, TM_NEWINDEX) == NULL) {  /* or no TM? */
+      if (slot == luaO_nilobject)  /* no previous entry? */
+        slot = luaH_newkey(L, h, key);  /* create one */
+      setobj2t(L, slot, val);
+      invalidateTMcache(h);
+      luaC_barrierback(L, h, val);
+      return;
+    }
+  }
+  luaV_settable(L, t, key, val);
+}
+
+
 /*
 ** Compare two strings 'ls' x 'rs', returning an integer smaller-equal-
 ** -larger than zero if 'ls' is smaller-equal-larger than 'rs'.
 ** The code is a little tricky because it allows '\0' in the strings
 ** and it uses 'strcoll' (to respect locales) for each segments
-** of the strings.
+** of the strings. Views, which are not '\0'-terminated, are compared
+** through copies in the concatenation buffer.
 */
-static int l_strcmp (const TString *ls, const TString *rs) {
+static int l_strcmp (lua_State *L, const TString *ls, const TString *rs) {
   const char *l = getstr(ls);
   size_t ll = ls->len;
   const char *r = getstr(rs);
   size_t lr = rs->len;
+  if (isview(ls) || isview(rs)) {
+    char *buff = luaZ_openspace(L, &G(L)->buff, ll + lr + 2);
+    memcpy(buff, l, ll * sizeof(char));
+    buff[ll] = '\0';
+    memcpy(buff + ll + 1, r, lr * sizeof(char));
+    buff[ll + 1 + lr] = '\0';
+    l = buff; r = buff + ll + 1;
+  }
   for (;;) {  /* for each segment */
     int temp = strcoll(l, r);
     if (temp != 0)  /* not equal? */
@@ -271,7 +455,7 @@ int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r) {
   else if (tofloat(l, &nl) && tofloat(r, &nr))  /* both are numbers? */
     return luai_numlt(nl, nr);
   else if (ttisstring(l) && ttisstring(r))  /* both are strings? */
-    return l_strcmp(tsvalue(l), tsvalue(r)) < 0;
+    return l_strcmp(L, tsvalue(l), tsvalue(r)) < 0;
   else if ((res = luaT_callorderTM(L, l, r, TM_LT)) < 0)  /* no metamethod? */
     luaG_ordererror(L, l, r);  /* error */
   return res;
@@ -289,7 +473,7 @@ int luaV_lessequal (lua_State *L, const TValue *l, const TValue *r) {
   else if (tofloat(l, &nl) && tofloat(r, &nr))  /* both are numbers? */
     return luai_numle(nl, nr);
   else if (ttisstring(l) && ttisstring(r))  /* both are strings? */
-    return l_strcmp(tsvalue(l), tsvalue(r)) <= 0;
+    return l_strcmp(L, tsvalue(l), tsvalue(r)) <= 0;
   else if ((res = luaT_callorderTM(L, l, r, TM_LE)) >= 0)  /* first try 'le' */
     return res;
   else if ((res = luaT_callorderTM(L, r, l, TM_LT)) < 0)  /* else try 'lt' */
@@ -408,13 +592,19 @@ void luaV_objlen (lua_State *L, StkId ra, const TValue *rb) {
       Table *h = hvalue(rb);
       tm = fasttm(L, h->metatable, TM_LEN);
       if (tm) break;  /* metamethod? break switch to call it */
-      setivalue(ra, luaH_getn(h));  /* else primitive len */
+      setivalue(L, ra, luaH_getn(h));  /* else primitive len */
       return;
     }
     case LUA_TSTRING: {
-      setivalue(ra, tsvalue(rb)->len);
+      setivalue(L, ra, tsvalue(rb)->len);
       return;
     }
+    case LUA_TUSERDATA: {
+      if (ttistarray(G(L), rb)) {
+        setivalue(L, ra, cast(lua_Integer, gettarray(uvalue(rb))->n));
+        return;
+      }
+    }  /* else go through */
     default: {  /* try metamethod */
       tm = luaT_gettmbyobj(L, rb, TM_LEN);
       if (ttisnil(tm))  /* no metamethod? */
@@ -528,11 +718,74 @@ static void pushclosure (lua_State *L, Proto *p, UpVal **encup, StkId base,
     ncl->upvals[i]->refcount++;
     /* new closure is white, so we do not need a barrier here */
   }
-  if (!isblack(p))  /* cache will not break GC invariant? */
+  /* cache will not break GC invariant? (In generational mode, an old
+     prototype is not traversed again to clear a dead cache.) */
+  if (!isblack(p) && G(L)->gcmode != KGC_GEN)
     p->cache = ncl;  /* save it on cache for reuse */
 }
 
 
+/*
+** create in 'ra' a closure for prototype 'p' (OP_CLOSURE), reusing the
+** cached one when possible
+*/
+void luaV_closure (lua_State *L, Proto *p, UpVal **encup, StkId base,
+                   StkId ra) {
+  LClosure *ncl = getcached(p, encup, base);  /* cached closure */
+  if (ncl == NULL)  /* no match? */
+    pushclosure(L, p, encup, base, ra);  /* create a new one */
+  else
+    setclLvalue(L, ra, ncl);  /* push cashed closure */
+}
+
+
+/*
+** prepare a numeric 'for' loop (OP_FORPREP) whose control values are
+** at 'ra': make them all integers or all floats and pre-decrement the
+** initial value
+*/
+void luaV_forprep (lua_State *L, StkId ra) {
+  TValue *init = ra;
+  TValue *plimit = ra + 1;
+  TValue *pstep = ra + 2;
+  lua_Integer ilimit;
+  int stopnow;
+  if (ttisinteger(init) && ttisinteger(pstep) &&
+      forlimit(L, plimit, &ilimit, ivalue(pstep), &stopnow)) {
+    /* all values are integer */
+    lua_Integer initv = (stopnow ? 0 : ivalue(init));
+    setivalue(L, plimit, ilimit);
+    setivalue(L, init, initv - ivalue(pstep));
+  }
+  else {  /* try making all values floats */
+    lua_Number ninit; lua_Number nlimit; lua_Number nstep;
+    if (!tonumber(plimit, &nlimit))
+      luaG_runerror(L, "'for' limit must be a number");
+    setfltvalue(plimit, nlimit);
+    if (!tonumber(pstep, &nstep))
+      luaG_runerror(L, "'for' step must be a number");
+    setfltvalue(pstep, nstep);
+    if (!tonumber(init, &ninit))
+      luaG_runerror(L, "'for' initial value must be a number");
+    setfltvalue(init, luai_numsub(L, ninit, nstep));
+  }
+}
+
+
+/*
+** create the inline caches of prototype 'p' and return the one of the
+** running instruction
+*/
+static FieldCache *newfcache (lua_State *L, CallInfo *ci, Proto *p) {
+  int i;
+  FieldCache *fc = luaM_newvector(L, p->sizecode, FieldCache);
+  for (i = 0; i < p->sizecode; i++)
+    fc[i].slot = fc[i].tmslot = 0;
+  p->fcache = fc;
+  return &fc[pcRel(ci->u.l.savedpc, p)];
+}
+
+
 /*
 ** finish execution of an opcode interrupted by an yield
 */
@@ -540,7 +793,7 @@ void luaV_finishOp (lua_State *L) {
   CallInfo *ci = L->ci;
   StkId base = ci->u.l.base;
   Instruction inst = *(ci->u.l.savedpc - 1);  /* interrupted instruction */
-  OpCode op = GET_OPCODE(inst);
+  OpCode op = GET_BASEOP(inst);  /* it may have been quickened meanwhile */
   switch (op) {  /* finish its execution */
     case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_IDIV:
     case OP_BAND: case OP_BOR: case OP_BXOR: case OP_SHL: case OP_SHR:
@@ -620,6 +873,29 @@ void luaV_finishOp (lua_State *L) {
 	ISK(GETARG_B(i)) ? k+INDEXK(GETARG_B(i)) : base+GETARG_B(i))
 #define RKC(i)	check_exp(getCMode(GET_OPCODE(i)) == OpArgK, \
 	ISK(GETARG_C(i)) ? k+INDEXK(GETARG_C(i)) : base+GETARG_C(i))
+
+/* inline cache of the running instruction */
+#define getfcache(L,ci,p)  \
+	((p)->fcache ? &(p)->fcache[pcRel((ci)->u.l.savedpc, p)] \
+	             : newfcache(L, ci, p))
+
+/* field read: 'ra' := 't'['key'], with 'key' a constant short string */
+#define getfield(t,key)  { \
+	FieldCache *fc = getfcache(L, ci, cl->p); \
+	const TValue *v = fastfield(t, key, fc); \
+	if (v != NULL) { setobj2s(L, ra, v); } \
+	else Protect(luaV_getfield(L, t, key, ra, fc)); }
+
+/* field write: 't'['key'] := 'val', with 'key' a constant short string */
+#define setfield(t,key,val)  { \
+	FieldCache *fc = getfcache(L, ci, cl->p); \
+	TValue *v = cast(TValue *, fastfield(t, key, fc)); \
+	if (v != NULL) { \
+	  setobj2t(L, v, val); \
+	  invalidateTMcache(hvalue(t)); \
+	  luaC_barrierback(L, hvalue(t), val); } \
+	else Protect(luaV_setfield(L, t, key, val, fc)); }
+
 #define KBx(i)  \
   (k + (GETARG_Bx(i) != 0 ? GETARG_Bx(i) - 1 : GETARG_Ax(*ci->u.l.savedpc++)))
 
@@ -636,6 +912,36 @@ void luaV_finishOp (lua_State *L) {
 
 #define Protect(x)	{ {x;}; base = ci->u.l.base; }
 
+
+/*
+** Quickening: rewrite the running instruction with opcode 'o'. Generic
+** arithmetic instructions quicken themselves into a variant specialized
+** for the operand types they see; a quickened instruction that gets
+** other types goes back to its generic form ('unquicken') and jumps to
+** the generic code. Prototypes are never shared among states, so the
+** rewrite is safe.
+*/
+#define quicken(ci,o)	SET_OPCODE(*cast(Instruction *, (ci)->u.l.savedpc - 1), o)
+
+#define unquicken(ci,i,o)	{ SET_OPCODE(i, o); quicken(ci, o); }
+
+/* quicken to float variant 'o' unless an operand is a coercible string */
+#define quickenflt(ci,rb,rc,o)  \
+	{ if (ttisnumber(rb) && ttisnumber(rc)) quicken(ci, o); }
+
+/* convert a number (but not a string) to a float */
+#define tofltnum(o,n)  \
+	(ttisfloat(o) ? (*(n) = fltvalue(o), 1) : \
+	 ttisinteger(o) ? (*(n) = cast_num(ivalue(o)), 1) : 0)
+
+/*
+** operands of a quickened float instruction: at least one of them must
+** be a float; the other may be an integer (as in 'x * 2')
+*/
+#define fltoperands(rb,rc,nb,nc)  \
+	(ttisfloat(rb) ? (*(nb) = fltvalue(rb), tofltnum(rc, nc)) : \
+	 (ttisfloat(rc) && tofltnum(rb, nb) && (*(nc) = fltvalue(rc), 1)))
+
 #define checkGC(L,c)  \
   Protect( luaC_condGC(L,{L->top = (c);  /* limit of live values */ \
                           luaC_step(L); \
@@ -643,539 +949,90 @@ void luaV_finishOp (lua_State *L) {
            luai_threadyield(L); )
 
 
+/*
+** With NaN boxing, integer arithmetic may allocate (see 'luaO_boxint')
+** where nothing else would run the collector, so loops and tail calls
+** give it a chance
+*/
+#if defined(LUA_NANBOXING)
+#define loopGC(L)	checkGC(L, ci->top)
+#else
+#define loopGC(L)	{ /* integers never allocate */ }
+#endif
+
+
+/* a hot loop goes on in the machine code of its function (see 'ljit.c') */
+#if defined(LUAI_JIT)
+#define jitloop(L,p)	{ if (luaJ_ready(L, p)) goto newframe; }
+#else
+#define jitloop(L,p)	{ /* no compiler */ }
+#endif
+
+
+/* 'L' has a hook to be called before each instruction */
+#define hasinsthook(L)	((L)->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT))
+
+/* leave the loop if it does not match the hooks of 'L' anymore */
+#define checkhooks(L)  \
+	{ if (VMHOOKED ? !hasinsthook(L) : hasinsthook(L)) return 1; }
+
+
+/* fetch an instruction and prepare its execution */
+#define vmfetch()	{ \
+  i = *(ci->u.l.savedpc++); \
+  if (VMHOOKED && hasinsthook(L) && \
+      (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) { \
+    Protect(luaG_traceexec(L)); \
+  } \
+  /* WARNING: several calls may realloc the stack and invalidate 'ra' */ \
+  ra = RA(i); \
+  lua_assert(base == ci->u.l.base); \
+  lua_assert(base <= L->top && L->top < L->stack + L->stacksize); \
+}
+
+
+/*
+** Superinstructions: after its own part, a fused instruction goes on
+** with the code at label 'lb' for the instruction that follows it,
+** without dispatching it. The hooked loop dispatches it as usual, so
+** that the hook sees it.
+*/
+#define fusenext(lb)  { \
+  if (VMHOOKED) { vmbreak; } \
+  i = *(ci->u.l.savedpc++); \
+  ra = RA(i); \
+  goto lb; }
+
+
 #define vmdispatch(o)	switch(o)
 #define vmcase(l)	case l:
 #define vmbreak		break
 
+/*
+** The main loop is compiled twice: 'execplain' for states without a
+** line or count hook pays nothing for hooks; 'exechooked' calls the
+** hook before each instruction. Hooks change through calls (or
+** asynchronously, through a signal), so the loops look for a change
+** only when changing frames, after calling a C function, and at loop
+** back edges, so that a signal can stop any loop. (A hook set inside
+** a metamethod takes effect at the next of these points.)
+*/
+#define VMHOOKED	0
+#define VMEXECUTE	execplain
+#include "lvmexec.h"
+#undef VMHOOKED
+#undef VMEXECUTE
+
+#define VMHOOKED	1
+#define VMEXECUTE	exechooked
+#include "lvmexec.h"
+#undef VMHOOKED
+#undef VMEXECUTE
+
+
 void luaV_execute (lua_State *L) {
-  CallInfo *ci = L->ci;
-  LClosure *cl;
-  TValue *k;
-  StkId base;
- newframe:  /* reentry point when frame changes (call/return) */
-  lua_assert(ci == L->ci);
-  cl = clLvalue(ci->func);
-  k = cl->p->k;
-  base = ci->u.l.base;
-  /* main loop of interpreter */
-  for (;;) {
-    Instruction i = *(ci->u.l.savedpc++);
-    StkId ra;
-    if ((L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) &&
-        (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) {
-      Protect(luaG_traceexec(L));
-    }
-    /* WARNING: several calls may realloc the stack and invalidate 'ra' */
-    ra = RA(i);
-    lua_assert(base == ci->u.l.base);
-    lua_assert(base <= L->top && L->top < L->stack + L->stacksize);
-    vmdispatch (GET_OPCODE(i)) {
-      vmcase(OP_MOVE) {
-        setobjs2s(L, ra, RB(i));
-        vmbreak;
-      }
-      vmcase(OP_LOADK) {
-        TValue *rb = k + GETARG_Bx(i);
-        setobj2s(L, ra, rb);
-        vmbreak;
-      }
-      vmcase(OP_LOADKX) {
-        TValue *rb;
-        lua_assert(GET_OPCODE(*ci->u.l.savedpc) == OP_EXTRAARG);
-        rb = k + GETARG_Ax(*ci->u.l.savedpc++);
-        setobj2s(L, ra, rb);
-        vmbreak;
-      }
-      vmcase(OP_LOADBOOL) {
-        setbvalue(ra, GETARG_B(i));
-        if (GETARG_C(i)) ci->u.l.savedpc++;  /* skip next instruction (if C) */
-        vmbreak;
-      }
-      vmcase(OP_LOADNIL) {
-        int b = GETARG_B(i);
-        do {
-          setnilvalue(ra++);
-        } while (b--);
-        vmbreak;
-      }
-      vmcase(OP_GETUPVAL) {
-        int b = GETARG_B(i);
-        setobj2s(L, ra, cl->upvals[b]->v);
-        vmbreak;
-      }
-      vmcase(OP_GETTABUP) {
-        int b = GETARG_B(i);
-        Protect(luaV_gettable(L, cl->upvals[b]->v, RKC(i), ra));
-        vmbreak;
-      }
-      vmcase(OP_GETTABLE) {
-        Protect(luaV_gettable(L, RB(i), RKC(i), ra));
-        vmbreak;
-      }
-      vmcase(OP_SETTABUP) {
-        int a = GETARG_A(i);
-        Protect(luaV_settable(L, cl->upvals[a]->v, RKB(i), RKC(i)));
-        vmbreak;
-      }
-      vmcase(OP_SETUPVAL) {
-        UpVal *uv = cl->upvals[GETARG_B(i)];
-        setobj(L, uv->v, ra);
-        luaC_upvalbarrier(L, uv);
-        vmbreak;
-      }
-      vmcase(OP_SETTABLE) {
-        Protect(luaV_settable(L, ra, RKB(i), RKC(i)));
-        vmbreak;
-      }
-      vmcase(OP_NEWTABLE) {
-        int b = GETARG_B(i);
-        int c = GETARG_C(i);
-        Table *t = luaH_new(L);
-        sethvalue(L, ra, t);
-        if (b != 0 || c != 0)
-          luaH_resize(L, t, luaO_fb2int(b), luaO_fb2int(c));
-        checkGC(L, ra + 1);
-        vmbreak;
-      }
-      vmcase(OP_SELF) {
-        StkId rb = RB(i);
-        setobjs2s(L, ra+1, rb);
-        Protect(luaV_gettable(L, rb, RKC(i), ra));
-        vmbreak;
-      }
-      vmcase(OP_ADD) { 
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (ttisinteger(rb) && ttisinteger(rc)) {
-          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
-          setivalue(ra, intop(+, ib, ic));
-        }
-        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          setfltvalue(ra, luai_numadd(L, nb, nc));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_ADD)); }
-        vmbreak;
-      }
-      vmcase(OP_SUB) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (ttisinteger(rb) && ttisinteger(rc)) {
-          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
-          setivalue(ra, intop(-, ib, ic));
-        }
-        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          setfltvalue(ra, luai_numsub(L, nb, nc));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SUB)); }
-        vmbreak;
-      }
-      vmcase(OP_MUL) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (ttisinteger(rb) && ttisinteger(rc)) {
-          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
-          setivalue(ra, intop(*, ib, ic));
-        }
-        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          setfltvalue(ra, luai_nummul(L, nb, nc));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_MUL)); }
-        vmbreak;
-      }
-      vmcase(OP_DIV) {  /* float division (always with floats) */
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          setfltvalue(ra, luai_numdiv(L, nb, nc));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_DIV)); }
-        vmbreak;
-      }
-      vmcase(OP_BAND) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Integer ib; lua_Integer ic;
-        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
-          setivalue(ra, intop(&, ib, ic));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BAND)); }
-        vmbreak;
-      }
-      vmcase(OP_BOR) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Integer ib; lua_Integer ic;
-        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
-          setivalue(ra, intop(|, ib, ic));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BOR)); }
-        vmbreak;
-      }
-      vmcase(OP_BXOR) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Integer ib; lua_Integer ic;
-        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
-          setivalue(ra, intop(^, ib, ic));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BXOR)); }
-        vmbreak;
-      }
-      vmcase(OP_SHL) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Integer ib; lua_Integer ic;
-        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
-          setivalue(ra, luaV_shiftl(ib, ic));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHL)); }
-        vmbreak;
-      }
-      vmcase(OP_SHR) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Integer ib; lua_Integer ic;
-        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
-          setivalue(ra, luaV_shiftl(ib, -ic));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHR)); }
-        vmbreak;
-      }
-      vmcase(OP_MOD) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (ttisinteger(rb) && ttisinteger(rc)) {
-          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
-          setivalue(ra, luaV_mod(L, ib, ic));
-        }
-        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          lua_Number m;
-          luai_nummod(L, nb, nc, m);
-          setfltvalue(ra, m);
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_MOD)); }
-        vmbreak;
-      }
-      vmcase(OP_IDIV) {  /* floor division */
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (ttisinteger(rb) && ttisinteger(rc)) {
-          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
-          setivalue(ra, luaV_div(L, ib, ic));
-        }
-        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          setfltvalue(ra, luai_numidiv(L, nb, nc));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_IDIV)); }
-        vmbreak;
-      }
-      vmcase(OP_POW) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        lua_Number nb; lua_Number nc;
-        if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
-          setfltvalue(ra, luai_numpow(L, nb, nc));
-        }
-        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_POW)); }
-        vmbreak;
-      }
-      vmcase(OP_UNM) {
-        TValue *rb = RB(i);
-        lua_Number nb;
-        if (ttisinteger(rb)) {
-          lua_Integer ib = ivalue(rb);
-          setivalue(ra, intop(-, 0, ib));
-        }
-        else if (tonumber(rb, &nb)) {
-          setfltvalue(ra, luai_numunm(L, nb));
-        }
-        else {
-          Protect(luaT_trybinTM(L, rb, rb, ra, TM_UNM));
-        }
-        vmbreak;
-      }
-      vmcase(OP_BNOT) {
-        TValue *rb = RB(i);
-        lua_Integer ib;
-        if (tointeger(rb, &ib)) {
-          setivalue(ra, intop(^, ~l_castS2U(0), ib));
-        }
-        else {
-          Protect(luaT_trybinTM(L, rb, rb, ra, TM_BNOT));
-        }
-        vmbreak;
-      }
-      vmcase(OP_NOT) {
-        TValue *rb = RB(i);
-        int res = l_isfalse(rb);  /* next assignment may change this value */
-        setbvalue(ra, res);
-        vmbreak;
-      }
-      vmcase(OP_LEN) {
-        Protect(luaV_objlen(L, ra, RB(i)));
-        vmbreak;
-      }
-      vmcase(OP_CONCAT) {
-        int b = GETARG_B(i);
-        int c = GETARG_C(i);
-        StkId rb;
-        L->top = base + c + 1;  /* mark the end of concat operands */
-        Protect(luaV_concat(L, c - b + 1));
-        ra = RA(i);  /* 'luav_concat' may invoke TMs and move the stack */
-        rb = b + base;
-        setobjs2s(L, ra, rb);
-        checkGC(L, (ra >= rb ? ra + 1 : rb));
-        L->top = ci->top;  /* restore top */
-        vmbreak;
-      }
-      vmcase(OP_JMP) {
-        dojump(ci, i, 0);
-        vmbreak;
-      }
-      vmcase(OP_EQ) {
-        TValue *rb = RKB(i);
-        TValue *rc = RKC(i);
-        Protect(
-          if (cast_int(luaV_equalobj(L, rb, rc)) != GETARG_A(i))
-            ci->u.l.savedpc++;
-          else
-            donextjump(ci);
-        )
-        vmbreak;
-      }
-      vmcase(OP_LT) {
-        Protect(
-          if (luaV_lessthan(L, RKB(i), RKC(i)) != GETARG_A(i))
-            ci->u.l.savedpc++;
-          else
-            donextjump(ci);
-        )
-        vmbreak;
-      }
-      vmcase(OP_LE) {
-        Protect(
-          if (luaV_lessequal(L, RKB(i), RKC(i)) != GETARG_A(i))
-            ci->u.l.savedpc++;
-          else
-            donextjump(ci);
-        )
-        vmbreak;
-      }
-      vmcase(OP_TEST) {
-        if (GETARG_C(i) ? l_isfalse(ra) : !l_isfalse(ra))
-            ci->u.l.savedpc++;
-          else
-          donextjump(ci);
-        vmbreak;
-      }
-      vmcase(OP_TESTSET) {
-        TValue *rb = RB(i);
-        if (GETARG_C(i) ? l_isfalse(rb) : !l_isfalse(rb))
-          ci->u.l.savedpc++;
-        else {
-          setobjs2s(L, ra, rb);
-          donextjump(ci);
-        }
-        vmbreak;
-      }
-      vmcase(OP_CALL) {
-        int b = GETARG_B(i);
-        int nresults = GETARG_C(i) - 1;
-        if (b != 0) L->top = ra+b;  /* else previous instruction set top */
-        if (luaD_precall(L, ra, nresults)) {  /* C function? */
-          if (nresults >= 0) L->top = ci->top;  /* adjust results */
-          base = ci->u.l.base;
-        }
-        else {  /* Lua function */
-          ci = L->ci;
-          ci->callstatus |= CIST_REENTRY;
-          goto newframe;  /* restart luaV_execute over new Lua function */
-        }
-        vmbreak;
-      }
-      vmcase(OP_TAILCALL) {
-        int b = GETARG_B(i);
-        if (b != 0) L->top = ra+b;  /* else previous instruction set top */
-        lua_assert(GETARG_C(i) - 1 == LUA_MULTRET);
-        if (luaD_precall(L, ra, LUA_MULTRET))  /* C function? */
-          base = ci->u.l.base;
-        else {
-          /* tail call: put called frame (n) in place of caller one (o) */
-          CallInfo *nci = L->ci;  /* called frame */
-          CallInfo *oci = nci->previous;  /* caller frame */
-          StkId nfunc = nci->func;  /* called function */
-          StkId ofunc = oci->func;  /* caller function */
-          /* last stack slot filled by 'precall' */
-          StkId lim = nci->u.l.base + getproto(nfunc)->numparams;
-          int aux;
-          /* close all upvalues from previous call */
-          if (cl->p->sizep > 0) luaF_close(L, oci->u.l.base);
-          /* move new frame into old one */
-          for (aux = 0; nfunc + aux < lim; aux++)
-            setobjs2s(L, ofunc + aux, nfunc + aux);
-          oci->u.l.base = ofunc + (nci->u.l.base - nfunc);  /* correct base */
-          oci->top = L->top = ofunc + (L->top - nfunc);  /* correct top */
-          oci->u.l.savedpc = nci->u.l.savedpc;
-          oci->callstatus |= CIST_TAIL;  /* function was tail called */
-          ci = L->ci = oci;  /* remove new frame */
-          lua_assert(L->top == oci->u.l.base + getproto(ofunc)->maxstacksize);
-          goto newframe;  /* restart luaV_execute over new Lua function */
-        }
-        vmbreak;
-      }
-      vmcase(OP_RETURN) {
-        int b = GETARG_B(i);
-        if (b != 0) L->top = ra+b-1;
-        if (cl->p->sizep > 0) luaF_close(L, base);
-        b = luaD_poscall(L, ra);
-        if (!(ci->callstatus & CIST_REENTRY))  /* 'ci' still the called one */
-          return;  /* external invocation: return */
-        else {  /* invocation via reentry: continue execution */
-          ci = L->ci;
-          if (b) L->top = ci->top;
-          lua_assert(isLua(ci));
-          lua_assert(GET_OPCODE(*((ci)->u.l.savedpc - 1)) == OP_CALL);
-          goto newframe;  /* restart luaV_execute over new Lua function */
-        }
-      }
-      vmcase(OP_FORLOOP) {
-        if (ttisinteger(ra)) {  /* integer loop? */
-          lua_Integer step = ivalue(ra + 2);
-          lua_Integer idx = ivalue(ra) + step; /* increment index */
-          lua_Integer limit = ivalue(ra + 1);
-          if ((0 < step) ? (idx <= limit) : (limit <= idx)) {
-            ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
-            setivalue(ra, idx);  /* update internal index... */
-            setivalue(ra + 3, idx);  /* ...and external index */
-          }
-        }
-        else {  /* floating loop */
-          lua_Number step = fltvalue(ra + 2);
-          lua_Number idx = luai_numadd(L, fltvalue(ra), step); /* inc. index */
-          lua_Number limit = fltvalue(ra + 1);
-          if (luai_numlt(0, step) ? luai_numle(idx, limit)
-                                  : luai_numle(limit, idx)) {
-            ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
-            setfltvalue(ra, idx);  /* update internal index... */
-            setfltvalue(ra + 3, idx);  /* ...and external index */
-          }
-        }
-        vmbreak;
-      }
-      vmcase(OP_FORPREP) {
-        TValue *init = ra;
-        TValue *plimit = ra + 1;
-        TValue *pstep = ra + 2;
-        lua_Integer ilimit;
-        int stopnow;
-        if (ttisinteger(init) && ttisinteger(pstep) &&
-            forlimit(plimit, &ilimit, ivalue(pstep), &stopnow)) {
-          /* all values are integer */
-          lua_Integer initv = (stopnow ? 0 : ivalue(init));
-          setivalue(plimit, ilimit);
-          setivalue(init, initv - ivalue(pstep));
-        }
-        else {  /* try making all values floats */
-          lua_Number ninit; lua_Number nlimit; lua_Number nstep;
-          if (!tonumber(plimit, &nlimit))
-            luaG_runerror(L, "'for' limit must be a number");
-          setfltvalue(plimit, nlimit);
-          if (!tonumber(pstep, &nstep))
-            luaG_runerror(L, "'for' step must be a number");
-          setfltvalue(pstep, nstep);
-          if (!tonumber(init, &ninit))
-            luaG_runerror(L, "'for' initial value must be a number");
-          setfltvalue(init, luai_numsub(L, ninit, nstep));
-        }
-        ci->u.l.savedpc += GETARG_sBx(i);
-        vmbreak;
-      }
-      vmcase(OP_TFORCALL) {
-        StkId cb = ra + 3;  /* call base */
-        setobjs2s(L, cb+2, ra+2);
-        setobjs2s(L, cb+1, ra+1);
-        setobjs2s(L, cb, ra);
-        L->top = cb + 3;  /* func. + 2 args (state and index) */
-        Protect(luaD_call(L, cb, GETARG_C(i), 1));
-        L->top = ci->top;
-        i = *(ci->u.l.savedpc++);  /* go to next instruction */
-        ra = RA(i);
-        lua_assert(GET_OPCODE(i) == OP_TFORLOOP);
-        goto l_tforloop;
-      }
-      vmcase(OP_TFORLOOP) {
-        l_tforloop:
-        if (!ttisnil(ra + 1)) {  /* continue loop? */
-          setobjs2s(L, ra, ra + 1);  /* save control variable */
-           ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
-        }
-        vmbreak;
-      }
-      vmcase(OP_SETLIST) {
-        int n = GETARG_B(i);
-        int c = GETARG_C(i);
-        unsigned int last;
-        Table *h;
-        if (n == 0) n = cast_int(L->top - ra) - 1;
-        if (c == 0) {
-          lua_assert(GET_OPCODE(*ci->u.l.savedpc) == OP_EXTRAARG);
-          c = GETARG_Ax(*ci->u.l.savedpc++);
-        }
-        luai_runtimecheck(L, ttistable(ra));
-        h = hvalue(ra);
-        last = ((c-1)*LFIELDS_PER_FLUSH) + n;
-        if (last > h->sizearray)  /* needs more space? */
-          luaH_resizearray(L, h, last);  /* pre-allocate it at once */
-        for (; n > 0; n--) {
-          TValue *val = ra+n;
-          luaH_setint(L, h, last--, val);
-          luaC_barrierback(L, h, val);
-        }
-        L->top = ci->top;  /* correct top (in case of previous open call) */
-        vmbreak;
-      }
-      vmcase(OP_CLOSURE) {
-        Proto *p = cl->p->p[GETARG_Bx(i)];
-        LClosure *ncl = getcached(p, cl->upvals, base);  /* cached closure */
-        if (ncl == NULL)  /* no match? */
-          pushclosure(L, p, cl->upvals, base, ra);  /* create a new one */
-        else
-          setclLvalue(L, ra, ncl);  /* push cashed closure */
-        checkGC(L, ra + 1);
-        vmbreak;
-      }
-      vmcase(OP_VARARG) {
-        int b = GETARG_B(i) - 1;
-        int j;
-        int n = cast_int(base - ci->func) - cl->p->numparams - 1;
-        if (b < 0) {  /* B == 0? */
-          b = n;  /* get all var. arguments */
-          Protect(luaD_checkstack(L, n));
-          ra = RA(i);  /* previous call may change the stack */
-          L->top = ra + n;
-        }
-        for (j = 0; j < b; j++) {
-          if (j < n) {
-            setobjs2s(L, ra + j, base - n + j);
-          }
-          else {
-            setnilvalue(ra + j);
-          }
-        }
-        vmbreak;
-      }
-      vmcase(OP_EXTRAARG) {
-        lua_assert(0);
-        vmbreak;
-      }
-    }
-  }
+  while (hasinsthook(L) ? exechooked(L) : execplain(L))
+    ;  /* hooks changed: go on with the other loop */
 }
 
 /* }================================================================== */
@@ -27,26 +27,66 @@
 #endif
 
 
+/*
+** You can define LUA_USE_JUMPTABLE to 0 or 1 to choose whether the
+** interpreter dispatches with a table of label addresses ("computed
+** goto", a GNU extension) or with a 'switch'.
+*/
+#if !defined(LUA_USE_JUMPTABLE)
+#if defined(__GNUC__)
+#define LUA_USE_JUMPTABLE	1
+#else
+#define LUA_USE_JUMPTABLE	0
+#endif
+#endif
+
+
 #define tonumber(o,n) \
-	(ttisfloat(o) ? (*(n) = fltvalue(o), 1) : luaV_tonumber_(o,n))
+	(ttisfloat(o) ? (*(n) = fltvalue(o), 1) : luaV_tonumber_(L,o,n))
 
 #define tointeger(o,i) \
-	(ttisinteger(o) ? (*(i) = ivalue(o), 1) : luaV_tointeger_(o,i))
+	(ttisinteger(o) ? (*(i) = ivalue(o), 1) : luaV_tointeger_(L,o,i))
 
 #define intop(op,v1,v2) l_castU2S(l_castS2U(v1) op l_castS2U(v2))
 
 #define luaV_rawequalobj(t1,t2)		luaV_equalobj(NULL,t1,t2)
 
+/* RK argument 'x' with value 'o' is a constant short string? */
+#define isfieldkey(x,o)	(ISK(x) && ttisshrstring(o))
+
+/*
+** fast path for field accesses: value of field 'key' of 't' when 't' is
+** a table holding a non-nil value at the node cached in 'fc'; NULL
+** otherwise
+*/
+#define fastfield(t,key,fc)  \
+	(ttistable(t) ? luaH_slotvalue(hvalue(t), tsvalue(key), (fc)->slot) \
+	              : NULL)
+
+/* 'o' is a typed array? (see 'lua_setarraymetatable') */
+#define ttistarray(g,o)  \
+	(ttisfulluserdata(o) && uvalue(o)->metatable == (g)->arraymt && \
+	 (g)->arraymt != NULL)
+
 
 LUAI_FUNC int luaV_equalobj (lua_State *L, const TValue *t1, const TValue *t2);
 LUAI_FUNC int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r);
 LUAI_FUNC int luaV_lessequal (lua_State *L, const TValue *l, const TValue *r);
-LUAI_FUNC int luaV_tonumber_ (const TValue *obj, lua_Number *n);
-LUAI_FUNC int luaV_tointeger_ (const TValue *obj, lua_Integer *p);
+LUAI_FUNC int luaV_tonumber_ (lua_State *L, const TValue *obj,
+                              lua_Number *n);
+LUAI_FUNC int luaV_tointeger_ (lua_State *L, const TValue *obj,
+                               lua_Integer *p);
 LUAI_FUNC void luaV_gettable (lua_State *L, const TValue *t, TValue *key,
                                             StkId val);
 LUAI_FUNC void luaV_settable (lua_State *L, const TValue *t, TValue *key,
                                             StkId val);
+LUAI_FUNC void luaV_getfield (lua_State *L, const TValue *t, TValue *key,
+                                            StkId val, FieldCache *fc);
+LUAI_FUNC void luaV_setfield (lua_State *L, const TValue *t, TValue *key,
+                                            StkId val, FieldCache *fc);
+LUAI_FUNC void luaV_closure (lua_State *L, Proto *p, UpVal **encup,
+                                           StkId base, StkId ra);
+LUAI_FUNC void luaV_forprep (lua_State *L, StkId ra);
 LUAI_FUNC void luaV_finishOp (lua_State *L);
 LUAI_FUNC void luaV_execute (lua_State *L);
 LUAI_FUNC void luaV_concat (lua_State *L, int total);
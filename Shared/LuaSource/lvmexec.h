@@ -0,0 +1,750 @@
+/*
+** $Id: lvmexec.h $
+** Main loop of the interpreter, compiled twice by 'lvm.c'
+** See Copyright Notice in lua.h
+*/
+
+
+/*
+** 'VMEXECUTE' runs Lua code starting at 'L->ci' and returns 0 when the
+** function in that frame returns. With 'VMHOOKED' false it never looks
+** at hooks; then it returns 1 when a line or count hook appears, so
+** that 'luaV_execute' goes on with the other compilation (which does
+** the opposite when the hook goes away).
+*/
+static int VMEXECUTE (lua_State *L) {
+  CallInfo *ci = L->ci;
+  LClosure *cl;
+  TValue *k;
+  StkId base;
+#if LUA_USE_JUMPTABLE
+#include "ljumptab.h"
+#endif
+ newframe:  /* reentry point when frame changes (call/return) */
+  lua_assert(ci == L->ci);
+  cl = clLvalue(ci->func);
+#if defined(LUAI_JIT)
+  if (luaJ_ready(L, cl->p)) {  /* run machine code? */
+    switch (luaJ_execute(L, ci)) {
+      case LUAJ_CALL: {  /* same as a call from OP_CALL */
+        ci = L->ci;
+        ci->callstatus |= CIST_REENTRY;
+        goto newframe;
+      }
+      case LUAJ_RETURN: {  /* same as a return from OP_RETURN */
+        if (!(ci->callstatus & CIST_REENTRY))  /* external invocation? */
+          return 0;
+        ci = L->ci;
+        goto newframe;
+      }
+      default: lua_assert(ci == L->ci);  /* go on interpreting */
+    }
+  }
+#endif
+  checkhooks(L);
+  k = cl->p->k;
+  base = ci->u.l.base;
+  /* main loop of interpreter */
+  for (;;) {
+    Instruction i;
+    StkId ra;
+    vmfetch();
+    vmdispatch (GET_OPCODE(i)) {
+      vmcase(OP_MOVE)
+      l_move: {
+        setobjs2s(L, ra, RB(i));
+        vmbreak;
+      }
+      vmcase(OP_LOADK)
+      l_loadk: {
+        TValue *rb = k + GETARG_Bx(i);
+        setobj2s(L, ra, rb);
+        vmbreak;
+      }
+      vmcase(OP_LOADKX) {
+        TValue *rb;
+        lua_assert(GET_OPCODE(*ci->u.l.savedpc) == OP_EXTRAARG);
+        rb = k + GETARG_Ax(*ci->u.l.savedpc++);
+        setobj2s(L, ra, rb);
+        vmbreak;
+      }
+      vmcase(OP_LOADBOOL) {
+        setbvalue(ra, GETARG_B(i));
+        if (GETARG_C(i)) ci->u.l.savedpc++;  /* skip next instruction (if C) */
+        vmbreak;
+      }
+      vmcase(OP_LOADNIL) {
+        int b = GETARG_B(i);
+        do {
+          setnilvalue(ra++);
+        } while (b--);
+        vmbreak;
+      }
+      vmcase(OP_GETUPVAL) {
+        int b = GETARG_B(i);
+        setobj2s(L, ra, cl->upvals[b]->v);
+        vmbreak;
+      }
+      vmcase(OP_GETTABUP) {
+        TValue *upval = cl->upvals[GETARG_B(i)]->v;
+        TValue *rc = RKC(i);
+        if (isfieldkey(GETARG_C(i), rc))
+          getfield(upval, rc)
+        else
+          Protect(luaV_gettable(L, upval, rc, ra));
+        vmbreak;
+      }
+      vmcase(OP_GETTABLE)
+      l_gettable: {
+        StkId rb = RB(i);
+        TValue *rc = RKC(i);
+        if (isfieldkey(GETARG_C(i), rc))
+          getfield(rb, rc)
+        else
+          Protect(luaV_gettable(L, rb, rc, ra));
+        vmbreak;
+      }
+      vmcase(OP_SETTABUP) {
+        TValue *upval = cl->upvals[GETARG_A(i)]->v;
+        TValue *rb = RKB(i);
+        if (isfieldkey(GETARG_B(i), rb))
+          setfield(upval, rb, RKC(i))
+        else
+          Protect(luaV_settable(L, upval, rb, RKC(i)));
+        vmbreak;
+      }
+      vmcase(OP_SETUPVAL) {
+        UpVal *uv = cl->upvals[GETARG_B(i)];
+        setobj(L, uv->v, ra);
+        luaC_upvalbarrier(L, uv);
+        vmbreak;
+      }
+      vmcase(OP_SETTABLE) {
+        TValue *rb = RKB(i);
+        if (isfieldkey(GETARG_B(i), rb))
+          setfield(ra, rb, RKC(i))
+        else
+          Protect(luaV_settable(L, ra, rb, RKC(i)));
+        vmbreak;
+      }
+      vmcase(OP_NEWTABLE) {
+        int b = GETARG_B(i);
+        int c = GETARG_C(i);
+        Table *t;
+        if (b == 0 && luaO_fb2int(c) <= MAXSHAPEKEYS) {  /* a record? */
+          t = luaH_newrecord(L, &G(L)->shaperoot, luaO_fb2int(c));
+          sethvalue(L, ra, t);
+        }
+        else {
+          t = luaH_new(L);
+          sethvalue(L, ra, t);
+          if (b != 0 || c != 0)
+            luaH_resize(L, t, luaO_fb2int(b), luaO_fb2int(c));
+        }
+        checkGC(L, ra + 1);
+        vmbreak;
+      }
+      vmcase(OP_SELF) {
+        StkId rb = RB(i);
+        TValue *rc = RKC(i);
+        setobjs2s(L, ra+1, rb);
+        if (isfieldkey(GETARG_C(i), rc))
+          getfield(rb, rc)
+        else
+          Protect(luaV_gettable(L, rb, rc, ra));
+        vmbreak;
+      }
+      vmcase(OP_ADD)
+      l_add: {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, intop(+, ib, ic));
+          quicken(ci, OP_ADDINT);
+        }
+        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          setfltvalue(ra, luai_numadd(L, nb, nc));
+          quickenflt(ci, rb, rc, OP_ADDFLT);
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_ADD)); }
+        vmbreak;
+      }
+      vmcase(OP_SUB)
+      l_sub: {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, intop(-, ib, ic));
+          quicken(ci, OP_SUBINT);
+        }
+        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          setfltvalue(ra, luai_numsub(L, nb, nc));
+          quickenflt(ci, rb, rc, OP_SUBFLT);
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SUB)); }
+        vmbreak;
+      }
+      vmcase(OP_MUL)
+      l_mul: {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, intop(*, ib, ic));
+          quicken(ci, OP_MULINT);
+        }
+        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          setfltvalue(ra, luai_nummul(L, nb, nc));
+          quickenflt(ci, rb, rc, OP_MULFLT);
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_MUL)); }
+        vmbreak;
+      }
+      vmcase(OP_DIV)  /* float division (always with floats) */
+      l_div: {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          setfltvalue(ra, luai_numdiv(L, nb, nc));
+          quickenflt(ci, rb, rc, OP_DIVFLT);
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_DIV)); }
+        vmbreak;
+      }
+      vmcase(OP_BAND) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Integer ib; lua_Integer ic;
+        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
+          setivalue(L, ra, intop(&, ib, ic));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BAND)); }
+        vmbreak;
+      }
+      vmcase(OP_BOR) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Integer ib; lua_Integer ic;
+        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
+          setivalue(L, ra, intop(|, ib, ic));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BOR)); }
+        vmbreak;
+      }
+      vmcase(OP_BXOR) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Integer ib; lua_Integer ic;
+        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
+          setivalue(L, ra, intop(^, ib, ic));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_BXOR)); }
+        vmbreak;
+      }
+      vmcase(OP_SHL) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Integer ib; lua_Integer ic;
+        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
+          setivalue(L, ra, luaV_shiftl(ib, ic));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHL)); }
+        vmbreak;
+      }
+      vmcase(OP_SHR) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Integer ib; lua_Integer ic;
+        if (tointeger(rb, &ib) && tointeger(rc, &ic)) {
+          setivalue(L, ra, luaV_shiftl(ib, -ic));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_SHR)); }
+        vmbreak;
+      }
+      vmcase(OP_MOD) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, luaV_mod(L, ib, ic));
+        }
+        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          lua_Number m;
+          luai_nummod(L, nb, nc, m);
+          setfltvalue(ra, m);
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_MOD)); }
+        vmbreak;
+      }
+      vmcase(OP_IDIV) {  /* floor division */
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, luaV_div(L, ib, ic));
+        }
+        else if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          setfltvalue(ra, luai_numidiv(L, nb, nc));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_IDIV)); }
+        vmbreak;
+      }
+      vmcase(OP_POW) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (tonumber(rb, &nb) && tonumber(rc, &nc)) {
+          setfltvalue(ra, luai_numpow(L, nb, nc));
+        }
+        else { Protect(luaT_trybinTM(L, rb, rc, ra, TM_POW)); }
+        vmbreak;
+      }
+      vmcase(OP_UNM) {
+        TValue *rb = RB(i);
+        lua_Number nb;
+        if (ttisinteger(rb)) {
+          lua_Integer ib = ivalue(rb);
+          setivalue(L, ra, intop(-, 0, ib));
+        }
+        else if (tonumber(rb, &nb)) {
+          setfltvalue(ra, luai_numunm(L, nb));
+        }
+        else {
+          Protect(luaT_trybinTM(L, rb, rb, ra, TM_UNM));
+        }
+        vmbreak;
+      }
+      vmcase(OP_BNOT) {
+        TValue *rb = RB(i);
+        lua_Integer ib;
+        if (tointeger(rb, &ib)) {
+          setivalue(L, ra, intop(^, ~l_castS2U(0), ib));
+        }
+        else {
+          Protect(luaT_trybinTM(L, rb, rb, ra, TM_BNOT));
+        }
+        vmbreak;
+      }
+      vmcase(OP_NOT) {
+        TValue *rb = RB(i);
+        int res = l_isfalse(rb);  /* next assignment may change this value */
+        setbvalue(ra, res);
+        vmbreak;
+      }
+      vmcase(OP_LEN) {
+        Protect(luaV_objlen(L, ra, RB(i)));
+        vmbreak;
+      }
+      vmcase(OP_CONCAT) {
+        int b = GETARG_B(i);
+        int c = GETARG_C(i);
+        StkId rb;
+        L->top = base + c + 1;  /* mark the end of concat operands */
+        Protect(luaV_concat(L, c - b + 1));
+        ra = RA(i);  /* 'luav_concat' may invoke TMs and move the stack */
+        rb = b + base;
+        setobjs2s(L, ra, rb);
+        checkGC(L, (ra >= rb ? ra + 1 : rb));
+        L->top = ci->top;  /* restore top */
+        vmbreak;
+      }
+      vmcase(OP_JMP) {
+        dojump(ci, i, 0);
+        if (GETARG_sBx(i) < 0) {  /* loop? */
+          jitloop(L, cl->p);
+          loopGC(L);
+        }
+        checkhooks(L);
+        vmbreak;
+      }
+      vmcase(OP_EQ) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        Protect(
+          if (cast_int(luaV_equalobj(L, rb, rc)) != GETARG_A(i))
+            ci->u.l.savedpc++;
+          else
+            donextjump(ci);
+        )
+        vmbreak;
+      }
+      vmcase(OP_LT)
+      l_lt: {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        if (ttisinteger(rb) && ttisinteger(rc))
+          quicken(ci, OP_LTINT);
+        else if (ttisnumber(rb) && ttisnumber(rc))
+          quicken(ci, OP_LTFLT);
+        Protect(
+          if (luaV_lessthan(L, rb, rc) != GETARG_A(i))
+            ci->u.l.savedpc++;
+          else
+            donextjump(ci);
+        )
+        vmbreak;
+      }
+      vmcase(OP_LE) {
+        Protect(
+          if (luaV_lessequal(L, RKB(i), RKC(i)) != GETARG_A(i))
+            ci->u.l.savedpc++;
+          else
+            donextjump(ci);
+        )
+        vmbreak;
+      }
+      vmcase(OP_TEST) {
+        if (GETARG_C(i) ? l_isfalse(ra) : !l_isfalse(ra))
+            ci->u.l.savedpc++;
+          else
+          donextjump(ci);
+        vmbreak;
+      }
+      vmcase(OP_TESTSET) {
+        TValue *rb = RB(i);
+        if (GETARG_C(i) ? l_isfalse(rb) : !l_isfalse(rb))
+          ci->u.l.savedpc++;
+        else {
+          setobjs2s(L, ra, rb);
+          donextjump(ci);
+        }
+        vmbreak;
+      }
+      vmcase(OP_CALL)
+      l_call: {
+        int b = GETARG_B(i);
+        int nresults = GETARG_C(i) - 1;
+        if (b != 0) L->top = ra+b;  /* else previous instruction set top */
+        if (luaD_precall(L, ra, nresults)) {  /* C function? */
+          if (nresults >= 0) L->top = ci->top;  /* adjust results */
+          base = ci->u.l.base;
+          checkhooks(L);
+        }
+        else {  /* Lua function */
+          ci = L->ci;
+          ci->callstatus |= CIST_REENTRY;
+          goto newframe;  /* restart luaV_execute over new Lua function */
+        }
+        vmbreak;
+      }
+      vmcase(OP_TAILCALL) {
+        int b = GETARG_B(i);
+        if (b != 0) L->top = ra+b;  /* else previous instruction set top */
+        lua_assert(GETARG_C(i) - 1 == LUA_MULTRET);
+        if (luaD_precall(L, ra, LUA_MULTRET)) {  /* C function? */
+          base = ci->u.l.base;
+          checkhooks(L);
+        }
+        else {
+          /* tail call: put called frame (n) in place of caller one (o) */
+          CallInfo *nci = L->ci;  /* called frame */
+          CallInfo *oci = nci->previous;  /* caller frame */
+          StkId nfunc = nci->func;  /* called function */
+          StkId ofunc = oci->func;  /* caller function */
+          /* last stack slot filled by 'precall' */
+          StkId lim = nci->u.l.base + getproto(nfunc)->numparams;
+          int aux;
+          /* close all upvalues from previous call */
+          if (cl->p->sizep > 0) luaF_close(L, oci->u.l.base);
+          /* move new frame into old one */
+          for (aux = 0; nfunc + aux < lim; aux++)
+            setobjs2s(L, ofunc + aux, nfunc + aux);
+          oci->u.l.base = ofunc + (nci->u.l.base - nfunc);  /* correct base */
+          oci->top = L->top = ofunc + (L->top - nfunc);  /* correct top */
+          oci->u.l.savedpc = nci->u.l.savedpc;
+          oci->callstatus |= CIST_TAIL;  /* function was tail called */
+          ci = L->ci = oci;  /* remove new frame */
+          lua_assert(L->top == oci->u.l.base + getproto(ofunc)->maxstacksize);
+          loopGC(L);
+          goto newframe;  /* restart luaV_execute over new Lua function */
+        }
+        vmbreak;
+      }
+      vmcase(OP_RETURN) {
+        int b = GETARG_B(i);
+        if (b != 0) L->top = ra+b-1;
+        if (cl->p->sizep > 0) luaF_close(L, base);
+        b = luaD_poscall(L, ra);
+        if (!(ci->callstatus & CIST_REENTRY))  /* 'ci' still the called one */
+          return 0;  /* external invocation: return */
+        else {  /* invocation via reentry: continue execution */
+          ci = L->ci;
+          if (b) L->top = ci->top;
+          lua_assert(isLua(ci));
+          lua_assert(GET_OPCODE(*((ci)->u.l.savedpc - 1)) == OP_CALL);
+          goto newframe;  /* restart luaV_execute over new Lua function */
+        }
+      }
+      vmcase(OP_FORLOOP) {
+        if (ttisinteger(ra)) {  /* integer loop? */
+          lua_Integer step = ivalue(ra + 2);
+          lua_Integer idx = ivalue(ra) + step; /* increment index */
+          lua_Integer limit = ivalue(ra + 1);
+          if ((0 < step) ? (idx <= limit) : (limit <= idx)) {
+            ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
+            setivalue(L, ra, idx);  /* update internal index... */
+            setivalue(L, ra + 3, idx);  /* ...and external index */
+            jitloop(L, cl->p);
+            loopGC(L);
+            checkhooks(L);
+          }
+        }
+        else {  /* floating loop */
+          lua_Number step = fltvalue(ra + 2);
+          lua_Number idx = luai_numadd(L, fltvalue(ra), step); /* inc. index */
+          lua_Number limit = fltvalue(ra + 1);
+          if (luai_numlt(0, step) ? luai_numle(idx, limit)
+                                  : luai_numle(limit, idx)) {
+            ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
+            setfltvalue(ra, idx);  /* update internal index... */
+            setfltvalue(ra + 3, idx);  /* ...and external index */
+            jitloop(L, cl->p);
+            loopGC(L);
+            checkhooks(L);
+          }
+        }
+        vmbreak;
+      }
+      vmcase(OP_FORPREP) {
+        luaV_forprep(L, ra);
+        ci->u.l.savedpc += GETARG_sBx(i);
+        vmbreak;
+      }
+      vmcase(OP_TFORCALL) {
+        StkId cb = ra + 3;  /* call base */
+        setobjs2s(L, cb+2, ra+2);
+        setobjs2s(L, cb+1, ra+1);
+        setobjs2s(L, cb, ra);
+        L->top = cb + 3;  /* func. + 2 args (state and index) */
+        Protect(luaD_call(L, cb, GETARG_C(i), 1));
+        L->top = ci->top;
+        i = *(ci->u.l.savedpc++);  /* go to next instruction */
+        ra = RA(i);
+        lua_assert(GET_OPCODE(i) == OP_TFORLOOP);
+        goto l_tforloop;
+      }
+      vmcase(OP_TFORLOOP) {
+        l_tforloop:
+        if (!ttisnil(ra + 1)) {  /* continue loop? */
+          setobjs2s(L, ra, ra + 1);  /* save control variable */
+           ci->u.l.savedpc += GETARG_sBx(i);  /* jump back */
+          jitloop(L, cl->p);
+          loopGC(L);
+          checkhooks(L);
+        }
+        vmbreak;
+      }
+      vmcase(OP_SETLIST) {
+        int n = GETARG_B(i);
+        int c = GETARG_C(i);
+        unsigned int last;
+        Table *h;
+        if (n == 0) n = cast_int(L->top - ra) - 1;
+        if (c == 0) {
+          lua_assert(GET_OPCODE(*ci->u.l.savedpc) == OP_EXTRAARG);
+          c = GETARG_Ax(*ci->u.l.savedpc++);
+        }
+        luai_runtimecheck(L, ttistable(ra));
+        h = hvalue(ra);
+        last = ((c-1)*LFIELDS_PER_FLUSH) + n;
+        if (last > h->sizearray)  /* needs more space? */
+          luaH_resizearray(L, h, last);  /* pre-allocate it at once */
+        for (; n > 0; n--) {
+          TValue *val = ra+n;
+          luaH_setint(L, h, last--, val);
+          luaC_barrierback(L, h, val);
+        }
+        L->top = ci->top;  /* correct top (in case of previous open call) */
+        vmbreak;
+      }
+      vmcase(OP_CLOSURE) {
+        luaV_closure(L, cl->p->p[GETARG_Bx(i)], cl->upvals, base, ra);
+        checkGC(L, ra + 1);
+        vmbreak;
+      }
+      vmcase(OP_VARARG) {
+        int b = GETARG_B(i) - 1;
+        int j;
+        int n = cast_int(base - ci->func) - cl->p->numparams - 1;
+        if (b < 0) {  /* B == 0? */
+          b = n;  /* get all var. arguments */
+          Protect(luaD_checkstack(L, n));
+          ra = RA(i);  /* previous call may change the stack */
+          L->top = ra + n;
+        }
+        for (j = 0; j < b; j++) {
+          if (j < n) {
+            setobjs2s(L, ra + j, base - n + j);
+          }
+          else {
+            setnilvalue(ra + j);
+          }
+        }
+        vmbreak;
+      }
+      vmcase(OP_EXTRAARG) {
+        lua_assert(0);
+        vmbreak;
+      }
+      vmcase(OP_ADDINT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, intop(+, ib, ic));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_ADD);
+        goto l_add;
+      }
+      vmcase(OP_ADDFLT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (fltoperands(rb, rc, &nb, &nc)) {
+          setfltvalue(ra, luai_numadd(L, nb, nc));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_ADD);
+        goto l_add;
+      }
+      vmcase(OP_SUBINT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, intop(-, ib, ic));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_SUB);
+        goto l_sub;
+      }
+      vmcase(OP_SUBFLT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (fltoperands(rb, rc, &nb, &nc)) {
+          setfltvalue(ra, luai_numsub(L, nb, nc));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_SUB);
+        goto l_sub;
+      }
+      vmcase(OP_MULINT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          lua_Integer ib = ivalue(rb); lua_Integer ic = ivalue(rc);
+          setivalue(L, ra, intop(*, ib, ic));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_MUL);
+        goto l_mul;
+      }
+      vmcase(OP_MULFLT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (fltoperands(rb, rc, &nb, &nc)) {
+          setfltvalue(ra, luai_nummul(L, nb, nc));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_MUL);
+        goto l_mul;
+      }
+      vmcase(OP_DIVFLT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (tofltnum(rb, &nb) && tofltnum(rc, &nc)) {
+          setfltvalue(ra, luai_numdiv(L, nb, nc));
+          vmbreak;
+        }
+        unquicken(ci, i, OP_DIV);
+        goto l_div;
+      }
+      vmcase(OP_LTINT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        if (ttisinteger(rb) && ttisinteger(rc)) {
+          if ((ivalue(rb) < ivalue(rc)) != GETARG_A(i))
+            ci->u.l.savedpc++;
+          else
+            donextjump(ci);
+          vmbreak;
+        }
+        unquicken(ci, i, OP_LT);
+        goto l_lt;
+      }
+      vmcase(OP_LTFLT) {
+        TValue *rb = RKB(i);
+        TValue *rc = RKC(i);
+        lua_Number nb; lua_Number nc;
+        if (ttisfloat(rb) ? (nb = fltvalue(rb), tofloat(rc, &nc))
+                          : (ttisfloat(rc) && tofloat(rb, &nb) &&
+                             (nc = fltvalue(rc), 1))) {
+          if (luai_numlt(nb, nc) != GETARG_A(i))
+            ci->u.l.savedpc++;
+          else
+            donextjump(ci);
+          vmbreak;
+        }
+        unquicken(ci, i, OP_LT);
+        goto l_lt;
+      }
+      vmcase(OP_MOVEMOVE) {
+        setobjs2s(L, ra, RB(i));
+        fusenext(l_move);
+      }
+      vmcase(OP_MOVECALL) {
+        setobjs2s(L, ra, RB(i));
+        fusenext(l_call);
+      }
+      vmcase(OP_LOADKCALL) {
+        TValue *rb = k + GETARG_Bx(i);
+        setobj2s(L, ra, rb);
+        fusenext(l_call);
+      }
+      vmcase(OP_GETUPVALMOVE) {
+        setobj2s(L, ra, cl->upvals[GETARG_B(i)]->v);
+        fusenext(l_move);
+      }
+      vmcase(OP_GETTABUPMOVE) {
+        TValue *upval = cl->upvals[GETARG_B(i)]->v;
+        TValue *rc = RKC(i);
+        if (isfieldkey(GETARG_C(i), rc))
+          getfield(upval, rc)
+        else
+          Protect(luaV_gettable(L, upval, rc, ra));
+        fusenext(l_move);
+      }
+      vmcase(OP_GETTABUPGETTABLE) {
+        TValue *upval = cl->upvals[GETARG_B(i)]->v;
+        TValue *rc = RKC(i);
+        if (isfieldkey(GETARG_C(i), rc))
+          getfield(upval, rc)
+        else
+          Protect(luaV_gettable(L, upval, rc, ra));
+        fusenext(l_gettable);
+      }
+      vmcase(OP_SELFLOADK) {
+        StkId rb = RB(i);
+        TValue *rc = RKC(i);
+        setobjs2s(L, ra+1, rb);
+        if (isfieldkey(GETARG_C(i), rc))
+          getfield(rb, rc)
+        else
+          Protect(luaV_gettable(L, rb, rc, ra));
+        fusenext(l_loadk);
+      }
+    }
+  }
+}
@@ -0,0 +1,17 @@
+-- the allocator of luaL_newstate: shrinks that cross from one kind of
+-- block to another (from 'malloc' or a mapping to a slab block, from a
+-- mapping to 'malloc') must not fail when no new block can be had, and
+-- the block must then work as usual (needs a build with LUAI_ALLOCFAIL)
+
+if not T.allocshrink then print("OK") return end
+
+local cases = {
+  {1000, 100},  {1000, 256}, {257, 8},        -- malloc -> slab
+  {200000, 5000}, {131072, 257},              -- mapping -> malloc
+  {200000, 64}, {131072, 1},                  -- mapping -> slab
+  {200000, 150000}, {5000, 300}, {200, 100},  -- same kind
+}
+for _, c in ipairs(cases) do
+  assert(T.allocshrink(c[1], c[2]), c[1] .. " -> " .. c[2])
+end
+print("OK")
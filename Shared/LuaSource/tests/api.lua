@@ -0,0 +1,20 @@
+-- parts of the C API reached through table 'T' (see lua.c)
+
+-- 'lua_tolstring' on a string view in a C upvalue stores a copy there,
+-- which the collector must see even when the closure is old (or black)
+local big = string.rep("abcdefghij", 10)
+for _, mode in ipairs{"generational", "incremental"} do
+  collectgarbage(mode)
+  for round = 1, 20 do
+    local f = T.stringupvalue(big:sub(2, 61))   -- a view
+    for i = 1, round % 4 do collectgarbage("step") end   -- 'f' gets old
+    assert(f() == big:sub(2, 61))   -- makes the copy
+    for i = 1, 4 do collectgarbage("step") end
+    local junk = {}   -- reuse the memory of a lost copy
+    for i = 1, 200 do junk[i] = string.rep(string.char(65 + i % 26), 60) end
+    assert(f() == big:sub(2, 61))
+  end
+end
+collectgarbage("incremental")
+
+print "OK"
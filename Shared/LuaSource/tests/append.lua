@@ -0,0 +1,23 @@
+local t = {}
+for i = 1, 100000 do t[#t + 1] = i end
+print(#t, t[100000], t[65537])
+local h = {x = 1}
+for i = 40, 1, -1 do h[i] = i end
+for i = 1, 9 do h[#h + 1] = i end
+print(#h) for i = 1, 52 do io.write(tostring(h[i]), " ") end print()
+local c = 0 for k, v in pairs(h) do c = c + 1 end print(c)
+local u = {}
+for i = 1, 1000 do u[i] = i end
+print(#u); u[1000] = nil; print(#u); u[1000] = 1; u[1001] = 2; print(#u)
+for i = 1, 1001 do u[i] = nil end print(#u, next(u))
+local w = {n = 1}
+w[1] = 1; w[2] = nil; w[3] = 3
+print(#w == 1 or #w == 3)
+local s = {}
+for i = 1, 200 do s[#s+1] = "a" s[#s+1] = nil end
+print(#s)
+local big = {}
+for i = 1, 10 do big[i * 2] = i end
+for i = 1, 21 do big[#big + 1] = -i end
+print(#big, big[1], big[2], big[20], big[21])
+for i = 1, 5 do table.insert(big, 1, i) end print(#big, big[1], big[#big])
@@ -0,0 +1,81 @@
+-- exercise quickened arithmetic across type changes
+local function f(a, b) return a + b, a - b, a * b, a / b, a < b end
+local vals = {1, 2.5, -3, 0.0, math.maxinteger, math.mininteger, "10", "2.5", 1/0, -(0/0)}
+local out = {}
+for round = 1, 3 do
+  for _, a in ipairs(vals) do
+    for _, b in ipairs(vals) do
+      local ok, r1, r2, r3, r4, r5 = pcall(f, a, b)
+      out[#out+1] = string.format("%s %s %s %s %s %s %s", tostring(a), tostring(b), tostring(ok), tostring(r1), tostring(r2), tostring(r3), tostring(r4)) .. tostring(r5)
+    end
+  end
+end
+for i = 1, #out, 37 do print(out[i]) end
+print(#out)
+-- math.type stability
+local function g(x) return x * 2, x + 1, x - 1 end
+for _, v in ipairs{1, 1.0, 3, 3.5, 2^62, 7} do print(math.type((g(v))), g(v)) end
+-- metamethods at a quickened site
+local mt = {__add = function(a, b) return "add" end, __lt = function(a, b) return true end,
+            __div = function() return "div" end, __sub = function() return "sub" end, __mul = function() return "mul" end}
+local t = setmetatable({}, mt)
+local function h(a, b) return a + b, a / b, a - b, a * b, (a < b) end
+for i = 1, 5 do print(h(i, i + 0.5)) end
+print(h(t, 1)); print(h(1, t)); print(h(2, 3))
+-- error messages
+local function e(a, b) return a + b end
+for i = 1, 3 do e(1, 2) end
+print(pcall(e, 1, nil))
+print(pcall(e, {}, 1))
+local function lt(a, b) return a < b end
+for i = 1, 3 do lt(1, 2) end
+print(pcall(lt, 1, "x"))
+print(pcall(lt, {}, {}))
+-- comparison loops
+local c = 0
+for i = 1, 100 do if i < 50 then c = c + 1 end end
+local x = 0.0
+while x < 10 do x = x + 0.5 end
+print(c, x)
+-- string coercion in arithmetic
+local function s(a) return a + 1 end
+for i = 1, 3 do print(s(i), s("5"), s(2.5)) end
+-- string.dump roundtrip after quickening
+local function k(a, b) local r = 0 for i = 1, a do r = r + i * b / 2 if r < 0 then r = -r end end return r end
+print(k(100, 3), k(100, 2.5))
+local d = string.dump(k)
+local k2 = load(d, "k", "b")
+print(k2(100, 3), k2(100, 2.5))
+local d2 = string.dump(k)
+print(d == d2)
+-- coroutine yield inside metamethod of a quickened site
+local ymt = {__add = function(a, b) return coroutine.yield("y") end,
+             __lt = function(a, b) return coroutine.yield("lt") end}
+local y = setmetatable({}, ymt)
+local function cadd(a, b) return a + b end
+local function clt(a, b) if a < b then return "yes" else return "no" end end
+for i = 1, 3 do cadd(1, 2); clt(1, 2) end
+local co = coroutine.wrap(function() return cadd(y, 1), clt(y, 1) end)
+print(co()); print(co(42)); print(co(false))
+-- debug names
+local function dn() local a = {} ; return a + 1 end
+print(pcall(dn))
+print(select(2, pcall(function() local q; return 1 + q end)))
+-- integer overflow wraps
+local function ov(a) return a + 1, a * 2, a - 1 end
+print(ov(math.maxinteger)); print(ov(math.mininteger))
+-- hooks with quickened code
+local count = 0
+debug.sethook(function() count = count + 1 end, "", 1)
+local z = 0
+for i = 1, 1000 do z = z + i * 0.5 end
+debug.sethook()
+print(z, count > 1000)
+local lines = {}
+debug.sethook(function(ev, l) lines[#lines+1] = l end, "l")
+local w = 0
+for i = 1, 3 do
+  w = w + i
+end
+debug.sethook()
+print(#lines, w)
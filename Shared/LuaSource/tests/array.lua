@@ -0,0 +1,61 @@
+local a = array.new("float64", 5)
+assert(#a == 5 and a[1] == 0 and a[6] == nil and a[0] == nil)
+for i = 1, 5 do a[i] = i * 1.5 end
+assert(a[3] == 4.5 and a[3.0] == 4.5)
+assert(array.type(a) == "float64" and array.type({}) == nil)
+local b = array.new("int32", {1, 2, 3, -4})
+assert(#b == 4 and b[4] == -4 and math.type(b[1]) == "integer")
+b[1] = 2^31 | 0; assert(b[1] == -2^31)
+b[2] = 3.0; assert(b[2] == 3)
+assert(not pcall(function() b[2] = 3.5 end))
+assert(not pcall(function() b[2] = "x" end))
+assert(not pcall(function() b[5] = 1 end))
+assert(not pcall(function() b[0] = 1 end))
+local ok, msg = pcall(function() b[1] = {} end); print(msg)
+ok, msg = pcall(function() b[9] = 1 end); print(msg)
+local u = array.new("uint8", 4)
+u[1] = 257; assert(u[1] == 1); u[2] = -1; assert(u[2] == 255)
+u:fill(7); assert(u[1] == 7 and u[4] == 7)
+u:fill(9, 2, 3); assert(u[1] == 7 and u[2] == 9 and u[3] == 9 and u[4] == 7)
+local f = array.new("float32", 3); f[1] = 0.1; assert(f[1] ~= 0.1 and math.abs(f[1]-0.1) < 1e-7)
+local s = a:slice(2, 4)
+assert(#s == 3 and s[1] == 3.0); s[1] = 100; assert(a[2] == 100)
+a = nil; collectgarbage(); collectgarbage()
+assert(s[3] == 6.0)
+local bytes = b:tobytes()
+assert(#bytes == 16)
+assert(select(1, string.unpack("<i4", bytes)) == -2^31)
+local b2 = array.frombytes("int32", bytes)
+for i = 1, 4 do assert(b2[i] == b[i]) end
+assert(not pcall(array.frombytes, "int32", "abc"))
+local t = b:totable(); assert(#t == 4 and t[3] == 3)
+local m = array.new("float64", {1,2,3,4,5})
+m:move(1, 3, 3); assert(m[3] == 1 and m[4] == 2 and m[5] == 3)
+local m2 = array.new("int32", 5)
+array.move(m, 1, 5, 1, m2); assert(m2[5] == 3)
+assert(not pcall(array.move, m, 1, 5, 2, m2))
+assert(not pcall(array.move, m, 1, 6, 1, m2))
+assert(tostring(m):match("^float64 array %(5%)"), tostring(m))
+-- io round trip
+local fn = os.tmpname()
+local fh = io.open(fn, "wb"); fh:write(m, "x"); fh:close()
+fh = io.open(fn, "rb")
+local r = array.new("float64", 5)
+assert(fh:read(r) == 5); assert(r[5] == 3); assert(fh:read(1) == "x")
+assert(fh:read(r) == nil); fh:close(); os.remove(fn)
+-- no elements, also over NULL (from 'lua_pusharray')
+for _, e in ipairs{array.new("float64", 0), T.emptyarray("float64"),
+                   T.emptyarray("float32")} do
+  assert(#e == 0 and e[1] == nil and array.type(e))
+  assert(tostring(e):match("^%w+ array %(0%): "))
+  assert(math.vsqrt(e, e) == e and math.vmin(e, e, 1) == e)
+  fh = io.open(fn, "wb"); assert(fh:write("a", e, "b") == fh); fh:close()
+  fh = io.open(fn, "rb"); assert(fh:read(e) == 0 and fh:read("a") == "ab")
+  assert(fh:read(e) == nil); fh:close(); os.remove(fn)
+end
+-- loops
+local big = array.new("float64", 1000)
+for i = 1, #big do big[i] = i end
+local sum = 0; for i = 1, #big do sum = sum + big[i] end
+assert(sum == 500500)
+print("OK")
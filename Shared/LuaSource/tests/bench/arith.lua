@@ -0,0 +1,92 @@
+-- numeric loops of the kind the modeling scripts run: float and integer
+-- arithmetic, arithmetic with constants, comparisons, and float math on
+-- the fields of bounding boxes and vec3-like records. Prints the best
+-- of 3 runs of each loop; compare builds to see the effect of the
+-- quickened opcodes (LUA_NOJIT isolates the interpreter)
+--
+-- usage: lua bench/arith.lua [iterations]
+
+local N = tonumber(arg[1]) or 10000000
+
+local function bench (name, f)
+  local best = math.huge
+  for r = 1, 3 do
+    collectgarbage()
+    local t0 = os.clock()
+    f(N)
+    best = math.min(best, os.clock() - t0)
+  end
+  print(string.format("%-10s %7.3f s  %6.1f Miter/s", name, best,
+                      N / best / 1e6))
+end
+
+-- float + float, float * float
+bench("float", function (n)
+  local x, y, d = 0.0, 1.0, 0.5
+  for i = 1, n do
+    x = x + d * y
+    y = y - d / x
+  end
+  return x + y
+end)
+
+-- integer + integer, integer * integer
+bench("int", function (n)
+  local a, b = 0, 1
+  for i = 1, n do
+    a = a + i * b
+    b = b - a
+  end
+  return a + b
+end)
+
+-- float against constants (RK operands)
+bench("floatk", function (n)
+  local x = 0.5
+  for i = 1, n do
+    x = x * 0.999 + 1.5
+    x = x - 0.25
+  end
+  return x
+end)
+
+-- float and integer comparisons
+bench("compare", function (n)
+  local lo, hi, c = 0.0, 1.0, 0
+  for i = 1, n do
+    local v = (i % 100) * 0.01
+    if v < lo then lo = v end
+    if hi < v then hi = v end
+    if c < i then c = c + 1 end
+  end
+  return lo + hi + c
+end)
+
+-- growing a bounding box by points
+bench("bbox", function (n)
+  local box = {minx = 0.0, miny = 0.0, maxx = 0.0, maxy = 0.0}
+  local p = {x = 0.0, y = 0.0}
+  for i = 1, n do
+    p.x = p.x + 0.37
+    p.y = p.y - 0.21
+    if p.x < box.minx then box.minx = p.x end
+    if box.maxx < p.x then box.maxx = p.x end
+    if p.y < box.miny then box.miny = p.y end
+    if box.maxy < p.y then box.maxy = p.y end
+  end
+  return box.maxx - box.minx
+end)
+
+-- length and normalization of a vec3-like record, in place
+bench("vec3", function (n)
+  local v = {x = 1.0, y = 2.0, z = 3.0}
+  local s = 0.0
+  for i = 1, n do
+    local len = (v.x * v.x + v.y * v.y + v.z * v.z) ^ 0.5
+    v.x = v.x / len + 0.1
+    v.y = v.y / len - 0.2
+    v.z = v.z / len + 0.3
+    s = s + len
+  end
+  return s
+end)
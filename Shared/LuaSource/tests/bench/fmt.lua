@@ -0,0 +1,43 @@
+-- float formatting throughput: tostring and the common conversions of
+-- string.format on random floats of mixed magnitudes. Prints the best of
+-- 3 runs of each, in millions of conversions per second
+--
+-- usage: lua bench/fmt.lua [conversions]
+
+local N = tonumber(arg[1]) or 2000000
+local fmt = string.format
+
+math.randomseed(18)
+local vals = {}
+for i = 1, 1000 do vals[i] = (math.random() - 0.5) * 10 ^ math.random(-6, 8) end
+
+local function bench (name, f)
+  local best = math.huge
+  for r = 1, 3 do
+    collectgarbage()
+    local t0 = os.clock()
+    f()
+    best = math.min(best, os.clock() - t0)
+  end
+  print(fmt("%-28s %6.2f M/s", name, N / best / 1e6))
+end
+
+local function conv (form)
+  return function ()
+    for i = 1, N do local s = fmt(form, vals[i % 1000 + 1]) end
+  end
+end
+
+bench("tostring(x)", function ()
+  for i = 1, N do local s = tostring(vals[i % 1000 + 1]) end
+end)
+bench('format("%.6f")', conv("%.6f"))
+bench('format("%g")', conv("%g"))
+bench('format("%.17g")', conv("%.17g"))
+bench('format("%.3e")', conv("%.3e"))
+bench('format("v %.6f %.6f %.6f")', function ()
+  for i = 1, N // 3 do
+    local s = fmt("v %.6f %.6f %.6f", vals[i % 1000 + 1],
+                  vals[(i + 1) % 1000 + 1], vals[(i + 2) % 1000 + 1])
+  end
+end)
@@ -0,0 +1,14 @@
+-- allocation and freeing of typical small objects
+--
+-- usage: lua bench/gc/alloc.lua [iterations]
+
+local N = tonumber(arg[1]) or 3000000
+local t0 = os.clock()
+local keep = {}
+for i = 1, N do
+  local o = {x = i, y = i}           -- table + small hash part
+  local f = function() return o end   -- closure + upvalue
+  local s = "k" .. (i % 5000)         -- short string
+  keep[i % 4096 + 1] = {o, f, s}      -- array of 3
+end
+print(string.format("churn %.2fs", os.clock() - t0))
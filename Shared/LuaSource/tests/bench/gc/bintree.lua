@@ -0,0 +1,21 @@
+-- binary trees: many short-lived trees next to one long-lived tree
+--
+-- usage: lua bench/gc/bintree.lua [depth]
+
+local function bottomup(d)
+  if d == 0 then return {} end
+  d = d - 1
+  return {bottomup(d), bottomup(d)}
+end
+local function check(t)
+  if t[1] then return 1 + check(t[1]) + check(t[2]) end
+  return 1
+end
+local N = tonumber(arg[1]) or 15
+local long = bottomup(N)
+local sum = 0
+for d = 4, N, 2 do
+  local iters = 2 ^ (N - d + 4)
+  for i = 1, iters do sum = sum + check(bottomup(d)) end
+end
+print(sum, check(long))
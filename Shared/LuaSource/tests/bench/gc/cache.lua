@@ -0,0 +1,15 @@
+-- a big long-lived table updated slowly while temporaries churn; in
+-- generational mode each minor collection traverses the whole table
+--
+-- usage: lua bench/gc/cache.lua
+
+local cache = {}
+for i = 1, 300000 do cache[i] = {id = i, name = "item" .. i} end
+local acc = 0
+for r = 1, 3000000 do
+  local k = r % 300000 + 1
+  local tmp = {x = r, y = r * 2, z = cache[k].id}
+  acc = acc + tmp.z
+  if r % 50 == 0 then cache[k] = {id = k, name = "item" .. k} end
+end
+print(acc)
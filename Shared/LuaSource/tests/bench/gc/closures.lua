@@ -0,0 +1,17 @@
+-- closures and short-lived objects (upvalues closed on return)
+--
+-- usage: lua bench/gc/closures.lua
+
+local function counter(start)
+  local n = start
+  return function(d) n = n + d; return n end
+end
+local live = {}
+for i = 1, 20000 do live[i] = counter(i) end
+local s = 0
+for r = 1, 2000000 do
+  local c = counter(r)
+  s = s + c(1) + live[r % 20000 + 1](0)
+  local t = {r, c}
+end
+print(s)
@@ -0,0 +1,37 @@
+-- fragmentation: build mixed-size objects, free every other one, keep
+-- churning, then collect and report what the process still holds
+--
+-- usage: lua bench/gc/frag.lua
+
+local t0 = os.clock()
+local live = {}
+for r = 1, 6 do
+  for i = 1, 400000 do
+    local k = (i * 7919) % 400000 + 1
+    if i % 2 == 0 then live[k] = nil
+    else
+      local n = i % 9
+      local v = {}
+      for j = 1, n do v[j] = j end
+      live[k] = {v, ("s"):rep(i % 40) .. r}
+    end
+  end
+end
+live = nil
+collectgarbage(); collectgarbage()
+local small = {}
+for i = 1, 100000 do small[i] = {i} end
+io.write(string.format("frag %.2fs  heap %.1f MB", os.clock() - t0,
+                       collectgarbage("count") / 1024))
+-- resident memory (Linux only): now and peak
+local f = io.open("/proc/self/status")
+if f then
+  for l in f:lines() do
+    local k, v = l:match("^Vm(%u%u%u):%s*(%d+)")
+    if k == "RSS" or k == "HWM" then
+      io.write(string.format("  %s %.0f MB", k, v / 1024))
+    end
+  end
+  f:close()
+end
+print()
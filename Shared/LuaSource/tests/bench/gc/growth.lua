@@ -0,0 +1,9 @@
+-- a structure that only grows (little garbage)
+--
+-- usage: lua bench/gc/growth.lua
+
+local t = {}
+for i = 1, 1500000 do t[i] = {i, i * 2} end
+local s = 0
+for i = 1, #t, 7 do s = s + t[i][2] end
+print(s)
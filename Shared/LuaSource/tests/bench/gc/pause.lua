@@ -0,0 +1,30 @@
+-- GC pauses: builds a big live heap, then churns short-lived garbage
+-- (some of it stored into old objects) for 20 s, recording the gaps
+-- between units of ~200 allocations
+--
+-- usage: [LUA_GEN=n] [LUA_PEAK=1] lua bench/gc/pause.lua [live tables]
+
+local N = tonumber(arg and arg[1]) or 3000000
+local live = {}
+for i = 1, N do live[i] = {i, tostring(i)} end
+collectgarbage(); collectgarbage()
+local heap = collectgarbage("count") / 1024
+local gaps = {}
+local clock = os.clock
+local t0 = clock()
+local last = t0
+local iters = 0
+while clock() - t0 < 20 do
+  for j = 1, 200 do
+    local t = {j, j + 1, {}}
+    if j % 50 == 0 then live[(iters * 7 + j) % N + 1][1] = {t, "x" .. j} end
+  end
+  local now = clock()
+  gaps[#gaps + 1] = now - last
+  last = now
+  iters = iters + 1
+end
+table.sort(gaps)
+local function pct(p) return gaps[math.max(1, math.floor(#gaps * p))] * 1000 end
+io.write(string.format("heap %.0f MB  units %d  p50 %.3f  p99 %.3f  p99.9 %.2f  max %.1f ms\n",
+  heap, #gaps, pct(0.5), pct(0.99), pct(0.999), gaps[#gaps] * 1000))
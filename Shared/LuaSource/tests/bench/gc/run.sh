@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# GC and allocator benchmarks
+#
+# usage: tests/bench/gc/run.sh [benchmark ...]
+#
+# Builds the interpreter in tests/lua.c and runs each benchmark three
+# times in incremental and in generational mode (LUA_GEN=0), printing
+# the best CPU time and the peak of allocated memory. 'alloc' and
+# 'frag' run instead with the realloc-based allocator of lua.c and with
+# the allocator of luaL_newstate (LUA_ALLOC=aux), printing their own
+# numbers. 'pause' and 'steptime' take 20 s and 6 s per run and are not
+# run by default; see their headers for their arguments.
+#
+# Environment:
+#   CC        compiler (default cc)
+#   CFLAGS    extra flags (default -O2)
+
+cd "$(dirname "$0")" || exit 1
+
+CC=${CC:-cc}
+case $(uname) in
+  Darwin) PLAT="-DLUA_USE_MACOSX" ;;
+  *) PLAT="-DLUA_USE_LINUX"; LIBS="-ldl" ;;
+esac
+
+[ $# -gt 0 ] || set -- bintree closures strings cache growth alloc frag
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+lua="$TMP/lua"
+if ! $CC -std=gnu99 ${CFLAGS:--O2} -DLUA_COMPAT_5_2 $PLAT -I../../.. \
+     -o "$lua" ../../../l*.c ../../lua.c -lm $LIBS; then
+  echo "build failed"
+  exit 1
+fi
+
+# best of three runs: "peak P MB  time T s" with the lowest T
+best () {
+  for k in 1 2 3; do
+    env LUA_PEAK=1 "$@" > /dev/null 2>> "$TMP/runs" || return 1
+  done
+  sort -n -k5 "$TMP/runs" | head -1
+  rm -f "$TMP/runs"
+}
+
+for b in "$@"; do
+  case $b in
+    alloc|frag)
+      printf "%-9s realloc  %s\n" $b "$("$lua" $b.lua)"
+      printf "%-9s slab     %s\n" $b "$(LUA_ALLOC=aux "$lua" $b.lua)" ;;
+    pause|steptime)
+      printf "%-9s inc      %s\n" $b "$(LUA_PEAK=1 "$lua" $b.lua 2>&1)"
+      printf "%-9s gen      %s\n" $b "$(LUA_GEN=0 LUA_PEAK=1 "$lua" $b.lua 2>&1)" ;;
+    *)
+      printf "%-9s inc      %s\n" $b "$(best "$lua" $b.lua)"
+      printf "%-9s gen      %s\n" $b "$(best LUA_GEN=0 "$lua" $b.lua)" ;;
+  esac
+done
@@ -0,0 +1,41 @@
+-- time-bounded GC steps: a live heap in 1000-entry blocks plus churn
+-- for 6 s, reporting the step-time statistics of the collector
+--
+-- usage: lua bench/gc/steptime.lua [live tables] [steptime us] [overhead]
+
+local N = tonumber(arg[1]) or 1000000
+local ST = tonumber(arg[2]) or 0
+collectgarbage("steptime", ST)
+collectgarbage("overhead", tonumber(arg[3]) or 100)
+collectgarbage("timing", 1)
+local live = {}
+for c = 1, N // 1000 do
+  local b = {}
+  for i = 1, 1000 do b[i] = {i, tostring(i)} end
+  live[c] = b
+end
+collectgarbage(); collectgarbage("stats", 1)
+local heap = collectgarbage("count") / 1024
+local peak = heap
+local t0 = os.clock()
+local iters = 0
+while os.clock() - t0 < 6 do
+  for j = 1, 200 do
+    local t = {j, j + 1, {}}
+    if j % 50 == 0 then
+      local b = live[(iters * 7 + j) % #live + 1]
+      b[j % 1000 + 1] = {t, "x" .. j}
+    end
+  end
+  iters = iters + 1
+  if iters % 100 == 0 then
+    local m = collectgarbage("count") / 1024
+    if m > peak then peak = m end
+  end
+end
+local s = collectgarbage("stats")
+io.write(string.format("steptime %d  heap %.0f MB  peak %.0f MB  units %d\n",
+                       ST, heap, peak, iters))
+io.write(string.format("steps %d  cycles %d  p50 %d  p99 %d  max %d us" ..
+                       "  total %.2f s\n", s.steps, s.cycles, s.p50, s.p99,
+                       s.max, s.time / 1e6))
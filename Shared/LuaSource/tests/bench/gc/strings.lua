@@ -0,0 +1,14 @@
+-- string churn with a live set of records
+--
+-- usage: lua bench/gc/strings.lua
+
+local recs = {}
+for i = 1, 100000 do recs[i] = {key = "k" .. i, n = i} end
+local total = 0
+for r = 1, 30 do
+  for i = 1, #recs, 3 do
+    local s = recs[i].key .. ":" .. r .. ":" .. (i * r)
+    total = total + #s
+  end
+end
+print(total)
@@ -0,0 +1,72 @@
+-- inserts and lookups in the hash part of tables, with string, integer
+-- and mixed keys: 'insert' builds a table of N keys 10 times, 'lookup'
+-- reads all its keys 20 times (plus as many missing keys), 'small'
+-- builds N/2 tables of 12 fields. Prints the best of 3 runs; compare a
+-- default build with a LUA_SWISSTABLE one
+--
+-- usage: lua bench/hash.lua [keys]
+
+local N = tonumber(arg[1]) or 200000
+
+local function bench (name, f, ...)
+  local best = math.huge
+  for r = 1, 3 do
+    collectgarbage()
+    local t0 = os.clock()
+    f(...)
+    best = math.min(best, os.clock() - t0)
+  end
+  return best
+end
+
+-- integer keys are spread out so that they all go to the hash part
+local kinds = {
+  string = function (i) return "key" .. i end,
+  integer = function (i) return i * 7919 end,
+  mixed = function (i)
+    local m = i % 3
+    return m == 0 and "k" .. i or m == 1 and i * 7919 or i + 0.5
+  end,
+}
+
+local function keys (kind, n, from)
+  local k, mk = {}, kinds[kind]
+  for i = 1, n do k[i] = mk(from + i) end
+  return k
+end
+
+local function insert (k)
+  for r = 1, 10 do
+    local t = {}
+    for i = 1, #k do t[k[i]] = i end
+  end
+end
+
+local function lookup (k, miss)
+  local t = {}
+  for i = 1, #k do t[k[i]] = i end
+  local s = 0
+  for r = 1, 20 do
+    for i = 1, #k do s = s + t[k[i]] end
+    for i = 1, #miss do if t[miss[i]] then s = s + 1 end end
+  end
+  return s
+end
+
+local function small (k)
+  local n = 0
+  for r = 1, N // 2 do
+    local t = {}
+    for i = 1, 12 do t[k[i]] = i end
+    n = n + #t
+  end
+  return n
+end
+
+print(string.format("%-8s %8s %8s %8s", "keys", "insert", "lookup", "small"))
+for _, kind in ipairs{"string", "integer", "mixed"} do
+  local k = keys(kind, N, 0)
+  local miss = keys(kind, N, N)
+  print(string.format("%-8s %8.3f %8.3f %8.3f", kind, bench(kind, insert, k),
+                      bench(kind, lookup, k, miss), bench(kind, small, k)))
+end
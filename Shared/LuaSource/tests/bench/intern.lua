@@ -0,0 +1,53 @@
+-- string hashing: interning identifier-style strings, looking them up
+-- as table keys, and using long OBJ lines that differ only in a few
+-- digits as keys (which collide if the hash skips bytes). Prints the
+-- best of 3 runs of each part
+--
+-- usage: lua bench/intern.lua [strings]
+
+local N = tonumber(arg[1]) or 200000
+
+local function bench (name, f)
+  local best = math.huge
+  for r = 1, 3 do
+    collectgarbage()
+    local t0 = os.clock()
+    f()
+    best = math.min(best, os.clock() - t0)
+  end
+  print(string.format("%-16s %7.3f s", name, best))
+end
+
+local fmt = string.format
+
+-- creating (interning) short strings
+bench("intern", function ()
+  local t = {}
+  for i = 1, N do t[i] = fmt("mesh_%d_vertex_%d", i % 97, i) end
+end)
+
+-- looking up existing short strings as keys
+local keys, set = {}, {}
+for i = 1, N do
+  keys[i] = fmt("mesh_%d_vertex_%d", i % 97, i)
+  set[keys[i]] = i
+end
+bench("short lookups", function ()
+  local s = 0
+  for r = 1, 5 do
+    for i = 1, N do s = s + set[keys[i]] end
+  end
+  return s
+end)
+
+-- long strings (hashed when first used as keys) of the same length
+local lines = {}
+for i = 1, N // 2 do
+  lines[i] = fmt("v %.6f %.6f %.6f # vertex %9d", 1.5, -2.25, 3.125, i)
+end
+assert(#lines[1] > 40)
+bench("long-line keys", function ()
+  local t = {}
+  for i = 1, #lines do t[lines[i]] = i end
+  return t
+end)
@@ -0,0 +1,116 @@
+-- a modeling workload in the style of the examples in README.md: shapes
+-- set up through command objects, objects placed in bounding boxes, and
+-- a wall of bricks built with a per-brick callback. 'command' and 'bbox'
+-- are minimal stand-ins for the public modules of the app, which only
+-- record what the Swift side would receive.
+--
+-- usage: lua bench/model.lua [walls]
+
+local dir = arg[0]:match("^(.*/)") or "./"
+local vec3 = dofile(dir .. "../../../Files/lua/vec3.lua")
+local N = tonumber(arg[1]) or 200
+
+local executed = 0
+
+local Command = {}
+Command.__index = Command
+
+command = {}
+
+function command:newShape (shape)
+  return setmetatable({shape = shape, params = {}}, Command)
+end
+
+function Command:set (key, x, y, z)
+  if y then x = vec3(x, y, z) end
+  self.params[key] = x
+end
+
+function Command:getVec3 (key)
+  local v = self.params[key] or vec3(0, 0, 0)
+  return vec3(v.x, v.y, v.z)
+end
+
+function Command:setVec3 (key, v) self.params[key] = v end
+function Command:setNumber (key, n) self.params[key] = n end
+function Command:execute (index) executed = executed + 1 end
+
+bbox = {}
+bbox.__index = bbox
+
+function bbox:new (center, size, rotation)
+  center = center or vec3(0, 0, 0)
+  size = size or vec3(5, 5, 5)
+  local b = setmetatable({center = center, size = size,
+                          rotation = rotation or vec3(0, 0, 0)}, bbox)
+  b.left, b.right = center.x - size.x / 2, center.x + size.x / 2
+  b.bottom, b.top = center.y - size.y / 2, center.y + size.y / 2
+  b.front, b.back = center.z - size.z / 2, center.z + size.z / 2
+  return b
+end
+
+function bbox:execute (cmd, index)
+  cmd:set("rotation", self.rotation)
+  cmd:execute(index)
+end
+
+-- the "Sphere" object of README.md
+local function buildObject (index, bb, options)
+  local radius = options.radius or 1.0
+  local cmd = command:newShape("Sphere")
+  cmd:set("position", bb.center)
+  cmd:set("radius", radius)
+  bb:execute(cmd, index)
+end
+
+local function wall (from, to, brick, height, f)
+  local len = (to - from):len()
+  local dir = (to - from):normalize()
+  local columns = math.floor(len / brick.x)
+  local rows = math.floor(height / brick.y)
+  for row = 0, rows - 1 do
+    for column = 0, columns - 1 do
+      local offset = (row % 2 == 0) and 0 or brick.x / 2
+      local p = from + dir * (column * brick.x + offset)
+      local cmd = command:newShape("Box")
+      cmd:set("position", p.x, row * brick.y + brick.y / 2, p.z)
+      cmd:set("size", brick.x, brick.y, brick.z)
+      f(cmd, column, row)
+    end
+  end
+end
+
+math.randomseed(1)
+for w = 1, N do
+  local bb = bbox:new()
+
+  local box = command:newShape("Box")
+  box:set("position", bb.center)
+  box:set("size", 1, 1, 1)
+  box:set("rounding", 0.1)
+  box:set("color", 1, 0, 0)
+  box:set("roughness", 0.2)
+  box:execute(0)
+
+  for i = 1, 12 do
+    local a = i / 12 * 2 * math.pi
+    local pos = vec3(bb.center.x + math.cos(a) * (bb.right - bb.center.x) / 2,
+                     bb.center.y, bb.center.z + math.sin(a) * 2)
+    local size = vec3(bb.right - bb.center.x, bb.size.y, bb.size.z) * 0.1
+    buildObject(1, bbox:new(pos, size), {radius = 0.5 + i / 24})
+  end
+
+  wall(vec3(-2.3, 0, -2), vec3(2.5, 0, -2), vec3(0.40, 0.30, 0.30), 4.6,
+       function (cmd, column, row)
+         local rotation = cmd:getVec3("rotation")
+         rotation.y = rotation.y + 40 * (math.random() - 0.5)
+         cmd:setVec3("rotation", rotation)
+         local rand = math.random() / 2
+         local color = vec3(0.9 * rand, 0.9 * rand, 0.9 * rand)
+         cmd:setVec3("color", color)
+         cmd:setNumber("roughness", 0.2)
+         cmd:setNumber("specular", 1)
+         cmd:execute(5)
+       end)
+end
+print(executed .. " commands")
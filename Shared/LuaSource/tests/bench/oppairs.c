@@ -0,0 +1,154 @@
+/*
+** $Id: oppairs.c $
+** Dynamic opcode and opcode-pair frequencies of Lua scripts
+** See Copyright Notice in lua.h
+*/
+
+/*
+** Usage: oppairs [-n count] script.lua [args]
+**
+** Build (from this directory):
+**   cc -O2 -DLUA_USE_LINUX -DLUA_NOJIT -I../.. -o oppairs ../../l*.c \
+**      oppairs.c -lm -ldl
+**
+** Runs the script with a count hook on every instruction and prints
+** the 'count' (default 20) most frequent opcodes and pairs of opcodes.
+** A pair is two instructions that run one right after the other in the
+** same call, the second at the next pc, which is what a superinstruction
+** can fuse. Quickened and fused instructions are counted as their
+** generic opcodes; a '*' marks the pairs that 'luaK_fuse' already fuses.
+** The last line gives the instructions that still need a dispatch of
+** their own when the marked pairs are fused.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lstate.h"
+
+
+static unsigned long long opcount[NUM_OPCODES];
+static unsigned long long paircount[NUM_OPCODES][NUM_OPCODES];
+static unsigned char pairfused[NUM_OPCODES][NUM_OPCODES];
+static unsigned long long total = 0;
+static unsigned long long nfused = 0;
+
+static const CallInfo *lastci = NULL;
+static const Instruction *lastpc = NULL;
+static OpCode lastop;
+static int lastfused;
+
+
+static void hook (lua_State *L, lua_Debug *ar) {
+  const CallInfo *ci = ar->i_ci;
+  const Instruction *pc = ci->u.l.savedpc - 1;  /* instruction to run */
+  OpCode op = GET_BASEOP(*pc);
+  (void)L;
+  opcount[op]++;
+  total++;
+  if (ci == lastci && pc == lastpc + 1) {  /* fell through from 'lastpc'? */
+    paircount[lastop][op]++;
+    if (lastfused) {
+      pairfused[lastop][op] = 1;
+      nfused++;
+    }
+  }
+  lastci = ci;
+  lastpc = pc;
+  lastop = op;
+  lastfused = (OP_MOVEMOVE <= GET_OPCODE(*pc) &&
+               GET_OPCODE(*pc) <= OP_SELFLOADK);
+}
+
+
+typedef struct Entry {
+  unsigned long long n;
+  int a, b;
+} Entry;
+
+
+static int cmpentry (const void *x, const void *y) {
+  const Entry *ex = (const Entry *)x;
+  const Entry *ey = (const Entry *)y;
+  return (ex->n < ey->n) - (ex->n > ey->n);
+}
+
+
+static void report (int count) {
+  static Entry e[NUM_OPCODES * NUM_OPCODES];
+  int n = 0;
+  int a, b, i;
+  printf("instructions: %llu\n\nopcodes:\n", total);
+  for (a = 0; a < NUM_OPCODES; a++) {
+    if (opcount[a] > 0) {
+      e[n].n = opcount[a]; e[n].a = a; e[n++].b = 0;
+    }
+  }
+  qsort(e, n, sizeof(Entry), cmpentry);
+  for (i = 0; i < n && i < count; i++)
+    printf("  %-10s %13llu %6.2f%%\n", luaP_opnames[e[i].a], e[i].n,
+                                       100.0 * e[i].n / total);
+  printf("\npairs:\n");
+  n = 0;
+  for (a = 0; a < NUM_OPCODES; a++) {
+    for (b = 0; b < NUM_OPCODES; b++) {
+      if (paircount[a][b] > 0) {
+        e[n].n = paircount[a][b]; e[n].a = a; e[n++].b = b;
+      }
+    }
+  }
+  qsort(e, n, sizeof(Entry), cmpentry);
+  for (i = 0; i < n && i < count; i++)
+    printf("  %-10s %-10s %13llu %6.2f%% %s\n", luaP_opnames[e[i].a],
+           luaP_opnames[e[i].b], e[i].n, 100.0 * e[i].n / total,
+           pairfused[e[i].a][e[i].b] ? "*" : "");
+  printf("\ndispatches with the marked pairs fused: %llu (%.1f%% fewer)\n",
+         total - nfused, total ? 100.0 * nfused / total : 0.0);
+}
+
+
+int main (int argc, char **argv) {
+  lua_State *L;
+  int count = 20;
+  int status;
+  int i;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+    count = atoi(argv[2]);
+    argv += 2; argc -= 2;
+  }
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s [-n count] script.lua [args]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  L = luaL_newstate();
+  if (L == NULL) {
+    fprintf(stderr, "%s: cannot create state\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  luaL_openlibs(L);
+  lua_createtable(L, argc, 0);
+  for (i = 0; i < argc; i++) {
+    lua_pushstring(L, argv[i]);
+    lua_rawseti(L, -2, i - 1);
+  }
+  lua_setglobal(L, "arg");
+  status = luaL_loadfile(L, argv[1]);
+  if (status == LUA_OK) {
+    lua_sethook(L, hook, LUA_MASKCOUNT, 1);
+    status = lua_pcall(L, 0, 0, 0);
+    lua_sethook(L, NULL, 0, 0);
+  }
+  if (status != LUA_OK)
+    fprintf(stderr, "%s\n", lua_tostring(L, -1));
+  else
+    report(count);
+  lua_close(L);
+  return (status == LUA_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,86 @@
+-- parsing text read whole with io.read("a"): an OBJ model (vertex and
+-- face lines) and a CSV table with a long text column, split into lines
+-- and fields with gmatch and converted with tonumber. Prints the best of
+-- 3 runs and the most memory in use while parsing (sampled with
+-- collectgarbage("count") every 1000 lines); long fields and lines are
+-- string views, so compare with a build before them. LUA_PEAK=1 adds
+-- the peak of the allocator
+--
+-- usage: lua bench/parse.lua [lines]
+
+local N = tonumber(arg[1]) or 200000
+local fmt = string.format
+
+local function writefile (name, f)
+  local fh = assert(io.open(name, "w"))
+  local b = string.buffer()
+  f(b)
+  fh:write(b)
+  fh:close()
+end
+
+local obj, csv = os.tmpname(), os.tmpname()
+writefile(obj, function (b)
+  for i = 1, N do
+    b:putf("v %.6f %.6f %.6f\n", i * 0.001, -i * 0.002, i * 0.0005)
+  end
+  for i = 1, N - 2 do b:putf("f %d %d %d\n", i, i + 1, i + 2) end
+end)
+writefile(csv, function (b)
+  local text = string.rep("lorem ipsum dolor sit amet ", 5)
+  for i = 1, N do b:putf("%d,%s%d,%.2f\n", i, text, i, i / 7) end
+end)
+
+local peak
+local function sample (i)
+  if i % 1000 == 0 then
+    local m = collectgarbage("count")
+    if m > peak then peak = m end
+  end
+end
+
+local function parseobj (s)
+  local v, f, i = {}, {}, 0
+  for line in s:gmatch("[^\n]+") do
+    i = i + 1; sample(i)
+    local kind, a, b, c = line:match("^(%a+) (%S+) (%S+) (%S+)")
+    if kind == "v" then
+      v[#v + 1] = {tonumber(a), tonumber(b), tonumber(c)}
+    elseif kind == "f" then
+      f[#f + 1] = {tonumber(a), tonumber(b), tonumber(c)}
+    end
+  end
+  return #v + #f
+end
+
+local function parsecsv (s)
+  local rows, i, sum = {}, 0, 0
+  for line in s:gmatch("[^\n]+") do
+    i = i + 1; sample(i)
+    local id, text, x = line:match("^([^,]*),([^,]*),([^,]*)")
+    rows[#rows + 1] = {id = tonumber(id), text = text}
+    sum = sum + x
+  end
+  return #rows
+end
+
+local function bench (name, file, parse)
+  local best, worst = math.huge, 0
+  for r = 1, 3 do
+    collectgarbage()
+    peak = collectgarbage("count")
+    local t0 = os.clock()
+    local fh = assert(io.open(file))
+    local n = parse(fh:read("a"))
+    fh:close()
+    best = math.min(best, os.clock() - t0)
+    worst = math.max(worst, peak)
+    assert(n > 0)
+  end
+  print(fmt("%-4s %7.3f s   peak heap %8.1f MB", name, best, worst / 1024))
+end
+
+bench("OBJ", obj, parseobj)
+bench("CSV", csv, parsecsv)
+os.remove(obj)
+os.remove(csv)
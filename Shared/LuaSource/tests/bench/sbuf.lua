@@ -0,0 +1,46 @@
+-- building a large string (OBJ-style vertex lines) piece by piece: with
+-- a string.buffer ('put' of the parts, 'putf' of a whole line), with a
+-- table of parts and table.concat, and with '..' on a growing string
+-- (on a tenth of the lines, as it is quadratic). Prints the best of 3
+-- runs of each and the memory in use right after building
+--
+-- usage: lua bench/sbuf.lua [lines]
+
+local N = tonumber(arg[1]) or 200000
+
+local function bench (name, n, f)
+  local best, mem = math.huge, 0
+  for r = 1, 3 do
+    collectgarbage()
+    local t0 = os.clock()
+    local s = f(n)
+    best = math.min(best, os.clock() - t0)
+    mem = collectgarbage("count")
+    assert(#s > n)
+  end
+  print(string.format("%-14s %8d lines %7.3f s %8.1f KB", name, n, best, mem))
+end
+
+bench("buffer:put", N, function (n)
+  local b = string.buffer()
+  for i = 1, n do b:put("v ", i, " ", i + 0.5, " ", -i, "\n") end
+  return b:tostring()
+end)
+
+bench("buffer:putf", N, function (n)
+  local b = string.buffer()
+  for i = 1, n do b:putf("v %d %.1f %d\n", i, i + 0.5, -i) end
+  return b:tostring()
+end)
+
+bench("table.concat", N, function (n)
+  local t = {}
+  for i = 1, n do t[#t + 1] = "v " .. i .. " " .. (i + 0.5) .. " " .. -i .. "\n" end
+  return table.concat(t)
+end)
+
+bench("..", N // 10, function (n)
+  local s = ""
+  for i = 1, n do s = s .. "v " .. i .. " " .. (i + 0.5) .. " " .. -i .. "\n" end
+  return s
+end)
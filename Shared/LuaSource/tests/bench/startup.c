@@ -0,0 +1,121 @@
+/*
+** $Id: startup.c $
+** Start-up latency of a state: loading it from scratch against cloning
+** See Copyright Notice in lua.h
+*/
+
+/*
+** Usage: startup [-n count] [module.lua]
+**
+** Build (from this directory):
+**   cc -O2 -DLUA_USE_LINUX -I../.. -o startup ../../l*.c startup.c \
+**      -lm -ldl
+**
+** Does what the builder does for each build, 'count' (default 1000)
+** times: a new state with the libraries, the 'print' wrapper and four
+** public modules (each one a copy of 'module', by default vec3.lua of
+** the app), against 'luaL_clonestate' of one such state. Both include
+** 'lua_close' of the new state. Prints the best of 5 rounds of each, in
+** microseconds per state.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+
+static const char *const modules[] = {"vec3", "vec2", "bbox", "command"};
+
+static const char printwrapper[] =
+  "print = function(...)\n"
+  "  local args = {...}\n"
+  "  local printResult = \"\"\n"
+  "  for i,v in ipairs(args) do\n"
+  "    if i > 1 then printResult = printResult .. \", \" end\n"
+  "    printResult = printResult .. tostring(v)\n"
+  "  end\n"
+  "  _print(printResult)\n"
+  "end\n";
+
+static const char *modfile = "../../../Files/lua/vec3.lua";
+
+
+static void check (lua_State *L, int status) {
+  if (status != LUA_OK) {
+    fprintf(stderr, "startup: %s\n", lua_tostring(L, -1));
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+static lua_State *load (void) {
+  lua_State *L = luaL_newstate();
+  size_t i;
+  if (L == NULL) {
+    fprintf(stderr, "startup: cannot create state\n");
+    exit(EXIT_FAILURE);
+  }
+  luaL_openlibs(L);
+  check(L, luaL_dostring(L, printwrapper));
+  for (i = 0; i < sizeof(modules) / sizeof(modules[0]); i++) {
+    check(L, luaL_loadfile(L, modfile));
+    check(L, lua_pcall(L, 0, 1, 0));
+    lua_setglobal(L, modules[i]);
+  }
+  return L;
+}
+
+
+static double now (void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+
+int main (int argc, char **argv) {
+  int n = 1000;
+  int i, r;
+  double cold = 1e30, clone = 1e30;
+  lua_State *S;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+    n = atoi(argv[2]);
+    argc -= 2; argv += 2;
+  }
+  if (argc > 1) modfile = argv[1];
+  if (n <= 0) {
+    fprintf(stderr, "usage: startup [-n count] [module.lua]\n");
+    return EXIT_FAILURE;
+  }
+  S = load();
+  lua_gc(S, LUA_GCCOLLECT, 0);
+  for (r = 0; r < 5; r++) {
+    double t = now();
+    for (i = 0; i < n; i++)
+      lua_close(load());
+    t = (now() - t) / n;
+    if (t < cold) cold = t;
+    t = now();
+    for (i = 0; i < n; i++) {
+      lua_State *L = luaL_clonestate(S);
+      if (L == NULL) {
+        fprintf(stderr, "startup: cannot clone state\n");
+        return EXIT_FAILURE;
+      }
+      lua_close(L);
+    }
+    t = (now() - t) / n;
+    if (t < clone) clone = t;
+  }
+  printf("snapshot heap     %8d KB\n", lua_gc(S, LUA_GCCOUNT, 0));
+  printf("load from scratch %8.1f us\n", cold);
+  printf("clone             %8.1f us\n", clone);
+  printf("speed-up          %8.1fx\n", cold / clone);
+  lua_close(S);
+  return 0;
+}
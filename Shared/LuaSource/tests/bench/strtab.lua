@@ -0,0 +1,35 @@
+-- pauses of the string table: interns new strings one at a time, with
+-- the collector stopped so that only the string table works, and
+-- records the worst time of a single intern (the string table grows
+-- several times on the way). Also prints the most strings moved by one
+-- step of an incremental resize, when the build has that counter
+--
+-- usage: lua bench/strtab.lua [strings]
+
+local N = tonumber(arg[1]) or 1000000
+local clock = os.clock
+local keep = {}
+local worst, slow = 0, 0
+for i = 1, N do keep[i] = false end  -- no table resizes in the loop
+
+collectgarbage()
+collectgarbage("stop")
+pcall(collectgarbage, "strpause")  -- reset the counter
+local t0 = clock()
+for i = 1, N do
+  local t = clock()
+  keep[i] = "str" .. i
+  t = clock() - t
+  if t > worst then worst = t end
+  if t > 0.0001 then slow = slow + 1 end
+end
+local total = clock() - t0
+local ok, moved = pcall(collectgarbage, "strpause")
+collectgarbage("restart")
+
+print(string.format("%d strings in %.3f s", N, total))
+print(string.format("worst intern     %8.3f ms", worst * 1000))
+print(string.format("interns > 0.1 ms %8d", slow))
+if ok and math.type(moved) == "integer" then
+  print(string.format("worst step moved %8d strings", moved))
+end
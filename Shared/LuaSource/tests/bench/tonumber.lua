@@ -0,0 +1,63 @@
+-- reading decimal numerals: tonumber of "%.6f" and "%.17g" strings,
+-- arithmetic on numeric strings, io.read("n") from a file and load()
+-- of a chunk of float literals. Prints the best of 3 runs of each, in
+-- millions of numerals per second
+--
+-- usage: lua bench/tonumber.lua [numerals]
+
+local N = tonumber(arg[1]) or 1000000
+local fmt = string.format
+
+math.randomseed(19)
+local vals = {}
+for i = 1, 1000 do vals[i] = (math.random() - 0.5) * 10 ^ math.random(-6, 8) end
+local f6, g17 = {}, {}
+for i = 1, 1000 do
+  f6[i] = fmt("%.6f", vals[i])
+  g17[i] = fmt("%.17g", vals[i])
+end
+
+local function bench (name, n, f)
+  local best = math.huge
+  for r = 1, 3 do
+    collectgarbage()
+    local t0 = os.clock()
+    f()
+    best = math.min(best, os.clock() - t0)
+  end
+  print(fmt("%-24s %6.2f M/s", name, n / best / 1e6))
+end
+
+bench('tonumber("%.6f")', N, function ()
+  local s = 0
+  for i = 1, N do s = s + tonumber(f6[i % 1000 + 1]) end
+end)
+bench('tonumber("%.17g")', N, function ()
+  local s = 0
+  for i = 1, N do s = s + tonumber(g17[i % 1000 + 1]) end
+end)
+bench("string arithmetic", N, function ()
+  local s = 0
+  for i = 1, N do s = s + f6[i % 1000 + 1] * 1 end
+end)
+
+local name = os.tmpname()
+local fh = assert(io.open(name, "w"))
+for i = 1, N do fh:write(f6[i % 1000 + 1], "\n") end
+fh:close()
+bench('io.read("n")', N, function ()
+  local fh = assert(io.open(name))
+  local s = 0
+  for i = 1, N do s = s + fh:read("n") end
+  fh:close()
+end)
+os.remove(name)
+
+local M = N // 4
+local parts = {"return {"}
+for i = 1, M do parts[#parts + 1] = g17[i % 1000 + 1] .. "," end
+parts[#parts + 1] = "}"
+local chunk = table.concat(parts)
+bench("load() of %.17g literals", M, function ()
+  assert(load(chunk))
+end)
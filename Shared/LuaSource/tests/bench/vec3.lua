@@ -0,0 +1,46 @@
+-- vec3 arithmetic through the metamethods of vec3.lua: time and number
+-- of allocations per operation (tables are vec3s, so each result is a
+-- new table; an unboxed vec3 would need none)
+--
+-- usage: lua bench/vec3.lua [iterations]
+
+local dir = arg[0]:match("^(.*/)") or "./"
+local vec3 = dofile(dir .. "../../../Files/lua/vec3.lua")
+local N = tonumber(arg[1]) or 1000000
+
+local function bench (name, nops, f)
+  collectgarbage()
+  local a0 = nallocs and nallocs() or 0
+  local t0 = os.clock()
+  f()
+  local t = os.clock() - t0
+  local a = nallocs and nallocs() - a0 or 0
+  print(string.format("%-10s %7.3f s  %6.1f Mops/s  %5.2f allocs/op",
+                      name, t, nops / t / 1e6, a / nops))
+end
+
+-- 4 operations per iteration: *, +, -, unary -
+bench("arith", 4 * N, function ()
+  local acc = vec3(0, 0, 0)
+  local d = vec3(0.1, 0.2, 0.3)
+  local u = vec3.unit_x
+  for i = 1, N do
+    acc = acc + d * 0.5 - u
+    acc = -acc
+  end
+end)
+
+-- construction plus field reads
+bench("new+read", N, function ()
+  local s = 0
+  for i = 1, N do
+    local v = vec3(i, 1, 2)
+    s = s + v.x + v.y + v.z
+  end
+end)
+
+-- methods that return numbers allocate nothing
+bench("dot", N, function ()
+  local a, b, s = vec3(1, 2, 3), vec3(4, 5, 6), 0
+  for i = 1, N do s = s + a:dot(b) end
+end)
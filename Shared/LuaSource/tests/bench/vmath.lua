@@ -0,0 +1,32 @@
+-- bulk math over typed arrays against the same loop in Lua: time per
+-- call on arrays of 65536 elements
+--
+-- usage: lua bench/vmath.lua [repetitions]
+
+local N, R = 65536, tonumber(arg[1]) or 200
+local a = array.new("float64", N)
+local b = array.new("float64", N)
+local d = array.new("float64", N)
+for i = 1, N do a[i] = i * 0.001; b[i] = i * 0.5 end
+
+local function bench (name, f)
+  local t0 = os.clock()
+  for r = 1, R do f() end
+  print(string.format("%-12s %8.1f us/call", name, (os.clock() - t0) / R * 1e6))
+end
+
+local sqrt, sin, min = math.sqrt, math.sin, math.min
+bench("loop sqrt", function () for i = 1, N do d[i] = sqrt(a[i]) end end)
+bench("vsqrt", function () math.vsqrt(d, a) end)
+bench("loop sin", function () for i = 1, N do d[i] = sin(a[i]) end end)
+bench("vsin", function () math.vsin(d, a) end)
+bench("loop min", function () for i = 1, N do d[i] = min(a[i], b[i]) end end)
+bench("vmin", function () math.vmin(d, a, b) end)
+bench("loop lerp", function ()
+  for i = 1, N do local x = a[i]; d[i] = x + (b[i] - x) * 0.3 end
+end)
+bench("vlerp", function () math.vlerp(d, a, b, 0.3) end)
+bench("loop axpy", function () for i = 1, N do b[i] = 2 * a[i] + b[i] end end)
+bench("vaxpy", function () math.vaxpy(2, a, b) end)
+local f = array.new("float32", N)
+bench("vfloor f32", function () math.vfloor(f, f) end)
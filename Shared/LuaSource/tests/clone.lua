@@ -0,0 +1,177 @@
+-- 'lua_clonestate' (through 'luaL_clonestate'): a clone must not share
+-- memory or resources with its original, which may be closed (or
+-- changed) while the clone is in use
+
+local function run (s, code)
+  local res = table.pack(T.dostring(s, code))
+  assert(res[1], res[2])
+  return table.unpack(res, 2, res.n)
+end
+
+local s, c
+
+
+-- globals, functions and upvalues
+s = T.newstate()
+run(s, [[
+  local n = 0
+  function count () n = n + 1; return n end
+  X = {1, 2, 3, t = {"x"}}
+  X.self = X
+]])
+run(s, "count()")
+c = T.clone(s)
+assert(c)
+run(s, "count(); X[1] = 10")
+T.close(s)
+assert(run(c, "return count()") == "2")
+assert(run(c, "return X[1] + #X.t[1]") == "2")
+assert(run(c, "return X.self == X"))
+T.close(c)
+
+
+-- a string buffer gets a block of its own
+s = T.newstate()
+run(s, "B = string.buffer(); B:put(string.rep('a', 1000))")
+c = T.clone(s)
+assert(c)
+run(s, "B:reset(); B:put(string.rep('z', 1000))")
+assert(run(c, "return B:tostring() == string.rep('a', 1000)") == "true")
+T.close(s)
+run(c, "B:put(string.rep('b', 5000))")
+assert(run(c, "return #B, B:tostring():sub(999, 1002)") == "6000")
+assert(select(2, run(c, "return #B, B:tostring():sub(999, 1002)")) == "aabb")
+T.close(c)
+
+
+-- files: an open file cannot be cloned; closed and standard files can
+local fn = os.tmpname()
+s = T.newstate()
+run(s, string.format("F = assert(io.open(%q, 'w'))", fn))
+assert(T.clone(s) == nil)
+run(s, "F:write('hello'); F:close()")
+c = T.clone(s)
+assert(c)
+assert(run(c, "return io.type(F)") == "closed file")
+assert(run(c, "return io.type(io.stdout), io.type(io.output())") == "file")
+run(c, "io.stdout:write(''); io.write('')")
+T.close(c)  -- must not close the standard files
+assert(run(s, "return io.type(io.stdout)") == "file")
+run(s, "assert(io.stdout:write('')); assert(io.stderr:write(''))")
+run(s, string.format("F = assert(io.open(%q))", fn))
+assert(T.clone(s) == nil)
+assert(run(s, "return F:read('a')") == "hello")
+run(s, "F:close()")
+T.close(s)
+os.remove(fn)
+
+
+-- compiled patterns in the cache point to their own copies
+s = T.newstate()
+run(s, [[
+  assert(string.find("zzzcab", "[abc]+") == 4)
+  assert(string.match("  ab_c1 ", "[%a_]+") == "ab_c")
+  assert(string.gsub("THE (quick) fox", "%f[%a]%a+", "W") == "W (W) W")
+]])
+c = T.clone(s)
+assert(c)
+T.close(s)
+local ok, i, j = T.dostring(c, 'return string.find("zzzcab", "[abc]+")')
+assert(ok and i == "4" and j == "6")
+assert(run(c, 'return string.match("  ab_c1 ", "[%a_]+")') == "ab_c")
+assert(run(c, 'return (string.gsub("THE (quick) fox", "%f[%a]%a+", "W"))')
+       == "W (W) W")
+T.close(c)
+
+
+-- typed arrays and slices get their elements in the clone
+s = T.newstate()
+run(s, [[
+  A = array.new("float64", 4)
+  for i = 1, 4 do A[i] = i end
+  S = A:slice(2, 3)
+  S2 = S:slice(2)
+  E = A:slice(5)
+]])
+c = T.clone(s)
+assert(c)
+run(s, "A[2] = 20; A[3] = 30")
+T.close(s)
+run(c, [[
+  assert(S[1] == 2 and S[2] == 3 and #S == 2)
+  assert(S2[1] == 3 and #S2 == 1 and #E == 0)
+  S[1] = 9; S2[1] = 8
+  assert(A[2] == 9 and A[3] == 8)
+]])
+T.close(c)
+
+
+-- any other userdata needs a '__clone'
+s = T.newstate()
+run(s, "U = T.newuserdata(16)")
+assert(T.clone(s) == nil)  -- no metatable
+run(s, "debug.setmetatable(U, {__index = {}})")
+assert(T.clone(s) == nil)  -- not a typed array
+run(s, "debug.setmetatable(U, {__gc = function () end})")
+assert(T.clone(s) == nil)
+run(s, [[
+  debug.setmetatable(U, {__gc = function () end,
+    __clone = function (u, o)
+      CLONED = (CLONED or 0) + 1
+      KINDS = type(u) .. " " .. type(o)
+    end})
+]])
+c = T.clone(s)
+assert(c)
+assert(run(c, "return CLONED") == "1")
+assert(run(c, "return KINDS") == "userdata userdata")
+assert(run(s, "return CLONED") == "nil")
+T.close(c)
+run(s, [[
+  B = string.buffer(); B:put(string.rep('x', 1000))
+  getmetatable(U).__clone = function () error("no") end
+]])
+assert(T.clone(s) == nil)
+-- a table with a '__clone'
+run(s, [[
+  U = nil
+  TB = setmetatable({}, {__clone = function (t, o)
+    assert(type(o) == "userdata")
+    t.cloned = true
+  end})
+]])
+c = T.clone(s)
+assert(c)
+assert(run(c, "return TB.cloned") == "true")
+assert(run(s, "return TB.cloned") == "nil")
+T.close(c)
+T.close(s)
+
+
+-- functions bound to their state (like the Swift functions of the app)
+-- must not be reachable in a clone: they are fine while they are only
+-- set and removed again, but any copy of them that is kept (in a
+-- table, an upvalue or a metatable) makes the clone fail
+s = T.newstate()
+run(s, [[
+  require = T.boundfunction(); _print = T.boundfunction()
+  assert(require() and _print())
+  require = nil; _print = nil
+]])
+c = T.clone(s)
+assert(c)
+T.close(c)
+for _, code in ipairs{
+  "M = {require = T.boundfunction()}",
+  "local req = T.boundfunction(); function load () return req() end",
+  "setmetatable(_G, {__index = T.boundfunction()})",
+  "package.loaded.m = {[T.boundfunction()] = true}",
+} do
+  local s = T.newstate()
+  run(s, code)
+  assert(T.clone(s) == nil, code)
+  T.close(s)
+end
+T.close(s)
+
+print "OK"
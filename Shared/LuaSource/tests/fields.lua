@@ -0,0 +1,110 @@
+-- field access through inline caches
+local function getx(t) return t.x end
+local function setx(t, v) t.x = v end
+local a = {x = 1, y = 2}
+local b = {y = 5, x = 7, z = 9}
+print(getx(a), getx(b), getx(a), getx(b))
+-- rehash moves keys
+local c = {x = 10}
+print(getx(c))
+for i = 1, 100 do c["k" .. i] = i end
+print(getx(c))
+setx(c, 11); print(getx(c))
+for i = 1, 100 do c["k" .. i] = nil end
+collectgarbage()
+for i = 1, 200 do c["j" .. i] = i end
+print(getx(c), c.j200)
+-- nil value then re-set
+local d = {x = 1}
+print(getx(d)); d.x = nil; print(getx(d)); setx(d, 3); print(getx(d))
+-- __index table chain
+local base = {x = "base"}
+local mid = setmetatable({}, {__index = base})
+local obj = setmetatable({}, {__index = mid})
+for i = 1, 3 do print(getx(obj)) end
+obj.x = "own"; print(getx(obj)); obj.x = nil; print(getx(obj))
+-- __index function
+local calls = 0
+local f = setmetatable({}, {__index = function(t, k) calls = calls + 1 return k .. "!" end})
+for i = 1, 3 do print(getx(f)) end
+print(calls)
+-- __index added later to a metatable that was cached as absent
+local mt = {}
+local late = setmetatable({}, mt)
+print(getx(late)); print(getx(late))
+mt.__index = {x = "late"}
+print(getx(late))
+mt.__index = nil
+print(getx(late))
+rawset(mt, "__index", {x = "raw"})
+print(getx(late))
+-- __newindex
+local log = {}
+local ni = setmetatable({}, {__newindex = function(t, k, v) log[#log+1] = k .. "=" .. tostring(v) end})
+setx(ni, 1); setx(ni, 2); print(#log, log[1], rawget(ni, "x"))
+rawset(ni, "x", 0); setx(ni, 5); print(rawget(ni, "x"), #log)
+-- methods
+local class = {}
+class.__index = class
+function class.new(v) return setmetatable({v = v}, class) end
+function class:get() return self.v end
+function class:set(v) self.v = v end
+local objs = {}
+for i = 1, 10 do objs[i] = class.new(i) end
+local s = 0
+for r = 1, 3 do for i = 1, 10 do objs[i]:set(objs[i]:get() + 1); s = s + objs[i]:get() end end
+print(s)
+-- replacing methods in the class
+function class:get() return -self.v end
+print(objs[1]:get())
+-- string methods
+local str = "hello"
+for i = 1, 3 do print(str:upper(), ("x"):rep(3)) end
+-- indexing errors
+print(pcall(getx, nil))
+print(pcall(getx, 5))
+print(pcall(function() local n; return n:foo() end))
+print(pcall(setx, nil, 1))
+print(pcall(function() return (1).x end))
+-- number with metatable through debug
+debug.setmetatable(0, {__index = {x = "numx"}})
+print(getx(1), getx(2.5))
+debug.setmetatable(0, nil)
+print(pcall(getx, 1))
+-- globals
+x = "gx"
+local function gx() return x end
+print(gx()); x = nil; print(gx()); x = 3; print(gx())
+for i = 1, 200 do _G["g" .. i] = i end
+print(gx(), g100)
+-- _ENV changes
+local function env(e) local _ENV = e; return x end
+print(env({x = 1}), env({y = 1, x = 2}), env(setmetatable({}, {__index = {x = 3}})))
+-- weak tables and dead keys
+local w = setmetatable({}, {__mode = "k"})
+local function wx(t) return t.x end
+local wt = {x = "w"}
+print(wx(wt))
+collectgarbage()
+print(wx(wt))
+-- loop chain
+local l1, l2 = {}, {}
+setmetatable(l1, {__index = l2}); setmetatable(l2, {__index = l1})
+print(pcall(getx, l1))
+-- many tables with same shape, different node positions
+local many = {}
+for i = 1, 50 do
+  local t = {}
+  for j = 1, i % 7 do t["p" .. j] = j end
+  t.x = i
+  many[i] = t
+end
+local tot = 0
+for r = 1, 2 do for i = 1, 50 do tot = tot + getx(many[i]) end end
+print(tot)
+-- coroutine yield in __index
+local co = coroutine.wrap(function()
+  local t = setmetatable({}, {__index = function(t, k) return coroutine.yield(k) end})
+  return t.x, t:y()
+end)
+print(co()); print(co(function() return "m" end)); 
@@ -0,0 +1,11 @@
+local out = {}
+local vals = {0, -0.0, 1, 0.1, 1/3, 2/3, 1e15, 1e16, 123.456, 5e-324, 1.7976931348623157e308, 2^53, 2^63, -1e-5, 0.5, 2.5, 1e22, 1e23, math.pi, 100}
+math.randomseed(7)
+for i = 1, 200 do vals[#vals + 1] = (math.random() - 0.5) * 10 ^ math.random(-20, 25) end
+local fmts = {"%g", "%f", "%e", "%.3f", "%.0f", "%.14g", "%.17g", "%E", "%G", "%.10e", "%5.2f", "%-10g|", "%+.3e", "%a", "%.3a", "%#.3g", "%.40f", "% f"}
+for _, v in ipairs(vals) do
+  out[#out + 1] = tostring(v)
+  for _, f in ipairs(fmts) do out[#out + 1] = string.format(f, v) end
+  out[#out + 1] = v .. ""
+end
+io.write(table.concat(out, "\n"), "\n")
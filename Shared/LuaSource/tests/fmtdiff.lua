@@ -0,0 +1,59 @@
+-- differential test of the float formatter: string.format and tostring
+-- against the C library's snprintf (T.cformat), on random bit patterns,
+-- short decimals, ties, subnormals and integers near 2^53
+
+local N = tonumber(arg[1]) or 20000
+local cformat = T.cformat
+local format = string.format
+local pack, unpack = string.pack, string.unpack
+
+math.randomseed(18)
+local random = math.random
+
+local function bits ()  -- any finite double, from its bit pattern
+  while true do
+    local x = unpack("<d", pack("<I4I4", random(0, 0xffffffff),
+                                         random(0, 0xffffffff)))
+    if x == x and x ~= math.huge and x ~= -math.huge then return x end
+  end
+end
+
+local gen = {
+  bits,
+  function () return random(-999999, 999999) / 10 ^ random(0, 8) end,
+  function () return (random(0, 1 << 20) + 0.5) / 10 ^ random(0, 3) end,
+  function () return random(1, 1 << 52) * 2.0^-1074 end,  -- subnormal
+  function () return 2^53 + random(-1000, 1000) * 1.0 end,
+  function () return random() * 10 ^ random(-30, 30) end,
+}
+
+local fails = 0
+local function check (fmt, x)
+  local got, want = format(fmt, x), cformat(fmt, x)
+  if got ~= want then
+    fails = fails + 1
+    if fails <= 10 then
+      print(format("%s of %a: got %s, want %s", fmt, x, got, want))
+    end
+  end
+end
+
+local ncases = 0
+for i = 1, N do
+  local x = gen[i % #gen + 1]()
+  check("%.17g", x); check("%.17g", -x)
+  check("%.14g", x)
+  check(format("%%.%de", random(0, 19)), x)
+  check(format("%%.%dg", random(0, 19)), x)
+  if math.abs(x) < 1e30 then
+    check(format("%%.%df", random(0, 40)), x)
+  end
+  if math.type(x) == "float" and tostring(x) ~= cformat("%.14g", x)
+     and tostring(x) ~= cformat("%.14g", x) .. ".0" then
+    fails = fails + 1
+    print("tostring of " .. format("%a", x) .. ": " .. tostring(x))
+  end
+  ncases = ncases + 6
+end
+assert(fails == 0, fails .. " differences in " .. ncases .. " cases")
+print("OK")
@@ -0,0 +1,60 @@
+local function fib(n) if n < 2 then return n end return fib(n-1) + fib(n-2) end
+print(fib(20))
+local function counter() local c = 0 return function() c = c + 1 return c end end
+local c1, c2 = counter(), counter()
+print(c1(), c1(), c2())
+local function va(...) local a, b = ... return select("#", ...), a, b, ... end
+print(va(1, nil, 3))
+local function tail(n) if n == 0 then return "done" end return tail(n - 1) end
+print(tail(100000))
+print(pcall(error, {code = 1}))
+print(select(2, pcall(error, "msg", 0)), select(2, pcall(error)))
+print(xpcall(function() error("x") end, function(m) return "handled: " .. m end))
+local ok, e = pcall(function() local t = nil; return t.x end) print(ok, e)
+local co = coroutine.create(function(a, b)
+  local c = coroutine.yield(a + b)
+  local d, e = coroutine.yield(c * 2)
+  return d + e
+end)
+print(coroutine.resume(co, 1, 2)) print(coroutine.resume(co, 10)) print(coroutine.resume(co, 3, 4)) print(coroutine.resume(co))
+print(coroutine.status(co), coroutine.isyieldable())
+local gen = coroutine.wrap(function() for i = 1, 3 do coroutine.yield(i) end end)
+print(gen(), gen(), gen())
+-- goto
+do local i = 1 ::top:: if i <= 3 then io.write(i, " ") i = i + 1 goto top end print() end
+-- upvalues shared in loops
+local fs = {} for i = 1, 3 do fs[i] = function() return i end end print(fs[1](), fs[2](), fs[3]())
+local shared do local x = 0 shared = {function() x = x + 1 end, function() return x end} end
+shared[1]() shared[1]() print(shared[2]())
+-- varargs in table constructor and calls
+local function count(...) return select("#", ...) end
+print(count(table.unpack({1, 2, 3, nil, 5}, 1, 5)), count(nil, nil), count())
+-- string.dump and load with upvalues
+local function adder(x) return function(y) return x + y end end
+local d = string.dump(adder)
+print(load(d)(3)(4))
+print(load("return 1 + 1")(), load("syntax error here"))
+local env = {print = print, x = 5}
+print(load("return x", "chunk", "t", env)())
+-- metamethods: all arithmetic
+local mt = {}
+for _, ev in ipairs{"add", "sub", "mul", "div", "mod", "pow", "unm", "idiv", "band", "bor", "bxor", "shl", "shr", "bnot", "concat", "len", "eq", "lt", "le", "call", "tostring"} do
+  mt["__" .. ev] = function(a, b) return ev end
+end
+mt.__eq = function() return true end
+mt.__lt = function() return true end
+mt.__le = function() return false end
+mt.__tostring = function() return "OBJ" end
+local o1, o2 = setmetatable({}, mt), setmetatable({}, mt)
+print(o1 + 1, 1 - o1, o1 * o1, o1 / 2, o1 % 2, o1 ^ 2, -o1, o1 // 2, o1 & 1, o1 | 1, o1 ~ 1, o1 << 1, o1 >> 1, ~o1, o1 .. "x", "x" .. o1, #o1, o1 == o2, o1 < o2, o1 <= o2, o1(), tostring(o1))
+print(pcall(function() return {} < {} end), pcall(function() return 1 < "2" end), "10" + 5, "3" * "4", 10 .. 20)
+-- integer division and modulo by zero
+print(pcall(function() return 1 // 0 end), pcall(function() return 1 % 0 end), 1 // 0.0, 1 % 0.0 ~= 1 % 0.0)
+print(math.maxinteger + 1 == math.mininteger, math.mininteger // -1, math.mininteger % -1)
+print(7 // 2, 7.0 // 2, -7 // 2, 7 % -3, -7 % 3, 7.5 % 2, -7.5 % 2, 2^-1, (-2)^2, 8 >> 1, 1 << 63, 1 << 64, -1 >> 1)
+print(math.floor(3.7), math.ceil(3.2), math.abs(-4), math.max(1, 5, 3), math.min(2, 0.5), math.huge, -math.huge, math.pi, math.sqrt(16), math.fmod(7, 3), math.fmod(-7, 3), math.modf(3.7))
+print(math.ult(1, -1), math.type(1), math.type(1.0), math.type("1"), 3 == 3.0, math.floor(-0.0), 1e308 * 10 == math.huge)
+for i = 10, 1, -3 do io.write(i, " ") end for i = 1.0, 2.0, 0.25 do io.write(i, " ") end for i = 1, 0 do io.write("never") end print()
+print(pcall(function() for i = 1, "x" do end end), pcall(function() for i = 1, 10, 0 do break end return "zero step" end))
+local n = 0 for i = 1, 3.5 do n = n + i end print(n)
+n = 0 for i = 0.1, 1, 0.1 do n = n + 1 end print(n)
@@ -0,0 +1,39 @@
+-- superinstruction pairs: names in errors, hooks, dump round trip
+local function f(a, b)
+  local x = a
+  local y = b
+  print(x, y)
+  local s = string.format("%d-%d", x, y)
+  local t = {k = s}
+  local u = t.k:upper()
+  return math.max(x, y), s, string.rep("ab", 2)
+end
+print(f(1, 2))
+print(pcall(function() local a = 1; local b = a; undefinedfn(b) end))
+print(pcall(function() local q = {}; local r = q; r.x.y = 1 end))
+print(pcall(function() return nosuch.field end))
+print(pcall(function() local o = {}; o:method("k") end))
+print(pcall(function() local o = {}; return math.nofunc(o) end))
+local up = nil
+print(pcall(function() local z = 3; up(z) end))
+local lines = {}
+debug.sethook(function(e, l) lines[#lines + 1] = l end, "l")
+f(3, 4)
+debug.sethook()
+print(table.concat(lines, " "))
+local n = 0
+debug.sethook(function() n = n + 1 end, "", 1)
+f(5, 6)
+debug.sethook()
+print(n)
+local g = load(string.dump(f))
+print(g(7, 8))
+print(pcall(load(string.dump(function() local a = 1; local b = a; undefinedfn(b) end))))
+local co = coroutine.wrap(function(...)
+  local t = setmetatable({}, {__index = function(t, k) return coroutine.yield(k) end})
+  local v = t.a
+  local w = v
+  print("in", w, t.b, select('#', ...))
+  return "end"
+end)
+print(co(1, 2), co("A"), co("B"))
@@ -0,0 +1,46 @@
+local weak = setmetatable({}, {__mode = "v"})
+local strong = {}
+for i = 1, 100 do local t = {i} weak[i] = t if i % 2 == 0 then strong[i] = t end end
+collectgarbage() collectgarbage()
+local c = 0 for k in pairs(weak) do c = c + 1 end print(c)
+local wk = setmetatable({}, {__mode = "k"})
+for i = 1, 50 do local key = {} wk[key] = i if i <= 10 then strong[#strong + 1] = key end end
+collectgarbage()
+c = 0 for k in pairs(wk) do c = c + 1 end print(c)
+local fin = {}
+for i = 1, 10 do setmetatable({}, {__gc = function() fin[#fin + 1] = i end}) end
+collectgarbage() collectgarbage()
+print(#fin)
+local eph = setmetatable({}, {__mode = "k"})
+do local k1 = {} local k2 = {} eph[k1] = k2 eph[k2] = k1 end
+collectgarbage()
+print(next(eph))
+print(collectgarbage("count") > 0, collectgarbage("step"), collectgarbage("isrunning"))
+collectgarbage("stop") print(collectgarbage("isrunning")) collectgarbage("restart")
+print(collectgarbage("setpause", 100), collectgarbage("setstepmul", 200))
+collectgarbage("setpause", 200) collectgarbage("setstepmul", 200)
+-- churn
+local keep = {}
+for i = 1, 200000 do
+  local t = {x = i, y = i * 2, s = "s" .. (i % 1000)}
+  if i % 1000 == 0 then keep[#keep + 1] = t end
+end
+print(#keep, keep[100].x, keep[100].s)
+local strs = {} for i = 1, 20000 do strs[i] = "str" .. i end
+for i = 1, 20000 do strs[i] = nil end
+collectgarbage()
+local s = 0 for i = 1, 20000 do s = s + #("str" .. i) end print(s)
+-- resurrection via finalizer
+local res
+setmetatable({name = "res"}, {__gc = function(o) res = o end})
+collectgarbage() collectgarbage()
+print(res and res.name)
+-- closures and upvalues through GC
+local fs = {}
+for i = 1, 1000 do local v = {i} fs[i] = function() return v[1] end end
+collectgarbage()
+s = 0 for i = 1, 1000 do s = s + fs[i]() end print(s)
+-- coroutines garbage
+for i = 1, 1000 do local co = coroutine.wrap(function() coroutine.yield(i) end) co() end
+collectgarbage()
+print("ok")
@@ -0,0 +1,139 @@
+-- the generational collector: old objects pointing to young ones through
+-- every kind of barrier, weak tables, finalizers and mode switches
+--
+-- usage: lua gcgen.lua [garbage per round] [minor multiplier]
+
+local N = tonumber(arg[1]) or 20000
+local function check (c, msg) if not c then error(msg, 2) end end
+
+collectgarbage("generational", tonumber(arg[2]) or 5)
+
+-- old table receiving young values (backward barrier)
+local old = {}
+for i = 1, 100 do old[i] = {i} end
+collectgarbage(); collectgarbage()
+for r = 1, 30 do
+  for i = 1, 100 do old[i] = {i + r, tostring(i * r)} end
+  local junk = {}
+  for i = 1, N // 10 do junk[i] = {i} end
+end
+for i = 1, 100 do
+  check(old[i][1] == i + 30 and old[i][2] == tostring(i * 30), "old")
+end
+
+-- closed upvalues (upvalue barrier)
+local function mk()
+  local v = {}
+  return function(x) if x then v = x end return v end
+end
+local fs = {}
+for i = 1, 200 do fs[i] = mk() end
+collectgarbage()
+for r = 1, 20 do
+  for i = 1, 200 do fs[i]({r, i, "s" .. r .. i}) end
+  for i = 1, N // 20 do local t = {i, {i}} end
+end
+for i = 1, 200 do
+  local t = fs[i]()
+  check(t[1] == 20 and t[2] == i and t[3] == "s20" .. i, "upv")
+end
+
+-- forward barrier: metatable/uservalue set on old objects
+local objs = {}
+for i = 1, 50 do objs[i] = setmetatable({}, nil) end
+collectgarbage()
+for r = 1, 10 do
+  for i = 1, 50 do setmetatable(objs[i], {__index = {v = r * i}}) end
+  for i = 1, N // 10 do local t = {} end
+end
+for i = 1, 50 do check(objs[i].v == 10 * i, "mt") end
+
+-- weak tables
+local wk = setmetatable({}, {__mode = "k"})
+local wv = setmetatable({}, {__mode = "v"})
+local wkv = setmetatable({}, {__mode = "kv"})
+local keep = {}
+for r = 1, 20 do
+  for i = 1, 200 do
+    local k = {}
+    wk[k] = {i}; wv[i + r * 1000] = {i}; wkv[k] = k
+    if i % 10 == 0 then keep[#keep + 1] = k end
+  end
+  for i = 1, N // 20 do local t = {i} end
+end
+collectgarbage(); collectgarbage()
+local n = 0
+for k, v in pairs(wk) do n = n + 1; check(type(v) == "table", "wk") end
+check(n == #keep, "wk count " .. n)
+n = 0 for k in pairs(wv) do n = n + 1 end
+check(n == 0, "wv count " .. n)
+n = 0 for k, v in pairs(wkv) do n = n + 1; check(k == v, "wkv") end
+check(n == #keep, "wkv count")
+
+-- finalizers and resurrection
+local fin, res = 0, {}
+for r = 1, 20 do
+  for i = 1, 100 do
+    setmetatable({i}, {__gc = function (o)
+      fin = fin + 1
+      if i % 25 == 0 then res[#res + 1] = o end
+    end})
+  end
+  for i = 1, N // 20 do local t = {i} end
+end
+collectgarbage(); collectgarbage()
+check(fin == 2000, "fin " .. fin)
+for i = 1, #res do check(type(res[i][1]) == "number", "res") end
+
+-- coroutines holding young objects
+local cos = {}
+for i = 1, 50 do
+  cos[i] = coroutine.wrap(function()
+    local acc = {}
+    while true do acc[#acc + 1] = {#acc}; coroutine.yield(#acc) end
+  end)
+end
+for r = 1, 40 do
+  for i = 1, 50 do check(cos[i]() == r, "co") end
+  for i = 1, N // 40 do local t = {i} end
+end
+
+-- strings, views and concatenation
+local s = string.rep("abcdefghij", 1000)
+local parts = {}
+for r = 1, 50 do
+  for i = 1, 100 do parts[i] = s:sub(i, i + 200) end
+  for i = 1, N // 50 do local t = "x" .. i end
+end
+for i = 1, 100 do check(parts[i] == s:sub(i, i + 200), "view") end
+
+-- mode switches in the middle of work
+local live = {}
+for r = 1, 30 do
+  collectgarbage(r % 2 == 0 and "incremental" or "generational")
+  for i = 1, 100 do live[(r * 100 + i) % 1000 + 1] = {r, i} end
+  for i = 1, N // 30 do local t = {i} end
+  if r % 7 == 0 then collectgarbage() end
+  collectgarbage("step")
+end
+for k, v in pairs(live) do check(type(v[1]) == "number", "switch") end
+collectgarbage("generational")
+
+-- big integers (boxed with NaN-boxing) stored in old tables
+local big = {}
+collectgarbage()
+for r = 1, 20 do
+  for i = 1, 100 do big[i] = math.maxinteger - i - r end
+  for i = 1, N // 20 do local t = {i} end
+end
+for i = 1, 100 do check(big[i] == math.maxinteger - i - 20, "big") end
+
+-- a growing structure (bad collections)
+local tree = {}
+for i = 1, N * 5 do tree[i] = {i, tostring(i)} end
+for i = 1, N * 5, 97 do check(tree[i][2] == tostring(i), "tree") end
+tree = nil
+collectgarbage()
+check(collectgarbage("incremental") == "generational", "mode")
+
+print "OK"
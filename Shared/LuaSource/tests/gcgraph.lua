@@ -0,0 +1,109 @@
+-- a random object graph mutated while the collector runs in both modes:
+-- minor and major collections, old objects getting finalizers, weak
+-- tables, upvalues, metatables, dead strings coming back and mode
+-- switches in the middle of a cycle. At the end every reachable part
+-- of the graph must still be intact.
+--
+-- usage: lua gcgraph.lua [seed [steps]]
+-- (to force frequent major collections, build with
+-- CFLAGS="-DLUAI_GENMAJORMUL=10 -DLUAI_GENMINORMUL=5")
+
+local function run (seed, STEPS, mode)
+  collectgarbage(mode)
+  math.randomseed(seed)
+  local R = math.random
+  local NN = 5000
+  local nodes = {}
+  local fin = 0
+  local gcmt = {__gc = function(o)
+    fin = fin + 1
+    assert(type(o.id) == "number")
+    if o.kids then for i = 1, #o.kids do assert(o.kids[i][1] == i) end end
+    if o.s then assert(#o.s > 0) end
+  end}
+  local weakk = setmetatable({}, {__mode = "k"})
+  local weakv = setmetatable({}, {__mode = "v"})
+  local function newnode (id)
+    local n = {id = id, s = "n" .. id % 5000}
+    local k = {}
+    for i = 1, R(6) do k[i] = {i} end
+    n.kids = k
+    if R(10) == 1 then setmetatable(n, gcmt) end
+    if R(7) == 1 then
+      local up = {id = id}
+      n.f = function (x) if x then up = x end return up end
+    end
+    return n
+  end
+  for i = 1, NN do nodes[i] = newnode(i) end
+  for step = 1, STEPS do
+    local op = R(15)
+    local a = R(NN)
+    local n = nodes[a]
+    if op == 1 then nodes[a] = newnode(a)
+    elseif op == 2 then n.link = nodes[R(NN)]; if n.g then n.g({step}) end
+    elseif op == 3 then n.kids[#n.kids + 1] = {#n.kids + 1}
+    elseif op == 4 and n.f then n.f({id = step})
+    elseif op == 5 then
+      if getmetatable(n) == nil then setmetatable(n, gcmt) end
+    elseif op == 6 then  -- strings die and come back
+      n.s = "n" .. (step % 5000)
+    elseif op == 7 then weakk[n] = {step}; weakv[step % 1000] = n
+    elseif op == 8 then
+      local g = {}
+      for i = 1, 50 do g[i] = {i, tostring(i)} end
+    elseif op == 9 then nodes[a] = {id = a, kids = {}, s = "fresh"}
+    elseif op == 10 and R(200) == 1 then collectgarbage("step", R(4))
+    elseif op == 11 and R(2000) == 1 then
+      collectgarbage(R(2) == 1 and "incremental" or "generational")
+    elseif op == 12 and R(5000) == 1 then collectgarbage()
+    elseif op == 13 then
+      local mt = getmetatable(n)
+      if mt == nil then setmetatable(n, {tag = {step}})
+      elseif mt ~= gcmt and R(2) == 1 then setmetatable(n, nil) end
+    elseif op == 15 then
+      if not n.w then
+        n.w = setmetatable({}, {__mode = (R(2) == 1) and "k" or "v"})
+      end
+      n.w[R(4)] = {step}; n.w[{step}] = nodes[R(NN)]
+    elseif op == 14 then
+      local x = {step}; n.up = function() return x end
+      nodes[R(NN)].g = function(v) if v then x = v end return x end
+    end
+  end
+  for i = 1, NN do
+    local n = nodes[i]
+    assert(n.id == i)
+    if n.link then assert(type(n.link.id) == "number") end
+    if n.f then assert(type(n.f().id) == "number") end
+    for j = 1, #n.kids do assert(n.kids[j][1] == j) end
+    assert(#n.s > 0)
+    local mt = getmetatable(n)
+    if mt and mt ~= gcmt then assert(type(mt.tag[1]) == "number") end
+    if n.up then assert(type(n.up()[1]) == "number") end
+    if n.g then assert(type(n.g()[1]) == "number") end
+    if n.w then
+      for k, v in pairs(n.w) do
+        if type(k) == "table" then assert(type(k[1]) == "number") end
+        if type(v) == "table" then assert(v.id or type(v[1]) == "number") end
+      end
+    end
+  end
+  for k, v in pairs(weakk) do
+    assert(type(k.id) == "number" and type(v[1]) == "number")
+  end
+  for k, v in pairs(weakv) do assert(type(v.id) == "number") end
+  collectgarbage()
+  assert(fin > 0)
+end
+
+if arg[1] then
+  run(tonumber(arg[1]), tonumber(arg[2]) or 300000, "generational")
+else
+  for seed = 1, 4 do
+    run(seed, 5000, (seed % 2 == 0) and "incremental" or "generational")
+  end
+end
+collectgarbage("incremental")
+
+print "OK"
@@ -0,0 +1,101 @@
+-- hooks switched on and off while code runs
+local function work(n)
+  local s = 0
+  for i = 1, n do
+    s = s + i
+  end
+  return s
+end
+
+-- set inside a loop, seen from the next instruction on
+local lines = {}
+local function setinloop()
+  local s = 0
+  for i = 1, 10 do
+    if i == 5 then debug.sethook(function(e, l) lines[#lines + 1] = l end, "l") end
+    s = s + i
+  end
+  debug.sethook()
+  return s
+end
+print(setinloop(), #lines, table.concat(lines, " "))
+
+-- seen in caller after the function that set it returns
+lines = {}
+local function sethere() debug.sethook(function(e, l) lines[#lines + 1] = l end, "l") end
+local function caller()
+  local a = 1
+  sethere()
+  local b = a + 1
+  local c = b + 1
+  debug.sethook()
+  return c
+end
+print(caller(), table.concat(lines, " "))
+
+-- count hook with count 1 and 7
+for _, cnt in ipairs{1, 7, 100} do
+  local n = 0
+  debug.sethook(function() n = n + 1 end, "", cnt)
+  work(300)
+  debug.sethook()
+  print(cnt, n)
+end
+
+-- hook removes itself
+local seen = 0
+debug.sethook(function(e, l) seen = seen + 1; if seen == 3 then debug.sethook() end end, "l")
+work(50)
+work(50)
+print(seen, debug.gethook())
+
+-- hooks of a coroutine set from outside while it is suspended
+local co = coroutine.create(function()
+  local s = 0
+  for i = 1, 3 do s = s + work(10); coroutine.yield(s) end
+  return s
+end)
+print(coroutine.resume(co))
+local cl = {}
+debug.sethook(co, function(e, l) cl[#cl + 1] = l end, "l")
+print(coroutine.resume(co))
+debug.sethook(co)
+print(coroutine.resume(co))
+print(coroutine.resume(co))
+print(#cl, table.concat(cl, " "))
+
+-- hooks that yield
+local co2 = coroutine.create(function()
+  debug.sethook(function(e, l) if e == "count" then coroutine.yield() end end, "", 5)
+  local s = 0
+  for i = 1, 20 do s = s + i end
+  debug.sethook()
+  return s
+end)
+local steps = 0
+while true do
+  local ok, r = coroutine.resume(co2)
+  steps = steps + 1
+  if coroutine.status(co2) == "dead" then print("co2", ok, r, steps) break end
+end
+
+-- deep recursion while hooked, returning to unhooked frames
+local function rec(n) if n == 0 then debug.sethook(function() end, "l") return 0 end return 1 + rec(n - 1) end
+print(rec(50))
+debug.sethook()
+print(work(1000))
+
+-- errors in hooked code keep names and lines
+debug.sethook(function() end, "l")
+print(pcall(function() local t = nil; return t.x end))
+debug.sethook(function() end, "", 1)
+print(pcall(function() local q; q() end))
+debug.sethook()
+print(pcall(function() local t = nil; return t.x end))
+
+-- call and return hooks only (no per-instruction hook)
+local ev = {}
+debug.sethook(function(e) ev[e] = (ev[e] or 0) + 1 end, "cr")
+work(10)
+debug.sethook()
+print(ev.call, ev["return"], ev["tail call"])
@@ -0,0 +1,244 @@
+-- edge cases for compiled code; output must equal the interpreter's
+local function show(...) print(...) end
+local function try(f, ...) local r = table.pack(pcall(f, ...)); show(table.unpack(r, 1, r.n)) end
+
+-- errors with variable names
+for rep = 1, 3 do
+  try(function() local x; for i = 1, 100 do x = (x or 0) + i end; local y; return x + y end)
+  try(function() local t = {}; for i = 1, 100 do t[i] = i end; return t.a.b end)
+  try(function() for i = 1, 100 do local z = i end; return undefinedglobal.x end)
+  try(function() local s = "a"; for i = 1, 100 do s = s .. i end; return s < 1 end)
+  try(function() for i = 1, 100 do end; return 1 // 0 end)
+  try(function() for i = 1, 100 do end; return 1 % 0 end)
+  try(function() local f; for i = 1, 100 do end; f() end)
+  try(function() for i = 1, 100 do end; return 1.5 | 1 end)
+  try(function() for i = 1, 100 do end; return -{} end)
+  try(function() for i = 1, 100 do end; return #nil end)
+  try(function() for i = "a", 2 do end end)
+  try(function() for i = 1, {} do end end)
+  try(function() for i = 1, 2, nil do end end)
+end
+
+-- integer and float arithmetic
+local acc = {}
+for i = 1, 200 do
+  local a, b = i, i * 0.25
+  acc[#acc + 1] = a + b
+  acc[#acc + 1] = a - i
+  acc[#acc + 1] = a * 3
+  acc[#acc + 1] = b / 0
+  acc[#acc + 1] = -b / 0
+  acc[#acc + 1] = a / 7
+  acc[#acc + 1] = a // 7
+  acc[#acc + 1] = a % -7
+  acc[#acc + 1] = b % -7
+  acc[#acc + 1] = 2 ^ (i % 10)
+  acc[#acc + 1] = a & 0xff ~ 3 | 16
+  acc[#acc + 1] = a << 60 >> 3
+  acc[#acc + 1] = ~a
+  acc[#acc + 1] = "10" + a
+  acc[#acc + 1] = a + "0x10"
+  acc[#acc + 1] = math.maxinteger + a
+  acc[#acc + 1] = math.mininteger - a
+  acc[#acc + 1] = math.maxinteger * a
+  acc[#acc + 1] = 3.0 - a
+  acc[#acc + 1] = a * 1.5 - 2
+end
+local h = 0
+for i = 1, #acc do h = (h * 31 + math.type(acc[i]):len()) % 1000003; show(string.format("%q", acc[i])) end
+
+-- comparisons
+local nan = 0/0
+local vals = {1, 1.0, 2, 2.5, -1, nan, math.huge, -math.huge, math.maxinteger, math.mininteger, 2^53, 2^63}
+for rep = 1, 2 do
+  for i = 1, #vals do for j = 1, #vals do
+    local a, b = vals[i], vals[j]
+    show(i, j, a < b, a <= b, a == b, a > b, a >= b, a ~= b, not (a < b), a < 2, a <= 2.5, a == 1, 1 < a, 2.5 <= a)
+  end end
+end
+for i = 1, 100 do
+  local s = tostring(i)
+  if s < "5" then acc[i] = true elseif s == "50" then acc[i] = 1 else acc[i] = false end
+end
+show(table.concat({tostring(acc[3]), tostring(acc[50]), tostring(acc[99])}, ","))
+
+-- metamethods in hot code
+local mt = {}
+mt.__index = function(t, k) return k * 2 end
+mt.__newindex = function(t, k, v) rawset(t, k, v + 1) end
+mt.__lt = function(a, b) return rawlen(a) < rawlen(b) end
+mt.__le = function(a, b) return rawlen(a) <= rawlen(b) end
+mt.__eq = function(a, b) return rawlen(a) == rawlen(b) end
+mt.__add = function(a, b) return "add" end
+mt.__concat = function(a, b) return "cat" end
+mt.__len = function(a) return 42 end
+mt.__call = function(self, x) return x + 1 end
+mt.__unm = function(a) return "unm" end
+local p, q = setmetatable({1}, mt), setmetatable({1, 2}, mt)
+for i = 1, 100 do
+  local t = setmetatable({}, mt)
+  t[i] = i
+  if i % 25 == 0 then
+    show(t[i], t[i + 1], p < q, p <= q, p == q, p + 1, 1 + p, p .. "x", #p, p(i), -p, rawequal(p, q))
+  end
+end
+
+-- for loops
+local cnt = 0
+for i = 1, 0 do cnt = cnt + 1 end
+for i = 10, 1, -3 do cnt = cnt + i end
+for i = 1.0, 2.0, 0.25 do cnt = cnt + i end
+for i = 1, 3.7 do cnt = cnt + i end
+for i = math.maxinteger - 5, math.maxinteger - 1 do cnt = cnt + 1 end
+for i = math.mininteger, math.mininteger + 5 do cnt = cnt + 1 end
+for i = math.mininteger + 6, math.mininteger + 2, -2 do cnt = cnt + 1 end
+for i = 1, math.huge do cnt = cnt + 1; if i > 100 then break end end
+for i = 0.1, 1, 0.1 do cnt = cnt + i end
+for i = 5, 1, -0.5 do cnt = cnt + i end
+show(cnt)
+
+-- closures capturing loop variables (upvalue closing)
+local fs = {}
+for i = 1, 300 do
+  local j = i * 2
+  fs[i] = function() j = j + 1; return i + j end
+end
+local w = 0
+while w < 300 do
+  w = w + 1
+  local c = w
+  fs[w + 300] = function() return c end
+  if w % 2 == 0 then goto cont end
+  c = -c
+  ::cont::
+end
+local sum = 0
+for i = 1, #fs do sum = sum + fs[i]() end
+show(sum, fs[1](), fs[1](), fs[301](), fs[302]())
+
+-- upvalues in hot loops
+local counter = 0
+local function inc(n) for i = 1, n do counter = counter + 1 end return counter end
+for i = 1, 100 do inc(i) end
+show(counter)
+
+-- varargs, select, multiple results, SETLIST
+local function va(...)
+  local a, b, c = ...
+  local t = {...}
+  local n = select('#', ...)
+  return n, a, b, c, #t, ...
+end
+for i = 1, 100 do
+  local r = table.pack(va(i, nil, i, nil))
+  if i % 50 == 0 then show(table.unpack(r, 1, r.n)) end
+end
+local function many(n) local t = {} for i = 1, n do t[i] = i end return table.unpack(t) end
+for i = 1, 3 do
+  local t = {many(300)}
+  local u = {0, many(60)}
+  show(#t, t[300], #u, u[61], select('#', many(200)))
+end
+local big = {}
+for i = 1, 26000 do big[i] = i end
+local src = "return {" .. table.concat(big, ",") .. "}"
+local bigt = load(src)()
+show(#bigt, bigt[25999])
+
+-- tail calls do not grow the stack; deep recursion works
+local function tc(n, a) if n == 0 then return a end return tc(n - 1, a + 1) end
+show(tc(1000000, 0))
+local function deep(n) if n == 0 then return 0 end return 1 + deep(n - 1) end
+show(deep(10000))
+local ok, err = pcall(function() local function inf(n) return 1 + inf(n + 1) end return inf(1) end)
+show(ok, (tostring(err):gsub("^.-:%d+: ", "")))
+
+-- coroutines: yields from inside compiled frames
+local function gen(n)
+  return coroutine.wrap(function()
+    for i = 1, n do coroutine.yield(i) end
+    local t = setmetatable({}, {__index = function(t, k) return coroutine.yield(k) end})
+    for i = 1, 3 do local v = t[i * 10]; coroutine.yield("got " .. tostring(v)) end
+    for k in function(s, c) c = (c or 0) + 1; if c > 3 then return nil end coroutine.yield("it" .. c); return c end do
+      coroutine.yield("k" .. k)
+    end
+    local lt = setmetatable({}, {__lt = function() return coroutine.yield("lt") end})
+    for i = 1, 2 do if lt < lt then coroutine.yield("yes") else coroutine.yield("no") end end
+    return "done"
+  end)
+end
+local g = gen(200)
+local outs = {}
+for i = 1, 230 do local v = g(i % 2 == 0) if v == nil then break end outs[#outs + 1] = tostring(v) if v == "done" then break end end
+show(#outs, table.concat(outs, " ", 195))
+
+-- hooks: count hook interrupts a compiled loop, line hooks see lines
+local n = 0
+debug.sethook(function() n = n + 1; if n == 5 then error("stop") end end, "", 1000)
+show(pcall(function() local x = 0; while true do x = x + 1 end end))
+debug.sethook()
+local lines = {}
+local function traced()
+  local s = 0
+  for i = 1, 3 do
+    s = s + i
+  end
+  return s
+end
+for i = 1, 100 do traced() end
+debug.sethook(function(ev, l) lines[#lines + 1] = l end, "l")
+traced()
+debug.sethook()
+show(table.concat(lines, ","))
+local function sethookmid()
+  local t = {}
+  for i = 1, 200 do
+    if i == 150 then debug.sethook(function(ev, l) t[#t + 1] = l end, "l") end
+    local _ = i
+  end
+  debug.sethook()
+  return #t
+end
+show(sethookmid())
+local calls = 0
+debug.sethook(function(ev) calls = calls + 1 end, "cr")
+for i = 1, 100 do traced() end
+debug.sethook()
+show(calls)
+
+-- traceback and getinfo from compiled frames
+local function lvl3() return debug.traceback("tb", 1):gsub("0x%x+", "ADDR") end
+local function lvl2() for i = 1, 100 do end return lvl3() end
+for i = 1, 70 do lvl2() end
+show(lvl2())
+local function cl() return debug.getinfo(1, "l").currentline end
+for i = 1, 70 do cl() end
+show(cl())
+
+-- strings and methods
+local parts = {}
+for i = 1, 200 do parts[#parts + 1] = ("x"):rep(i % 5) .. i end
+show(#table.concat(parts), ("abc"):upper(), #parts[200])
+
+-- GC barriers: store new objects into old tables during collection
+local old = {}
+for i = 1, 1000 do old[i] = false end
+collectgarbage()
+for rep = 1, 50 do
+  collectgarbage("step", 1)
+  for i = 1, 1000 do old[i] = {i} end
+end
+collectgarbage()
+local s2 = 0
+for i = 1, 1000 do s2 = s2 + old[i][1] end
+show(s2)
+
+-- switching the compiler at run time
+local jit = debug.jit or function() return true end
+local was = jit()
+jit(false)
+local t1 = 0
+for i = 1, 1000 do t1 = t1 + i end
+jit(was)
+for i = 1, 1000 do t1 = t1 + i end
+show(t1, type(jit()))
@@ -0,0 +1,38 @@
+-- machine code of many small functions shares executable memory (not
+-- a page or more each), which is reused once the functions are collected
+
+local function vmsize ()   -- in KB, or nil without /proc
+  local f = io.open("/proc/self/status")
+  if not f then return nil end
+  local s = f:read("a")
+  f:close()
+  return tonumber(s:match("VmSize:%s*(%d+)"))
+end
+
+local function hotfunctions (n)
+  local fs = {}
+  for i = 1, n do
+    local f = load("local x = ... return x + " .. i)   -- a new prototype
+    for j = 1, 100 do assert(f(j) == j + i) end
+    fs[i] = f
+  end
+  return fs
+end
+
+-- address space not explained by the Lua heap
+local function overhead (f)
+  collectgarbage()
+  local vm, kb = vmsize(), collectgarbage("count")
+  local res = f()
+  if vm == nil then return 0, res end
+  return (vmsize() - vm) - (collectgarbage("count") - kb), res
+end
+
+local n, fs = overhead(function () return hotfunctions(5000) end)
+assert(n < 10000, "too much memory for the code of small functions")
+fs = nil
+collectgarbage()
+n, fs = overhead(function () return hotfunctions(5000) end)
+assert(n < 5000, "code of collected functions not reused")
+for i = 1, #fs, 97 do assert(fs[i](1) == 1 + i) end
+print "OK"
@@ -0,0 +1,401 @@
+/*
+** $Id: lua.c $
+** Interpreter for the regression tests and benchmarks in this directory
+** See Copyright Notice in lua.h
+*/
+
+/*
+** Usage: lua script.lua [args]
+**
+** Environment variables:
+**   LUA_ALLOC=check  check the old size of every realloc and free
+**   LUA_ALLOC=aux    use the allocator of 'luaL_newstate'
+**   LUA_GEN=n        run in generational mode ('lua_gc' LUA_GCGEN n)
+**   LUA_STEPTIME=n   time-bounded GC steps of n microseconds
+**   LUA_TIMING=1     record GC step times
+**   LUA_PEAK=1       print the peak of allocated memory (with the default
+**                    allocator only) and the CPU time on exit
+**
+** Besides the standard libraries, scripts get 'nallocs()', the number
+** of blocks allocated so far and the bytes in use (with the default
+** allocator only), and
+** the functions in table 'T', which reach parts of the C API that the
+** libraries do not use.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lualib.h"
+
+
+static long nallocs = 0;
+static size_t curmem = 0;
+static size_t peakmem = 0;
+
+
+/* like 'l_alloc' in lauxlib.c, counting blocks and bytes */
+static void *countalloc (void *ud, void *ptr, size_t osize, size_t nsize) {
+  void *nb;
+  (void)ud;
+  if (ptr == NULL) osize = 0;
+  if (nsize == 0) {
+    free(ptr);
+    curmem -= osize;
+    return NULL;
+  }
+  nb = realloc(ptr, nsize);
+  if (nb != NULL) {
+    if (ptr == NULL) nallocs++;
+    curmem += nsize - osize;
+    if (curmem > peakmem) peakmem = curmem;
+  }
+  return nb;
+}
+
+
+/* keeps the size of each block before it and checks 'osize' against it */
+static void *checkalloc (void *ud, void *ptr, size_t osize, size_t nsize) {
+  size_t *h = (ptr != NULL) ? (size_t *)ptr - 2 : NULL;
+  (void)ud;
+  if (h != NULL && h[0] != osize) {
+    fprintf(stderr, "bad old size %lu (real %lu)\n",
+                    (unsigned long)osize, (unsigned long)h[0]);
+    abort();
+  }
+  if (nsize == 0) {
+    free(h);
+    return NULL;
+  }
+  h = (size_t *)realloc(h, nsize + 2 * sizeof(size_t));
+  if (h == NULL) return NULL;
+  h[0] = nsize;
+  return h + 2;
+}
+
+
+static int l_nallocs (lua_State *L) {
+  lua_pushinteger(L, nallocs);
+  lua_pushinteger(L, (lua_Integer)curmem);
+  return 2;
+}
+
+
+/*
+** {======================================================
+** Table 'T'
+** =======================================================
+*/
+
+static int upvalue_aux (lua_State *L) {
+  size_t l;
+  const char *s = lua_tolstring(L, lua_upvalueindex(1), &l);
+  lua_pushlstring(L, s, l);
+  return 1;
+}
+
+/*
+** T.stringupvalue(s): a C closure with upvalue 's' (which can be a
+** string view) that returns 'lua_tolstring' of that upvalue
+*/
+static int t_stringupvalue (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TSTRING);
+  lua_settop(L, 1);
+  lua_pushcclosure(L, upvalue_aux, 1);
+  return 1;
+}
+
+
+/* T.newuserdata(size): a new full userdata, with no metatable */
+static int t_newuserdata (lua_State *L) {
+  lua_Integer sz = luaL_checkinteger(L, 1);
+  memset(lua_newuserdata(L, (size_t)sz), 0, (size_t)sz);
+  return 1;
+}
+
+
+/*
+** T.emptyarray(kind): a typed array of the given kind ("float64",
+** "float32", "int32" or "uint8") with no elements, made by
+** 'lua_pusharray' over NULL
+*/
+static int t_emptyarray (lua_State *L) {
+  static const char *const kinds[] = {
+    "float64", "float32", "int32", "uint8", NULL
+  };
+  lua_pusharray(L, luaL_checkoption(L, 1, NULL, kinds), NULL, 0);
+  return 1;
+}
+
+
+/*
+** T.cformat(fmt, x): float 'x' formatted by the C library with 'fmt',
+** a single conversion of a double such as "%.17g" (to check the float
+** formatter of the core against it)
+*/
+static int t_cformat (lua_State *L) {
+  const char *fmt = luaL_checkstring(L, 1);
+  double x = (double)luaL_checknumber(L, 2);
+  char buff[512];
+  int n = snprintf(buff, sizeof(buff), fmt, x);
+  luaL_argcheck(L, 0 <= n && n < (int)sizeof(buff), 1, "result too long");
+  lua_pushlstring(L, buff, (size_t)n);
+  return 1;
+}
+
+
+/*
+** T.strtod(s): numeral 's' read by the C library's 'strtod', or nil if
+** 'strtod' does not take all of 's' (but trailing spaces)
+*/
+static int t_strtod (lua_State *L) {
+  const char *s = luaL_checkstring(L, 1);
+  char *e;
+  double x = strtod(s, &e);
+  if (e == s)
+    return 0;
+  while (isspace((unsigned char)*e)) e++;
+  if (*e != '\0')
+    return 0;
+  lua_pushnumber(L, (lua_Number)x);
+  return 1;
+}
+
+
+#if defined(LUAI_ALLOCFAIL)
+
+extern int luai_allocfail;  /* in lauxlib.c */
+
+
+/* whether the first 'n' bytes of 'b' are as 't_allocshrink' filled them */
+static int intact (const unsigned char *b, size_t n) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    if (b[i] != (unsigned char)(i * 7))
+      return 0;
+  }
+  return 1;
+}
+
+
+/*
+** T.allocshrink(osize, nsize): with the allocator of 'luaL_newstate',
+** allocates a block of 'osize' bytes and, while no new block can be
+** allocated, shrinks it to 'nsize' and then to about half of that;
+** then grows it back to 'osize' and frees it. Returns whether every
+** step succeeded and kept the contents of the block.
+*/
+static int t_allocshrink (lua_State *L) {
+  size_t osize = (size_t)luaL_checkinteger(L, 1);
+  size_t nsize = (size_t)luaL_checkinteger(L, 2);
+  size_t hsize = nsize / 2 + 1;
+  lua_State *L1;
+  lua_Alloc f;
+  void *ud;
+  unsigned char *b;
+  size_t i;
+  int ok;
+  luaL_argcheck(L, 0 < nsize && nsize <= osize, 2, "not a shrink");
+  L1 = luaL_newstate();
+  if (L1 == NULL)
+    return luaL_error(L, "cannot create state");
+  f = lua_getallocf(L1, &ud);
+  b = (unsigned char *)f(ud, NULL, 0, osize);
+  if (b == NULL) {
+    lua_close(L1);
+    return luaL_error(L, "cannot allocate the block");
+  }
+  for (i = 0; i < osize; i++)  /* fill */
+    b[i] = (unsigned char)(i * 7);
+  luai_allocfail = 1;
+  ok = ((b = (unsigned char *)f(ud, b, osize, nsize)) != NULL &&
+        intact(b, nsize) &&
+        (b = (unsigned char *)f(ud, b, nsize, hsize)) != NULL &&
+        intact(b, hsize));
+  luai_allocfail = 0;
+  if (ok) {
+    ok = ((b = (unsigned char *)f(ud, b, hsize, osize)) != NULL &&
+          intact(b, hsize));
+    if (ok)
+      f(ud, b, osize, 0);
+  }
+  lua_close(L1);
+  lua_pushboolean(L, ok);
+  return 1;
+}
+
+#endif
+
+
+static int bound_aux (lua_State *L) {
+  lua_pushboolean(L, 1);
+  return 1;
+}
+
+
+/*
+** T.boundfunction(): a function bound to its state the way the app
+** binds its Swift functions, as a C closure whose upvalue is a userdata
+** with no '__clone', so that 'lua_clonestate' refuses any state that
+** can reach it. It returns true.
+*/
+static int t_boundfunction (lua_State *L) {
+  lua_newuserdata(L, 0);
+  lua_pushcclosure(L, bound_aux, 1);
+  return 1;
+}
+
+
+static void opentlib (lua_State *L);
+
+
+/*
+** Other states, as light userdata: T.newstate() creates one with the
+** standard libraries and 'T', T.clone(s) clones 's' with
+** 'luaL_clonestate' (or returns nil if that fails), and T.close(s)
+** closes 's'. T.dostring(s, code) runs 'code' in 's' and returns
+** whether it ran without errors, followed by its results (or the error
+** message) as strings.
+*/
+static lua_State *tostate (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+  return (lua_State *)lua_touserdata(L, 1);
+}
+
+
+static int t_newstate (lua_State *L) {
+  lua_State *L1 = luaL_newstate();
+  if (L1 == NULL)
+    return luaL_error(L, "cannot create state");
+  luaL_openlibs(L1);
+  opentlib(L1);
+  lua_pushlightuserdata(L, L1);
+  return 1;
+}
+
+
+static int t_clone (lua_State *L) {
+  lua_State *L1 = luaL_clonestate(tostate(L));
+  if (L1 == NULL)
+    lua_pushnil(L);
+  else
+    lua_pushlightuserdata(L, L1);
+  return 1;
+}
+
+
+static int t_close (lua_State *L) {
+  lua_close(tostate(L));
+  return 0;
+}
+
+
+static int t_dostring (lua_State *L) {
+  lua_State *L1 = tostate(L);
+  const char *code = luaL_checkstring(L, 2);
+  int top = lua_gettop(L1);
+  int status = luaL_dostring(L1, code);
+  int n = lua_gettop(L1) - top;
+  int i;
+  luaL_checkstack(L, n + 1, "too many results");
+  lua_pushboolean(L, status == LUA_OK);
+  for (i = top + 1; i <= top + n; i++) {
+    lua_pushstring(L, luaL_tolstring(L1, i, NULL));
+    lua_pop(L1, 1);
+  }
+  lua_settop(L1, top);
+  return n + 1;
+}
+
+
+static const luaL_Reg tlib[] = {
+  {"stringupvalue", t_stringupvalue},
+  {"newuserdata", t_newuserdata},
+  {"emptyarray", t_emptyarray},
+  {"cformat", t_cformat},
+  {"strtod", t_strtod},
+#if defined(LUAI_ALLOCFAIL)
+  {"allocshrink", t_allocshrink},
+#endif
+  {"boundfunction", t_boundfunction},
+  {"newstate", t_newstate},
+  {"clone", t_clone},
+  {"close", t_close},
+  {"dostring", t_dostring},
+  {NULL, NULL}
+};
+
+
+static void opentlib (lua_State *L) {
+  luaL_newlib(L, tlib);
+  lua_setglobal(L, "T");
+}
+
+/* }====================================================== */
+
+
+static int traceback (lua_State *L) {
+  const char *msg = lua_tostring(L, 1);
+  luaL_traceback(L, L, msg, 1);
+  return 1;
+}
+
+
+static lua_State *newstate (void) {
+  const char *a = getenv("LUA_ALLOC");
+  if (a != NULL && strcmp(a, "check") == 0)
+    return lua_newstate(checkalloc, NULL);
+  else if (a != NULL && strcmp(a, "aux") == 0)
+    return luaL_newstate();
+  else
+    return lua_newstate(countalloc, NULL);
+}
+
+
+static void setgc (lua_State *L) {
+  const char *e;
+  if ((e = getenv("LUA_GEN")) != NULL)
+    lua_gc(L, LUA_GCGEN, atoi(e));
+  if ((e = getenv("LUA_STEPTIME")) != NULL)
+    lua_gc(L, LUA_GCSTEPTIME, atoi(e));
+  if (getenv("LUA_TIMING") != NULL)
+    lua_gc(L, LUA_GCTIMING, 1);
+}
+
+
+int main (int argc, char **argv) {
+  lua_State *L = newstate();
+  int status;
+  int i;
+  if (L == NULL) {
+    fprintf(stderr, "%s: cannot create state\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  luaL_openlibs(L);
+  setgc(L);
+  lua_register(L, "nallocs", l_nallocs);
+  opentlib(L);
+  lua_createtable(L, argc, 0);
+  for (i = 0; i < argc; i++) {
+    lua_pushstring(L, argv[i]);
+    lua_rawseti(L, -2, i - 1);
+  }
+  lua_setglobal(L, "arg");
+  lua_pushcfunction(L, traceback);
+  status = luaL_loadfile(L, (argc < 2) ? NULL : argv[1]);
+  if (status == LUA_OK)
+    status = lua_pcall(L, 0, 0, 1);
+  if (status != LUA_OK)
+    fprintf(stderr, "%s\n", lua_tostring(L, -1));
+  lua_close(L);
+  if (getenv("LUA_PEAK") != NULL)
+    fprintf(stderr, "peak %.1f MB  time %.2f s\n", peakmem / 1048576.0,
+                    (double)clock() / CLOCKS_PER_SEC);
+  return (status == LUA_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
@@ -0,0 +1,39 @@
+-- NaNs of both signs look the same in every layout of values
+-- (LUA_NANBOXING keeps the sign of a NaN, not its payload)
+
+local nan = 0/0
+local values = {
+  nan, -nan, -(-nan), nan * -1, math.huge - math.huge, -math.huge + math.huge,
+  math.huge * 0, math.fmod(1, 0.0), math.sqrt(-1), math.log(-1),
+  math.abs(nan), math.abs(-nan), nan + 1, 1 - nan, nan // 1, nan % 1,
+}
+local t, keep = {}, {}
+for i = 1, #values do
+  local v = values[i]
+  keep[i] = v          -- through a table (array part)
+  t["k" .. i] = v      -- and hash part
+end
+
+for i = 1, #values do
+  local v, a, h = values[i], keep[i], t["k" .. i]
+  print(i, tostring(v), string.format("%f %g %.3e %5.1f", v, v, v, v),
+        v .. "", tostring(a), tostring(h), v ~= v, math.type(v))
+  if math.type(v) == "float" then
+    -- the byte with the sign and high exponent bits
+    print("", string.pack("<d", v):byte(8), string.pack(">d", a):byte(1))
+  end
+end
+
+-- unpacked NaNs
+for _, s in ipairs{"\0\0\0\0\0\0\248\127", "\0\0\0\0\0\0\248\255",
+                   "\1\0\0\0\0\0\240\127", "\1\0\0\0\0\0\240\255"} do
+  local v = string.unpack("<d", s)
+  print(tostring(v), string.format("%f", v), v ~= v, -v ~= -v)
+end
+
+-- NaN as a key, in comparisons and in min/max
+print(pcall(function () t[nan] = 1 end))
+print(pcall(function () t[-nan] = 1 end))
+print(t[nan], t[-nan], rawget(t, nan))
+print(nan == nan, nan < 1, 1 < nan, nan <= nan, -nan >= -nan)
+print(math.max(nan, 1), math.max(1, nan), math.min(-nan, 1), math.min(1, -nan))
@@ -0,0 +1,44 @@
+-- integers around the 48-bit payload limit, NaN, weak tables, GC of boxes
+local lim = {1<<47, (1<<47)-1, -(1<<47), -(1<<47)-1, math.maxinteger, math.mininteger, 0, -1, 1<<62}
+for _, v in ipairs(lim) do
+  print(v, v+1, v-1, v*2, v//3, v%7, v>>1, v<<1, ~v, -v, math.type(v), v == v+0, tostring(v))
+end
+local t = {}
+for i, v in ipairs(lim) do t[v] = i end
+for i, v in ipairs(lim) do assert(t[v] == i) end
+for i, v in ipairs(lim) do assert(t[v + 0.0] == t[math.tointeger(v + 0.0)]) end
+local n = 0 for k in pairs(t) do n = n + 1 end print("keys", n)
+print(0/0 ~= 0/0, -(0/0) ~= -(0/0), math.huge, -math.huge, -0.0, 1/-0.0)
+local nan = 0/0
+local ok = pcall(function() t[nan] = 1 end) print("nan key", ok)
+print(math.tointeger("9223372036854775807"), tonumber("0x7fffffffffffffff"), tonumber("140737488355328"),
+      "140737488355328" + 0, "140737488355328" | 0, ("3" .. "") * (1<<50))
+-- big integer arithmetic loop (allocates boxes)
+local x = 1 << 50
+local s = 0
+for i = 1, 200000 do x = x + 1; s = s ~ x end
+print(x, s, collectgarbage("count") < 20000)
+-- weak tables keep integer keys and values
+local w = setmetatable({}, {__mode = "kv"})
+w[1 << 60] = 1 << 61; w[1] = 2; w[{}] = 1
+collectgarbage(); collectgarbage()
+local c = 0 for k, v in pairs(w) do c = c + 1 end
+print("weak", c, w[1 << 60], w[1])
+-- big loops counters
+local cnt = 0
+for i = math.maxinteger - 3, math.maxinteger - 1 do cnt = cnt + 1 end
+for i = math.mininteger + 3, math.mininteger + 1, -1 do cnt = cnt + 1 end
+print("for", cnt)
+-- constants
+local a, b = 123456789012345678, -123456789012345678
+print(a, b, a + b, 123456789012345678 == a, string.format("%d %x", a, a))
+-- string.pack / unpack with big ints
+print(string.unpack("j", string.pack("j", math.mininteger)))
+-- tail calls with boxes
+local function tc(n, acc) if n == 0 then return acc end return tc(n - 1, acc + (1 << 55)) end
+print(tc(100000, 0))
+-- userdata user values
+local co = coroutine.wrap(function(...) local v = ... ; while true do v = coroutine.yield(v * (1<<40)) end end)
+print(co(3), co(1 << 20))
+print(select('#', table.unpack({1, nil, 3}, 1, 3)), #"abc", next({}))
+print(string.format("%.14g", 2^53), 2^63, math.ult(1, -1), 7 // 0.0, -7 // 0.0, pcall(function() return 1 // 0 end))
@@ -0,0 +1,71 @@
+-- 'next' while keys are deleted and inserted again. Once the collector
+-- has turned a deleted entry into a dead key, the same key can come
+-- back in another node; 'next' must find the live one and end.
+
+local function count (t, max)
+  local n = 0
+  for k, v in next, t do
+    n = n + 1
+    assert(n <= max, "'next' does not end")
+    assert(t[k] == v)
+  end
+  return n
+end
+
+-- string keys, deleted during a traversal and added back after a GC
+local keys = {}
+for i = 1, 40 do keys[i] = "key" .. i end
+local t = {}
+for i = 1, 40 do t[keys[i]] = i end
+for r = 1, 200 do
+  for k in next, t do   -- clearing fields during a traversal is allowed
+    if #k % 3 == r % 3 then t[k] = nil end
+  end
+  collectgarbage()
+  for i = 1, 40 do t[keys[i]] = t[keys[i]] or r end
+  assert(count(t, 40) == 40)
+end
+
+-- table keys
+local objs = {}
+for i = 1, 50 do objs[i] = {} end
+t = {}
+for i = 1, 50 do t[objs[i]] = i end
+for r = 1, 100 do
+  for i = r % 5 + 1, 50, 5 do t[objs[i]] = nil end
+  collectgarbage()
+  for i = 1, 50, 2 do t[objs[i]] = i end
+  for i = 2, 50, 2 do t[objs[i]] = t[objs[i]] or i end
+  assert(count(t, 50) == 50)
+end
+
+-- a bounded cache that evicts the first key 'next' gives
+t = {}
+local n = 0
+for i = 1, 100000 do
+  local k = "p" .. (i % 97) .. "x"
+  if t[k] == nil then
+    if n == 64 then
+      t[next(t)] = nil
+      n = n - 1
+      if i % 1000 == 0 then collectgarbage() end
+    end
+    t[k] = i
+    n = n + 1
+    assert(count(t, 64) == n)
+  end
+end
+
+-- rolling window of keys
+t = {}
+for i = 1, 64 do t["k" .. i] = i end
+for i = 65, 20000 do
+  t["k" .. (i - 64)] = nil
+  t["k" .. i] = i
+  if i % 500 == 0 then
+    collectgarbage()
+    assert(count(t, 64) == 64)
+  end
+end
+
+print "OK"
@@ -0,0 +1,98 @@
+-- pattern matching: random patterns and subjects through find, match,
+-- gsub and gmatch, and the cache of compiled patterns
+--
+-- The random part prints a digest of the results of each block of
+-- cases; patterns.expected comes from unmodified Lua 5.3.0, whose
+-- matcher interprets patterns, so the compiled patterns must give the
+-- same results, errors included. Run 'lua patterns.lua dump <seed>'
+-- to print the results themselves, to compare two builds.
+
+local atoms = {"a", "b", "c", ".", "%a", "%d", "%s", "%w", "[abc]", "[^a]",
+  "[a-c]", "[%a_]", "[%]x]", "%%", "%.", "(", ")", "()", "%1", "%2", "%b()",
+  "%f[%w]", "%f[a]", "$", "^", "*", "+", "-", "?", "x", "%", "[", "]", "%b",
+  "%f", "%0", "%z", "%q", "[^%d]"}
+local chars = {"a", "b", "c", "x", "1", "2", " ", "(", ")", "_", "%", ".", "\0"}
+
+local function rpat ()
+  local t = {}
+  for i = 1, math.random(1, 6) do t[#t + 1] = atoms[math.random(#atoms)] end
+  return table.concat(t)
+end
+
+local function rsub ()
+  local t = {}
+  for i = 1, math.random(0, 20) do t[#t + 1] = chars[math.random(#chars)] end
+  return table.concat(t)
+end
+
+local function ser (ok, ...)
+  local t = {tostring(ok)}
+  for i = 1, select('#', ...) do t[#t + 1] = tostring((select(i, ...))) end
+  return table.concat(t, ",")
+end
+
+local function gmatchall (s, p)
+  local r = {}
+  for a, b in string.gmatch(s, p) do
+    r[#r + 1] = tostring(a) .. ":" .. tostring(b)
+    if #r > 50 then break end
+  end
+  return table.concat(r, ";")
+end
+
+-- results of one random case
+local function case (out)
+  local p, s = rpat(), rsub()
+  local init = math.random(-3, 25)
+  out[#out + 1] = ser(pcall(string.find, s, p, init))
+  out[#out + 1] = ser(pcall(string.match, s, p, init))
+  out[#out + 1] = ser(pcall(string.gsub, s, p, "<%0>", math.random(0, 5)))
+  out[#out + 1] = ser(pcall(string.gsub, s, p,
+                            function (a, b) return b and a .. b or a end))
+  out[#out + 1] = ser(pcall(gmatchall, s, p))
+end
+
+local function digest (s)
+  s = s .. string.rep("\0", 7)
+  local h = #s
+  for i = 1, #s - 7, 8 do h = h * 31 + string.unpack("<i8", s, i) end
+  return string.format("%016x", h)
+end
+
+if arg[1] == "dump" then
+  math.randomseed(tonumber(arg[2]) or 1)
+  local out = {}
+  for i = 1, 2000 do case(out) end
+  io.write(table.concat(out, "\n"), "\n")
+  return
+end
+
+for seed = 1, 3 do
+  math.randomseed(seed)
+  for block = 1, 8 do
+    local out = {}
+    for i = 1, 250 do case(out) end
+    print(seed, block, digest(table.concat(out, "\n")))
+  end
+end
+
+-- more patterns than the cache holds, with collections in between:
+-- evicting a pattern deletes a key of the cache while others are added
+-- again later, and gmatch iterators keep evicted patterns in use
+local iters = {}
+for i = 1, 20000 do
+  local k = i % 97
+  local p = "(%d+)" .. string.rep("x", k % 7) .. "()"
+  local s = "12" .. string.rep("x", k % 7) .. "z"
+  local a, b = string.match(s, p)
+  assert(a == "12" and b == 3 + k % 7)
+  if i % 100 == 0 then
+    iters[#iters + 1] = string.gmatch("1x 22x 333x", "(%d+)x")
+    collectgarbage()
+  end
+end
+for _, it in ipairs(iters) do
+  assert(it() == "1" and it() == "22" and it() == "333" and it() == nil)
+end
+
+print "OK"
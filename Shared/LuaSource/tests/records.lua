@@ -0,0 +1,59 @@
+-- records of up to 4 fields keep their slots in the table block
+-- (run with LUA_ALLOC=check to also check the sizes of freed blocks)
+local N = 1000
+local keep = {}
+for i = 1, N do keep[i] = false end
+
+-- blocks allocated per call of 'f', rounded (the collector and the
+-- interpreter allocate a few blocks of their own now and then)
+local function allocs(f)
+  local a = nallocs()
+  for i = 1, N do keep[i] = f(i) end
+  return math.floor((nallocs() - a) / N * 10 + 0.5) / 10
+end
+
+if nallocs() > 0 then  -- blocks are counted?
+  assert(allocs(function(i) return {x = i, y = i, z = i} end) == 1)
+  assert(allocs(function(i) return {x = i, y = i, z = i, w = i} end) == 1)
+  assert(allocs(function(i) local r = {x = i} r.y = i r.z = i return r end) == 1)
+  assert(allocs(function(i) return {a = i, b = i, c = i, d = i, e = i} end) == 2)
+  assert(allocs(function(i) local r = {} r.x = i return r end) == 2)
+end
+
+-- growing past the inline room moves the slots out
+local r = {x = 1, y = 2, z = 3, w = 4}
+r.v = 5
+r.u = 6
+assert(r.x == 1 and r.w == 4 and r.v == 5 and r.u == 6)
+local n = 0
+for k, v in pairs(r) do n = n + 1 assert(r[k] == v) end
+assert(n == 6)
+r.x = nil; r.x = 7
+assert(r.x == 7 and r.y == 2)
+
+-- leaving shape mode from inline slots
+local s = {x = 1, y = 2}
+s[1] = "a"
+s.z = 3
+assert(s.x == 1 and s.y == 2 and s.z == 3 and s[1] == "a")
+local q = {x = 1, y = 2, z = 3}
+for i = 1, 40 do q["k" .. i] = i end
+assert(q.x == 1 and q.z == 3 and q.k40 == 40)
+
+-- copies do not share the slots of the original
+local c = table.clone({x = 1, y = 2, z = 3})
+local d = table.clone(c)
+d.x = 10; d.w = 4; d.v = 5
+assert(c.x == 1 and c.w == nil and d.x == 10 and d.v == 5)
+table.clear(c)
+assert(next(c) == nil and d.y == 2)
+
+-- inline records die with their slots
+for i = 1, N do keep[i] = nil end
+for i = 1, 20 * N do
+  local t = {x = i, y = i}
+  if i % 3 == 0 then t.z = i t.w = i t.v = i end
+  if i % 7 == 0 then keep[i % N + 1] = t end
+end
+collectgarbage()
+for i = 1, N do local t = keep[i] assert(t == nil or t.x == t.y) end
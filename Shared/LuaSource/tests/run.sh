@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# Regression tests for the Lua core in ..
+#
+# usage: tests/run.sh [script.lua ...]
+#
+# Builds the interpreter in lua.c in several configurations and runs the
+# scripts (all *.lua here by default) with each of them. A script with a
+# '.expected' file must print exactly that on stdout, with addresses
+# replaced by ADDR. Most of these files are the output of unmodified
+# Lua 5.3.0 (with glibc's printf). Any other script must just run
+# without errors.
+#
+# Environment:
+#   CC        compiler (default cc)
+#   CFLAGS    extra flags for every configuration
+#   ASAN=1    build with ASan, UBSan and internal assertions
+#   CONFIGS   configurations to test (default: all of them)
+
+cd "$(dirname "$0")" || exit 1
+
+CC=${CC:-cc}
+case $(uname) in
+  Darwin) PLAT="-DLUA_USE_MACOSX" ;;
+  *) PLAT="-DLUA_USE_LINUX"; LIBS="-ldl" ;;
+esac
+if [ -n "$ASAN" ]; then
+  OPT="-g -O1 -fno-omit-frame-pointer -fsanitize=address,undefined -DLUAI_ASSERT"
+else
+  OPT="-O2"
+fi
+CONFIGS=${CONFIGS:-"default nojit jithot nanbox swiss"}
+
+flags () {
+  case $1 in
+    default) echo "" ;;
+    nojit) echo "-DLUA_NOJIT" ;;
+    jithot) echo "-DLUAI_JITHOT=1" ;;
+    nanbox) echo "-DLUA_NANBOXING" ;;
+    swiss) echo "-DLUA_SWISSTABLE" ;;
+  esac
+}
+
+[ $# -gt 0 ] || set -- *.lua
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+fail=0
+
+for c in $CONFIGS; do
+  lua="$TMP/lua-$c"
+  # (LUAI_ALLOCFAIL lets the tests make the allocator fail)
+  if ! $CC -std=gnu99 $OPT -DLUA_COMPAT_5_2 -DLUAI_ALLOCFAIL $PLAT \
+       $(flags $c) $CFLAGS \
+       -I.. -o "$lua" ../l*.c lua.c -lm $LIBS; then
+    echo "$c: build failed"
+    exit 1
+  fi
+  for f in "$@"; do
+    t=${f%.lua}
+    if ! "$lua" "$f" > "$TMP/out" 2> "$TMP/err"; then
+      echo "$c $f: FAILED"
+      cat "$TMP/err"
+      fail=1
+    elif [ -f "$t.expected" ]; then
+      sed -e 's/0x[0-9a-f]\{8,\}/ADDR/g' "$TMP/out" > "$TMP/masked"
+      if ! cmp -s "$t.expected" "$TMP/masked"; then
+        echo "$c $f: output differs"
+        diff "$t.expected" "$TMP/masked" | head -20
+        fail=1
+      fi
+    fi
+  done
+  echo "$c: done"
+done
+
+[ $fail = 0 ] && echo "all tests passed"
+exit $fail
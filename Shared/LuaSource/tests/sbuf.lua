@@ -0,0 +1,45 @@
+local b = string.buffer()
+assert(#b == 0 and tostring(b) == "" and b:tostring() == "")
+assert(b:put("abc", 12, 1.5, "") == b)
+assert(tostring(b) == "abc121.5", tostring(b))
+b:putf("[%5.2f|%d|%s|%q]", 3.14159, 42, "x", "a\nb")
+assert(b:tostring() == 'abc121.5[ 3.14|42|x|"a\\\nb"]', b:tostring())
+b:reset(); assert(#b == 0)
+b:rep("ab", 3, ","); assert(b:tostring() == "ab,ab,ab")
+b:rep("x", 0); b:rep("y", -1); assert(#b == 8)
+b:put(b); assert(b:tostring() == "ab,ab,abab,ab,ab")
+local c = string.buffer(100); c:put("<", b, ">"); assert(c:tostring() == "<ab,ab,abab,ab,ab>")
+assert(not pcall(b.put, b, {}))
+assert(not pcall(b.put, {}, "x"))
+assert(not pcall(b.putf, b, "%y", 1))
+assert(not pcall(string.buffer, -1))
+-- large content, geometric growth
+local big = string.buffer()
+for i = 1, 100000 do big:putf("v %d %d %d\n", i, i + 1, i + 2) end
+local s = big:tostring()
+assert(#s == #big and s:sub(1, 8) == "v 1 2 3\n")
+-- putf larger than the luaL_Buffer initial space
+big:reset(); big:putf("%s%s", string.rep("a", 10000), string.rep("b", 20000))
+assert(#big == 30000)
+-- ... does not leave its temporary block behind
+if nallocs() > 0 then  -- bytes are counted?
+  local x = string.rep("x", 100000)
+  collectgarbage(); collectgarbage("stop")
+  big:reset(); big:putf("%s", x)
+  local _, m = nallocs()
+  for i = 1, 100 do big:reset(); big:putf("%s", x) end
+  local _, m1 = nallocs()
+  collectgarbage("restart")
+  assert(m1 - m < 1000000, m1 - m)
+end
+-- io.write with buffers
+local fn = os.tmpname()
+local f = io.open(fn, "w"); f:write(b, "|", c); f:close()
+f = io.open(fn); assert(f:read("a") == "ab,ab,abab,ab,ab|<ab,ab,abab,ab,ab>"); f:close(); os.remove(fn)
+-- string.format still works everywhere
+assert(string.format("%s=%d", "k", 7) == "k=7")
+assert(#string.format("%s", string.rep("x", 20000)) == 20000)
+assert(#string.rep("abc", 10000, "--") == 30000 + 9999 * 2)
+assert(table.concat({string.rep("z", 9000), string.rep("w", 9000)}) == string.rep("z", 9000) .. string.rep("w", 9000))
+collectgarbage()
+print("OK")
@@ -0,0 +1,73 @@
+local function keys(t) local r = {} for k, v in pairs(t) do r[#r+1] = tostring(k).."="..tostring(v) end table.sort(r) return table.concat(r, ",") end
+local mt = {__index = function(t, k) return "idx:"..k end}
+local vs = {}
+for i = 1, 1000 do
+  vs[i] = setmetatable({x = i, y = i * 2, z = i * 3}, mt)
+end
+local s = 0
+for i = 1, 1000 do local v = vs[i]; s = s + v.x + v.y + v.z end
+print(s, vs[5].w, keys(vs[7]))
+-- nil assignment and re-add
+local a = {x = 1, y = 2}
+a.x = nil
+print(keys(a), a.x, next(a))
+a.x = 5 print(keys(a))
+-- conversion by int key, long key, too many keys
+local b = {p = 1, q = 2}
+b[1] = "one" print(keys(b), #b)
+local c = {p = 1}
+c[string.rep("k", 50)] = 3 print(keys(c))
+local d = {}
+for i = 1, 20 do d["k"..i] = i end
+print(keys(d))
+for i = 1, 20 do d["k"..i] = nil end
+print(next(d))
+-- next during traversal with assignments to existing fields
+local e = {a = 1, b = 2, c = 3, d = 4}
+for k in pairs(e) do e[k] = nil end
+print(next(e))
+-- rawset/rawget
+local f = setmetatable({u = 1}, {__newindex = function(t, k, v) rawset(t, k, v * 10) end})
+f.v = 2; rawset(f, "w", 3); f.u = 7
+print(keys(f), rawget(f, "v"))
+-- weak values
+local w = setmetatable({k1 = {}, k2 = "s"}, {__mode = "v"})
+collectgarbage() collectgarbage()
+print(keys(w))
+local wk = setmetatable({k1 = {}, k2 = {}}, {__mode = "k"})
+collectgarbage()
+print(wk.k1 ~= nil, wk.k2 ~= nil)
+local wkv = setmetatable({k1 = {}}, {__mode = "kv"})
+collectgarbage()
+print(wkv.k1)
+-- many shapes / dictionaries, with GC churn
+for round = 1, 50 do
+  local objs = {}
+  for i = 1, 200 do
+    local o = {}
+    o["f"..(i % 37)] = i
+    o["g"..(i % 11)] = i
+    o.h = round
+    objs[i] = o
+  end
+  collectgarbage("step", 100)
+end
+collectgarbage()
+-- table.insert / setlist with multret into record
+local function mr() return 1, 2, 3 end
+local g = {x = 1, mr()}
+print(keys(g), #g)
+local h = {}
+table.insert(h, "a") table.insert(h, "b")
+print(#h, h[1], h[2])
+-- method calls
+local obj = {n = 0}
+function obj:inc() self.n = self.n + 1 end
+for i = 1, 10 do obj:inc() end
+print(obj.n)
+-- next with invalid key
+print(pcall(next, {a = 1}, "zz"))
+print(#{x = 1}, #{})
+local big = {a=1,b=2,c=3,d=4,e=5,f=6,g=7,h=8}
+big.i = 9
+print(keys(big))
@@ -0,0 +1,36 @@
+print(("%5.2f|%d|%s|%q|%x|%g|%e"):format(3.14159, 42, "hi", "a\nb\0c", 255, 1e20, 12345.678))
+print(string.format("%.14g", 0.1), 0.1, 1/3, -0.0, 1e100, 2^63, -2^63, 100, 100.0, 1e15, 1e16)
+print(string.format("%10s|%-10s|%.3s", "a", "b", "abcdef"))
+print(string.format("%5.1f %08.3f %+.2e %.0f %#x %o %c", 2.25, -3.14159, 12345.6789, 2.5, 255, 8, 65))
+print(string.format("%a", 1.0) ~= nil, string.format("%i", 7))
+print(tostring(1e300 * 1e10), tostring(-1e300 * 1e10), tostring(0/0) == tostring(0/0))
+print(3 // 0.0, -3 // 0.0, 3 % -2, -3 % 2, 3.5 % -2, 5 // 2, -5 // 2, 5.0 // 2, 2^2, 7 / 2)
+print(math.tointeger(3.0), math.tointeger(3.5), 3 | 0, pcall(function() return 3.5 | 0 end))
+print(tonumber("0x10"), tonumber("  10  "), tonumber("1e2"), tonumber("0x1p4"), tonumber("10", 2), tonumber("zz", 36), tonumber("1e"), tonumber(""), tonumber("0x"), tonumber(".5"), tonumber("5."), tonumber("inf"), tonumber("nan"))
+print(tonumber("9223372036854775807"), tonumber("9223372036854775808"), tonumber("-9223372036854775808"), tonumber("1" .. string.rep("0", 30)))
+print(tonumber("0x7fffffffffffffff"), tonumber("0xffffffffffffffff"), tonumber("1.5e308"), tonumber("1e309"), tonumber("4.9e-324"), tonumber("2.2250738585072014e-308"))
+print(tonumber("123456789012345678901234567890e-10"), tonumber("0.000000000000000000000000000001"), tonumber("3.14159265358979323846264338327950288"))
+print(("hello world"):find("o w"), ("hello"):find("l+"), ("hello"):match("(h)(e)"), ("abc"):rep(3, ","))
+print(("key=val; k2=v2"):gsub("(%w+)=(%w+)", "%2=%1"))
+for k, v in string.gmatch("a=1, b=2, c=3", "(%w+)=(%w+)") do io.write(k, v, ";") end print()
+print(("  trim  "):match("^%s*(.-)%s*$"), ("x"):byte(), string.char(72, 105), ("abc"):upper(), ("ABC"):lower(), ("abc"):reverse(), ("abc"):len())
+print(("hello"):sub(2, -2), ("hello"):sub(-3), ("hello"):sub(10), ("%d"):format(3))
+print(("f(a,b)"):match("%((.-)%)"), ("[test]"):match("%[(.*)%]"), ("THE (quick) fox"):find("%((%a+)%)"))
+print(("hello"):gsub("", "-"), ("abc"):gsub("%w", "%0%0"), ("hello world"):gsub("o", {o = "0"}), ("abc"):gsub(".", function(c) return c:byte() end))
+print(string.find("a.b", ".", 1, true), string.find("abc", "b", -1), ("x"):find(""), ("aaa"):match("a-b"), ("aaab"):match("a-b"))
+print(("%bxy"):len(), ("(foo(bar))baz"):match("%b()"), ("THE (quick) fox"):gsub("%f[%a]%a+", "W"))
+print(("one two  three"):gsub("%s+", " "), ("x = 1"):match("^(%w+)%s*=%s*(%d+)$"))
+print(string.rep("ab", 3), #string.rep("a", 10000), ("abc"):byte(1, -1))
+print(table.concat({1, 2, "x", 3.5}, "-"), pcall(table.concat, {1, {}, 3}))
+local parts = {} for w in ("the quick brown fox"):gmatch("%a+") do parts[#parts + 1] = w end print(#parts, parts[4])
+print(string.pack and #string.pack("i4d", 1, 2.0), string.unpack and string.unpack("i4", string.pack("i4", 100)))
+print(utf8 and utf8.char(72, 228, 8364), utf8 and utf8.len("häll€"))
+print(#("x"):rep(100) .. "y", "a" .. 1 .. 2.5, 10 .. "")
+local long = string.rep("long string ", 10)
+local lk = {} lk[long] = 1 lk[string.rep("long string ", 10)] = (lk[long] or 0) + 1 print(lk[long])
+print(("%s %s"):format(nil, true), ("%5s"):format(true))
+print(pcall(string.rep), pcall(string.format, "%d", 3.5))
+print(string.format("%.3f", 1/3), string.format("%.0f", 0.5), string.format("%.1f", 0.05), string.format("%.2f", 1.005), string.format("%.10f", 1e-5), string.format("%f", 123456789.125), string.format("%.2f", -0.001), string.format("%.3f", 1e15), string.format("%.3f", 2^70))
+print(string.format("%g %g %g %g %g", 100000, 1000000, 1e-4, 1e-5, 123456789))
+print(2^53 + 1, 123456789012.0, 0.1 + 0.2, 1e-7, 123e-20, -1.5e-300, 5e-324, 1.7976931348623157e308)
+local nums = {} for i = 1, 200 do nums[#nums+1] = tostring(i / 7) .. tostring(i * 1.1) .. tostring(-i / 3e5) end print(table.concat(nums):len(), nums[77])
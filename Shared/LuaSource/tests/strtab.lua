@@ -0,0 +1,19 @@
+-- intern many strings, check identity across incremental resizes
+local t = {}
+local N = 300000
+for i = 1, N do t["k" .. i] = i end
+for i = 1, N, 7 do assert(t["k" .. i] == i) end
+collectgarbage(); collectgarbage()
+-- drop most strings so the table shrinks, while creating new ones
+t = nil
+collectgarbage(); collectgarbage()
+local u = {}
+for r = 1, 3 do
+  for i = 1, 50000 do u["z" .. i .. "_" .. r] = i end
+  collectgarbage("step", 100)
+end
+for r = 1, 3 do for i = 1, 50000, 11 do assert(u["z" .. i .. "_" .. r] == i) end end
+u = nil; collectgarbage(); collectgarbage()
+local p = collectgarbage("strpause")
+assert(math.type(p) == "integer" and p < 200, p)
+print("OK", p > 0)
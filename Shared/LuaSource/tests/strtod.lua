@@ -0,0 +1,92 @@
+-- fuzzer for the reading of decimal numerals: tonumber against the C
+-- library's strtod (T.strtod), bit for bit, on numerals of random
+-- doubles at 1-17 digits, random digit strings with points and
+-- exponents, values near 2^53 and 2^64, long mantissas and exponents up
+-- to +-350; and the acceptance of short random strings
+
+local N = tonumber(arg[1]) or 20000
+local strtod, cformat = T.strtod, T.cformat
+local format = string.format
+local pack, unpack = string.pack, string.unpack
+
+math.randomseed(19)
+local random = math.random
+
+local function digits (n)
+  local t = {}
+  for i = 1, n do t[i] = random(0, 9) end
+  return table.concat(t)
+end
+
+local gen = {
+  function ()  -- a random double, at 1-17 significant digits
+    local x
+    repeat
+      x = unpack("<d", pack("<I4I4", random(0, 0xffffffff),
+                                     random(0, 0xffffffff)))
+    until x == x and x ~= math.huge and x ~= -math.huge
+    return cformat(format("%%.%de", random(0, 16)), x)
+  end,
+  function ()  -- digits with a point and maybe an exponent
+    local s = digits(random(0, 12)) .. "." .. digits(random(1, 12))
+    if random(0, 1) == 1 then s = s .. "e" .. random(-40, 40) end
+    return (random(0, 1) == 1 and "-" or "") .. s
+  end,
+  function ()  -- near 2^53 and 2^64
+    local b = random(0, 1) == 1 and 2^53 or 2^64
+    return cformat("%.1f", b + random(-4096, 4096) * (b / 2^53))
+  end,
+  function ()  -- long mantissas (beyond 19 digits)
+    return "0." .. digits(random(15, 40)) .. "e" .. random(-20, 20)
+  end,
+  function ()  -- large exponents
+    return digits(random(1, 19)) .. "e" .. random(-350, 350)
+  end,
+  function ()  -- ties: 'm * 2^e' with an odd 54-bit 'm', halfway
+               -- between two doubles, written exactly
+    local m = ((1 << 52) | random(0, (1 << 52) - 1)) * 2 + 1
+    local e = random(-3, 8)
+    if e >= 0 then return format("%d.0", m << e) end
+    local d = tostring(m * ({5, 25, 125})[-e])  -- 'm * 5^-e', exact
+    return d:sub(1, e - 1) .. "." .. d:sub(e)
+  end,
+}
+
+local fails = 0
+local function fail (msg)
+  fails = fails + 1
+  if fails <= 10 then print(msg) end
+end
+
+local function same (x, y)  -- same bits (and so same sign of zero)?
+  if math.type(x) == "integer" then x = x + 0.0 end
+  return pack("<d", x) == pack("<d", y)
+end
+
+for i = 1, N do
+  local s = gen[i % #gen + 1]()
+  local want = strtod(s)
+  local got = tonumber(s)
+  if want == nil or got == nil or not same(got, want) then
+    fail(format("%s: got %s, want %s", s, tostring(got),
+                want and format("%a", want) or "nil"))
+  end
+end
+
+-- acceptance of short strings over the characters of numerals
+local chars = "0123456789.eE+- "
+for i = 1, N do
+  local t = {}
+  for j = 1, random(1, 8) do
+    local k = random(1, #chars)
+    t[j] = chars:sub(k, k)
+  end
+  local s = table.concat(t)
+  local got, want = tonumber(s), strtod(s)
+  if (got == nil) ~= (want == nil) or (got and got + 0.0 ~= want) then
+    fail(format("%q: got %s, want %s", s, tostring(got), tostring(want)))
+  end
+end
+
+assert(fails == 0, fails .. " differences")
+print("OK")
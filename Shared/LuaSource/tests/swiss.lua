@@ -0,0 +1,48 @@
+local function sum(t) local n, s = 0, 0 for k, v in pairs(t) do n = n + 1; s = s + (type(v)=="number" and v or 1) end return n, s end
+-- mixed keys
+local t = {}
+local keys = {}
+for i = 1, 5000 do
+  local k = ({i, -i, i + 0.5, "s"..i, {}, function() return i end, i % 2 == 0})[i % 7 + 1]
+  keys[#keys+1] = k; t[k] = i
+end
+print(sum(t))
+for i = 1, #keys, 3 do t[keys[i]] = nil end
+print(sum(t))
+for i = 1, #keys do local e = i; if (i - 1) % 3 == 0 then e = nil end; assert(t[keys[i]] == e or type(keys[i]) == "boolean" or type(keys[i]) == "function") end
+-- clear during traversal
+for k in pairs(t) do t[k] = nil end
+print(next(t))
+-- churn (queue)
+local q = {}
+for i = 1, 100000 do q["k"..i] = i; if i > 10 then q["k"..(i-10)] = nil end end
+print(sum(q))
+-- big integer sparse keys
+local s = {}
+for i = 1, 20000 do s[i * 1000003] = i end
+local c = 0 for i = 1, 20000 do if s[i * 1000003] == i then c = c + 1 end end
+print(c, sum(s))
+-- weak tables
+local wk = setmetatable({}, {__mode = "k"})
+local wv = setmetatable({}, {__mode = "v"})
+local keep = {}
+for i = 1, 2000 do local o = {}; wk[o] = i; wv[i] = {}; if i % 2 == 0 then keep[#keep+1] = o end end
+collectgarbage(); collectgarbage()
+print(sum(wk), next(wv))
+for k, v in pairs(wk) do wk[k] = nil end
+print(next(wk))
+-- next while keys die
+local wk2 = setmetatable({}, {__mode = "k"})
+for i = 1, 100 do wk2[{}] = i end
+local k = next(wk2)
+collectgarbage()
+print(pcall(next, wk2, k))
+-- table.insert/remove, length, lua_createtable
+local a = {}
+for i = 1, 1000 do a[i] = i end
+for i = 1, 500 do table.remove(a) end
+print(#a, select('#', table.unpack(a)))
+local h = {n = 1, m = 2, [3] = 3, [4.5] = 4}
+for i = 1, 100 do h["f"..i] = i end
+print(sum(h))
+print(pcall(next, {}, "nokey"))
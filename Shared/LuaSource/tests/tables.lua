@@ -0,0 +1,92 @@
+local function dump(t)
+  local keys = {}
+  for k in pairs(t) do keys[#keys+1] = k end
+  table.sort(keys, function(a, b)
+    if type(a) == type(b) and (type(a) == "number" or type(a) == "string") then return a < b end
+    return type(a) < type(b) end)
+  local out = {}
+  for _, k in ipairs(keys) do out[#out+1] = tostring(k) .. "=" .. tostring(t[k]) end
+  return table.concat(out, ",")
+end
+local t = {}
+for i = 1, 100 do t[i] = i * i end
+print(#t, t[50], dump({1, 2, 3, x = 1, y = 2, [10] = 10, [2.5] = "f", [true] = "b"}))
+for i = 1, 100, 3 do t[i] = nil end
+local c = 0 for k, v in pairs(t) do c = c + k end print(c)
+local u = {}
+for i = 1, 1000 do u[#u + 1] = i end
+print(#u, u[1000])
+for i = 1000, 1, -1 do u[i] = nil end
+print(#u, next(u))
+local h = {}
+for i = 1, 500 do h["k" .. i] = i end
+for i = 1, 500, 2 do h["k" .. i] = nil end
+c = 0 for k, v in pairs(h) do c = c + v end print(c)
+for i = 1, 500 do h["z" .. i] = i end
+c = 0 for k, v in pairs(h) do c = c + v end print(c)
+-- next during traversal with assignment to existing keys
+for k, v in pairs(h) do h[k] = v * 2 end
+c = 0 for k, v in pairs(h) do c = c + v end print(c)
+-- clearing during traversal
+for k in pairs(h) do h[k] = nil end
+print(next(h))
+-- float keys normalization
+local f = {}
+f[1.0] = "a"; f[2^53] = "b"; f[-0.0] = "z"
+print(f[1], f[math.tointeger(2^53)], f[0], math.type(next(f)))
+-- table library
+local s = {5, 2, 8, 1, 9, 3}
+table.sort(s) print(table.concat(s, " "))
+table.sort(s, function(a, b) return a > b end) print(table.concat(s, " "))
+table.insert(s, 1, 0) table.insert(s, 100) print(table.concat(s, " "), #s)
+print(table.remove(s), table.remove(s, 1), table.concat(s, " "))
+print(table.unpack({1, 2, 3}))
+print(select("#", table.unpack({}, 1, 3)))
+local mv = table.move({1, 2, 3, 4, 5}, 2, 4, 1) print(table.concat(mv, ","))
+print(table.pack(1, nil, 3).n)
+-- length with holes in hash part
+local lh = {}
+lh[1] = 1; lh[2] = 2; lh[3] = 3; lh[5] = 5
+print(#lh == 3 or #lh == 5)
+-- large sparse
+local sp = {}
+sp[1e6] = 1; sp[-1] = 2; sp[0] = 3
+print(dump(sp))
+-- constructors
+local ctor = {1, 2, 3, n = 3, [4] = 4, 5}
+print(dump(ctor))
+local function va(...) return {...} end
+print(#va(1, 2, 3, 4, 5, 6, 7, 8, 9, 10))
+local big = {} for i = 1, 60 do big[i] = i end
+local bb = {table.unpack(big)} print(#bb, bb[60])
+-- rawlen, rawequal
+print(rawlen({1, 2}), rawlen("abc"), rawequal(t, t), rawequal({}, {}))
+-- __len, __pairs
+local pl = setmetatable({}, {__len = function() return 42 end, __pairs = function(t) return function(_, k) if not k then return 1, "one" end end, t, nil end})
+print(#pl) for k, v in pairs(pl) do print(k, v) end
+-- ipairs with __index
+local ip = setmetatable({}, {__index = function(t, i) if i <= 3 then return i * 10 end end})
+for i, v in ipairs(ip) do io.write(i, ":", v, " ") end print()
+-- table keys of all types
+local kt = {}
+local fn = function() end
+local co = coroutine.create(fn)
+kt[fn] = 1; kt[co] = 2; kt[kt] = 3; kt[print] = 4; kt[io.stdout] = 5
+c = 0 for k, v in pairs(kt) do c = c + v end print(c)
+print(pcall(function() kt[nil] = 1 end))
+print(pcall(function() kt[0/0] = 1 end))
+print(kt[nil], kt[0/0])
+-- integer keys around array boundary
+local ab = {}
+for i = 1, 16 do ab[i] = i end
+ab[17] = 17; ab[33] = 33; ab[20] = 20
+print(#ab >= 17, ab[33], ab[20])
+local sum = 0 for k, v in pairs(ab) do sum = sum + k end print(sum)
+-- shrinking
+local shr = {}
+for i = 1, 64 do shr[i] = i end
+for i = 1, 64 do shr[i] = nil end
+shr.x = 1
+collectgarbage()
+for i = 1, 10 do shr["a" .. i] = i end
+print(dump(shr))
@@ -0,0 +1,47 @@
+local function dump(t)
+  local ks = {}
+  for k, v in pairs(t) do ks[#ks + 1] = tostring(k) .. "=" .. tostring(v) end
+  table.sort(ks) return table.concat(ks, ",")
+end
+local t = table.new(100, 10)
+print(#t, next(t))
+for i = 1, 100 do t[i] = i end
+for i = 1, 10 do t["k" .. i] = i end
+print(#t, dump(t):len())
+local c = table.clone(t)
+print(#c, dump(c) == dump(t), c ~= t)
+c[1] = "x"; print(t[1], c[1])
+table.clear(t)
+print(#t, next(t))
+for i = 1, 50 do t[i] = -i end t.z = 1
+print(#t, dump(t):len())
+-- shapes
+local r = {x = 1, y = 2, z = 3}
+local r2 = table.clone(r) r2.w = 4
+print(dump(r), dump(r2))
+local big = {a=1,b=2,c=3,d=4,e=5,f=6,g=7}
+local b2 = table.clone(big)
+print(dump(b2)) table.clear(big) print(next(big)) big.a = 9 print(dump(big))
+-- metatables
+local mt = {__index = function() return "dflt" end}
+local m = setmetatable({1, 2}, mt)
+local m2 = table.clone(m)
+print(getmetatable(m2) == mt, m2.foo, #m2)
+print(pcall(table.clone, setmetatable({}, {__metatable = false})))
+print(pcall(table.new, -1))
+print(pcall(table.clear, 3))
+-- weak and gc
+local w = setmetatable({}, {__mode = "k"})
+for i = 1, 100 do w[{}] = i end
+local w2 = table.clone(w)
+collectgarbage() collectgarbage()
+print(next(w), next(w2))
+local keep = {}
+for i = 1, 1000 do local x = {i = i} keep[#keep + 1] = x end
+local k2 = table.clone(keep)
+keep = nil collectgarbage()
+local s = 0 for i = 1, #k2 do s = s + k2[i].i end print(s)
+local e = table.clone({}) e.a = 1 print(dump(e))
+local h = {} for i = 1, 40 do h["x" .. i] = i end for i = 1, 40, 2 do h["x" .. i] = nil end
+local h2 = table.clone(h) for i = 41, 60 do h2["x" .. i] = i end
+local n = 0 for k in pairs(h2) do n = n + 1 end print(n, h2.x2, h2.x3, h2.x60)
@@ -0,0 +1,21 @@
+local dir = arg[0]:match("^(.*/)") or "./"
+local vec3 = dofile(dir .. "../../Files/lua/vec3.lua")
+local function f(n) return math.type(n) == "float" and string.format("%a", n) or tostring(n) end
+local function s(v) return string.format("%s %s %s %s", math.type(v.x), f(v.x), f(v.y), f(v.z)) end
+local a, b = vec3(1, 2, 3), vec3(0.5, -1, 4)
+local i = vec3(7, 8, 9)
+print(s(a + b), s(a - b), s(a * b), s(a / b), s(-a), s(a * 3), s(a * 0.1), s(a / 3), s(i / 2), s(i + i), s(i * 2), s(-i))
+print(getmetatable(a + b) == getmetatable(a), (a + b):len(), tostring(a + b), a + b == vec3(1.5, 1, 7))
+print(pcall(function() return 2 * a end))
+print(pcall(function() return a + 1 end))
+print(pcall(function() return a + {x = 1, y = 2, z = 3} end))
+local c = vec3(1, 2, 3); c.z = "x"
+print(pcall(function() return c + a end))
+local d = vec3(1, 2, 3); d.w = 1
+print(s(d + a))
+local acc = vec3(0, 0, 0)
+for k = 1, 10000 do acc = acc + vec3(k, k * 0.5, 1) * 0.25 - vec3(1, 1, 1) / 3 end
+print(s(acc), s(acc:normalize()), s(acc:cross(a)), s(a:lerp(b, 0.3)))
+print(s(vec3.unit_x + vec3.unit_y), vec3.is_vec3(acc))
+collectgarbage()
+print(s(a + b))
@@ -0,0 +1,70 @@
+local big = string.rep("abcdefghij", 20) .. "0123456789" .. string.rep("z", 100)
+local v = big:sub(11, 80)   -- long view
+assert(#v == 70 and v == string.rep("abcdefghij", 7))
+assert(v:sub(1, 50) == string.rep("abcdefghij", 5))  -- view of view
+assert(v:sub(3, 5) == "cde")
+assert(v:byte(1) == 97 and v:byte(-1) == 106)
+-- keys: materialized, found by equal strings
+local t = {}
+t[v] = 1
+assert(t[string.rep("abcdefghij", 7)] == 1)
+assert(t[big:sub(1, 70)] == 1)
+-- comparison
+assert(big:sub(1,60) < big:sub(2,61))
+assert(big:sub(1,60) <= big:sub(1,60))
+assert(not (big:sub(2,61) < big:sub(1,60)))
+-- numeric coercion
+local num = "   " .. string.rep("1", 45) .. "   xyz"
+local nv = num:sub(1, 51)
+assert(nv + 0 == tonumber(string.rep("1", 45)))
+assert(math.type(num:sub(1, 48) + 0) == "float")
+local n2 = (string.rep("0", 40) .. "7" .. "99999"):sub(1, 41)
+assert(n2 + 1 == 8, n2 + 1)
+-- views longer than the stack buffer of the conversion
+local pad = string.rep(" ", 300)
+local lv = (pad .. "42" .. pad .. "x"):sub(1, -2)
+assert(#lv == 602 and lv + 1 == 43 and math.type(lv // 1) == math.type("42" // 1))
+assert(lv | 1 == 43 and tonumber(lv) == 42)
+for i = lv, lv do assert(i == 42) end
+local lf = ("0." .. string.rep("0", 300) .. "5e301!"):sub(1, -2)
+assert(lf * 1 == 5.0, lf * 1)
+assert(not pcall(function () return (pad .. "4 2" .. pad .. "x"):sub(1, -2) + 1 end))
+-- frontier at end of view
+local s = string.rep("a", 50) .. "bbbb"
+local w = s:sub(1, 50)
+assert(w:find("%f[%z]") == 51)
+assert(w:match("a$"))
+-- captures/gmatch/gsub
+local line = string.rep("x", 45) .. "," .. string.rep("y", 50) .. "," .. "short"
+local fields = {}
+for f in line:gmatch("([^,]+)") do fields[#fields+1] = f end
+assert(#fields == 3 and #fields[1] == 45 and fields[3] == "short")
+local a, b = line:match("^([^,]*),([^,]*)")
+assert(#a == 45 and b == string.rep("y", 50))
+local m = {[string.rep("y", 50)] = "Y"}
+assert(line:gsub("[^,]+", m) == string.rep("x", 45) .. ",Y,short")
+assert(string.format("%s|", fields[2]) == string.rep("y", 50) .. "|")
+assert(fields[1] .. "!" == string.rep("x", 45) .. "!")
+assert(tostring(fields[1]) == string.rep("x", 45))
+local sb = string.buffer(); sb:put(fields[1]); assert(sb:tostring() == fields[1])
+-- parent retention
+local function mem() collectgarbage(); collectgarbage(); return collectgarbage("count") end
+local base = mem()
+local vv
+do
+  local p = string.rep("q", 1000000) .. tostring({})
+  vv = p:sub(10, 900)
+end
+assert(mem() - base > 900)  -- parent alive
+assert(#vv == 891 and vv:sub(1, 3) == "qqq")
+vv = nil
+assert(mem() - base < 100)
+local k = {}
+do
+  local p = string.rep("r", 1000000) .. tostring({})
+  k[p:sub(5, 100)] = true
+end
+assert(mem() - base < 100 and k[string.rep("r", 96)])  -- key is a copy
+assert(load("return " .. string.rep(" ", 60):sub(1, 45) .. "1")() == 1)
+io.write(fields[2]:sub(1, 0), "")
+print("OK")
@@ -0,0 +1,93 @@
+local N = 1003
+local function mk(kind, f) local a = array.new(kind, N) for i = 1, N do a[i] = f(i) end return a end
+local src = mk("float64", function(i) return (i - 500) * 0.37 end)
+local pos = mk("float64", function(i) return i * 1.7 end)
+local function check(name, dst, f)
+  for i = 1, N do
+    local e = f(i)
+    if not (dst[i] == e or (dst[i] ~= dst[i] and e ~= e)) then
+      error(string.format("%s: %d: %.17g ~= %.17g", name, i, dst[i], e))
+    end
+  end
+end
+local d = array.new("float64", N)
+math.vsin(d, src); check("sin", d, function(i) return math.sin(src[i]) end)
+math.vcos(d, src); check("cos", d, function(i) return math.cos(src[i]) end)
+math.vsqrt(d, pos); check("sqrt", d, function(i) return math.sqrt(pos[i]) end)
+math.vfloor(d, src); check("floor", d, function(i) return math.floor(src[i]) + 0.0 end)
+math.vabs(d, src); check("abs", d, function(i) return math.abs(src[i]) end)
+math.vmin(d, src, 3); check("min", d, function(i) return src[i] < 3 and src[i] or 3.0 end)
+math.vmax(d, src, pos); check("max", d, function(i) return math.max(src[i], pos[i]) end)
+math.vclamp(d, src, -10, 10); check("clamp", d, function(i) return math.min(math.max(src[i], -10), 10) + 0.0 end)
+math.vlerp(d, src, pos, 0.25); check("lerp", d, function(i) return src[i] + (pos[i] - src[i]) * 0.25 end)
+-- fma: compare with exact products where possible
+local ia = mk("int32", function(i) return i end)
+math.vfma(d, ia, 3, 0.5); check("fma", d, function(i) return i * 3 + 0.5 end)
+local y = mk("float64", function(i) return i end)
+assert(math.vaxpy(2, src, y) == y); check("axpy", y, function(i) return 2 * src[i] + i end)
+-- float32 destination, in place
+local f = mk("float32", function(i) return i * 0.5 end)
+math.vfloor(f, f); check("f32", f, function(i) return math.floor(i * 0.5) + 0.0 end)
+local u = mk("uint8", function(i) return i % 256 end)
+math.vmax(d, u, 100); check("u8", d, function(i) return math.max(i % 256, 100) + 0.0 end)
+-- NaNs and signed zeros give what math.min and math.max give, in the
+-- vector and in the scalar code (sizes up to 9 cover both)
+local special = {0/0, -(0/0), 0.0, -0.0, 1, -1, math.huge, -math.huge}
+local function same (x, y)
+  return (x ~= x and y ~= y) or (x == y and 1/x == 1/y)
+end
+for n = 1, 9 do
+  local a, b, c = array.new("float64", n), array.new("float64", n), array.new("float64", n)
+  local r = array.new("float64", n)
+  for _, x in ipairs(special) do
+    for _, y in ipairs(special) do
+      a:fill(x); b:fill(y)
+      math.vmin(r, a, b)
+      for i = 1, n do assert(same(r[i], math.min(x, y)), "vmin") end
+      math.vmax(r, a, b)
+      for i = 1, n do assert(same(r[i], math.max(x, y)), "vmax") end
+      math.vmin(r, x, b)
+      assert(same(r[n], math.min(x, y)))
+      for _, z in ipairs(special) do
+        c:fill(z)
+        math.vclamp(r, a, b, c)
+        for i = 1, n do
+          assert(same(r[i], math.min(math.max(x, y), z)), "vclamp")
+        end
+      end
+    end
+  end
+end
+-- math.min(0/0, 1) is nan
+local r = array.new("float64", 2)
+math.vmin(r, 0/0, array.new("float64", {1, 2}))
+assert(r[1] ~= r[1] and r[2] ~= r[2])
+-- overlapping slices of one array: as if all operands were read first
+local function seq(kind, n)
+  local a = array.new(kind, n) for i = 1, n do a[i] = i end return a
+end
+for _, kind in ipairs{"float64", "float32"} do
+  for _, n in ipairs{10, 1000} do
+    local a = seq(kind, n)  -- destination after the operand
+    math.vmax(a:slice(4), a:slice(1, -4), 0)
+    for i = 1, n do assert(a[i] == (i <= 3 and i or i - 3)) end
+    a = seq(kind, n)  -- destination before the operands
+    math.vfma(a:slice(1, -3), a:slice(3), 1, a:slice(2, -2))
+    for i = 1, n - 2 do assert(a[i] == 2 * i + 3) end
+    assert(a[n - 1] == n - 1 and a[n] == n)
+    a = seq(kind, n)  -- in place, plus an overlapping operand
+    math.vlerp(a:slice(2), a:slice(2), a:slice(1, -2), 0.5)
+    for i = 2, n do assert(a[i] == i - 0.5) end
+  end
+end
+local o = seq("float64", 10)  -- operands on both sides of the destination
+assert(not pcall(math.vmin, o:slice(2, 9), o:slice(1, 8), o:slice(3, 10)))
+print(select(2, pcall(math.vmin, o:slice(2, 9), o:slice(1, 8), o:slice(3, 10))))
+-- errors
+assert(not pcall(math.vsin, array.new("int32", N), src))
+assert(not pcall(math.vsin, d, array.new("float64", 3)))
+assert(not pcall(math.vsin, d, "x"))
+assert(not pcall(math.vsin, {}, src))
+print(select(2, pcall(math.vsin, d, array.new("float64", 3))))
+math.vsin(array.new("float64", 0), array.new("float32", 0))
+print("OK")